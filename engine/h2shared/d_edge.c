@@ -234,24 +234,28 @@ static const int SiegeFlatSkyFadeTable[25] =
 #endif	/* H2W */
 
 
+// how D_SetupSurface wants the spans of a surface drawn
+#define	DS_SKIP		0
+#define	DS_SOLID	1	// flat color
+#define	DS_SKY		2
+#define	DS_TURB		3
+#define	DS_SPANS	4	// textured from the surface cache
+#define	DS_SOLIDT	5	// translucent flat color
+#define	DS_SPANST	6	// translucent textured
+#define	DS_ZSPANS	8	// flag: write the z buffer, too
+
+static vec3_t	world_transformed_modelorg;
+static surfcache_t	*d_setupcache;	// cache entry the last textured setup used
+
 /*
 ==============
-D_DrawSurfaces
+D_BeginSurfaces
 ==============
 */
-void D_DrawSurfaces (qboolean Translucent)
+static void D_BeginSurfaces (void)
 {
-	surf_t			*s;
-	msurface_t		*pface;
-	surfcache_t		*pcurrentcache;
-	vec3_t			world_transformed_modelorg;
-	vec3_t			local_modelorg;
-	int			count;
-
 	// Restore the settings
 	currententity = &r_worldentity;
-//	VectorCopy (world_transformed_modelorg,
-//				transformed_modelorg);
 	VectorCopy (base_vpn, vpn);
 	VectorCopy (base_vup, vup);
 	VectorCopy (base_vright, vright);
@@ -260,338 +264,440 @@ void D_DrawSurfaces (qboolean Translucent)
 
 	TransformVector (modelorg, transformed_modelorg);
 	VectorCopy (transformed_modelorg, world_transformed_modelorg);
+}
+
+/*
+==============
+D_SetupSurface
+
+Sets the d_ gradients and the texture source up for s, and returns
+how its spans are to be drawn, with the flat color in *color.
+==============
+*/
+static int D_SetupSurface (surf_t *s, qboolean Translucent, int *color)
+{
+	msurface_t		*pface;
+	surfcache_t		*pcurrentcache;
+	vec3_t			local_modelorg;
+	int			draw, light;
+	byte			*pixels;
+
+	d_setupcache = NULL;
+
+	d_zistepu = s->d_zistepu;
+	d_zistepv = s->d_zistepv;
+	d_ziorigin = s->d_ziorigin;
 
 // TODO: could preset a lot of this at mode set time
 	if (r_drawflat.integer)
 	{
-		if (Translucent)
-			return;
+		*color = (intptr_t)s->data & 0xFF;
+		return DS_SOLID | DS_ZSPANS;
+	}
 
-		for (s = &surfaces[1] ; s < surface_p ; s++)
-		{
-			if (!s->spans)
-				continue;
+	if (!Translucent)
+	{
+		r_drawnpolycount++;
 
-			d_zistepu = s->d_zistepu;
-			d_zistepv = s->d_zistepv;
-			d_ziorigin = s->d_ziorigin;
+		if (s->flags & SURF_TRANSLUCENT)
+			return DS_SKIP;
+	}
+	else if (!(s->flags & SURF_TRANSLUCENT))
+		return DS_SKIP;
 
-			D_DrawSolidSurface (s, (intptr_t)s->data & 0xFF);
-			D_DrawZSpans (s->spans);
-		}
+//	if (!strncmp(pface->texinfo->texture->name,"*BLACK",6))
+	if (s->flags & SURF_DRAWBLACK)	// black vis-breaker, no turb
+	{
+#	if defined (H2W)
+		if (cl_siege)
+			*color = SiegeFlatSkyFadeTable[(int)floor(d_lightstylevalue[0]/22)];
+		else
+#	endif	/* H2W */
+			*color = 0;
+		return DS_SOLID | DS_ZSPANS;
 	}
-	else
+
+	if (!Translucent)
 	{
-		if (!Translucent)
+		if (s->flags & SURF_DRAWSKY)
 		{
-			for (s = &surfaces[1] ; s < surface_p ; s++)
+			if (!r_skymade)
 			{
-				if (!s->spans)
-					continue;
-
-				r_drawnpolycount++;
+				R_MakeSky ();
+			}
 
-				if (s->flags & SURF_TRANSLUCENT)
-					continue;
+			return DS_SKY | DS_ZSPANS;
+		}
+		if (s->flags & SURF_DRAWBACKGROUND)
+		{
+		// set up a gradient for the background surface that places it
+		// effectively at infinity distance from the viewpoint
+			d_zistepu = 0;
+			d_zistepv = 0;
+			d_ziorigin = -0.9;
+
+			*color = r_clearcolor.integer & 0xFF;
+			return DS_SOLID | DS_ZSPANS;
+		}
+	}
 
-				d_zistepu = s->d_zistepu;
-				d_zistepv = s->d_zistepv;
-				d_ziorigin = s->d_ziorigin;
+	if (s->insubmodel)
+	{
+	// FIXME: we don't want to do all this for every polygon!
+	// TODO: store once at start of frame
+		currententity = s->entity;	//FIXME: make this passed in to
+									// R_RotateBmodel ()
+		VectorSubtract (r_origin, currententity->origin, local_modelorg);
+		TransformVector (local_modelorg, transformed_modelorg);
+
+		R_RotateBmodel ();	// FIXME: don't mess with the frustum,
+							// make entity passed in
+	}
 
-			//	if (!strncmp(pface->texinfo->texture->name,"*BLACK",6))
-				if (s->flags & SURF_DRAWBLACK)	// black vis-breaker, no turb
-				{
-#	if defined (H2W)
-					if (cl_siege)
-						D_DrawSolidSurface (s, SiegeFlatSkyFadeTable[(int)floor(d_lightstylevalue[0]/22)]);
-					else
-#	endif	/* H2W */
-						D_DrawSolidSurface (s, 0);
-					D_DrawZSpans (s->spans);
-					continue;
-				}
-				if (s->flags & SURF_DRAWSKY)
-				{
-					if (!r_skymade)
-					{
-						R_MakeSky ();
-					}
-
-					D_DrawSkyScans8 (s->spans);
-					D_DrawZSpans (s->spans);
-				}
-				else if (s->flags & SURF_DRAWBACKGROUND)
-				{
-				// set up a gradient for the background surface that places it
-				// effectively at infinity distance from the viewpoint
-					d_zistepu = 0;
-					d_zistepv = 0;
-					d_ziorigin = -0.9;
-
-					D_DrawSolidSurface (s, r_clearcolor.integer & 0xFF);
-					D_DrawZSpans (s->spans);
-				}
-				else if (s->flags & SURF_DRAWTURB)
-				{
-					pface = (msurface_t *) s->data;
-					miplevel = 0;
-					cacheblock = (pixel_t *)
-							((byte *)pface->texinfo->texture +
-							pface->texinfo->texture->offsets[0]);
-					cachewidth = 64;
-
-					if (s->insubmodel)
-					{
-					// FIXME: we don't want to do all this for every polygon!
-					// TODO: store once at start of frame
-						currententity = s->entity;	//FIXME: make this passed in to
-													// R_RotateBmodel ()
-						VectorSubtract (r_origin, currententity->origin,
-								local_modelorg);
-						TransformVector (local_modelorg, transformed_modelorg);
-
-						R_RotateBmodel ();	// FIXME: don't mess with the frustum,
-											// make entity passed in
-					}
-
-					D_CalcGradients (pface);
-					Turbulent8 (s);
-					D_DrawZSpans (s->spans);
-
-					if (s->insubmodel)
-					{
-					//
-					// restore the old drawing state
-					// FIXME: we don't want to do this every time!
-					// TODO: speed up
-					//
-						currententity = &r_worldentity;
-						VectorCopy (world_transformed_modelorg,
-									transformed_modelorg);
-						VectorCopy (base_vpn, vpn);
-						VectorCopy (base_vup, vup);
-						VectorCopy (base_vright, vright);
-						VectorCopy (base_modelorg, modelorg);
-						R_TransformFrustum ();
-					}
-				}
-				else
-				{
-					if (s->insubmodel)
-					{
-					// FIXME: we don't want to do all this for every polygon!
-					// TODO: store once at start of frame
-						currententity = s->entity;	//FIXME: make this passed in to
-													// R_RotateBmodel ()
-						VectorSubtract (r_origin, currententity->origin, local_modelorg);
-						TransformVector (local_modelorg, transformed_modelorg);
-
-						R_RotateBmodel ();	// FIXME: don't mess with the frustum,
-											// make entity passed in
-					}
-
-					pface = (msurface_t *) s->data;
-					if ((s->flags & SURF_DRAWSOLID) &&
-						((s->entity->drawflags & MLS_ABSLIGHT) == MLS_ABSLIGHT || !pface->samples))
-					{
-						byte *pixels = ((byte *)pface->texinfo->texture +
-							pface->texinfo->texture->offsets[0]);
-						int light;
-						if (!r_fullbright.integer)
-						{
-							if ((s->entity->drawflags & MLS_ABSLIGHT) == MLS_ABSLIGHT)
-								light = s->entity->abslight;
-							else
-								light = r_refdef.ambientlight;
-						}
-						else
-							light = 255;
-						D_DrawSolidSurface (s, ((unsigned char *)vid.colormap)[(((255-light)<<VID_CBITS) & 0xFF00) + pixels[0]]);
-					}
-					else
-					{
-						miplevel = D_MipLevelForScale (s->nearzi * scale_for_mip
-										* pface->texinfo->mipadjust);
-
-					// FIXME: make this passed in to D_CacheSurface
-						pcurrentcache = D_CacheSurface (pface, miplevel);
-
-						cacheblock = (pixel_t *)pcurrentcache->data;
-						cachewidth = pcurrentcache->width;
-
-						D_CalcGradients (pface);
-
-						(*d_drawspans) (s->spans);
-					}
-
-					D_DrawZSpans (s->spans);
-
-					if (s->insubmodel)
-					{
-					//
-					// restore the old drawing state
-					// FIXME: we don't want to do this every time!
-					// TODO: speed up
-					//
-						currententity = &r_worldentity;
-						VectorCopy (world_transformed_modelorg,
-									transformed_modelorg);
-						VectorCopy (base_vpn, vpn);
-						VectorCopy (base_vup, vup);
-						VectorCopy (base_vright, vright);
-						VectorCopy (base_modelorg, modelorg);
-						R_TransformFrustum ();
-					}
-				}
-			}
+	pface = (msurface_t *) s->data;
+	if (s->flags & SURF_DRAWTURB)
+	{
+		miplevel = 0;
+		cacheblock = (pixel_t *)
+				((byte *)pface->texinfo->texture +
+				pface->texinfo->texture->offsets[0]);
+		cachewidth = 64;
+
+		D_CalcGradients (pface);
+		draw = Translucent ? DS_TURB : DS_TURB | DS_ZSPANS;
+	}
+	else if ((s->flags & SURF_DRAWSOLID) &&
+		((s->entity->drawflags & MLS_ABSLIGHT) == MLS_ABSLIGHT || !pface->samples))
+	{
+		pixels = ((byte *)pface->texinfo->texture +
+				pface->texinfo->texture->offsets[0]);
+		if (!r_fullbright.integer)
+		{
+			if ((s->entity->drawflags & MLS_ABSLIGHT) == MLS_ABSLIGHT)
+				light = s->entity->abslight;
+			else
+				light = r_refdef.ambientlight;
 		}
 		else
-		{
-			count = 0;
+			light = 255;
+		*color = ((unsigned char *)vid.colormap)[(((255-light)<<VID_CBITS) & 0xFF00) + pixels[0]];
+		draw = Translucent ? DS_SOLIDT : DS_SOLID | DS_ZSPANS;
+	}
+	else
+	{
+		miplevel = D_MipLevelForScale (s->nearzi * scale_for_mip
+						* pface->texinfo->mipadjust);
 
-			for (s = &surfaces[1] ; s < surface_p ; s++)
-			{
-				if (!s->spans || !(s->flags & SURF_TRANSLUCENT))
-					continue;
+	// FIXME: make this passed in to D_CacheSurface
+		pcurrentcache = D_CacheSurface (pface, miplevel);
 
-				count++;
+		cacheblock = (pixel_t *)pcurrentcache->data;
+		cachewidth = pcurrentcache->width;
+		d_setupcache = pcurrentcache;
 
-				d_zistepu = s->d_zistepu;
-				d_zistepv = s->d_zistepv;
-				d_ziorigin = s->d_ziorigin;
+		D_CalcGradients (pface);
+		draw = Translucent ? DS_SPANST : DS_SPANS | DS_ZSPANS;
+	}
 
-			//	if (!strncmp(pface->texinfo->texture->name, "*BLACK", 6))
-				if (s->flags & SURF_DRAWBLACK)	// black vis-breaker, no turb
-				{
-#	if defined (H2W)
-					if (cl_siege)
-						D_DrawSolidSurface (s, SiegeFlatSkyFadeTable[(int)floor(d_lightstylevalue[0]/22)]);
-					else
-#	endif	/* H2W */
-						D_DrawSolidSurface (s, 0);
-					D_DrawZSpans (s->spans);
-					continue;
-				}
-				if (s->flags & SURF_DRAWTURB)
-				{
-					pface = (msurface_t *) s->data;
-					miplevel = 0;
-					cacheblock = (pixel_t *)
-							((byte *)pface->texinfo->texture +
-							pface->texinfo->texture->offsets[0]);
-					cachewidth = 64;
-
-					if (s->insubmodel)
-					{
-					// FIXME: we don't want to do all this for every polygon!
-					// TODO: store once at start of frame
-						currententity = s->entity;	//FIXME: make this passed in to
-													// R_RotateBmodel ()
-						VectorSubtract (r_origin, currententity->origin,
-								local_modelorg);
-						TransformVector (local_modelorg, transformed_modelorg);
-
-						R_RotateBmodel ();	// FIXME: don't mess with the frustum,
-											// make entity passed in
-					}
-
-					D_CalcGradients (pface);
-					Turbulent8 (s);
-				//	D_DrawZSpans (s->spans);
-
-					if (s->insubmodel)
-					{
-					//
-					// restore the old drawing state
-					// FIXME: we don't want to do this every time!
-					// TODO: speed up
-					//
-						currententity = &r_worldentity;
-						VectorCopy (world_transformed_modelorg,
-									transformed_modelorg);
-						VectorCopy (base_vpn, vpn);
-						VectorCopy (base_vup, vup);
-						VectorCopy (base_vright, vright);
-						VectorCopy (base_modelorg, modelorg);
-						R_TransformFrustum ();
-					}
-				}
-				else
-				{
-					if (s->insubmodel)
-					{
-					// FIXME: we don't want to do all this for every polygon!
-					// TODO: store once at start of frame
-						currententity = s->entity;	//FIXME: make this passed in to
-													// R_RotateBmodel ()
-						VectorSubtract (r_origin, currententity->origin, local_modelorg);
-						TransformVector (local_modelorg, transformed_modelorg);
-
-						R_RotateBmodel ();	// FIXME: don't mess with the frustum,
-											// make entity passed in
-					}
-
-					pface = (msurface_t *) s->data;
-					if ((s->flags & SURF_DRAWSOLID) &&
-						((s->entity->drawflags & MLS_ABSLIGHT) == MLS_ABSLIGHT || !pface->samples))
-					{
-						byte *pixels = ((byte *)pface->texinfo->texture +
-							pface->texinfo->texture->offsets[0]);
-						int light;
-						if (!r_fullbright.integer)
-						{
-							if ((s->entity->drawflags & MLS_ABSLIGHT) == MLS_ABSLIGHT)
-								light = s->entity->abslight;
-							else
-								light = r_refdef.ambientlight;
-						}
-						else
-							light = 255;
-						D_DrawSolidSurfaceT (s, ((unsigned char *)vid.colormap)[(((255-light)<<VID_CBITS) & 0xFF00) + pixels[0]]);
-					}
-					else
-					{
-						miplevel = D_MipLevelForScale (s->nearzi * scale_for_mip
-										* pface->texinfo->mipadjust);
-
-					// FIXME: make this passed in to D_CacheSurface
-						pcurrentcache = D_CacheSurface (pface, miplevel);
-
-						cacheblock = (pixel_t *)pcurrentcache->data;
-						cachewidth = pcurrentcache->width;
-
-						D_CalcGradients (pface);
-
-					//	(*d_drawspans) (s->spans);
+	if (s->insubmodel)
+	{
+	//
+	// restore the old drawing state
+	// FIXME: we don't want to do this every time!
+	// TODO: speed up
+	//
+		currententity = &r_worldentity;
+		VectorCopy (world_transformed_modelorg,
+					transformed_modelorg);
+		VectorCopy (base_vpn, vpn);
+		VectorCopy (base_vup, vup);
+		VectorCopy (base_vright, vright);
+		VectorCopy (base_modelorg, modelorg);
+		R_TransformFrustum ();
+	}
+
+	return draw;
+}
+
+/*
+==============
+D_DrawSurface
+
+Draws the spans of s the way D_SetupSurface said to
+==============
+*/
+static void D_DrawSurface (surf_t *s, int draw, int color)
+{
+	switch (draw & ~DS_ZSPANS)
+	{
+	case DS_SOLID:
+		D_DrawSolidSurface (s, color);
+		break;
+	case DS_SKY:
+		D_DrawSkyScans8 (s->spans);
+		break;
+	case DS_TURB:
+		Turbulent8 (s);
+		break;
+	case DS_SPANS:
+		(*d_drawspans) (s->spans);
+		break;
+	case DS_SOLIDT:
+		D_DrawSolidSurfaceT (s, color);
+		break;
+	case DS_SPANST:
 #if id386 || id68k
-						D_DrawSpans16T(s->spans);
+		D_DrawSpans16T (s->spans);
 #else
-						D_DrawSpans8T(s->spans);
+		D_DrawSpans8T (s->spans);
 #endif
-					}
-
-				//	D_DrawZSpans (s->spans);
-
-					if (s->insubmodel)
-					{
-					//
-					// restore the old drawing state
-					// FIXME: we don't want to do this every time!
-					// TODO: speed up
-					//
-						currententity = &r_worldentity;
-						VectorCopy (world_transformed_modelorg,
-									transformed_modelorg);
-						VectorCopy (base_vpn, vpn);
-						VectorCopy (base_vup, vup);
-						VectorCopy (base_vright, vright);
-						VectorCopy (base_modelorg, modelorg);
-						R_TransformFrustum ();
-					}
-				}
-			}
-		//	Con_Printf("   Surf is %d\n", count);
+		break;
+	}
+
+	if (draw & DS_ZSPANS)
+		D_DrawZSpans (s->spans);
+}
+
+/*
+==============
+D_DrawSurfaces
+==============
+*/
+void D_DrawSurfaces (qboolean Translucent)
+{
+	surf_t			*s;
+	int			draw, color;
+
+	D_BeginSurfaces ();
+
+	if (r_drawflat.integer && Translucent)
+		return;
+
+	for (s = &surfaces[1] ; s < surface_p ; s++)
+	{
+		if (!s->spans)
+			continue;
+
+		draw = D_SetupSurface (s, Translucent, &color);
+		if (draw != DS_SKIP)
+			D_DrawSurface (s, draw, color);
+	}
+}
+
+
+#if R_BANDTHREADS
+/*
+===============================================================================
+
+BANDED DRAWING
+
+R_ScanEdges hands over one copy of the surfaces per band, each holding the
+spans of its lines.  Every surface with spans is set up once on the main
+thread, and the state the setup leaves is recorded.  The cache entries the
+setups need built are queued and built in parallel afterwards; then the
+bands load the recorded state into their own d_ variables and draw in
+parallel.
+
+If a cache entry allocated during the setups reused memory that an earlier
+setup of the same pass already handed out, that surface would be drawn from
+the wrong texels, so the queued builds are dropped and the pass falls back
+to drawing the bands one at a time with a setup per band, the same as the
+serial span list flushes.
+
+===============================================================================
+*/
+
+typedef struct
+{
+	int		draw, color;
+	float		sdivzstepu, tdivzstepu, zistepu;
+	float		sdivzstepv, tdivzstepv, zistepv;
+	float		sdivzorigin, tdivzorigin, ziorigin;
+	fixed16_t	sadjust, tadjust, bbextents, bbextentt;
+	pixel_t		*cacheblock;
+	int		cachewidth;
+	byte		*cachestart, *cacheend;	// surface cache memory used
+	qboolean	cachebuilt;		// ..and was written by this setup
+} dsurfstate_t;
+
+static dsurfstate_t	*d_surfstates;
+static int		d_maxsurfstates;
+static surf_t		**d_bandsurfs;
+static int		d_bandnumsurfs;
+
+/*
+==============
+D_SaveSurfaceState
+==============
+*/
+static void D_SaveSurfaceState (dsurfstate_t *st)
+{
+	st->sdivzstepu = d_sdivzstepu;
+	st->tdivzstepu = d_tdivzstepu;
+	st->zistepu = d_zistepu;
+	st->sdivzstepv = d_sdivzstepv;
+	st->tdivzstepv = d_tdivzstepv;
+	st->zistepv = d_zistepv;
+	st->sdivzorigin = d_sdivzorigin;
+	st->tdivzorigin = d_tdivzorigin;
+	st->ziorigin = d_ziorigin;
+	st->sadjust = sadjust;
+	st->tadjust = tadjust;
+	st->bbextents = bbextents;
+	st->bbextentt = bbextentt;
+	st->cacheblock = cacheblock;
+	st->cachewidth = cachewidth;
+}
+
+/*
+==============
+D_LoadSurfaceState
+==============
+*/
+static void D_LoadSurfaceState (const dsurfstate_t *st)
+{
+	d_sdivzstepu = st->sdivzstepu;
+	d_tdivzstepu = st->tdivzstepu;
+	d_zistepu = st->zistepu;
+	d_sdivzstepv = st->sdivzstepv;
+	d_tdivzstepv = st->tdivzstepv;
+	d_zistepv = st->zistepv;
+	d_sdivzorigin = st->sdivzorigin;
+	d_tdivzorigin = st->tdivzorigin;
+	d_ziorigin = st->ziorigin;
+	sadjust = st->sadjust;
+	tadjust = st->tadjust;
+	bbextents = st->bbextents;
+	bbextentt = st->bbextentt;
+	cacheblock = st->cacheblock;
+	cachewidth = st->cachewidth;
+}
+
+/*
+==============
+D_BandCachesValid
+
+False if a cache entry was built over memory an earlier setup of this
+pass is using.
+==============
+*/
+static qboolean D_BandCachesValid (int numsurfs)
+{
+	dsurfstate_t	*st, *prev;
+
+	for (st = &d_surfstates[1] ; st < &d_surfstates[numsurfs] ; st++)
+	{
+		if (!st->cachebuilt)
+			continue;
+
+		for (prev = &d_surfstates[1] ; prev < st ; prev++)
+		{
+			if (prev->cachestart && prev->cachestart < st->cacheend &&
+					st->cachestart < prev->cacheend)
+				return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+==============
+D_DrawBandJob
+==============
+*/
+static void D_DrawBandJob (void *data, int job)
+{
+	surf_t		*surfs = d_bandsurfs[job];
+	dsurfstate_t	*st;
+	int		i;
+
+	for (i = 1, st = &d_surfstates[1] ; i < d_bandnumsurfs ; i++, st++)
+	{
+		if (!surfs[i].spans || st->draw == DS_SKIP)
+			continue;
+
+		D_LoadSurfaceState (st);
+		D_DrawSurface (&surfs[i], st->draw, st->color);
+	}
+}
+
+/*
+==============
+D_DrawSurfaceBands
+==============
+*/
+void D_DrawSurfaceBands (surf_t **bands, int numbands, int numsurfs, qboolean Translucent)
+{
+	surf_t		*oldsurfaces, *oldsurface_p;
+	dsurfstate_t	*st;
+	int		i, b, built;
+
+	if (numsurfs > d_maxsurfstates)
+	{
+		free (d_surfstates);
+		d_maxsurfstates = numsurfs + 256;
+		d_surfstates = (dsurfstate_t *) malloc (d_maxsurfstates * sizeof(dsurfstate_t));
+		if (!d_surfstates)
+			Sys_Error ("%s: out of memory", __thisfunc__);
+	}
+
+	D_BeginSurfaces ();
+
+	if (r_drawflat.integer && Translucent)
+		return;
+
+	D_DeferCacheBuilds (true);
+
+	for (i = 1, st = &d_surfstates[1] ; i < numsurfs ; i++, st++)
+	{
+		st->draw = DS_SKIP;
+		st->cachestart = st->cacheend = NULL;
+		st->cachebuilt = false;
+
+		for (b = 0 ; b < numbands ; b++)
+		{
+			if (bands[b][i].spans)
+				break;
+		}
+		if (b == numbands)
+			continue;
+
+		built = c_surf;
+		st->draw = D_SetupSurface (&bands[b][i], Translucent, &st->color);
+		D_SaveSurfaceState (st);
+		if (d_setupcache)
+		{
+			st->cachestart = (byte *)d_setupcache;
+			st->cacheend = (byte *)d_setupcache + d_setupcache->size;
+			st->cachebuilt = (c_surf != built);
+		}
+	}
+
+	D_DeferCacheBuilds (false);
+
+	if (!D_BandCachesValid (numsurfs))
+	{
+		D_CancelDeferredCaches ();
+		oldsurfaces = surfaces;
+		oldsurface_p = surface_p;
+		for (b = 0 ; b < numbands ; b++)
+		{
+			surfaces = bands[b];
+			surface_p = &bands[b][numsurfs];
+			D_DrawSurfaces (Translucent);
 		}
+		surfaces = oldsurfaces;
+		surface_p = oldsurface_p;
+		return;
 	}
+
+	D_BuildDeferredCaches ();
+
+	d_bandsurfs = bands;
+	d_bandnumsurfs = numsurfs;
+	Thread_RunJobs (D_DrawBandJob, NULL, numbands);
 }
 
+#endif	/* R_BANDTHREADS */
+
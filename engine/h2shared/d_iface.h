@@ -235,10 +235,10 @@ typedef struct
 	int		surfmip;	// mipmapped ratio of surface texels / world pixels
 	int		surfwidth;	// in mipmapped texels
 	int		surfheight;	// in mipmapped texels
+	int		drawflags;	// of the entity the surface belongs to,
+	int		abslight;	//  for surfaces built off the main thread
 } drawsurf_t;
 
-extern drawsurf_t	r_drawsurf;
-
 void R_DrawSurface (void);
 void R_GenTile (msurface_t *psurf, void *pdest);
 
@@ -95,12 +95,12 @@ extern surfcache_t	*d_initial_rover;
 
 ASM_LINKAGE_BEGIN
 
-extern float	d_sdivzstepu, d_tdivzstepu, d_zistepu;
-extern float	d_sdivzstepv, d_tdivzstepv, d_zistepv;
-extern float	d_sdivzorigin, d_tdivzorigin, d_ziorigin;
+extern R_TLS float	d_sdivzstepu, d_tdivzstepu, d_zistepu;
+extern R_TLS float	d_sdivzstepv, d_tdivzstepv, d_zistepv;
+extern R_TLS float	d_sdivzorigin, d_tdivzorigin, d_ziorigin;
 
-extern fixed16_t	sadjust, tadjust;
-extern fixed16_t	bbextents, bbextentt;
+extern R_TLS fixed16_t	sadjust, tadjust;
+extern R_TLS fixed16_t	bbextents, bbextentt;
 
 ASM_LINKAGE_END
 
@@ -187,11 +187,25 @@ ASM_LINKAGE_END
 
 void Turbulent8 (surf_t *s);
 
+#if R_BANDTHREADS
+void D_DrawSurfaceBands (surf_t **bands, int numbands, int numsurfs, qboolean Translucent);
+// draws the spans each copy of the surfaces in bands[] holds, on workers
+#endif
+
 void D_DrawSkyScans8 (espan_t *pspan);
 void D_DrawSkyScans16 (espan_t *pspan);
 
 surfcache_t *D_CacheSurface (msurface_t *surface, int miplevel);
 
+#if R_BANDTHREADS
+void D_DeferCacheBuilds (qboolean defer);
+// while set, D_CacheSurface allocates the entries it has to build, but
+// leaves building them to D_BuildDeferredCaches
+void D_BuildDeferredCaches (void);
+void D_CancelDeferredCaches (void);
+// makes the next D_CacheSurface of each deferred entry build it itself
+#endif
+
 void D_Patch (void);
 
 
@@ -212,8 +226,8 @@ extern short	*zspantable[MAXHEIGHT];
 
 #define	SCAN_SIZE		2048
 
-extern byte	scanList[SCAN_SIZE];
-extern int	ZScanCount;
+extern R_TLS byte	scanList[SCAN_SIZE];
+extern R_TLS int	ZScanCount;
 
 extern int	d_aflatcolor;
 
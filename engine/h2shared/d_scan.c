@@ -26,12 +26,12 @@
 #include "d_local.h"
 
 ASM_LINKAGE_BEGIN
-unsigned char	*r_turb_pbase, *r_turb_pdest;
-fixed16_t		r_turb_s, r_turb_t, r_turb_sstep, r_turb_tstep;
-int				*r_turb_turb;
-int				r_turb_spancount;
-byte			scanList[SCAN_SIZE];
-int				ZScanCount;
+R_TLS unsigned char	*r_turb_pbase, *r_turb_pdest;
+R_TLS fixed16_t		r_turb_s, r_turb_t, r_turb_sstep, r_turb_tstep;
+R_TLS int		*r_turb_turb;
+R_TLS int		r_turb_spancount;
+R_TLS byte		scanList[SCAN_SIZE];
+R_TLS int		ZScanCount;
 ASM_LINKAGE_END
 
 
@@ -29,8 +29,19 @@ qboolean	r_cache_thrash = false;	// set if surface cache is thrashing
 static int				sc_size;
 surfcache_t			*sc_rover, *sc_base;
 
+surfcachestats_t		d_cachestats;
+static surfcachestats_t		sc_frame;	// counted for the frame being drawn
+
+static int			sc_vidsize;	// what the video mode set aside,
+						//  the -surfcachesize baseline
+static void			*sc_grown;	// a bigger cache than that, if any
+static int			sc_thrashframes;
+
 #define GUARDSIZE       4
 
+#define	SC_GROWFRAMES	16	// thrashing frames in a row before growing
+#define	SC_MAXGROW	4	// never grow past this times the baseline
+
 
 int D_SurfaceCacheForRes (int width, int height)
 {
@@ -78,15 +89,11 @@ static void D_ClearCacheGuard (void)
 
 /*
 ================
-D_InitCaches
-
+D_SetCacheBuffer
 ================
 */
-void D_InitCaches (void *buffer, int size)
+static void D_SetCacheBuffer (void *buffer, int size)
 {
-	if (!msg_suppress_1)
-		Con_Printf ("%ik surface cache\n", size/1024);
-
 	sc_size = size - GUARDSIZE;
 	sc_base = (surfcache_t *)buffer;
 	sc_rover = sc_base;
@@ -98,6 +105,73 @@ void D_InitCaches (void *buffer, int size)
 	D_ClearCacheGuard ();
 }
 
+/*
+================
+D_InitCaches
+
+================
+*/
+void D_InitCaches (void *buffer, int size)
+{
+	if (!msg_suppress_1)
+		Con_Printf ("%ik surface cache\n", size/1024);
+
+	if (sc_grown)
+	{
+		D_FlushCaches ();
+		free (sc_grown);
+		sc_grown = NULL;
+	}
+
+	sc_vidsize = size;
+	sc_thrashframes = 0;
+
+	D_SetCacheBuffer (buffer, size);
+}
+
+/*
+================
+D_AdaptCaches
+
+Called at the start of a frame, before r_cache_thrash is cleared.  Once the
+cache has been thrashing for a while, it is moved to a buffer twice as big,
+up to SC_MAXGROW times the size the video mode set aside.  The bigger cache
+is kept until the video mode changes.
+================
+*/
+void D_AdaptCaches (void)
+{
+	void	*buffer;
+	int	size;
+
+	d_cachestats = sc_frame;
+	d_cachestats.size = sc_size + GUARDSIZE;
+	memset (&sc_frame, 0, sizeof(sc_frame));
+
+	if (!sc_base || !r_cache_thrash)
+	{
+		sc_thrashframes = 0;
+		return;
+	}
+	if (++sc_thrashframes < SC_GROWFRAMES)
+		return;
+	sc_thrashframes = 0;
+
+	size = (sc_size + GUARDSIZE) * 2;
+	if (size > sc_vidsize * SC_MAXGROW)
+		return;
+	buffer = malloc (size);
+	if (!buffer)
+		return;
+
+	D_FlushCaches ();
+	free (sc_grown);
+	sc_grown = buffer;
+	D_SetCacheBuffer (buffer, size);
+
+	Con_DPrintf ("surface cache thrashing, grown to %ik\n", size/1024);
+}
+
 
 /*
 ==================
@@ -163,7 +237,10 @@ static surfcache_t *D_SCAlloc (int width, int size)
 // colect and free surfcache_t blocks until the rover block is large enough
 	new_sc = sc_rover;
 	if (sc_rover->owner)
+	{
 		*sc_rover->owner = NULL;
+		sc_frame.evictions++;
+	}
 
 	while (new_sc->size < size)
 	{
@@ -172,7 +249,10 @@ static surfcache_t *D_SCAlloc (int width, int size)
 		if (!sc_rover)
 			Sys_Error ("%s: hit the end of memory", __thisfunc__);
 		if (sc_rover->owner)
+		{
 			*sc_rover->owner = NULL;
+			sc_frame.evictions++;
+		}
 
 		new_sc->size += sc_rover->size;
 		new_sc->next = sc_rover->next;
@@ -235,6 +315,106 @@ static void D_SCDump (void)
 
 //=============================================================================
 
+#if R_BANDTHREADS
+/*
+==============================================================================
+
+DEFERRED BUILDS
+
+While the banded drawer sets up the surfaces of a pass, the cache entries
+that need building only get their memory, and what R_DrawSurface needs to
+fill them in is queued.  Once all surfaces are set up, the queue is built
+in parallel, each entry by a job of its own: the entries never share any
+memory, since D_DrawSurfaceBands falls back to the serial drawer if one was
+allocated over another in use by the same pass.
+
+==============================================================================
+*/
+
+static drawsurf_t	*sc_builds;
+static int		sc_numbuilds, sc_maxbuilds;
+static qboolean		sc_defer;
+
+/*
+================
+D_DeferCacheBuilds
+================
+*/
+void D_DeferCacheBuilds (qboolean defer)
+{
+	if (defer)
+		sc_numbuilds = 0;
+	sc_defer = defer;
+}
+
+/*
+================
+D_DeferBuild
+
+Queues r_drawsurf, or returns false if there is no room for it.
+================
+*/
+static qboolean D_DeferBuild (void)
+{
+	drawsurf_t	*builds;
+
+	if (sc_numbuilds == sc_maxbuilds)
+	{
+		builds = (drawsurf_t *) realloc (sc_builds, (sc_maxbuilds + 256) * sizeof(drawsurf_t));
+		if (!builds)
+			return false;
+		sc_builds = builds;
+		sc_maxbuilds += 256;
+	}
+
+	sc_builds[sc_numbuilds++] = r_drawsurf;
+	return true;
+}
+
+/*
+================
+D_BuildCacheJob
+================
+*/
+static void D_BuildCacheJob (void *data, int job)
+{
+	r_drawsurf = sc_builds[job];
+	R_DrawSurface ();
+}
+
+/*
+================
+D_BuildDeferredCaches
+================
+*/
+void D_BuildDeferredCaches (void)
+{
+	Thread_RunJobs (D_BuildCacheJob, NULL, sc_numbuilds);
+	sc_numbuilds = 0;
+}
+
+/*
+================
+D_CancelDeferredCaches
+================
+*/
+void D_CancelDeferredCaches (void)
+{
+	drawsurf_t	*ds;
+	surfcache_t	*cache;
+
+	for (ds = sc_builds ; ds < &sc_builds[sc_numbuilds] ; ds++)
+	{
+	// skip entries a later allocation of the pass has thrown out
+		cache = ds->surf->cachespots[ds->surfmip];
+		if (cache && (pixel_t *)cache->data == ds->surfdat)
+			cache->texture = NULL;	// never matches, so rebuilt on lookup
+	}
+
+	sc_numbuilds = 0;
+}
+#endif	/* R_BANDTHREADS */
+
 /*
 ================
 D_CacheSurface
@@ -280,7 +460,12 @@ surfcache_t *D_CacheSurface (msurface_t *surface, int miplevel)
 			&& cache->lightadj[2] == r_drawsurf.lightadj[2]
 			&& cache->lightadj[3] == r_drawsurf.lightadj[3] 
 			&& !DoSurface)
+	{
+		sc_frame.hits++;
 		return cache;
+	}
+
+	sc_frame.misses++;
 
 //
 // determine shape of surface
@@ -323,8 +508,14 @@ surfcache_t *D_CacheSurface (msurface_t *surface, int miplevel)
 // draw and light the surface texture
 //
 	r_drawsurf.surf = surface;
+	r_drawsurf.drawflags = currententity->drawflags;
+	r_drawsurf.abslight = currententity->abslight;
 
 	c_surf++;
+#if R_BANDTHREADS
+	if (sc_defer && D_DeferBuild ())
+		return cache;
+#endif
 	R_DrawSurface ();
 
 	return surface->cachespots[miplevel];
@@ -19,6 +19,8 @@
  */
 
 #include	"quakedef.h"
+#include	"r_local.h"
+#include	"d_local.h"
 
 #if	!id386
 
@@ -32,14 +34,14 @@
 // FIXME: make into one big structure, like cl or sv
 // FIXME: do separately for refresh engine and driver
 
-float	d_sdivzstepu, d_tdivzstepu, d_zistepu;
-float	d_sdivzstepv, d_tdivzstepv, d_zistepv;
-float	d_sdivzorigin, d_tdivzorigin, d_ziorigin;
+R_TLS float	d_sdivzstepu, d_tdivzstepu, d_zistepu;
+R_TLS float	d_sdivzstepv, d_tdivzstepv, d_zistepv;
+R_TLS float	d_sdivzorigin, d_tdivzorigin, d_ziorigin;
 
-fixed16_t	sadjust, tadjust, bbextents, bbextentt;
+R_TLS fixed16_t	sadjust, tadjust, bbextents, bbextentt;
 
-pixel_t		*cacheblock;
-int		cachewidth;
+R_TLS pixel_t	*cacheblock;
+R_TLS int	cachewidth;
 
 pixel_t		*d_viewbuffer;
 
@@ -98,6 +98,7 @@ static	cvar_t	scr_showram = {"showram", "1", CVAR_NONE};
 static	cvar_t	scr_showturtle = {"showturtle", "0", CVAR_NONE};
 static	cvar_t	scr_showpause = {"showpause", "1", CVAR_NONE};
 static	cvar_t	scr_showfps = {"showfps", "0", CVAR_NONE};
+static	cvar_t	scr_particlestats = {"r_particlestats", "0", CVAR_NONE};
 //static	cvar_t	gl_triplebuffer = {"gl_triplebuffer", "0", CVAR_ARCHIVE};
 
 #if !defined(H2W)
@@ -453,6 +454,7 @@ void SCR_Init (void)
 	Cvar_RegisterVariable (&scr_showturtle);
 	Cvar_RegisterVariable (&scr_showpause);
 	Cvar_RegisterVariable (&scr_showfps);
+	Cvar_RegisterVariable (&scr_particlestats);
 	Cvar_RegisterVariable (&scr_centertime);
 //	Cvar_RegisterVariable (&gl_triplebuffer);
 
@@ -566,6 +568,29 @@ static void SCR_DrawFPS (void)
 	Draw_String(x, y, st);
 }
 
+/*
+==============
+SCR_DrawParticleStats
+
+Particles of the last frame
+==============
+*/
+static void SCR_DrawParticleStats (void)
+{
+	char	st[64];
+	int	y;
+
+	if (!scr_particlestats.integer)
+		return;
+
+	y = vid.height - sb_lines - 16;
+	q_snprintf (st, sizeof(st), "particles %i", r_partstats.active);
+	Draw_String (8, y, st);
+	q_snprintf (st, sizeof(st), "%4i new %4i drop %4i cull",
+			r_partstats.spawned, r_partstats.dropped, r_partstats.culled);
+	Draw_String (8, y + 8, st);
+}
+
 /*
 ==============
 DrawPause
@@ -1334,6 +1359,7 @@ void SCR_UpdateScreen (void)
 		SCR_CheckDrawCenterString();
 		Sbar_Draw();
 		SCR_DrawFPS();
+		SCR_DrawParticleStats();
 
 		Plaque_Draw(plaquemessage, false);
 		SCR_DrawConsole();
@@ -32,7 +32,7 @@ static char	loadname[MAX_QPATH];	/* for hunk tags */
 
 static qmodel_t *Mod_LoadModel (qmodel_t *mod, qboolean crash);
 static void Mod_LoadSpriteModel (qmodel_t *mod, void *buffer);
-static void Mod_LoadBrushModel (qmodel_t *mod, void *buffer);
+static void Mod_LoadBrushModel (qmodel_t *mod, fsview_t *view);
 static void Mod_LoadAliasModel (qmodel_t *mod, void *buffer);
 static void Mod_LoadAliasModelNew (qmodel_t *mod, void *buffer);
 
@@ -282,6 +282,7 @@ static qmodel_t *Mod_LoadModel (qmodel_t *mod, qboolean crash)
 	byte	*buf;
 	byte	stackbuf[1024];		// avoid dirtying the cache heap
 	int	mod_type;
+	fsview_t	view;
 
 	if (mod->type == mod_alias)
 	{
@@ -299,8 +300,7 @@ static qmodel_t *Mod_LoadModel (qmodel_t *mod, qboolean crash)
 //
 // load the file
 //
-	buf = FS_LoadStackFile (mod->name, stackbuf, sizeof(stackbuf), & mod->path_id);
-	if (!buf)
+	if (!FS_OpenView (mod->name, &view, & mod->path_id))
 	{
 		if (crash)
 			Sys_Error ("%s: %s not found", __thisfunc__, mod->name);
@@ -321,7 +321,18 @@ static qmodel_t *Mod_LoadModel (qmodel_t *mod, qboolean crash)
 // call the apropriate loader
 	mod->needload = NL_PRESENT;
 
-	mod_type = (buf[0] | (buf[1] << 8) | (buf[2] << 16) | (buf[3] << 24));
+	buf = (byte *)view.data;
+	mod_type = (view.size < 4) ? 0 : (buf[0] | (buf[1] << 8) | (buf[2] << 16) | (buf[3] << 24));
+	if (mod_type == RAPOLYHEADER || mod_type == IDPOLYHEADER || mod_type == IDSPRITEHEADER)
+	{	// these swap their data in place, so they get a copy
+		if (view.size < (long) sizeof(stackbuf))
+			buf = stackbuf;
+		else
+			buf = (byte *) Hunk_TempAlloc (view.size + 1);
+		memcpy (buf, view.data, view.size);
+		buf[view.size] = 0;
+	}
+
 	switch (mod_type)
 	{
 	case RAPOLYHEADER:
@@ -334,10 +345,11 @@ static qmodel_t *Mod_LoadModel (qmodel_t *mod, qboolean crash)
 		Mod_LoadSpriteModel (mod, buf);
 		break;
 	default:
-		Mod_LoadBrushModel (mod, buf);
+		Mod_LoadBrushModel (mod, &view);
 		break;
 	}
 
+	FS_CloseView (&view);
 	return mod;
 }
 
@@ -366,7 +378,7 @@ qmodel_t *Mod_ForName (const char *name, qboolean crash)
 ===============================================================================
 */
 
-static byte	*mod_base;
+static byte	*mod_base;	// a read only file view: never write through it
 
 
 /*
@@ -377,7 +389,8 @@ Mod_LoadTextures
 static void Mod_LoadTextures (lump_t *l)
 {
 	int		i, j, pixels, num, maxanim, altmax;
-	miptex_t	*mt;
+	int		nummiptex, dataofs;
+	miptex_t	*mt, mtheader;
 	texture_t	*tx, *tx2;
 	texture_t	*anims[10];
 	texture_t	*altanims[10];
@@ -396,17 +409,19 @@ static void Mod_LoadTextures (lump_t *l)
 	}
 	m = (dmiptexlump_t *)(mod_base + l->fileofs);
 
-	m->nummiptex = LittleLong (m->nummiptex);
+	nummiptex = LittleLong (m->nummiptex);
 
-	loadmodel->numtextures = m->nummiptex;
-	loadmodel->textures = (texture_t **) Hunk_AllocName (m->nummiptex * sizeof(*loadmodel->textures), "texture");
+	loadmodel->numtextures = nummiptex;
+	loadmodel->textures = (texture_t **) Hunk_AllocName (nummiptex * sizeof(*loadmodel->textures), "texture");
 
-	for (i = 0; i < m->nummiptex; i++)
+	for (i = 0; i < nummiptex; i++)
 	{
-		m->dataofs[i] = LittleLong(m->dataofs[i]);
-		if (m->dataofs[i] == -1)
+		dataofs = LittleLong(m->dataofs[i]);
+		if (dataofs == -1)
 			continue;
-		mt = (miptex_t *)((byte *)m + m->dataofs[i]);
+	// swap a copy of the header, the file data is read only
+		memcpy (&mtheader, (byte *)m + dataofs, sizeof(miptex_t));
+		mt = &mtheader;
 		mt->width = LittleLong (mt->width);
 		mt->height = LittleLong (mt->height);
 		for (j = 0; j < MIPLEVELS; j++)
@@ -476,7 +491,7 @@ bsp_tex_internal:
 			for (j = 0; j < MIPLEVELS; j++)
 				tx->offsets[j] = mt->offsets[j] + sizeof(texture_t) - sizeof(miptex_t);
 			// the pixels immediately follow the structures
-			memcpy ( tx+1, mt+1, pixels);
+			memcpy ( tx+1, (byte *)m + dataofs + sizeof(miptex_t), pixels);
 #ifdef WAL_TEXTURES
 		}
 #endif
@@ -488,7 +503,7 @@ bsp_tex_internal:
 //
 // sequence the animations
 //
-	for (i = 0; i < m->nummiptex; i++)
+	for (i = 0; i < nummiptex; i++)
 	{
 		tx = loadmodel->textures[i];
 		if (!tx || tx->name[0] != '+')
@@ -521,7 +536,7 @@ bsp_tex_internal:
 		else
 			Sys_Error ("Bad animating texture %s", tx->name);
 
-		for (j = i+1; j < m->nummiptex; j++)
+		for (j = i+1; j < nummiptex; j++)
 		{
 			tx2 = loadmodel->textures[j];
 			if (!tx2 || tx2->name[0] != '+')
@@ -1653,18 +1668,20 @@ static float RadiusFromBounds (const vec3_t mins, const vec3_t maxs)
 Mod_LoadBrushModel
 =================
 */
-static void Mod_LoadBrushModel (qmodel_t *mod, void *buffer)
+static void Mod_LoadBrushModel (qmodel_t *mod, fsview_t *view)
 {
 	int			i, j;
-	dheader_t	*header;
+	dheader_t	header;
 	dmodel_t	*bm;
 	qboolean	bsp2 = false;
 
 	loadmodel->type = mod_brush;
 
-	header = (dheader_t *)buffer;
+	if (view->size < (long) sizeof(dheader_t))
+		Sys_Error ("%s: %s is too short", __thisfunc__, mod->name);
+	memcpy (&header, view->data, sizeof(dheader_t));
 
-	i = LittleLong (header->version);
+	i = LittleLong (header.version);
 #ifndef ENABLE_BSP2
 	(void) bsp2;
 #else
@@ -1676,27 +1693,33 @@ static void Mod_LoadBrushModel (qmodel_t *mod, void *buffer)
 		Sys_Error ("%s: %s has unsupported version %i", __thisfunc__, mod->name, i);
 
 // swap all the lumps
-	mod_base = (byte *)header;
+	mod_base = (byte *)view->data;
 
 	for (i = 0; i < (int) sizeof(dheader_t) / 4; i++)
-		((int *)header)[i] = LittleLong ( ((int *)header)[i]);
+		((int *)&header)[i] = LittleLong ( ((int *)&header)[i]);
+	for (i = 0; i < HEADER_LUMPS; i++)
+	{
+		if (header.lumps[i].fileofs < 0 || header.lumps[i].filelen < 0 ||
+		    header.lumps[i].fileofs > view->size - header.lumps[i].filelen)
+			Sys_Error ("%s: %s has a bad lump %i", __thisfunc__, mod->name, i);
+	}
 
 // load into heap
-	Mod_LoadVertexes (&header->lumps[LUMP_VERTEXES]);
-	Mod_LoadEdges (&header->lumps[LUMP_EDGES], bsp2);
-	Mod_LoadSurfedges (&header->lumps[LUMP_SURFEDGES]);
-	Mod_LoadTextures (&header->lumps[LUMP_TEXTURES]);
-	Mod_LoadLighting (&header->lumps[LUMP_LIGHTING]);
-	Mod_LoadPlanes (&header->lumps[LUMP_PLANES]);
-	Mod_LoadTexinfo (&header->lumps[LUMP_TEXINFO]);
-	Mod_LoadFaces (&header->lumps[LUMP_FACES], bsp2);
-	Mod_LoadMarksurfaces (&header->lumps[LUMP_MARKSURFACES], bsp2);
-	Mod_LoadVisibility (&header->lumps[LUMP_VISIBILITY]);
-	Mod_LoadLeafs (&header->lumps[LUMP_LEAFS], bsp2);
-	Mod_LoadNodes (&header->lumps[LUMP_NODES], bsp2);
-	Mod_LoadClipnodes (&header->lumps[LUMP_CLIPNODES], bsp2);
-	Mod_LoadEntities (&header->lumps[LUMP_ENTITIES]);
-	Mod_LoadSubmodels (&header->lumps[LUMP_MODELS]);
+	Mod_LoadVertexes (&header.lumps[LUMP_VERTEXES]);
+	Mod_LoadEdges (&header.lumps[LUMP_EDGES], bsp2);
+	Mod_LoadSurfedges (&header.lumps[LUMP_SURFEDGES]);
+	Mod_LoadTextures (&header.lumps[LUMP_TEXTURES]);
+	Mod_LoadLighting (&header.lumps[LUMP_LIGHTING]);
+	Mod_LoadPlanes (&header.lumps[LUMP_PLANES]);
+	Mod_LoadTexinfo (&header.lumps[LUMP_TEXINFO]);
+	Mod_LoadFaces (&header.lumps[LUMP_FACES], bsp2);
+	Mod_LoadMarksurfaces (&header.lumps[LUMP_MARKSURFACES], bsp2);
+	Mod_LoadVisibility (&header.lumps[LUMP_VISIBILITY]);
+	Mod_LoadLeafs (&header.lumps[LUMP_LEAFS], bsp2);
+	Mod_LoadNodes (&header.lumps[LUMP_NODES], bsp2);
+	Mod_LoadClipnodes (&header.lumps[LUMP_CLIPNODES], bsp2);
+	Mod_LoadEntities (&header.lumps[LUMP_ENTITIES]);
+	Mod_LoadSubmodels (&header.lumps[LUMP_MODELS]);
 
 	Mod_MakeHull0 ();
 
@@ -1683,23 +1683,36 @@ Returns a chain of entities that have origins within a spherical area
 findradius (origin, radius)
 =================
 */
+static int	findradius_list[MAX_EDICTS];
+
 static void PF_findradius (void)
 {
 	edict_t	*ent, *chain;
 	float	rad;
 	float	*org;
-	int		i;
+	int		i, count;
 
 	chain = (edict_t *)sv.edicts;
 
 	org = G_VECTOR(OFS_PARM0);
 	rad = G_FLOAT(OFS_PARM1);
+
+	// the candidates come in edict order, so the chain is the same
+	// as with a walk over all edicts
+	count = SV_GridFindRadius (org, rad, findradius_list);
+	if (count < 0)
+	{
+		for (i = 1; i < sv.num_edicts; i++)
+			findradius_list[i - 1] = i;
+		count = sv.num_edicts - 1;
+	}
+
 	rad *= rad;
 
-	ent = NEXT_EDICT(sv.edicts);
-	for (i = 1; i < sv.num_edicts; i++, ent = NEXT_EDICT(ent))
+	for (i = 0; i < count; i++)
 	{
 		float d, lensq;
+		ent = EDICT_NUM(findradius_list[i]);
 		if (ent->free)
 			continue;
 		if (ent->v.solid == SOLID_NOT)
@@ -1720,6 +1733,7 @@ static void PF_findradius (void)
 
 		ent->v.chain = EDICT_TO_PROG(chain);
 		chain = ent;
+		sv_gridstats.found++;
 	}
 
 	RETURN_EDICT(chain);
@@ -1895,7 +1909,7 @@ static void PF_Find (void)
 }
 #else
 {
-	int		e;
+	int		e, i;
 	int		f;
 	const char	*s, *t;
 	edict_t	*ed;
@@ -1906,6 +1920,15 @@ static void PF_Find (void)
 	if (!s)
 		PR_RunError ("%s: bad search string", __thisfunc__);
 
+	// the common fields are hashed
+	i = ED_FindString (f, s, e);
+	if (i >= 0)
+	{
+		ed = (i) ? EDICT_NUM(i) : (edict_t *)sv.edicts;
+		RETURN_EDICT(ed);
+		return;
+	}
+
 	for (e++ ; e < sv.num_edicts ; e++)
 	{
 		ed = EDICT_NUM(e);
@@ -20,6 +20,7 @@
  */
 
 #include "quakedef.h"
+#include "hashindex.h"
 
 #if defined(H2W) && !defined(SERVERONLY)
 #error SERVERONLY not defined for HW server
@@ -42,6 +43,7 @@ static	char		pr_null_string[] = "";
 static	char		*pr_strings;
 static	int		pr_stringssize;
 static	const char	**pr_knownstrings;
+static	byte		*pr_knownstringsfixed;	/* allocated by PR_AllocString */
 static	int		pr_maxknownstrings;
 static	int		pr_numknownstrings;
 static	ddef_t		*pr_fielddefs;
@@ -622,6 +624,8 @@ void ED_ClearEdict (edict_t *e)
 	memset (&e->baseline, 0, sizeof(e->baseline));
 	#endif
 	e->free = false;
+	SV_GridDirty (e);
+	ED_FindDirty (e);
 }
 
 /*
@@ -732,6 +736,290 @@ void ED_Free (edict_t *ed)
 
 	ed->freetime = sv.time;
 	ed->alloctime = -1;
+	ED_FindDirty (ed);
+}
+
+/*
+=============================================================================
+
+FIND INDEX
+
+The gamecode calls find in loops everywhere, nearly always on one of
+a handful of string fields.  Each of those gets a hash of the edicts
+by the contents of the field, so a lookup only compares the edicts
+that can match.  Stores to the fields mark the edict dirty and dirty
+edicts are rehashed before every lookup until the frame is over.
+Engine strings which can change under the edict, such as client names
+and the temp strings of ftos and friends, are kept on a side chain
+that is always compared.
+
+=============================================================================
+*/
+
+#define	FIND_NOTLINKED	-1
+#define	FIND_VOLATILE	-2
+
+typedef struct
+{
+	int		ofs;
+	hashindex_t	hash;		// constant strings, by contents
+	hashindex_t	side;		// volatile strings, all under key 0
+	int		key[MAX_EDICTS];
+} findindex_t;
+
+typedef struct
+{
+	int		queries, unindexed;
+	double	candidates;
+} findstats_t;
+
+static findindex_t	find_index[4];
+static findstats_t	find_stats;
+
+static qboolean	find_valid;		// false: rebuild from scratch
+static byte	find_dirty[MAX_EDICTS];
+static int	find_dirtylist[MAX_EDICTS];
+static int	find_numdirty;
+static double	find_dirtytime;		// sv.time of the edicts on the dirty list
+
+/*
+===============
+ED_ClearFindIndex
+
+The strings are about to be reset, throw away everything
+===============
+*/
+static void ED_ClearFindIndex (void)
+{
+	find_valid = false;
+}
+
+static findindex_t *ED_FindIndexForField (int ofs)
+{
+	int		i;
+
+	for (i = 0; i < 4; i++)
+	{
+		if (find_index[i].ofs == ofs)
+			return &find_index[i];
+	}
+	return NULL;
+}
+
+/*
+===============
+ED_FindStringFixed
+
+Strings in the progs and ones made by PR_AllocString never change.
+===============
+*/
+static qboolean ED_FindStringFixed (int num)
+{
+	if (num >= 0 && num < pr_stringssize)
+		return true;
+	if (num < 0 && num >= -pr_numknownstrings)
+		return pr_knownstringsfixed[-1 - num] && pr_knownstrings[-1 - num];
+	return false;
+}
+
+static void ED_FindUnlink (findindex_t *fi, int num)
+{
+	if (fi->key[num] >= 0)
+		Hash_Remove (&fi->hash, fi->key[num], num);
+	else if (fi->key[num] == FIND_VOLATILE)
+		Hash_Remove (&fi->side, 0, num);
+	fi->key[num] = FIND_NOTLINKED;
+}
+
+static void ED_FindLink (findindex_t *fi, int num)
+{
+	edict_t	*ed;
+	int		str;
+
+	ed = EDICT_NUM(num);
+	if (ed->free)
+		return;
+
+	str = E_INT(ed, fi->ofs);
+	if (ED_FindStringFixed(str))
+	{
+		fi->key[num] = Hash_GenerateKeyString (&fi->hash, PR_GetString(str), true);
+		Hash_Add (&fi->hash, fi->key[num], num);
+	}
+	else
+	{
+		fi->key[num] = FIND_VOLATILE;
+		Hash_Add (&fi->side, 0, num);
+	}
+}
+
+static void ED_FindRelinkDirty (void)
+{
+	int		i, j, num;
+
+	for (j = 0; j < find_numdirty; j++)
+	{
+		num = find_dirtylist[j];
+		for (i = 0; i < 4; i++)
+		{
+			ED_FindUnlink (&find_index[i], num);
+			ED_FindLink (&find_index[i], num);
+		}
+	}
+}
+
+static void ED_FindClearDirty (void)
+{
+	int		j;
+
+	for (j = 0; j < find_numdirty; j++)
+		find_dirty[find_dirtylist[j]] = false;
+	find_numdirty = 0;
+}
+
+/*
+===============
+ED_FindSync
+
+Brings the hashes up to date with the edicts.  Dirty edicts stay dirty
+until the next frame: progs take the address of a field, may run a
+find while working out the value, and only then store to the field.
+===============
+*/
+static void ED_FindSync (void)
+{
+	findindex_t	*fi;
+	int		i, j;
+
+	if (!find_valid)
+	{
+		for (i = 0; i < 4; i++)
+		{
+			fi = &find_index[i];
+			Hash_Clear (&fi->hash);
+			Hash_Clear (&fi->side);
+			for (j = 0; j < MAX_EDICTS; j++)
+				fi->key[j] = FIND_NOTLINKED;
+			for (j = 0; j < sv.num_edicts; j++)
+				ED_FindLink (fi, j);
+		}
+		find_valid = true;
+	}
+	else
+	{
+		ED_FindRelinkDirty ();
+	}
+
+	if (find_dirtytime != sv.time)
+		ED_FindClearDirty ();
+}
+
+/*
+===============
+ED_FindDirty
+
+Called whenever a store to one of the indexed fields of ent may follow
+===============
+*/
+void ED_FindDirty (edict_t *ent)
+{
+	int		num;
+
+	if (find_dirtytime != sv.time)
+	{	// the stores of the earlier frame are all done
+		if (find_valid)
+			ED_FindRelinkDirty ();
+		ED_FindClearDirty ();
+		find_dirtytime = sv.time;
+	}
+
+	num = ((byte *)ent - (byte *)sv.edicts) / pr_edict_size;
+	if (find_dirty[num])
+		return;
+	find_dirty[num] = true;
+	find_dirtylist[find_numdirty++] = num;
+}
+
+/*
+===============
+ED_FindString
+===============
+*/
+int ED_FindString (int ofs, const char *s, int start)
+{
+	findindex_t	*fi;
+	hashindex_t	*hi;
+	int		i, num, best;
+
+	find_stats.queries++;
+	fi = ED_FindIndexForField (ofs);
+	if (!fi)
+	{
+		find_stats.unindexed++;
+		return -1;
+	}
+
+	ED_FindSync ();
+
+	// the chains aren't sorted, so keep the lowest match
+	best = sv.num_edicts;
+	for (i = 0; i < 2; i++)
+	{
+		if (i == 0)
+		{
+			hi = &fi->hash;
+			num = Hash_First (hi, Hash_GenerateKeyString(hi, s, true));
+		}
+		else
+		{
+			hi = &fi->side;
+			num = Hash_First (hi, 0);
+		}
+		for ( ; num != -1; num = Hash_Next(hi, num))
+		{
+			if (num <= start || num >= best)
+				continue;
+			find_stats.candidates++;
+			if (!strcmp(E_STRING(EDICT_NUM(num), ofs), s))
+				best = num;
+		}
+	}
+
+	return (best < sv.num_edicts) ? best : 0;
+}
+
+/*
+===============
+ED_FindStats_f
+===============
+*/
+void ED_FindStats_f (void)
+{
+	Con_Printf ("find: %d queries, %d on unindexed fields\n",
+			find_stats.queries, find_stats.unindexed);
+	Con_Printf ("%.0f candidates compared\n", find_stats.candidates);
+}
+
+/*
+===============
+ED_InitFindIndex
+===============
+*/
+static void ED_InitFindIndex (void)
+{
+	int		i, size;
+
+	for (size = 1; size < MAX_EDICTS; size <<= 1)
+		;
+	find_index[0].ofs = offsetof(entvars_t, classname) / 4;
+	find_index[1].ofs = offsetof(entvars_t, targetname) / 4;
+	find_index[2].ofs = offsetof(entvars_t, target) / 4;
+	find_index[3].ofs = offsetof(entvars_t, netname) / 4;
+	for (i = 0; i < 4; i++)
+	{
+		Hash_Allocate (&find_index[i].hash, size);
+		Hash_Allocate (&find_index[i].side, size);
+	}
 }
 
 //===========================================================================
@@ -774,25 +1062,93 @@ static ddef_t *ED_FieldAtOfs (int ofs)
 	return NULL;
 }
 
+/*
+=============================================================================
+
+NAME LOOKUPS
+
+Map and savegame loading look up a def for every key of every entity,
+so the field and global defs and the functions are hashed by name when
+the progs are loaded.  The function hash is keyed case-insensitively
+so that ED_FindFunctioni can use it, too.
+
+=============================================================================
+*/
+
+static hashindex_t	pr_fieldhash;
+static hashindex_t	pr_globalhash;
+static hashindex_t	pr_functionhash;
+
+typedef struct
+{
+	double	parsetime;	// in ED_ParseEdict and ED_ParseGlobals
+	double	loadtime;	// in ED_LoadFromFile, spawn functions included
+	int		edicts;		// parsed by ED_ParseEdict
+	int		lookups;	// field, global and function names looked up
+	int		compares;	// strcmps done for those
+	int		linear;		// strcmps a linear search would have done
+} maploadstats_t;
+
+static maploadstats_t	maploadstats;
+
+static void PR_HashNames (hashindex_t *hi, const void *base, int stride, int count, qboolean caseSensitive)
+{
+	const char	*name;
+	int		i, size;
+
+	for (size = 1; size < count; size <<= 1)
+		;
+	Hash_Free (hi);
+	Hash_Allocate (hi, size);
+
+	// add backwards so that the first of any duplicates is found first
+	for (i = count - 1; i >= 0; i--)
+	{
+		name = PR_GetString(*(const int *)((const byte *)base + i * stride));
+		Hash_Add (hi, Hash_GenerateKeyString(hi, name, caseSensitive), i);
+	}
+}
+
 /*
 ============
-ED_FindField
+PR_HashDefs
 ============
 */
-static ddef_t *ED_FindField (const char *name)
+static void PR_HashDefs (void)
 {
-	ddef_t		*def;
-	int			i;
+	PR_HashNames (&pr_fieldhash, &pr_fielddefs[0].s_name, sizeof(ddef_t), progs->numfielddefs, true);
+	PR_HashNames (&pr_globalhash, &pr_globaldefs[0].s_name, sizeof(ddef_t), progs->numglobaldefs, true);
+	PR_HashNames (&pr_functionhash, &pr_functions[0].s_name, sizeof(dfunction_t), progs->numfunctions, false);
+}
 
-	for (i = 0; i < progs->numfielddefs; i++)
+static ddef_t *ED_FindDef (hashindex_t *hi, ddef_t *defs, int numdefs, const char *name)
+{
+	int		i;
+
+	maploadstats.lookups++;
+	for (i = Hash_First(hi, Hash_GenerateKeyString(hi, name, true)); i != -1; i = Hash_Next(hi, i))
 	{
-		def = &pr_fielddefs[i];
-		if ( !strcmp(PR_GetString(def->s_name), name) )
-			return def;
+		maploadstats.compares++;
+		if ( !strcmp(PR_GetString(defs[i].s_name), name) )
+		{
+			maploadstats.linear += i + 1;
+			return &defs[i];
+		}
 	}
+	maploadstats.linear += numdefs;
 	return NULL;
 }
 
+/*
+============
+ED_FindField
+============
+*/
+static ddef_t *ED_FindField (const char *name)
+{
+	return ED_FindDef (&pr_fieldhash, pr_fielddefs, progs->numfielddefs, name);
+}
+
 
 /*
 ============
@@ -801,16 +1157,7 @@ ED_FindGlobal
 */
 static ddef_t *ED_FindGlobal (const char *name)
 {
-	ddef_t		*def;
-	int			i;
-
-	for (i = 0; i < progs->numglobaldefs; i++)
-	{
-		def = &pr_globaldefs[i];
-		if ( !strcmp(PR_GetString(def->s_name), name) )
-			return def;
-	}
-	return NULL;
+	return ED_FindDef (&pr_globalhash, pr_globaldefs, progs->numglobaldefs, name);
 }
 
 
@@ -821,32 +1168,50 @@ ED_FindFunction
 */
 static dfunction_t *ED_FindFunction (const char *fn_name)
 {
-	dfunction_t		*func;
 	int				i;
 
-	for (i = 0; i < progs->numfunctions; i++)
+	maploadstats.lookups++;
+	for (i = Hash_First(&pr_functionhash, Hash_GenerateKeyString(&pr_functionhash, fn_name, false));
+			i != -1; i = Hash_Next(&pr_functionhash, i))
 	{
-		func = &pr_functions[i];
-		if ( !strcmp(PR_GetString(func->s_name), fn_name) )
-			return func;
+		maploadstats.compares++;
+		if ( !strcmp(PR_GetString(pr_functions[i].s_name), fn_name) )
+		{
+			maploadstats.linear += i + 1;
+			return &pr_functions[i];
+		}
 	}
+	maploadstats.linear += progs->numfunctions;
 	return NULL;
 }
 
 dfunction_t *ED_FindFunctioni (const char *fn_name)
 {
-	dfunction_t		*func;
 	int				i;
-	
-	for (i = 0; i < progs->numfunctions; i++)
+
+	for (i = Hash_First(&pr_functionhash, Hash_GenerateKeyString(&pr_functionhash, fn_name, false));
+			i != -1; i = Hash_Next(&pr_functionhash, i))
 	{
-		func = &pr_functions[i];
-		if ( !q_strcasecmp(PR_GetString(func->s_name), fn_name) )
-			return func;
+		if ( !q_strcasecmp(PR_GetString(pr_functions[i].s_name), fn_name) )
+			return &pr_functions[i];
 	}
 	return NULL;
 }
 
+/*
+============
+ED_MapLoadStats_f
+============
+*/
+static void ED_MapLoadStats_f (void)
+{
+	Con_Printf ("last map load: %d edicts parsed in %.1f ms, %.1f ms with spawn functions\n",
+			maploadstats.edicts, maploadstats.parsetime * 1000.0,
+			maploadstats.loadtime * 1000.0);
+	Con_Printf ("%d name lookups, %d compares (%d with linear search)\n",
+			maploadstats.lookups, maploadstats.compares, maploadstats.linear);
+}
+
 
 eval_t *GetEdictFieldValue(edict_t *ed, const char *field)
 {
@@ -1296,6 +1661,7 @@ void ED_ParseGlobals (const char *data)
 {
 	char	keyname[64];
 	ddef_t	*key;
+	double	start = Sys_DoubleTime ();
 
 	while (1)
 	{
@@ -1326,6 +1692,8 @@ void ED_ParseGlobals (const char *data)
 		if (!ED_ParseEpair ((void *)pr_globals, key, com_token))
 			Host_Error ("%s: parse error", __thisfunc__);
 	}
+
+	maploadstats.parsetime += Sys_DoubleTime () - start;
 }
 
 //============================================================================
@@ -1464,6 +1832,7 @@ const char *ED_ParseEdict (const char *data, edict_t *ent)
 	char		keyname[256];
 	qboolean	anglehack, init;
 	int		n;
+	double		start = Sys_DoubleTime ();
 
 	init = false;
 
@@ -1554,11 +1923,444 @@ const char *ED_ParseEdict (const char *data, edict_t *ent)
 
 	if (!init)
 		ent->free = true;
+	SV_GridDirty (ent);
+	ED_FindDirty (ent);
+
+	maploadstats.edicts++;
+	maploadstats.parsetime += Sys_DoubleTime () - start;
 
 	return data;
 }
 
 
+/*
+==============================================================================
+
+BINARY SNAPSHOTS
+
+A snapshot keeps the entity fields and the saved globals as raw words,
+so it can only be read back by the progs that wrote it.  Strings from
+the progs are kept as offsets, the other ones go into a string table
+at the end and are stored as -1 - their index in it.  Entity references
+are kept as edict numbers, and references to free edicts are dropped
+like ED_Write does.  Everything is padded to 4 bytes so that the words
+of an edict can be fixed up in place.
+
+==============================================================================
+*/
+
+#define	SNAP_ALIGN(len)		(((len) + 3) & ~3)
+
+/*
+=============
+ED_SnapFields
+
+Finds the string and entity fields, with each offset only once.
+=============
+*/
+static void ED_SnapFields (edsnap_t *s)
+{
+	ddef_t	*d;
+	byte	*seen;
+	int		i, type, pass;
+
+	s->fields = (int *) malloc (progs->numfielddefs * sizeof(int));
+	seen = (byte *) malloc (progs->entityfields);
+	s->numstringfields = s->numfields = 0;
+	for (pass = ev_string; ; pass = ev_entity)
+	{
+		memset (seen, 0, progs->entityfields);
+		for (i = 1; i < progs->numfielddefs; i++)
+		{
+			d = &pr_fielddefs[i];
+			type = d->type & ~DEF_SAVEGLOBAL;
+			if (type != pass || d->ofs >= progs->entityfields || seen[d->ofs])
+				continue;
+			seen[d->ofs] = 1;
+			s->fields[s->numfields++] = d->ofs;
+		}
+		if (pass == ev_entity)
+			break;
+		s->numstringfields = s->numfields;
+	}
+	free (seen);
+}
+
+/*
+=============
+ED_SnapBegin
+=============
+*/
+void ED_SnapBegin (edsnap_t *s)
+{
+	memset (s, 0, sizeof(*s));
+	s->maxsize = 0x40000;
+	s->data = (byte *) malloc (s->maxsize);
+	s->strings = (int *) calloc (pr_numknownstrings + 1, sizeof(int));
+	if (!s->data || !s->strings)
+		Sys_Error ("%s: out of memory", __thisfunc__);
+	ED_SnapFields (s);
+}
+
+/*
+=============
+ED_SnapSpace
+
+Returns room for length bytes, zeroed up to the next 4 byte boundary.
+=============
+*/
+void *ED_SnapSpace (edsnap_t *s, int length)
+{
+	byte	*p;
+	int		size = SNAP_ALIGN(length);
+
+	if (s->cursize + size > s->maxsize)
+	{
+		while (s->cursize + size > s->maxsize)
+			s->maxsize <<= 1;
+		s->data = (byte *) realloc (s->data, s->maxsize);
+		if (!s->data)
+			Sys_Error ("%s: out of memory", __thisfunc__);
+	}
+	p = s->data + s->cursize;
+	s->cursize += size;
+	memset (p + length, 0, size - length);
+	return p;
+}
+
+void ED_SnapWriteString (edsnap_t *s, const char *str)
+{
+	int		len = strlen(str) + 1;
+
+	memcpy (ED_SnapSpace(s, len), str, len);
+}
+
+static int ED_SnapString (edsnap_t *s, int num)
+{
+	const char	*str;
+	int		len, k;
+
+	if (num >= 0)
+		return (num < pr_stringssize) ? num : 0;
+	k = -1 - num;
+	if (k >= pr_numknownstrings || !(str = pr_knownstrings[k]))
+		return 0;
+	if (!s->strings[k])
+	{
+		len = strlen(str) + 1;
+		if (s->tablesize + len > s->maxtable)
+		{
+			s->maxtable = (s->maxtable + len) * 2;
+			s->table = (byte *) realloc (s->table, s->maxtable);
+			if (!s->table)
+				Sys_Error ("%s: out of memory", __thisfunc__);
+		}
+		memcpy (s->table + s->tablesize, str, len);
+		s->tablesize += len;
+		s->strings[k] = ++s->numstrings;
+	}
+	return -s->strings[k];
+}
+
+static int ED_SnapEdictNum (int ofs)
+{
+	edict_t	*e;
+	int		b;
+
+	if (ofs <= 0 || ofs % pr_edict_size)
+		return 0;
+	b = ofs / pr_edict_size;
+	if (b >= sv.num_edicts)
+		return 0;
+	e = EDICT_NUM(b);
+	return e->free ? 0 : b;
+}
+
+/*
+=============
+ED_SnapWriteGlobals
+
+The globals ED_WriteGlobals would save, in the order of their defs.
+=============
+*/
+void ED_SnapWriteGlobals (edsnap_t *s)
+{
+	ddef_t	*def;
+	int		*v;
+	int		i, type, count;
+
+	for (i = count = 0; i < progs->numglobaldefs; i++)
+	{
+		def = &pr_globaldefs[i];
+		type = def->type & ~DEF_SAVEGLOBAL;
+		if ((def->type & DEF_SAVEGLOBAL) && (type == ev_string || type == ev_float || type == ev_entity))
+			count++;
+	}
+
+	*(int *)ED_SnapSpace (s, 4) = count;
+	v = (int *) ED_SnapSpace (s, count * 4);
+	for (i = 0; i < progs->numglobaldefs; i++)
+	{
+		def = &pr_globaldefs[i];
+		type = def->type & ~DEF_SAVEGLOBAL;
+		if (!(def->type & DEF_SAVEGLOBAL))
+			continue;
+		if (type == ev_string)
+			*v++ = ED_SnapString (s, ((int *)pr_globals)[def->ofs]);
+		else if (type == ev_entity)
+			*v++ = ED_SnapEdictNum (((int *)pr_globals)[def->ofs]);
+		else if (type == ev_float)
+			*v++ = ((int *)pr_globals)[def->ofs];
+	}
+}
+
+/*
+=============
+ED_SnapWriteEdict
+
+Edict number, free flag, then the fields.
+=============
+*/
+void ED_SnapWriteEdict (edsnap_t *s, edict_t *ed)
+{
+	int		*v;
+	int		i;
+
+	v = (int *) ED_SnapSpace (s, 8 + progs->entityfields * 4);
+	v[0] = NUM_FOR_EDICT(ed);
+	v[1] = ed->free;
+	v += 2;
+	if (ed->free)
+	{
+		memset (v, 0, progs->entityfields * 4);
+		return;
+	}
+	memcpy (v, &ed->v, progs->entityfields * 4);
+	for (i = 0; i < s->numstringfields; i++)
+		v[s->fields[i]] = ED_SnapString (s, v[s->fields[i]]);
+	for ( ; i < s->numfields; i++)
+		v[s->fields[i]] = ED_SnapEdictNum (v[s->fields[i]]);
+}
+
+/*
+=============
+ED_SnapEnd
+
+Appends the string table and a trailer with its position.  The data
+is left for the caller to free.
+=============
+*/
+int ED_SnapEnd (edsnap_t *s)
+{
+	int		*trailer;
+	int		ofs;
+
+	ofs = s->cursize;
+	if (s->tablesize)
+		memcpy (ED_SnapSpace(s, s->tablesize), s->table, s->tablesize);
+	trailer = (int *) ED_SnapSpace (s, 8);
+	trailer[0] = ofs;
+	trailer[1] = s->numstrings;
+
+	free (s->table);
+	free (s->strings);
+	free (s->fields);
+	s->table = NULL;
+	s->strings = s->fields = NULL;
+	return s->cursize;
+}
+
+/*
+=============
+ED_SnapOpen
+
+Puts the strings of the table into the string area.  Returns false if
+the data doesn't look like a snapshot.
+=============
+*/
+qboolean ED_SnapOpen (edsnap_t *s, byte *data, int size)
+{
+	const char	*str, *end;
+	char	*p;
+	int		trailer[2];
+	int		i, len;
+
+	memset (s, 0, sizeof(*s));
+	if (size < 8 || size & 3)
+		return false;
+	memcpy (trailer, data + size - 8, 8);
+	if (trailer[0] < 0 || trailer[0] > size - 8 || trailer[1] < 0 || trailer[1] > size)
+		return false;
+
+	s->data = data;
+	s->cursize = trailer[0];
+	s->strings = (int *) malloc ((trailer[1] + 1) * sizeof(int));
+	if (!s->strings)
+		Sys_Error ("%s: out of memory", __thisfunc__);
+	str = (const char *)data + trailer[0];
+	end = (const char *)data + size - 8;
+	for (i = 0; i < trailer[1]; i++)
+	{
+		len = strlen(str) + 1;
+		if (str + len > end)
+			break;
+		s->strings[i] = PR_AllocString (len, &p);
+		memcpy (p, str, len);
+		str += len;
+	}
+	s->numstrings = i;
+	if (i != trailer[1])
+	{
+		ED_SnapClose (s);
+		return false;
+	}
+	ED_SnapFields (s);
+	return true;
+}
+
+qboolean ED_SnapRead (edsnap_t *s, void *dst, int length)
+{
+	int		size = SNAP_ALIGN(length);
+
+	if (s->readcount + size > s->cursize)
+	{
+		s->badread = true;
+		return false;
+	}
+	memcpy (dst, s->data + s->readcount, length);
+	s->readcount += size;
+	return true;
+}
+
+const char *ED_SnapReadString (edsnap_t *s)
+{
+	const char	*str = (const char *)s->data + s->readcount;
+	const char	*end;
+
+	end = (const char *) memchr (str, 0, s->cursize - s->readcount);
+	if (!end)
+	{
+		s->badread = true;
+		return "";
+	}
+	s->readcount += SNAP_ALIGN(end - str + 1);
+	return str;
+}
+
+static int ED_SnapReadStringNum (edsnap_t *s, int num)
+{
+	if (num >= 0)
+		return (num < pr_stringssize) ? num : 0;
+	if (-1 - num >= s->numstrings)
+	{
+		s->badread = true;
+		return 0;
+	}
+	return s->strings[-1 - num];
+}
+
+static int ED_SnapReadEdictNum (edsnap_t *s, int num)
+{
+	if (num < 0 || num >= MAX_EDICTS)
+	{
+		s->badread = true;
+		return 0;
+	}
+	return EDICT_TO_PROG(EDICT_NUM(num));
+}
+
+/*
+=============
+ED_SnapReadGlobals
+=============
+*/
+qboolean ED_SnapReadGlobals (edsnap_t *s)
+{
+	ddef_t	*def;
+	int		i, type, count, val;
+
+	if (!ED_SnapRead (s, &count, 4))
+		return false;
+	for (i = 0; i < progs->numglobaldefs && count > 0; i++)
+	{
+		def = &pr_globaldefs[i];
+		type = def->type & ~DEF_SAVEGLOBAL;
+		if (!(def->type & DEF_SAVEGLOBAL))
+			continue;
+		if (type != ev_string && type != ev_float && type != ev_entity)
+			continue;
+		if (!ED_SnapRead (s, &val, 4))
+			return false;
+		count--;
+		if (type == ev_string)
+			val = ED_SnapReadStringNum (s, val);
+		else if (type == ev_entity)
+			val = ED_SnapReadEdictNum (s, val);
+		((int *)pr_globals)[def->ofs] = val;
+	}
+	if (count)
+		s->badread = true;
+	return !s->badread;
+}
+
+/*
+=============
+ED_SnapReadEdict
+
+Reads the next edict into place and returns its number, or -1 when
+there are no more of them or the data is bad.
+=============
+*/
+int ED_SnapReadEdict (edsnap_t *s)
+{
+	edict_t	*ent;
+	int		*v;
+	int		head[2];
+	int		i;
+
+	if (s->readcount >= s->cursize)
+		return -1;
+	if (!ED_SnapRead (s, head, 8))
+		return -1;
+	if (head[0] < 1 || head[0] >= MAX_EDICTS ||
+	    s->readcount + progs->entityfields * 4 > s->cursize)
+	{
+		s->badread = true;
+		return -1;
+	}
+
+	ent = EDICT_NUM(head[0]);
+	v = (int *) &ent->v;
+	ED_SnapRead (s, v, progs->entityfields * 4);
+	for (i = 0; i < s->numstringfields; i++)
+		v[s->fields[i]] = ED_SnapReadStringNum (s, v[s->fields[i]]);
+	for ( ; i < s->numfields; i++)
+		v[s->fields[i]] = ED_SnapReadEdictNum (s, v[s->fields[i]]);
+	// like ED_ParseEdict, an edict without any fields set is free
+	for (i = 0; i < progs->entityfields && !v[i]; i++)
+		;
+	ent->free = (head[1] || i == progs->entityfields);
+	SV_GridDirty (ent);
+	ED_FindDirty (ent);
+
+	return s->badread ? -1 : head[0];
+}
+
+/*
+=============
+ED_SnapClose
+
+Frees what ED_SnapOpen allocated.  The data stays with the caller.
+=============
+*/
+void ED_SnapClose (edsnap_t *s)
+{
+	free (s->strings);
+	free (s->fields);
+	s->strings = s->fields = NULL;
+}
+
+
 extern int entity_file_size;
 
 /*
@@ -1585,6 +2387,7 @@ void ED_LoadFromFile (const char *data)
 	int		start_amount = current_loading_size;
 	const char	*orig = data;
 	#endif
+	double		start = Sys_DoubleTime ();
 
 	*sv_globals.time = sv.time;
 
@@ -1730,6 +2533,8 @@ void ED_LoadFromFile (const char *data)
 	}
 
 	Con_DPrintf ("%i entities inhibited\n", inhibit);
+
+	maploadstats.loadtime += Sys_DoubleTime () - start;
 }
 
 
@@ -1987,6 +2792,10 @@ void PR_LoadProgs (void)
 	if (pr_knownstrings)
 		Z_Free ((void *)pr_knownstrings);
 	pr_knownstrings = NULL;
+	if (pr_knownstringsfixed)
+		Z_Free (pr_knownstringsfixed);
+	pr_knownstringsfixed = NULL;
+	ED_ClearFindIndex ();
 	PR_SetEngineString(pr_null_string);
 
 	if (progs->version == PROG_VERSION_V6)
@@ -2062,6 +2871,12 @@ void PR_LoadProgs (void)
 	pr_edict_size += sizeof(void *) - 1;
 	pr_edict_size &= ~(sizeof(void *) - 1);
 
+	PR_HashDefs ();
+	memset (&maploadstats, 0, sizeof(maploadstats));
+
+	PR_TranslateProgs ();
+	PR_LoadNativeProgs (fs_filesize);
+
 #if !defined(SERVERONLY)
 	// set the cl_playerclass value after sv_globals has been created
 	if (sv_globals.cl_playerclass)
@@ -2092,8 +2907,15 @@ void PR_Init (void)
 	Cmd_AddCommand ("edicts", ED_PrintEdicts);
 	Cmd_AddCommand ("edictcount", ED_Count);
 	Cmd_AddCommand ("profile", PR_Profile_f);
+	Cmd_AddCommand ("gridstats", SV_GridStats_f);
+	Cmd_AddCommand ("findstats", ED_FindStats_f);
+	Cmd_AddCommand ("maploadstats", ED_MapLoadStats_f);
+
+	ED_InitFindIndex ();
 
 	Cvar_RegisterVariable (&max_temp_edicts);
+	Cvar_RegisterVariable (&pr_threaded);
+	Cvar_RegisterVariable (&pr_native);
 
 #if !defined(H2W)
 	Cvar_RegisterVariable (&nomonsters);
@@ -2155,6 +2977,7 @@ static void PR_AllocStringSlots (void)
 	pr_maxknownstrings += PR_STRING_ALLOCSLOTS;
 	Sys_DPrintf("%s: realloc'ing for %d slots\n", __thisfunc__, pr_maxknownstrings);
 	pr_knownstrings = (const char **) Z_Realloc ((void *)pr_knownstrings, pr_maxknownstrings * sizeof(char *), Z_MAINZONE);
+	pr_knownstringsfixed = (byte *) Z_Realloc (pr_knownstringsfixed, pr_maxknownstrings, Z_MAINZONE);
 }
 
 const char *PR_GetString (int num)
@@ -2212,6 +3035,7 @@ int PR_SetEngineString (const char *s)
 		pr_numknownstrings++;
 //	}
 	pr_knownstrings[i] = s;
+	pr_knownstringsfixed[i] = false;
 	return -1 - i;
 }
 
@@ -2233,6 +3057,7 @@ int PR_AllocString (int size, char **ptr)
 		pr_numknownstrings++;
 //	}
 	pr_knownstrings[i] = (char *)Hunk_AllocName(size, "string");
+	pr_knownstringsfixed[i] = true;
 	if (ptr)
 		*ptr = (char *) pr_knownstrings[i];
 	return -1 - i;
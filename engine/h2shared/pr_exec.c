@@ -24,11 +24,20 @@
 
 #include "quakedef.h"
 #include "q_ctype.h"
+#include "pr_native.h"
 
 // MACROS ------------------------------------------------------------------
 
 #define MAX_STACK_DEPTH	64	/* was 32 */
 #define LOCALSTACK_SIZE	2048
+#define MAX_RUNAWAY	100000	/* statements per PR_ExecuteProgram call */
+
+/* use gcc's labels as values for the threaded interpreter */
+#if defined(__GNUC__)
+#define PRX_COMPUTED_GOTO	1
+#else
+#define PRX_COMPUTED_GOTO	0
+#endif
 
 // TYPES -------------------------------------------------------------------
 
@@ -38,6 +47,37 @@ typedef struct
 	dfunction_t	*f;
 } prstack_t;
 
+/* a statement pre-decoded by PR_TranslateProgs() for the threaded
+ * interpreter: operands are resolved to global pointers and branch
+ * offsets to absolute statement numbers.  pr_code[] is indexed the
+ * same way as pr_statements[], so the return addresses on pr_stack
+ * and pr_xstatement stay valid for both interpreters.  */
+typedef struct
+{
+	unsigned short	op;	/* dispatch opcode: OP_* or one of PRX_* */
+	unsigned short	sop;	/* the same statement without fusion */
+	int		jump;	/* branch target statement, if any */
+	eval_t		*a, *b, *c;
+} prcode_t;
+
+/* fused opcodes: a statement pair executed by one dispatch.  the
+ * second statement keeps its own slot in pr_code[], so jumping into
+ * the middle of a pair simply runs it on its own.  */
+enum {
+	PRX_LOADSTORE = OP_CASERANGE + 1,	/* OP_LOAD_{F,S,ENT,FLD,FNC} + OP_STORE_* */
+	PRX_LOADSTORE_V,	/* OP_LOAD_V + OP_STORE_V */
+	PRX_EQ_F_IFNOT,		/* comparison + OP_IFNOT on its result */
+	PRX_NE_F_IFNOT,
+	PRX_LE_IFNOT,
+	PRX_GE_IFNOT,
+	PRX_LT_IFNOT,
+	PRX_GT_IFNOT,
+	PRX_EQ_E_IFNOT,
+	PRX_NE_E_IFNOT,
+	PRX_BADOP,		/* not a valid opcode */
+	PRX_NUMOPS
+};
+
 /* switch types */
 enum {
 	SWITCH_F,
@@ -58,6 +98,8 @@ const char *PR_GlobalStringNoContents(int ofs);
 
 static int EnterFunction(dfunction_t *f);
 static int LeaveFunction(void);
+static void PR_ExecuteCode(dfunction_t *f);
+static void PR_ExecuteNative(func_t fnum);
 static void PrintStatement(dstatement_t *s);
 static void PrintCallHistory(void);
 
@@ -70,6 +112,19 @@ dfunction_t	*pr_xfunction;
 int		pr_xstatement;
 int		pr_argc;
 
+cvar_t		pr_threaded = {"pr_threaded", "1", CVAR_NONE};
+cvar_t		pr_native = {"pr_native", "1", CVAR_NONE};
+
+int		pr_nativeloops;
+
+#if !defined(USE_PROGS_NATIVE)
+/* no progs compiled in: see utils/qc2c */
+const pr_nativeprogs_t pr_nativeprogs[] =
+{
+	{ PR_NATIVE_VERSION, 0, 0, 0, 0, NULL }
+};
+#endif
+
 // PRIVATE DATA DEFINITIONS ------------------------------------------------
 
 static prstack_t pr_stack[MAX_STACK_DEPTH];
@@ -77,6 +132,9 @@ static int pr_depth;
 static int localstack[LOCALSTACK_SIZE];
 static int localstack_used;
 
+static prcode_t	*pr_code;
+static const pr_nativefunc_t	*pr_nativefuncs;
+
 static const char *pr_opnames[] =
 {
 	"DONE",
@@ -174,6 +232,18 @@ void PR_ExecuteProgram (func_t fnum)
 
 	pr_trace = false;
 
+	if (pr_nativefuncs && pr_native.integer && pr_nativefuncs[fnum])
+	{
+		PR_ExecuteNative(fnum);
+		return;
+	}
+
+	if (pr_code && pr_threaded.integer)
+	{
+		PR_ExecuteCode(f);
+		return;
+	}
+
 	exitdepth = pr_depth;
 
 	st = &pr_statements[EnterFunction(f)];
@@ -186,7 +256,7 @@ void PR_ExecuteProgram (func_t fnum)
 	b = OPB;
 	c = OPC;
 
-	if (++profile > 100000)
+	if (++profile > MAX_RUNAWAY)
 	{
 		pr_xstatement = st - pr_statements;
 		PR_RunError("runaway loop error");
@@ -422,6 +492,10 @@ void PR_ExecuteProgram (func_t fnum)
 			pr_xstatement = st - pr_statements;
 			PR_RunError("assignment to world entity");
 		}
+		if (SV_GRID_FIELD(b->_int))
+			SV_GridDirty (ed);
+		else if (ED_FIND_FIELD(b->_int))
+			ED_FindDirty (ed);
 		c->_int = (byte *)((int *)&ed->v + b->_int) - (byte *)sv.edicts;
 		break;
 
@@ -823,6 +897,1087 @@ void PR_ExecuteProgram (func_t fnum)
 #undef OPC
 
 
+//==========================================================================
+//
+// PR_TranslateProgs
+//
+// Pre-decodes pr_statements into pr_code for PR_ExecuteCode: operand
+// pointers and branch targets are resolved once, and a few common
+// statement pairs are fused into a single dispatch.  Called from
+// PR_LoadProgs once the statements have been byte swapped.
+//
+//==========================================================================
+
+static int PR_JumpTarget (int s, int ofs)
+{
+	if (is_progs_v6)
+		ofs = (signed short)ofs;
+	return s + ofs;
+}
+
+void PR_TranslateProgs (void)
+{
+	dstatement_t	*st;
+	prcode_t	*code;
+	int		i, fused;
+
+	pr_code = (prcode_t *) Hunk_AllocName(progs->numstatements * sizeof(prcode_t), "progcode");
+
+	for (i = 0, st = pr_statements, code = pr_code; i < progs->numstatements; i++, st++, code++)
+	{
+		code->op = code->sop = (st->op > OP_CASERANGE) ? PRX_BADOP : st->op;
+		code->jump = -1;
+		code->a = (eval_t *)&pr_globals[st->a];
+		code->b = (eval_t *)&pr_globals[st->b];
+		code->c = (eval_t *)&pr_globals[st->c];
+
+		switch (st->op)
+		{
+		case OP_IF:
+		case OP_IFNOT:
+		case OP_SWITCH_F:
+		case OP_CASE:
+			code->jump = PR_JumpTarget(i, st->b);
+			break;
+		case OP_GOTO:
+			code->jump = PR_JumpTarget(i, st->a);
+			break;
+		case OP_CASERANGE:
+			code->jump = PR_JumpTarget(i, st->c);
+			break;
+		}
+	}
+
+	/* fuse pairs.  a pair is only fused when the second statement
+	 * consumes the temporary produced by the first one.  */
+	fused = 0;
+	for (i = 0, st = pr_statements, code = pr_code; i < progs->numstatements - 1; i++, st++, code++)
+	{
+		switch (st->op)
+		{
+		case OP_LOAD_F:
+		case OP_LOAD_S:
+		case OP_LOAD_ENT:
+		case OP_LOAD_FLD:
+		case OP_LOAD_FNC:
+			if (st[1].op >= OP_STORE_F && st[1].op <= OP_STORE_FNC &&
+			    st[1].op != OP_STORE_V && st[1].a == st->c)
+				code->op = PRX_LOADSTORE;
+			break;
+		case OP_LOAD_V:
+			if (st[1].op == OP_STORE_V && st[1].a == st->c)
+				code->op = PRX_LOADSTORE_V;
+			break;
+		case OP_EQ_F:
+		case OP_NE_F:
+		case OP_LE:
+		case OP_GE:
+		case OP_LT:
+		case OP_GT:
+		case OP_EQ_E:
+		case OP_NE_E:
+			if (st[1].op != OP_IFNOT || st[1].a != st->c)
+				break;
+			switch (st->op)
+			{
+			case OP_EQ_F:	code->op = PRX_EQ_F_IFNOT;	break;
+			case OP_NE_F:	code->op = PRX_NE_F_IFNOT;	break;
+			case OP_LE:	code->op = PRX_LE_IFNOT;	break;
+			case OP_GE:	code->op = PRX_GE_IFNOT;	break;
+			case OP_LT:	code->op = PRX_LT_IFNOT;	break;
+			case OP_GT:	code->op = PRX_GT_IFNOT;	break;
+			case OP_EQ_E:	code->op = PRX_EQ_E_IFNOT;	break;
+			case OP_NE_E:	code->op = PRX_NE_E_IFNOT;	break;
+			}
+			break;
+		}
+		if (code->op != code->sop)
+			fused++;
+	}
+
+	Con_DPrintf ("Translated %d statements, %d pairs fused\n", progs->numstatements, fused);
+}
+
+
+//==========================================================================
+//
+// PR_ExecuteCode
+//
+// Threaded interpreter over pr_code, selected by the pr_threaded cvar.
+// It must give the same results as the switch interpreter above: the
+// handlers are kept in the same order and the same form as there.  The
+// runaway counter is still bumped for every statement, but it is only
+// checked when control is transferred (branches, calls and returns),
+// which is where any loop has to pass through.  With gcc, tracing is
+// done by swapping the dispatch table, and fused pairs are executed as
+// two separate statements while tracing.
+//
+//==========================================================================
+
+#if PRX_COMPUTED_GOTO
+#define vmcase(l)	label_##l:
+#define vmdispatch	goto *dispatch[ip->op]
+#else
+#define vmcase(l)	case l:
+#define vmdispatch	continue
+#endif
+/* go to the next statement */
+#define vmnext		++ip; ++profile; vmdispatch
+/* go to the next statement after a call or a return */
+#define vmenter		++ip; if (++profile > MAX_RUNAWAY) goto runaway; vmdispatch
+/* go to the branch target of the current statement */
+#define vmjump(t)	ip = &pr_code[(t)]; if (++profile > MAX_RUNAWAY) goto runaway; vmdispatch
+/* the second statement of a fused comparison + OP_IFNOT pair */
+#define vmifnot		++ip; ++profile;					\
+			if (!ip->a->_int) { vmjump(ip->jump); }			\
+			vmnext
+
+static void PR_ExecuteCode (dfunction_t *f)
+{
+	prcode_t	*ip;
+	eval_t		*ptr, *a, *b, *c;
+	float		*vecptr;
+	dfunction_t	*newf;
+	edict_t		*ed;
+	int exitdepth;
+	int profile, startprofile;
+	/* switch/case support:  */
+	int	case_type = -1;
+	float	switch_float = 0;
+#if PRX_COMPUTED_GOTO
+	#define LABEL(l)	[l] = &&label_##l
+	static void * const opcode_labels[PRX_NUMOPS] =
+	{
+		LABEL(OP_DONE),
+		LABEL(OP_MUL_F), LABEL(OP_MUL_V), LABEL(OP_MUL_FV), LABEL(OP_MUL_VF),
+		LABEL(OP_DIV_F),
+		LABEL(OP_ADD_F), LABEL(OP_ADD_V),
+		LABEL(OP_SUB_F), LABEL(OP_SUB_V),
+		LABEL(OP_EQ_F), LABEL(OP_EQ_V), LABEL(OP_EQ_S), LABEL(OP_EQ_E), LABEL(OP_EQ_FNC),
+		LABEL(OP_NE_F), LABEL(OP_NE_V), LABEL(OP_NE_S), LABEL(OP_NE_E), LABEL(OP_NE_FNC),
+		LABEL(OP_LE), LABEL(OP_GE), LABEL(OP_LT), LABEL(OP_GT),
+		LABEL(OP_LOAD_F), LABEL(OP_LOAD_V), LABEL(OP_LOAD_S),
+		LABEL(OP_LOAD_ENT), LABEL(OP_LOAD_FLD), LABEL(OP_LOAD_FNC),
+		LABEL(OP_ADDRESS),
+		LABEL(OP_STORE_F), LABEL(OP_STORE_V), LABEL(OP_STORE_S),
+		LABEL(OP_STORE_ENT), LABEL(OP_STORE_FLD), LABEL(OP_STORE_FNC),
+		LABEL(OP_STOREP_F), LABEL(OP_STOREP_V), LABEL(OP_STOREP_S),
+		LABEL(OP_STOREP_ENT), LABEL(OP_STOREP_FLD), LABEL(OP_STOREP_FNC),
+		LABEL(OP_RETURN),
+		LABEL(OP_NOT_F), LABEL(OP_NOT_V), LABEL(OP_NOT_S), LABEL(OP_NOT_ENT), LABEL(OP_NOT_FNC),
+		LABEL(OP_IF), LABEL(OP_IFNOT),
+		LABEL(OP_CALL0), LABEL(OP_CALL1), LABEL(OP_CALL2), LABEL(OP_CALL3), LABEL(OP_CALL4),
+		LABEL(OP_CALL5), LABEL(OP_CALL6), LABEL(OP_CALL7), LABEL(OP_CALL8),
+		LABEL(OP_STATE),
+		LABEL(OP_GOTO),
+		LABEL(OP_AND), LABEL(OP_OR),
+		LABEL(OP_BITAND), LABEL(OP_BITOR),
+		LABEL(OP_MULSTORE_F), LABEL(OP_MULSTORE_V), LABEL(OP_MULSTOREP_F), LABEL(OP_MULSTOREP_V),
+		LABEL(OP_DIVSTORE_F), LABEL(OP_DIVSTOREP_F),
+		LABEL(OP_ADDSTORE_F), LABEL(OP_ADDSTORE_V), LABEL(OP_ADDSTOREP_F), LABEL(OP_ADDSTOREP_V),
+		LABEL(OP_SUBSTORE_F), LABEL(OP_SUBSTORE_V), LABEL(OP_SUBSTOREP_F), LABEL(OP_SUBSTOREP_V),
+		LABEL(OP_FETCH_GBL_F), LABEL(OP_FETCH_GBL_V), LABEL(OP_FETCH_GBL_S),
+		LABEL(OP_FETCH_GBL_E), LABEL(OP_FETCH_GBL_FNC),
+		LABEL(OP_CSTATE), LABEL(OP_CWSTATE),
+		LABEL(OP_THINKTIME),
+		LABEL(OP_BITSET), LABEL(OP_BITSETP), LABEL(OP_BITCLR), LABEL(OP_BITCLRP),
+		LABEL(OP_RAND0), LABEL(OP_RAND1), LABEL(OP_RAND2),
+		LABEL(OP_RANDV0), LABEL(OP_RANDV1), LABEL(OP_RANDV2),
+		LABEL(OP_SWITCH_F), LABEL(OP_SWITCH_V), LABEL(OP_SWITCH_S),
+		LABEL(OP_SWITCH_E), LABEL(OP_SWITCH_FNC),
+		LABEL(OP_CASE), LABEL(OP_CASERANGE),
+
+		LABEL(PRX_LOADSTORE), LABEL(PRX_LOADSTORE_V),
+		LABEL(PRX_EQ_F_IFNOT), LABEL(PRX_NE_F_IFNOT),
+		LABEL(PRX_LE_IFNOT), LABEL(PRX_GE_IFNOT),
+		LABEL(PRX_LT_IFNOT), LABEL(PRX_GT_IFNOT),
+		LABEL(PRX_EQ_E_IFNOT), LABEL(PRX_NE_E_IFNOT),
+		LABEL(PRX_BADOP)
+	};
+	#undef LABEL
+	static void * const trace_labels[PRX_NUMOPS] =
+	{
+		[0 ... PRX_NUMOPS - 1] = &&do_trace
+	};
+	void * const	*dispatch = opcode_labels;
+#endif
+
+	exitdepth = pr_depth;
+
+	ip = &pr_code[EnterFunction(f)];
+	startprofile = profile = 0;
+
+#if PRX_COMPUTED_GOTO
+	vmenter;
+do_trace:
+	PrintStatement(&pr_statements[ip - pr_code]);
+	goto *opcode_labels[ip->sop];
+#else
+	++ip;
+	if (++profile > MAX_RUNAWAY)
+		goto runaway;
+    while (1)
+    {
+	if (pr_trace)
+	{
+		PrintStatement(&pr_statements[ip - pr_code]);
+	}
+
+	switch (pr_trace ? ip->sop : ip->op)
+	{
+#endif
+	vmcase(OP_ADD_F)
+		ip->c->_float = ip->a->_float + ip->b->_float;
+		vmnext;
+	vmcase(OP_ADD_V)
+		a = ip->a; b = ip->b; c = ip->c;
+		c->vector[0] = a->vector[0] + b->vector[0];
+		c->vector[1] = a->vector[1] + b->vector[1];
+		c->vector[2] = a->vector[2] + b->vector[2];
+		vmnext;
+
+	vmcase(OP_SUB_F)
+		ip->c->_float = ip->a->_float - ip->b->_float;
+		vmnext;
+	vmcase(OP_SUB_V)
+		a = ip->a; b = ip->b; c = ip->c;
+		c->vector[0] = a->vector[0] - b->vector[0];
+		c->vector[1] = a->vector[1] - b->vector[1];
+		c->vector[2] = a->vector[2] - b->vector[2];
+		vmnext;
+
+	vmcase(OP_MUL_F)
+		ip->c->_float = ip->a->_float * ip->b->_float;
+		vmnext;
+	vmcase(OP_MUL_V)
+		a = ip->a; b = ip->b;
+		ip->c->_float = a->vector[0] * b->vector[0] +
+				a->vector[1] * b->vector[1] +
+				a->vector[2] * b->vector[2];
+		vmnext;
+	vmcase(OP_MUL_FV)
+		a = ip->a; b = ip->b; c = ip->c;
+		c->vector[0] = a->_float * b->vector[0];
+		c->vector[1] = a->_float * b->vector[1];
+		c->vector[2] = a->_float * b->vector[2];
+		vmnext;
+	vmcase(OP_MUL_VF)
+		a = ip->a; b = ip->b; c = ip->c;
+		c->vector[0] = b->_float * a->vector[0];
+		c->vector[1] = b->_float * a->vector[1];
+		c->vector[2] = b->_float * a->vector[2];
+		vmnext;
+
+	vmcase(OP_DIV_F)
+		ip->c->_float = ip->a->_float / ip->b->_float;
+		vmnext;
+
+	vmcase(OP_BITAND)
+		ip->c->_float = (int)ip->a->_float & (int)ip->b->_float;
+		vmnext;
+
+	vmcase(OP_BITOR)
+		ip->c->_float = (int)ip->a->_float | (int)ip->b->_float;
+		vmnext;
+
+	vmcase(OP_GE)
+		ip->c->_float = ip->a->_float >= ip->b->_float;
+		vmnext;
+	vmcase(OP_LE)
+		ip->c->_float = ip->a->_float <= ip->b->_float;
+		vmnext;
+	vmcase(OP_GT)
+		ip->c->_float = ip->a->_float > ip->b->_float;
+		vmnext;
+	vmcase(OP_LT)
+		ip->c->_float = ip->a->_float < ip->b->_float;
+		vmnext;
+	vmcase(OP_AND)
+		ip->c->_float = ip->a->_float && ip->b->_float;
+		vmnext;
+	vmcase(OP_OR)
+		ip->c->_float = ip->a->_float || ip->b->_float;
+		vmnext;
+
+	vmcase(OP_NOT_F)
+		ip->c->_float = !ip->a->_float;
+		vmnext;
+	vmcase(OP_NOT_V)
+		a = ip->a;
+		ip->c->_float = !a->vector[0] && !a->vector[1] && !a->vector[2];
+		vmnext;
+	vmcase(OP_NOT_S)
+		ip->c->_float = !ip->a->string || !*PR_GetString(ip->a->string);
+		vmnext;
+	vmcase(OP_NOT_FNC)
+		ip->c->_float = !ip->a->function;
+		vmnext;
+	vmcase(OP_NOT_ENT)
+		ip->c->_float = (PROG_TO_EDICT(ip->a->edict) == sv.edicts);
+		vmnext;
+
+	vmcase(OP_EQ_F)
+		ip->c->_float = ip->a->_float == ip->b->_float;
+		vmnext;
+	vmcase(OP_EQ_V)
+		a = ip->a; b = ip->b;
+		ip->c->_float = (a->vector[0] == b->vector[0]) &&
+				(a->vector[1] == b->vector[1]) &&
+				(a->vector[2] == b->vector[2]);
+		vmnext;
+	vmcase(OP_EQ_S)
+		ip->c->_float = !strcmp(PR_GetString(ip->a->string), PR_GetString(ip->b->string));
+		vmnext;
+	vmcase(OP_EQ_E)
+		ip->c->_float = ip->a->_int == ip->b->_int;
+		vmnext;
+	vmcase(OP_EQ_FNC)
+		ip->c->_float = ip->a->function == ip->b->function;
+		vmnext;
+
+	vmcase(OP_NE_F)
+		ip->c->_float = ip->a->_float != ip->b->_float;
+		vmnext;
+	vmcase(OP_NE_V)
+		a = ip->a; b = ip->b;
+		ip->c->_float = (a->vector[0] != b->vector[0]) ||
+				(a->vector[1] != b->vector[1]) ||
+				(a->vector[2] != b->vector[2]);
+		vmnext;
+	vmcase(OP_NE_S)
+		ip->c->_float = strcmp(PR_GetString(ip->a->string), PR_GetString(ip->b->string));
+		vmnext;
+	vmcase(OP_NE_E)
+		ip->c->_float = ip->a->_int != ip->b->_int;
+		vmnext;
+	vmcase(OP_NE_FNC)
+		ip->c->_float = ip->a->function != ip->b->function;
+		vmnext;
+
+	vmcase(OP_STORE_F)
+	vmcase(OP_STORE_ENT)
+	vmcase(OP_STORE_FLD)	// integers
+	vmcase(OP_STORE_S)
+	vmcase(OP_STORE_FNC)	// pointers
+		ip->b->_int = ip->a->_int;
+		vmnext;
+	vmcase(OP_STORE_V)
+		a = ip->a; b = ip->b;
+		b->vector[0] = a->vector[0];
+		b->vector[1] = a->vector[1];
+		b->vector[2] = a->vector[2];
+		vmnext;
+
+	vmcase(OP_STOREP_F)
+	vmcase(OP_STOREP_ENT)
+	vmcase(OP_STOREP_FLD)	// integers
+	vmcase(OP_STOREP_S)
+	vmcase(OP_STOREP_FNC)	// pointers
+		ptr = (eval_t *)((byte *)sv.edicts + ip->b->_int);
+		ptr->_int = ip->a->_int;
+		vmnext;
+	vmcase(OP_STOREP_V)
+		a = ip->a;
+		ptr = (eval_t *)((byte *)sv.edicts + ip->b->_int);
+		ptr->vector[0] = a->vector[0];
+		ptr->vector[1] = a->vector[1];
+		ptr->vector[2] = a->vector[2];
+		vmnext;
+
+	vmcase(OP_MULSTORE_F)	// f *= f
+		ip->b->_float *= ip->a->_float;
+		vmnext;
+	vmcase(OP_MULSTORE_V)	// v *= f
+		a = ip->a; b = ip->b;
+		b->vector[0] *= a->_float;
+		b->vector[1] *= a->_float;
+		b->vector[2] *= a->_float;
+		vmnext;
+	vmcase(OP_MULSTOREP_F)	// e.f *= f
+		ptr = (eval_t *)((byte *)sv.edicts + ip->b->_int);
+		ip->c->_float = (ptr->_float *= ip->a->_float);
+		vmnext;
+	vmcase(OP_MULSTOREP_V)	// e.v *= f
+		a = ip->a; c = ip->c;
+		ptr = (eval_t *)((byte *)sv.edicts + ip->b->_int);
+		c->vector[0] = (ptr->vector[0] *= a->_float);
+		c->vector[0] = (ptr->vector[1] *= a->_float);
+		c->vector[0] = (ptr->vector[2] *= a->_float);
+		vmnext;
+
+	vmcase(OP_DIVSTORE_F)	// f /= f
+		ip->b->_float /= ip->a->_float;
+		vmnext;
+	vmcase(OP_DIVSTOREP_F)	// e.f /= f
+		ptr = (eval_t *)((byte *)sv.edicts + ip->b->_int);
+		ip->c->_float = (ptr->_float /= ip->a->_float);
+		vmnext;
+
+	vmcase(OP_ADDSTORE_F)	// f += f
+		ip->b->_float += ip->a->_float;
+		vmnext;
+	vmcase(OP_ADDSTORE_V)	// v += v
+		a = ip->a; b = ip->b;
+		b->vector[0] += a->vector[0];
+		b->vector[1] += a->vector[1];
+		b->vector[2] += a->vector[2];
+		vmnext;
+	vmcase(OP_ADDSTOREP_F)	// e.f += f
+		ptr = (eval_t *)((byte *)sv.edicts + ip->b->_int);
+		ip->c->_float = (ptr->_float += ip->a->_float);
+		vmnext;
+	vmcase(OP_ADDSTOREP_V)	// e.v += v
+		a = ip->a; c = ip->c;
+		ptr = (eval_t *)((byte *)sv.edicts + ip->b->_int);
+		c->vector[0] = (ptr->vector[0] += a->vector[0]);
+		c->vector[1] = (ptr->vector[1] += a->vector[1]);
+		c->vector[2] = (ptr->vector[2] += a->vector[2]);
+		vmnext;
+
+	vmcase(OP_SUBSTORE_F)	// f -= f
+		ip->b->_float -= ip->a->_float;
+		vmnext;
+	vmcase(OP_SUBSTORE_V)	// v -= v
+		a = ip->a; b = ip->b;
+		b->vector[0] -= a->vector[0];
+		b->vector[1] -= a->vector[1];
+		b->vector[2] -= a->vector[2];
+		vmnext;
+	vmcase(OP_SUBSTOREP_F)	// e.f -= f
+		ptr = (eval_t *)((byte *)sv.edicts + ip->b->_int);
+		ip->c->_float = (ptr->_float -= ip->a->_float);
+		vmnext;
+	vmcase(OP_SUBSTOREP_V)	// e.v -= v
+		a = ip->a; c = ip->c;
+		ptr = (eval_t *)((byte *)sv.edicts + ip->b->_int);
+		c->vector[0] = (ptr->vector[0] -= a->vector[0]);
+		c->vector[1] = (ptr->vector[1] -= a->vector[1]);
+		c->vector[2] = (ptr->vector[2] -= a->vector[2]);
+		vmnext;
+
+	vmcase(OP_ADDRESS)
+		ed = PROG_TO_EDICT(ip->a->edict);
+#ifdef PARANOID
+		NUM_FOR_EDICT(ed);	// Make sure it's in range
+#endif
+		if (ed == (edict_t *)sv.edicts && sv.state == ss_active)
+		{
+			pr_xstatement = ip - pr_code;
+			PR_RunError("assignment to world entity");
+		}
+		if (SV_GRID_FIELD(ip->b->_int))
+			SV_GridDirty (ed);
+		else if (ED_FIND_FIELD(ip->b->_int))
+			ED_FindDirty (ed);
+		ip->c->_int = (byte *)((int *)&ed->v + ip->b->_int) - (byte *)sv.edicts;
+		vmnext;
+
+	vmcase(OP_LOAD_F)
+	vmcase(OP_LOAD_FLD)
+	vmcase(OP_LOAD_ENT)
+	vmcase(OP_LOAD_S)
+	vmcase(OP_LOAD_FNC)
+		ed = PROG_TO_EDICT(ip->a->edict);
+#ifdef PARANOID
+		NUM_FOR_EDICT(ed);	// Make sure it's in range
+#endif
+		ptr = (eval_t *)((int *)&ed->v + ip->b->_int);
+		ip->c->_int = ptr->_int;
+		vmnext;
+
+	vmcase(OP_LOAD_V)
+		ed = PROG_TO_EDICT(ip->a->edict);
+#ifdef PARANOID
+		NUM_FOR_EDICT(ed);	// Make sure it's in range
+#endif
+		c = ip->c;
+		ptr = (eval_t *)((int *)&ed->v + ip->b->_int);
+		c->vector[0] = ptr->vector[0];
+		c->vector[1] = ptr->vector[1];
+		c->vector[2] = ptr->vector[2];
+		vmnext;
+
+	vmcase(PRX_LOADSTORE)	// OP_LOAD_* + OP_STORE_*
+		ed = PROG_TO_EDICT(ip->a->edict);
+#ifdef PARANOID
+		NUM_FOR_EDICT(ed);	// Make sure it's in range
+#endif
+		ptr = (eval_t *)((int *)&ed->v + ip->b->_int);
+		ip->c->_int = ptr->_int;
+		++ip; ++profile;
+		ip->b->_int = ip->a->_int;
+		vmnext;
+
+	vmcase(PRX_LOADSTORE_V)	// OP_LOAD_V + OP_STORE_V
+		ed = PROG_TO_EDICT(ip->a->edict);
+#ifdef PARANOID
+		NUM_FOR_EDICT(ed);	// Make sure it's in range
+#endif
+		c = ip->c;
+		ptr = (eval_t *)((int *)&ed->v + ip->b->_int);
+		c->vector[0] = ptr->vector[0];
+		c->vector[1] = ptr->vector[1];
+		c->vector[2] = ptr->vector[2];
+		++ip; ++profile;
+		a = ip->a; b = ip->b;
+		b->vector[0] = a->vector[0];
+		b->vector[1] = a->vector[1];
+		b->vector[2] = a->vector[2];
+		vmnext;
+
+	vmcase(OP_FETCH_GBL_F)
+	vmcase(OP_FETCH_GBL_S)
+	vmcase(OP_FETCH_GBL_E)
+	vmcase(OP_FETCH_GBL_FNC)
+	  {	int i = (int)ip->b->_float;
+		if (i < 0 || i > ((int *)ip->a)[-1])
+		{
+			pr_xstatement = ip - pr_code;
+			PR_RunError("array index out of bounds: %d", i);
+		}
+		ptr = (eval_t *)(&ip->a->_float + i);
+		ip->c->_int = ptr->_int;
+	  }	vmnext;
+	vmcase(OP_FETCH_GBL_V)
+	  {	int i = (int)ip->b->_float;
+		if (i < 0 || i > ((int *)ip->a)[-1])
+		{
+			pr_xstatement = ip - pr_code;
+			PR_RunError("array index out of bounds: %d", i);
+		}
+		c = ip->c;
+		ptr = (eval_t *)(&ip->a->_float + (i * 3));
+		c->vector[0] = ptr->vector[0];
+		c->vector[1] = ptr->vector[1];
+		c->vector[2] = ptr->vector[2];
+	  }	vmnext;
+
+	vmcase(OP_IFNOT)
+		if (!ip->a->_int)
+		{
+			vmjump(ip->jump);
+		}
+		vmnext;
+
+	vmcase(OP_IF)
+		if (ip->a->_int)
+		{
+			vmjump(ip->jump);
+		}
+		vmnext;
+
+	vmcase(OP_GOTO)
+		vmjump(ip->jump);
+
+	vmcase(PRX_EQ_F_IFNOT)	// comparison + OP_IFNOT
+		ip->c->_float = ip->a->_float == ip->b->_float;
+		vmifnot;
+	vmcase(PRX_NE_F_IFNOT)
+		ip->c->_float = ip->a->_float != ip->b->_float;
+		vmifnot;
+	vmcase(PRX_LE_IFNOT)
+		ip->c->_float = ip->a->_float <= ip->b->_float;
+		vmifnot;
+	vmcase(PRX_GE_IFNOT)
+		ip->c->_float = ip->a->_float >= ip->b->_float;
+		vmifnot;
+	vmcase(PRX_LT_IFNOT)
+		ip->c->_float = ip->a->_float < ip->b->_float;
+		vmifnot;
+	vmcase(PRX_GT_IFNOT)
+		ip->c->_float = ip->a->_float > ip->b->_float;
+		vmifnot;
+	vmcase(PRX_EQ_E_IFNOT)
+		ip->c->_float = ip->a->_int == ip->b->_int;
+		vmifnot;
+	vmcase(PRX_NE_E_IFNOT)
+		ip->c->_float = ip->a->_int != ip->b->_int;
+		vmifnot;
+
+	vmcase(OP_CALL8)
+	vmcase(OP_CALL7)
+	vmcase(OP_CALL6)
+	vmcase(OP_CALL5)
+	vmcase(OP_CALL4)
+	vmcase(OP_CALL3)
+	vmcase(OP_CALL2)	// Copy second arg to shared space
+		vecptr = G_VECTOR(OFS_PARM1);
+		VectorCopy(ip->c->vector, vecptr);
+	vmcase(OP_CALL1)	// Copy first arg to shared space
+		vecptr = G_VECTOR(OFS_PARM0);
+		VectorCopy(ip->b->vector, vecptr);
+	vmcase(OP_CALL0)
+		pr_xfunction->profile += profile - startprofile;
+		startprofile = profile;
+		pr_xstatement = ip - pr_code;
+		pr_argc = ip->sop - OP_CALL0;
+		if (!ip->a->function)
+		{
+			PR_RunError("NULL function");
+		}
+		newf = &pr_functions[ip->a->function];
+		if (newf->first_statement < 0)
+		{ // Built-in function
+			int i = -newf->first_statement;
+			if (i >= pr_numbuiltins)
+			{
+				PR_RunError("Bad builtin call number %d", i);
+			}
+			pr_builtins[i]();
+#if PRX_COMPUTED_GOTO
+			/* traceon/traceoff are builtins, and so is anything
+			 * that can run a nested PR_ExecuteProgram()  */
+			dispatch = pr_trace ? trace_labels : opcode_labels;
+#endif
+			vmenter;
+		}
+		// Normal function
+		ip = &pr_code[EnterFunction(newf)];
+		vmenter;
+
+	vmcase(OP_DONE)
+	vmcase(OP_RETURN)
+	  {
+		float *retptr = &pr_globals[OFS_RETURN];
+		float *valptr = &ip->a->_float;
+		pr_xfunction->profile += profile - startprofile;
+		startprofile = profile;
+		pr_xstatement = ip - pr_code;
+		*retptr++ = *valptr++;
+		*retptr++ = *valptr++;
+		*retptr   = *valptr;
+		ip = &pr_code[LeaveFunction()];
+		if (pr_depth == exitdepth)
+		{ // Done
+			return;
+		}
+	  }	vmenter;
+
+	vmcase(OP_STATE)
+		ed = PROG_TO_EDICT(*sv_globals.self);
+		ed->v.nextthink = *sv_globals.time + HX_FRAME_TIME;
+		ed->v.frame = ip->a->_float;
+		ed->v.think = ip->b->function;
+		vmnext;
+
+	vmcase(OP_CSTATE)	// Cycle state
+	  {	int startFrame, endFrame;
+		ed = PROG_TO_EDICT(*sv_globals.self);
+		ed->v.nextthink = *sv_globals.time + HX_FRAME_TIME;
+		ed->v.think = pr_xfunction - pr_functions;
+		*sv_globals.cycle_wrapped = false;
+		startFrame = (int)ip->a->_float;
+		endFrame = (int)ip->b->_float;
+		if (startFrame <= endFrame)
+		{ // Increment
+			if (ed->v.frame < startFrame || ed->v.frame > endFrame)
+			{
+				ed->v.frame = startFrame;
+			}
+			else
+			{
+				ed->v.frame++;
+				if (ed->v.frame > endFrame)
+				{
+					*sv_globals.cycle_wrapped = true;
+					ed->v.frame = startFrame;
+				}
+			}
+		}
+		else
+		{ // Decrement
+			if (ed->v.frame > startFrame || ed->v.frame < endFrame)
+			{
+				ed->v.frame = startFrame;
+			}
+			else
+			{
+				ed->v.frame--;
+				if (ed->v.frame < endFrame)
+				{
+					*sv_globals.cycle_wrapped = true;
+					ed->v.frame = startFrame;
+				}
+			}
+		}
+	  }	vmnext;
+
+	vmcase(OP_CWSTATE)	// Cycle weapon state
+	  {	int startFrame, endFrame;
+		ed = PROG_TO_EDICT(*sv_globals.self);
+		ed->v.nextthink = *sv_globals.time + HX_FRAME_TIME;
+		ed->v.think = pr_xfunction - pr_functions;
+		*sv_globals.cycle_wrapped = false;
+		startFrame = (int)ip->a->_float;
+		endFrame = (int)ip->b->_float;
+		if (startFrame <= endFrame)
+		{ // Increment
+			if (ed->v.weaponframe < startFrame
+				|| ed->v.weaponframe > endFrame)
+			{
+				ed->v.weaponframe = startFrame;
+			}
+			else
+			{
+				ed->v.weaponframe++;
+				if (ed->v.weaponframe > endFrame)
+				{
+					*sv_globals.cycle_wrapped = true;
+					ed->v.weaponframe = startFrame;
+				}
+			}
+		}
+		else
+		{ // Decrement
+			if (ed->v.weaponframe > startFrame
+				|| ed->v.weaponframe < endFrame)
+			{
+				ed->v.weaponframe = startFrame;
+			}
+			else
+			{
+				ed->v.weaponframe--;
+				if (ed->v.weaponframe < endFrame)
+				{
+					*sv_globals.cycle_wrapped = true;
+					ed->v.weaponframe = startFrame;
+				}
+			}
+		}
+	  }	vmnext;
+
+	vmcase(OP_THINKTIME)
+		ed = PROG_TO_EDICT(ip->a->edict);
+#ifdef PARANOID
+		NUM_FOR_EDICT(ed);	// Make sure it's in range
+#endif
+		if (ed == (edict_t *)sv.edicts && sv.state == ss_active)
+		{
+			pr_xstatement = ip - pr_code;
+			PR_RunError("assignment to world entity");
+		}
+		ed->v.nextthink = *sv_globals.time + ip->b->_float;
+		vmnext;
+
+	vmcase(OP_BITSET)	// f (+) f
+		ip->b->_float = (int)ip->b->_float | (int)ip->a->_float;
+		vmnext;
+	vmcase(OP_BITSETP)	// e.f (+) f
+		ptr = (eval_t *)((byte *)sv.edicts + ip->b->_int);
+		ptr->_float = (int)ptr->_float | (int)ip->a->_float;
+		vmnext;
+	vmcase(OP_BITCLR)	// f (-) f
+		ip->b->_float = (int)ip->b->_float & ~((int)ip->a->_float);
+		vmnext;
+	vmcase(OP_BITCLRP)	// e.f (-) f
+		ptr = (eval_t *)((byte *)sv.edicts + ip->b->_int);
+		ptr->_float = (int)ptr->_float & ~((int)ip->a->_float);
+		vmnext;
+
+	vmcase(OP_RAND0)
+	  {	float val;
+		val = rand() * (1.0 / RAND_MAX);
+		G_FLOAT(OFS_RETURN) = val;
+	  }	vmnext;
+	vmcase(OP_RAND1)
+	  {	float val;
+		val = rand() * (1.0 / RAND_MAX) * ip->a->_float;
+		G_FLOAT(OFS_RETURN) = val;
+	  }	vmnext;
+	vmcase(OP_RAND2)
+	  {	float val;
+		a = ip->a; b = ip->b;
+		if (a->_float < b->_float)
+		{
+			val = a->_float + (rand() * (1.0 / RAND_MAX) * (b->_float - a->_float));
+		}
+		else
+		{
+			val = b->_float + (rand() * (1.0 / RAND_MAX) * (a->_float - b->_float));
+		}
+		G_FLOAT(OFS_RETURN) = val;
+	  }	vmnext;
+	vmcase(OP_RANDV0)
+	  {	float val;
+		float *retptr = &G_FLOAT(OFS_RETURN);
+		val = rand() * (1.0 / RAND_MAX);
+		*retptr++ = val;
+		val = rand() * (1.0 / RAND_MAX);
+		*retptr++ = val;
+		val = rand() * (1.0 / RAND_MAX);
+		*retptr   = val;
+	  }	vmnext;
+	vmcase(OP_RANDV1)
+	  {	float val;
+		float *retptr = &G_FLOAT(OFS_RETURN);
+		a = ip->a;
+		val = rand() * (1.0 / RAND_MAX) * a->vector[0];
+		*retptr++ = val;
+		val = rand() * (1.0 / RAND_MAX) * a->vector[1];
+		*retptr++ = val;
+		val = rand() * (1.0 / RAND_MAX) * a->vector[2];
+		*retptr   = val;
+	  }	vmnext;
+	vmcase(OP_RANDV2)
+	  {	float val;
+		int	i;
+		float *retptr = &G_FLOAT(OFS_RETURN);
+		a = ip->a; b = ip->b;
+		for (i = 0; i < 3; i++)
+		{
+			if (a->vector[i] < b->vector[i])
+			{
+				val = a->vector[i] + (rand() * (1.0 / RAND_MAX) * (b->vector[i] - a->vector[i]));
+			}
+			else
+			{
+				val = b->vector[i] + (rand() * (1.0 / RAND_MAX) * (a->vector[i] - b->vector[i]));
+			}
+			*retptr++ = val;
+		}
+	  }	vmnext;
+	vmcase(OP_SWITCH_F)
+		case_type = SWITCH_F;
+		switch_float = ip->a->_float;
+		vmjump(ip->jump);
+	vmcase(OP_SWITCH_V)
+	vmcase(OP_SWITCH_S)
+	vmcase(OP_SWITCH_E)
+	vmcase(OP_SWITCH_FNC)
+		pr_xstatement = ip - pr_code;
+		PR_RunError("%s not done yet!", pr_opnames[ip->sop]);
+
+	vmcase(OP_CASERANGE)
+		if (case_type != SWITCH_F)
+		{
+			pr_xstatement = ip - pr_code;
+			PR_RunError("caserange fucked!");
+		}
+		if ((switch_float >= ip->a->_float) && (switch_float <= ip->b->_float))
+		{
+			vmjump(ip->jump);
+		}
+		vmnext;
+	vmcase(OP_CASE)
+		switch (case_type)
+		{
+		case SWITCH_F:
+			if (switch_float == ip->a->_float)
+			{
+				vmjump(ip->jump);
+			}
+			break;
+		case SWITCH_V:
+		case SWITCH_S:
+		case SWITCH_E:
+		case SWITCH_FNC:
+			pr_xstatement = ip - pr_code;
+			PR_RunError("OP_CASE for %s not done yet!",
+					pr_opnames[case_type + OP_SWITCH_F - SWITCH_F]);
+			break;
+		default:
+			pr_xstatement = ip - pr_code;
+			PR_RunError("fucked case!");
+		}
+		vmnext;
+
+	vmcase(PRX_BADOP)
+#if !PRX_COMPUTED_GOTO
+	default:
+#endif
+		pr_xstatement = ip - pr_code;
+		PR_RunError("Bad opcode %i", pr_statements[pr_xstatement].op);
+#if !PRX_COMPUTED_GOTO
+	}
+    }	/* end of while(1) loop */
+#endif
+
+runaway:
+	pr_xstatement = ip - pr_code;
+	PR_RunError("runaway loop error");
+}
+#undef vmcase
+#undef vmdispatch
+#undef vmnext
+#undef vmenter
+#undef vmjump
+#undef vmifnot
+
+
+//==========================================================================
+//
+// PR_LoadNativeProgs
+//
+// Looks for a compiled in C translation of the progs just loaded (see
+// utils/qc2c).  A translation is only used if it was generated from the
+// very same file.  Called from PR_LoadProgs.
+//
+//==========================================================================
+
+void PR_LoadNativeProgs (int filesize)
+{
+	const pr_nativeprogs_t	*p;
+
+	pr_nativefuncs = NULL;
+
+	for (p = pr_nativeprogs; p->functions; p++)
+	{
+		if (p->version != PR_NATIVE_VERSION)
+			continue;
+		if (p->crc != pr_crc || p->filesize != filesize)
+			continue;
+		if (p->numstatements != progs->numstatements ||
+		    p->numfunctions != progs->numfunctions)
+			continue;
+		pr_nativefuncs = p->functions;
+		Con_DPrintf("Using native code for progs (crc %u)\n", pr_crc);
+		return;
+	}
+}
+
+
+//==========================================================================
+//
+// PR_ExecuteNative
+//
+// Runs a function through its C translation.  Profiling and tracing are
+// not available in translated code.
+//
+//==========================================================================
+
+static void PR_ExecuteNative (func_t fnum)
+{
+	int	oldloops;
+
+	oldloops = pr_nativeloops;
+	pr_nativeloops = 0;
+
+	EnterFunction(&pr_functions[fnum]);
+	pr_nativefuncs[fnum]();
+	LeaveFunction();
+
+	pr_nativeloops = oldloops;
+}
+
+
+//==========================================================================
+//
+// PR_NativeCall
+//
+// OP_CALL0 to OP_CALL8 from translated code: the arguments are already
+// in place.  s is the calling statement.
+//
+//==========================================================================
+
+void PR_NativeCall (int s, int argc, func_t fnum)
+{
+	dfunction_t	*newf;
+
+	pr_xstatement = s;
+	pr_argc = argc;
+	if (!fnum)
+	{
+		PR_RunError("NULL function");
+	}
+	if (fnum < 0 || fnum >= progs->numfunctions)
+	{
+		PR_RunError("Bad function number %d", fnum);
+	}
+	newf = &pr_functions[fnum];
+	if (newf->first_statement < 0)
+	{ // Built-in function
+		int i = -newf->first_statement;
+		if (i >= pr_numbuiltins)
+		{
+			PR_RunError("Bad builtin call number %d", i);
+		}
+		pr_builtins[i]();
+		return;
+	}
+
+	if (!pr_nativefuncs[fnum])
+	{ // qc2c left this one to the interpreter
+		PR_ExecuteProgram(fnum);
+		pr_xstatement = s;
+		return;
+	}
+
+	EnterFunction(newf);
+	pr_nativefuncs[fnum]();
+	LeaveFunction();
+	pr_xstatement = s;
+}
+
+
+//==========================================================================
+//
+// PR_NativeCycleState
+//
+// OP_CSTATE and OP_CWSTATE from translated code.
+//
+//==========================================================================
+
+void PR_NativeCycleState (float start, float end, qboolean weapon)
+{
+	edict_t	*ed;
+	float	*frame;
+	int	startFrame, endFrame;
+
+	ed = PROG_TO_EDICT(*sv_globals.self);
+	ed->v.nextthink = *sv_globals.time + HX_FRAME_TIME;
+	ed->v.think = pr_xfunction - pr_functions;
+	*sv_globals.cycle_wrapped = false;
+	startFrame = (int)start;
+	endFrame = (int)end;
+	frame = (weapon) ? &ed->v.weaponframe : &ed->v.frame;
+	if (startFrame <= endFrame)
+	{ // Increment
+		if (*frame < startFrame || *frame > endFrame)
+		{
+			*frame = startFrame;
+		}
+		else
+		{
+			*frame += 1;
+			if (*frame > endFrame)
+			{
+				*sv_globals.cycle_wrapped = true;
+				*frame = startFrame;
+			}
+		}
+	}
+	else
+	{ // Decrement
+		if (*frame > startFrame || *frame < endFrame)
+		{
+			*frame = startFrame;
+		}
+		else
+		{
+			*frame -= 1;
+			if (*frame < endFrame)
+			{
+				*sv_globals.cycle_wrapped = true;
+				*frame = startFrame;
+			}
+		}
+	}
+}
+
+
+//==========================================================================
+//
+// PR_NativeError
+//
+//==========================================================================
+
+void PR_NativeError (int s, const char *error)
+{
+	pr_xstatement = s;
+	PR_RunError("%s", error);
+}
+
+
 //==========================================================================
 //
 // EnterFunction
@@ -0,0 +1,297 @@
+/* pr_native.h -- runtime interface for QuakeC translated to C
+ *
+ * The C files generated by utils/qc2c from a progs.dat include this
+ * header and are linked into the server binary (make PROGS_NATIVE=file.c).
+ * Every statement maps to one of the PRA_ macros below, which must be
+ * kept in sync with the interpreters in pr_exec.c.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef HX2_PR_NATIVE_H
+#define HX2_PR_NATIVE_H
+
+/* bump this whenever the generated code would need to change */
+#define PR_NATIVE_VERSION	1
+
+typedef void (*pr_nativefunc_t) (void);
+
+typedef struct
+{
+	int		version;	/* PR_NATIVE_VERSION */
+	unsigned short	crc;		/* CRC_Block() of the whole progs file */
+	int		filesize;
+	int		numstatements;
+	int		numfunctions;
+	const pr_nativefunc_t	*functions;	/* NULL for builtins */
+} pr_nativeprogs_t;
+
+/* the generated file defines this, terminated by a NULL functions entry */
+extern const pr_nativeprogs_t	pr_nativeprogs[];
+
+extern	int	pr_nativeloops;
+
+void PR_NativeCall (int s, int argc, func_t fnum);
+void PR_NativeCycleState (float start, float end, qboolean weapon);
+FUNC_NORETURN void PR_NativeError (int s, const char *error);
+#ifdef __WATCOMC__
+#pragma aux PR_NativeError aborts;
+#endif
+
+/* generated functions cache pr_globals in a local 'glob' */
+#define PRA_G(o)	((eval_t *)&glob[o])
+#define PRA_PTR(o)	((eval_t *)((byte *)sv.edicts + PRA_G(o)->_int))
+#define PRA_FIELD(a,b)	((eval_t *)((int *)&PROG_TO_EDICT(PRA_G(a)->edict)->v + PRA_G(b)->_int))
+
+#define PRA_ADD_F(s,a,b,c)	PRA_G(c)->_float = PRA_G(a)->_float + PRA_G(b)->_float
+#define PRA_ADD_V(s,a,b,c)	do {					\
+	PRA_G(c)->vector[0] = PRA_G(a)->vector[0] + PRA_G(b)->vector[0];\
+	PRA_G(c)->vector[1] = PRA_G(a)->vector[1] + PRA_G(b)->vector[1];\
+	PRA_G(c)->vector[2] = PRA_G(a)->vector[2] + PRA_G(b)->vector[2];\
+	} while (0)
+#define PRA_SUB_F(s,a,b,c)	PRA_G(c)->_float = PRA_G(a)->_float - PRA_G(b)->_float
+#define PRA_SUB_V(s,a,b,c)	do {					\
+	PRA_G(c)->vector[0] = PRA_G(a)->vector[0] - PRA_G(b)->vector[0];\
+	PRA_G(c)->vector[1] = PRA_G(a)->vector[1] - PRA_G(b)->vector[1];\
+	PRA_G(c)->vector[2] = PRA_G(a)->vector[2] - PRA_G(b)->vector[2];\
+	} while (0)
+#define PRA_MUL_F(s,a,b,c)	PRA_G(c)->_float = PRA_G(a)->_float * PRA_G(b)->_float
+#define PRA_MUL_V(s,a,b,c)	PRA_G(c)->_float =			\
+	PRA_G(a)->vector[0] * PRA_G(b)->vector[0] +			\
+	PRA_G(a)->vector[1] * PRA_G(b)->vector[1] +			\
+	PRA_G(a)->vector[2] * PRA_G(b)->vector[2]
+#define PRA_MUL_FV(s,a,b,c)	do {					\
+	PRA_G(c)->vector[0] = PRA_G(a)->_float * PRA_G(b)->vector[0];	\
+	PRA_G(c)->vector[1] = PRA_G(a)->_float * PRA_G(b)->vector[1];	\
+	PRA_G(c)->vector[2] = PRA_G(a)->_float * PRA_G(b)->vector[2];	\
+	} while (0)
+#define PRA_MUL_VF(s,a,b,c)	do {					\
+	PRA_G(c)->vector[0] = PRA_G(b)->_float * PRA_G(a)->vector[0];	\
+	PRA_G(c)->vector[1] = PRA_G(b)->_float * PRA_G(a)->vector[1];	\
+	PRA_G(c)->vector[2] = PRA_G(b)->_float * PRA_G(a)->vector[2];	\
+	} while (0)
+#define PRA_DIV_F(s,a,b,c)	PRA_G(c)->_float = PRA_G(a)->_float / PRA_G(b)->_float
+#define PRA_BITAND(s,a,b,c)	PRA_G(c)->_float = (int)PRA_G(a)->_float & (int)PRA_G(b)->_float
+#define PRA_BITOR(s,a,b,c)	PRA_G(c)->_float = (int)PRA_G(a)->_float | (int)PRA_G(b)->_float
+#define PRA_GE(s,a,b,c)		PRA_G(c)->_float = PRA_G(a)->_float >= PRA_G(b)->_float
+#define PRA_LE(s,a,b,c)		PRA_G(c)->_float = PRA_G(a)->_float <= PRA_G(b)->_float
+#define PRA_GT(s,a,b,c)		PRA_G(c)->_float = PRA_G(a)->_float > PRA_G(b)->_float
+#define PRA_LT(s,a,b,c)		PRA_G(c)->_float = PRA_G(a)->_float < PRA_G(b)->_float
+#define PRA_AND(s,a,b,c)	PRA_G(c)->_float = PRA_G(a)->_float && PRA_G(b)->_float
+#define PRA_OR(s,a,b,c)		PRA_G(c)->_float = PRA_G(a)->_float || PRA_G(b)->_float
+
+#define PRA_NOT_F(s,a,b,c)	PRA_G(c)->_float = !PRA_G(a)->_float
+#define PRA_NOT_V(s,a,b,c)	PRA_G(c)->_float = !PRA_G(a)->vector[0] && !PRA_G(a)->vector[1] && !PRA_G(a)->vector[2]
+#define PRA_NOT_S(s,a,b,c)	PRA_G(c)->_float = !PRA_G(a)->string || !*PR_GetString(PRA_G(a)->string)
+#define PRA_NOT_FNC(s,a,b,c)	PRA_G(c)->_float = !PRA_G(a)->function
+#define PRA_NOT_ENT(s,a,b,c)	PRA_G(c)->_float = (PROG_TO_EDICT(PRA_G(a)->edict) == sv.edicts)
+
+#define PRA_EQ_F(s,a,b,c)	PRA_G(c)->_float = PRA_G(a)->_float == PRA_G(b)->_float
+#define PRA_EQ_V(s,a,b,c)	PRA_G(c)->_float =			\
+	(PRA_G(a)->vector[0] == PRA_G(b)->vector[0]) &&			\
+	(PRA_G(a)->vector[1] == PRA_G(b)->vector[1]) &&			\
+	(PRA_G(a)->vector[2] == PRA_G(b)->vector[2])
+#define PRA_EQ_S(s,a,b,c)	PRA_G(c)->_float = !strcmp(PR_GetString(PRA_G(a)->string), PR_GetString(PRA_G(b)->string))
+#define PRA_EQ_E(s,a,b,c)	PRA_G(c)->_float = PRA_G(a)->_int == PRA_G(b)->_int
+#define PRA_EQ_FNC(s,a,b,c)	PRA_G(c)->_float = PRA_G(a)->function == PRA_G(b)->function
+#define PRA_NE_F(s,a,b,c)	PRA_G(c)->_float = PRA_G(a)->_float != PRA_G(b)->_float
+#define PRA_NE_V(s,a,b,c)	PRA_G(c)->_float =			\
+	(PRA_G(a)->vector[0] != PRA_G(b)->vector[0]) ||			\
+	(PRA_G(a)->vector[1] != PRA_G(b)->vector[1]) ||			\
+	(PRA_G(a)->vector[2] != PRA_G(b)->vector[2])
+#define PRA_NE_S(s,a,b,c)	PRA_G(c)->_float = strcmp(PR_GetString(PRA_G(a)->string), PR_GetString(PRA_G(b)->string))
+#define PRA_NE_E(s,a,b,c)	PRA_G(c)->_float = PRA_G(a)->_int != PRA_G(b)->_int
+#define PRA_NE_FNC(s,a,b,c)	PRA_G(c)->_float = PRA_G(a)->function != PRA_G(b)->function
+
+#define PRA_STORE(s,a,b,c)	PRA_G(b)->_int = PRA_G(a)->_int
+#define PRA_STORE_V(s,a,b,c)	do {					\
+	PRA_G(b)->vector[0] = PRA_G(a)->vector[0];			\
+	PRA_G(b)->vector[1] = PRA_G(a)->vector[1];			\
+	PRA_G(b)->vector[2] = PRA_G(a)->vector[2];			\
+	} while (0)
+#define PRA_STOREP(s,a,b,c)	PRA_PTR(b)->_int = PRA_G(a)->_int
+#define PRA_STOREP_V(s,a,b,c)	do {					\
+	eval_t *ptr = PRA_PTR(b);					\
+	ptr->vector[0] = PRA_G(a)->vector[0];				\
+	ptr->vector[1] = PRA_G(a)->vector[1];				\
+	ptr->vector[2] = PRA_G(a)->vector[2];				\
+	} while (0)
+
+#define PRA_MULSTORE_F(s,a,b,c)	PRA_G(b)->_float *= PRA_G(a)->_float
+#define PRA_MULSTORE_V(s,a,b,c)	do {					\
+	PRA_G(b)->vector[0] *= PRA_G(a)->_float;			\
+	PRA_G(b)->vector[1] *= PRA_G(a)->_float;			\
+	PRA_G(b)->vector[2] *= PRA_G(a)->_float;			\
+	} while (0)
+#define PRA_MULSTOREP_F(s,a,b,c)	PRA_G(c)->_float = (PRA_PTR(b)->_float *= PRA_G(a)->_float)
+/* same as the interpreters, which only ever update c->vector[0] */
+#define PRA_MULSTOREP_V(s,a,b,c)	do {				\
+	eval_t *ptr = PRA_PTR(b);					\
+	PRA_G(c)->vector[0] = (ptr->vector[0] *= PRA_G(a)->_float);	\
+	PRA_G(c)->vector[0] = (ptr->vector[1] *= PRA_G(a)->_float);	\
+	PRA_G(c)->vector[0] = (ptr->vector[2] *= PRA_G(a)->_float);	\
+	} while (0)
+#define PRA_DIVSTORE_F(s,a,b,c)	PRA_G(b)->_float /= PRA_G(a)->_float
+#define PRA_DIVSTOREP_F(s,a,b,c)	PRA_G(c)->_float = (PRA_PTR(b)->_float /= PRA_G(a)->_float)
+#define PRA_ADDSTORE_F(s,a,b,c)	PRA_G(b)->_float += PRA_G(a)->_float
+#define PRA_ADDSTORE_V(s,a,b,c)	do {					\
+	PRA_G(b)->vector[0] += PRA_G(a)->vector[0];			\
+	PRA_G(b)->vector[1] += PRA_G(a)->vector[1];			\
+	PRA_G(b)->vector[2] += PRA_G(a)->vector[2];			\
+	} while (0)
+#define PRA_ADDSTOREP_F(s,a,b,c)	PRA_G(c)->_float = (PRA_PTR(b)->_float += PRA_G(a)->_float)
+#define PRA_ADDSTOREP_V(s,a,b,c)	do {				\
+	eval_t *ptr = PRA_PTR(b);					\
+	PRA_G(c)->vector[0] = (ptr->vector[0] += PRA_G(a)->vector[0]);	\
+	PRA_G(c)->vector[1] = (ptr->vector[1] += PRA_G(a)->vector[1]);	\
+	PRA_G(c)->vector[2] = (ptr->vector[2] += PRA_G(a)->vector[2]);	\
+	} while (0)
+#define PRA_SUBSTORE_F(s,a,b,c)	PRA_G(b)->_float -= PRA_G(a)->_float
+#define PRA_SUBSTORE_V(s,a,b,c)	do {					\
+	PRA_G(b)->vector[0] -= PRA_G(a)->vector[0];			\
+	PRA_G(b)->vector[1] -= PRA_G(a)->vector[1];			\
+	PRA_G(b)->vector[2] -= PRA_G(a)->vector[2];			\
+	} while (0)
+#define PRA_SUBSTOREP_F(s,a,b,c)	PRA_G(c)->_float = (PRA_PTR(b)->_float -= PRA_G(a)->_float)
+#define PRA_SUBSTOREP_V(s,a,b,c)	do {				\
+	eval_t *ptr = PRA_PTR(b);					\
+	PRA_G(c)->vector[0] = (ptr->vector[0] -= PRA_G(a)->vector[0]);	\
+	PRA_G(c)->vector[1] = (ptr->vector[1] -= PRA_G(a)->vector[1]);	\
+	PRA_G(c)->vector[2] = (ptr->vector[2] -= PRA_G(a)->vector[2]);	\
+	} while (0)
+
+#define PRA_ADDRESS(s,a,b,c)	do {					\
+	edict_t *ed = PROG_TO_EDICT(PRA_G(a)->edict);			\
+	if (ed == (edict_t *)sv.edicts && sv.state == ss_active)	\
+		PR_NativeError(s, "assignment to world entity");	\
+	if (SV_GRID_FIELD(PRA_G(b)->_int))				\
+		SV_GridDirty(ed);					\
+	else if (ED_FIND_FIELD(PRA_G(b)->_int))			\
+		ED_FindDirty(ed);					\
+	PRA_G(c)->_int = (byte *)((int *)&ed->v + PRA_G(b)->_int) - (byte *)sv.edicts;	\
+	} while (0)
+#define PRA_LOAD(s,a,b,c)	PRA_G(c)->_int = PRA_FIELD(a,b)->_int
+#define PRA_LOAD_V(s,a,b,c)	do {					\
+	eval_t *ptr = PRA_FIELD(a,b);					\
+	PRA_G(c)->vector[0] = ptr->vector[0];				\
+	PRA_G(c)->vector[1] = ptr->vector[1];				\
+	PRA_G(c)->vector[2] = ptr->vector[2];				\
+	} while (0)
+
+#define PRA_FETCH_GBL(s,a,b,c)	do {					\
+	int i = (int)PRA_G(b)->_float;					\
+	if (i < 0 || i > PRA_G((a) - 1)->_int)				\
+		PR_NativeError(s, "array index out of bounds");		\
+	PRA_G(c)->_int = PRA_G((a) + i)->_int;				\
+	} while (0)
+#define PRA_FETCH_GBL_V(s,a,b,c)	do {				\
+	int i = (int)PRA_G(b)->_float;					\
+	if (i < 0 || i > PRA_G((a) - 1)->_int)				\
+		PR_NativeError(s, "array index out of bounds");		\
+	PRA_G(c)->vector[0] = PRA_G((a) + i * 3)->vector[0];		\
+	PRA_G(c)->vector[1] = PRA_G((a) + i * 3)->vector[1];		\
+	PRA_G(c)->vector[2] = PRA_G((a) + i * 3)->vector[2];		\
+	} while (0)
+
+#define PRA_STATE(s,a,b,c)	do {					\
+	edict_t *ed = PROG_TO_EDICT(*sv_globals.self);			\
+	ed->v.nextthink = *sv_globals.time + HX_FRAME_TIME;		\
+	ed->v.frame = PRA_G(a)->_float;					\
+	ed->v.think = PRA_G(b)->function;				\
+	} while (0)
+#define PRA_CSTATE(s,a,b,c)	PR_NativeCycleState(PRA_G(a)->_float, PRA_G(b)->_float, false)
+#define PRA_CWSTATE(s,a,b,c)	PR_NativeCycleState(PRA_G(a)->_float, PRA_G(b)->_float, true)
+#define PRA_THINKTIME(s,a,b,c)	do {					\
+	edict_t *ed = PROG_TO_EDICT(PRA_G(a)->edict);			\
+	if (ed == (edict_t *)sv.edicts && sv.state == ss_active)	\
+		PR_NativeError(s, "assignment to world entity");	\
+	ed->v.nextthink = *sv_globals.time + PRA_G(b)->_float;		\
+	} while (0)
+
+#define PRA_BITSET(s,a,b,c)	PRA_G(b)->_float = (int)PRA_G(b)->_float | (int)PRA_G(a)->_float
+#define PRA_BITSETP(s,a,b,c)	do {					\
+	eval_t *ptr = PRA_PTR(b);					\
+	ptr->_float = (int)ptr->_float | (int)PRA_G(a)->_float;		\
+	} while (0)
+#define PRA_BITCLR(s,a,b,c)	PRA_G(b)->_float = (int)PRA_G(b)->_float & ~((int)PRA_G(a)->_float)
+#define PRA_BITCLRP(s,a,b,c)	do {					\
+	eval_t *ptr = PRA_PTR(b);					\
+	ptr->_float = (int)ptr->_float & ~((int)PRA_G(a)->_float);	\
+	} while (0)
+
+#define PRA_RANDOM		(rand() * (1.0 / RAND_MAX))
+#define PRA_RAND0(s,a,b,c)	do {					\
+	float val = PRA_RANDOM;						\
+	glob[OFS_RETURN] = val;						\
+	} while (0)
+#define PRA_RAND1(s,a,b,c)	do {					\
+	float val = PRA_RANDOM * PRA_G(a)->_float;			\
+	glob[OFS_RETURN] = val;						\
+	} while (0)
+#define PRA_RAND2(s,a,b,c)	do {					\
+	float val;							\
+	if (PRA_G(a)->_float < PRA_G(b)->_float)			\
+		val = PRA_G(a)->_float + (PRA_RANDOM * (PRA_G(b)->_float - PRA_G(a)->_float));	\
+	else								\
+		val = PRA_G(b)->_float + (PRA_RANDOM * (PRA_G(a)->_float - PRA_G(b)->_float));	\
+	glob[OFS_RETURN] = val;						\
+	} while (0)
+#define PRA_RANDV0(s,a,b,c)	do {					\
+	float val;							\
+	val = PRA_RANDOM; glob[OFS_RETURN+0] = val;			\
+	val = PRA_RANDOM; glob[OFS_RETURN+1] = val;			\
+	val = PRA_RANDOM; glob[OFS_RETURN+2] = val;			\
+	} while (0)
+#define PRA_RANDV1(s,a,b,c)	do {					\
+	float val;							\
+	val = PRA_RANDOM * PRA_G(a)->vector[0]; glob[OFS_RETURN+0] = val;\
+	val = PRA_RANDOM * PRA_G(a)->vector[1]; glob[OFS_RETURN+1] = val;\
+	val = PRA_RANDOM * PRA_G(a)->vector[2]; glob[OFS_RETURN+2] = val;\
+	} while (0)
+#define PRA_RANDV2(s,a,b,c)	do {					\
+	float val;							\
+	int i;								\
+	for (i = 0; i < 3; i++)						\
+	{								\
+		if (PRA_G(a)->vector[i] < PRA_G(b)->vector[i])		\
+			val = PRA_G(a)->vector[i] + (PRA_RANDOM * (PRA_G(b)->vector[i] - PRA_G(a)->vector[i]));	\
+		else							\
+			val = PRA_G(b)->vector[i] + (PRA_RANDOM * (PRA_G(a)->vector[i] - PRA_G(b)->vector[i]));	\
+		glob[OFS_RETURN+i] = val;				\
+	}								\
+	} while (0)
+
+/* calls and returns */
+#define PRA_CALL(s,n,a,b,c)	do {					\
+	if ((n) >= 2) VectorCopy(PRA_G(c)->vector, &glob[OFS_PARM1]);	\
+	if ((n) >= 1) VectorCopy(PRA_G(b)->vector, &glob[OFS_PARM0]);	\
+	PR_NativeCall(s, n, PRA_G(a)->function);			\
+	} while (0)
+#define PRA_RETURN(s,a)		do {					\
+	glob[OFS_RETURN+0] = glob[(a)+0];				\
+	glob[OFS_RETURN+1] = glob[(a)+1];				\
+	glob[OFS_RETURN+2] = glob[(a)+2];				\
+	pr_xstatement = s;						\
+	return;								\
+	} while (0)
+
+/* taken backward branches count towards the runaway loop limit */
+#define PRA_LOOP(s)		do {					\
+	if (++pr_nativeloops > 100000)					\
+		PR_NativeError(s, "runaway loop error");		\
+	} while (0)
+
+#endif	/* HX2_PR_NATIVE_H */
@@ -87,6 +87,8 @@ extern	qboolean	is_progs_v6;
 void PR_Init (void);
 
 void PR_ExecuteProgram (func_t fnum);
+void PR_TranslateProgs (void);
+void PR_LoadNativeProgs (int filesize);
 void PR_LoadProgs (void);
 
 const char *PR_GetString (int num);
@@ -107,8 +109,57 @@ const char *ED_ParseEdict (const char *data, edict_t *ent);
 void ED_WriteGlobals (FILE *f);
 void ED_ParseGlobals (const char *data);
 
+/* binary snapshots of the edicts and the saved globals for savegames,
+ * only good for the progs that wrote them */
+typedef struct
+{
+	byte	*data;		/* malloc'ed when writing */
+	int		cursize;	/* reading: end of the edicts */
+	int		maxsize;
+	int		readcount;
+	qboolean	badread;
+	int		*strings;	/* writing: known string -> table index + 1
+				 * reading: string_t of each table entry */
+	int		numstrings;
+	byte	*table;
+	int		tablesize, maxtable;
+	int		*fields;	/* string field offsets, then entity ones */
+	int		numstringfields, numfields;
+} edsnap_t;
+
+void ED_SnapBegin (edsnap_t *s);
+void *ED_SnapSpace (edsnap_t *s, int length);
+void ED_SnapWriteString (edsnap_t *s, const char *str);
+void ED_SnapWriteGlobals (edsnap_t *s);
+void ED_SnapWriteEdict (edsnap_t *s, edict_t *ed);
+int ED_SnapEnd (edsnap_t *s);
+// appends the string table and returns the size of s->data
+
+qboolean ED_SnapOpen (edsnap_t *s, byte *data, int size);
+qboolean ED_SnapRead (edsnap_t *s, void *dst, int length);
+const char *ED_SnapReadString (edsnap_t *s);
+qboolean ED_SnapReadGlobals (edsnap_t *s);
+int ED_SnapReadEdict (edsnap_t *s);
+void ED_SnapClose (edsnap_t *s);
+
 void ED_LoadFromFile (const char *data);
 
+void ED_FindDirty (edict_t *ent);
+// call whenever one of the indexed string fields of ent might change
+
+int ED_FindString (int ofs, const char *s, int start);
+// returns the first edict after start whose field at ofs reads s, or
+// 0 if there is none.  returns -1 if the field isn't indexed
+
+void ED_FindStats_f (void);
+
+// progs took the address of one of the fields find is indexed on
+#define	ED_FIND_FIELD(ofs)						\
+	((ofs) == (int)(offsetof(entvars_t, classname) / 4) ||		\
+	 (ofs) == (int)(offsetof(entvars_t, targetname) / 4) ||		\
+	 (ofs) == (int)(offsetof(entvars_t, target) / 4) ||		\
+	 (ofs) == (int)(offsetof(entvars_t, netname) / 4))
+
 /*
 #define EDICT_NUM(n)		((edict_t *)(sv.edicts+ (n)*pr_edict_size))
 #define NUM_FOR_EDICT(e)	(((byte *)(e) - sv.edicts) / pr_edict_size)
@@ -163,6 +214,8 @@ void ED_PrintNum (int ent);
 eval_t *GetEdictFieldValue(edict_t *ed, const char *field);
 
 extern	cvar_t		max_temp_edicts;
+extern	cvar_t		pr_threaded;
+extern	cvar_t		pr_native;
 
 extern	qboolean	ignore_precache;
 
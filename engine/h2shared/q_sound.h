@@ -151,6 +151,9 @@ extern	vec3_t		listener_up;
 
 extern	cvar_t		sfxvolume;
 extern	cvar_t		loadas8bit;
+extern	cvar_t		snd_mixsimd;
+extern	cvar_t		snd_resample;
+extern	cvar_t		snd_resamplecache;
 
 #define	MAX_RAW_SAMPLES	8192
 extern	portable_samplepair_t	s_rawsamples[MAX_RAW_SAMPLES];
@@ -165,6 +168,7 @@ sfxcache_t *S_LoadSound (sfx_t *s);
 wavinfo_t GetWavinfo (const char *name, byte *wav, int wavlength);
 
 void SND_InitScaletable (void);
+void S_SoundBench_f (void);
 
 ASM_LINKAGE_BEGIN
 #if id386
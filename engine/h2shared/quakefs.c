@@ -28,6 +28,10 @@
 #endif
 #include "filenames.h"
 #include "hashindex.h"
+#if defined(PLATFORM_UNIX)
+#include <sys/mman.h>
+#define	FS_MMAP		1
+#endif
 
 typedef struct
 {
@@ -42,6 +46,8 @@ typedef struct pack_s
 	int	numfiles;
 	pakfiles_t	*files;
 	hashindex_t	hash;
+	byte	*mapbase;	/* the whole pak mapped read only, or NULL */
+	long	mapsize;
 } pack_t;
 
 typedef struct searchpath_s
@@ -67,6 +73,22 @@ unsigned int	gameflags;
 cvar_t	oem = {"oem", "0", CVAR_ROM};
 cvar_t	registered = {"registered", "0", CVAR_ROM};
 
+typedef struct
+{
+	int	opens;		/* stdio handles given out by FS_OpenFile */
+	int	loads;		/* files copied into memory by FS_LoadFile */
+	double	loadbytes;
+	int	views;		/* FS_OpenView calls */
+	int	viewcopies;	/* views that had to be read into memory */
+	double	viewbytes;
+	double	time;		/* seconds spent loading and opening views */
+} fsstats_t;
+
+static fsstats_t	fs_stats;
+static fsstats_t	fs_mapstart, fs_mapstats;	/* for the last map change */
+static double	fs_mapstarttime, fs_maptime;
+static qboolean	fs_nommap;
+
 typedef struct
 {
 	int	numfiles;
@@ -248,6 +270,59 @@ static unsigned int check_known_paks (int paknum, int numfiles, unsigned short c
 	return GAME_MODIFIED;	/* we shouldn't reach here */
 }
 
+/*
+=================
+FS_MapPack
+
+Maps the whole pak read only, so that files can be loaded or viewed
+without going through stdio.  Leaves mapbase NULL if it can't.
+=================
+*/
+static void FS_MapPack (pack_t *pack)
+{
+#if defined(FS_MMAP)
+	void	*base;
+	long	size;
+
+	pack->mapbase = NULL;
+	pack->mapsize = 0;
+	if (fs_nommap)
+		return;
+
+	size = Sys_filesize (pack->filename);
+	if (size <= 0)
+		return;
+	base = mmap (NULL, (size_t) size, PROT_READ, MAP_SHARED, fileno(pack->handle), 0);
+	if (base == MAP_FAILED)
+	{
+		Sys_Printf ("WARNING: couldn't map %s, using stdio\n", pack->filename);
+		return;
+	}
+
+	pack->mapbase = (byte *) base;
+	pack->mapsize = size;
+#endif	/* FS_MMAP */
+}
+
+/*
+=================
+FS_ClosePack
+
+Unmaps and closes the pak and frees it.
+=================
+*/
+static void FS_ClosePack (pack_t *pack)
+{
+#if defined(FS_MMAP)
+	if (pack->mapbase)
+		munmap (pack->mapbase, (size_t) pack->mapsize);
+#endif
+	fclose (pack->handle);
+	Z_Free (pack->files);
+	Hash_Free (&pack->hash);
+	Z_Free (pack);
+}
+
 /*
 =================
 FS_LoadPackFile
@@ -338,6 +413,7 @@ static pack_t *FS_LoadPackFile (const char *packfile, int paknum, qboolean base_
 	pack->handle = packhandle;
 	pack->numfiles = numpackfiles;
 	pack->files = newfiles;
+	FS_MapPack (pack);
 
 	Sys_Printf ("Added packfile %s (%i files, %i crc)\n", packfile, numpackfiles, crc);
 	return pack;
@@ -481,12 +557,7 @@ void FS_Gamedir (const char *dir)
 	while (fs_searchpaths != fs_base_searchpaths)
 	{
 		if (fs_searchpaths->pack)
-		{
-			fclose (fs_searchpaths->pack->handle);
-			Z_Free (fs_searchpaths->pack->files);
-			Hash_Free(&fs_searchpaths->pack->hash);
-			Z_Free (fs_searchpaths->pack);
-		}
+			FS_ClosePack (fs_searchpaths->pack);
 		next = fs_searchpaths->next;
 		Z_Free (fs_searchpaths);
 		fs_searchpaths = next;
@@ -755,16 +826,17 @@ int FS_CreatePath (char *path)
 
 /*
 ===========
-FS_OpenFile
+FS_FindFile
 
-Finds the file in the search path, returns fs_filesize.
+Finds the file in the search path and sets fs_filesize.  Returns the
+search path it is in, with the index of the file in *pakfile if that is
+a pak, or its full path in ospath.  Returns NULL if it can't be found.
 ===========
 */
-long FS_OpenFile (const char *filename, FILE **file, unsigned int *path_id)
+static searchpath_t *FS_FindFile (const char *filename, int *pakfile, char *ospath, size_t ospathsize)
 {
 	searchpath_t	*search;
 	pack_t		*pak;
-	char	ospath[MAX_OSPATH];
 	int	i, key;
 
 	file_from_pak = 0;
@@ -783,39 +855,104 @@ long FS_OpenFile (const char *filename, FILE **file, unsigned int *path_id)
 				/* found it! */
 				fs_filesize = pak->files[i].filelen;
 				file_from_pak = 1;
-				if (path_id)
-					*path_id = search->path_id;
-				if (!file) /* for FS_FileExists() */
-					return fs_filesize;
-				/* open a new file on the pakfile */
-				*file = fopen (pak->filename, "rb");
-				if (!*file)
-					Sys_Error ("Couldn't reopen %s", pak->filename);
-				fseek (*file, pak->files[i].filepos, SEEK_SET);
-				return fs_filesize;
+				*pakfile = i;
+				return search;
 			}
 		}
 		else	/* check a file in the directory tree */
 		{
-			q_snprintf (ospath, sizeof(ospath), "%s/%s",search->filename, filename);
+			q_snprintf (ospath, ospathsize, "%s/%s",search->filename, filename);
 			fs_filesize = Sys_filesize (ospath);
 			if (fs_filesize < 0)
 				continue;
-			if (path_id)
-				*path_id = search->path_id;
-			if (!file) /* for FS_FileExists() */
-				return fs_filesize;
-			*file = fopen (ospath, "rb");
-			if (!*file)
-				Sys_Error ("Couldn't reopen %s", ospath);
-			return fs_filesize;
+			*pakfile = -1;
+			return search;
 		}
 	}
 
 	Sys_DPrintf ("%s: can't find %s\n", __thisfunc__, filename);
 
-	if (file) *file = NULL;
 	fs_filesize = -1;
+	return NULL;
+}
+
+/*
+===========
+FS_OpenFound
+
+Opens a file found by FS_FindFile with stdio.
+===========
+*/
+static FILE *FS_OpenFound (searchpath_t *search, int pakfile, const char *ospath)
+{
+	FILE	*f;
+
+	fs_stats.opens++;
+	if (search->pack)
+	{
+		/* open a new file on the pakfile */
+		f = fopen (search->pack->filename, "rb");
+		if (!f)
+			Sys_Error ("Couldn't reopen %s", search->pack->filename);
+		fseek (f, search->pack->files[pakfile].filepos, SEEK_SET);
+		return f;
+	}
+
+	f = fopen (ospath, "rb");
+	if (!f)
+		Sys_Error ("Couldn't reopen %s", ospath);
+	return f;
+}
+
+/*
+===========
+FS_MappedFile
+
+Returns where a file found by FS_FindFile starts in the pak's mapping,
+or NULL if it isn't mapped.
+===========
+*/
+static const byte *FS_MappedFile (searchpath_t *search, int pakfile)
+{
+	pakfiles_t	*info;
+
+	if (!search->pack || !search->pack->mapbase)
+		return NULL;
+
+	info = &search->pack->files[pakfile];
+	if (info->filepos < 0 || info->filelen < 0 ||
+	    info->filepos > search->pack->mapsize - info->filelen)
+		return NULL;	/* pak truncated after it was loaded: stdio will tell */
+
+	return search->pack->mapbase + info->filepos;
+}
+
+/*
+===========
+FS_OpenFile
+
+Finds the file in the search path, returns fs_filesize.
+===========
+*/
+long FS_OpenFile (const char *filename, FILE **file, unsigned int *path_id)
+{
+	searchpath_t	*search;
+	char	ospath[MAX_OSPATH];
+	int	pakfile;
+
+	search = FS_FindFile (filename, &pakfile, ospath, sizeof(ospath));
+	if (!search)
+	{
+		if (file) *file = NULL;
+		return fs_filesize;
+	}
+
+	if (path_id)
+		*path_id = search->path_id;
+	if (!file) /* for FS_FileExists() */
+		return fs_filesize;
+
+	*file = FS_OpenFound (search, pakfile, ospath);
 	return fs_filesize;
 }
 
@@ -881,17 +1018,16 @@ static int		zone_num;
 #define Draw_EndDisc()
 #endif
 
-static byte *FS_LoadFile (const char *path, int usehunk, unsigned int *path_id)
+static byte *FS_LoadFound (searchpath_t *search, int pakfile, const char *ospath,
+			   const char *path, int usehunk)
 {
 	FILE	*h;
 	byte	*buf;
+	const byte	*mapped;
 	char	base[32];
 	long	len;
 
-/* look for it in the filesystem or pack files */
-	len = FS_OpenFile (path, &h, path_id);
-	if (len < 0)
-		return NULL;
+	len = fs_filesize;
 
 /* extract the file's base name for hunk tag */
 	COM_FileBase (path, base, sizeof(base));
@@ -931,6 +1067,14 @@ static byte *FS_LoadFile (const char *path, int usehunk, unsigned int *path_id)
 
 	((byte *)buf)[len] = 0;
 
+	mapped = FS_MappedFile (search, pakfile);
+	if (mapped)
+	{
+		memcpy (buf, mapped, (size_t)len);
+		return buf;
+	}
+
+	h = FS_OpenFound (search, pakfile, ospath);
 	Draw_BeginDisc ();
 	if (!fread(buf, (size_t)len, 1, h))
 		Sys_Error ("%s: Error reading %s", __thisfunc__, path);
@@ -940,6 +1084,31 @@ static byte *FS_LoadFile (const char *path, int usehunk, unsigned int *path_id)
 	return buf;
 }
 
+static byte *FS_LoadFile (const char *path, int usehunk, unsigned int *path_id)
+{
+	searchpath_t	*search;
+	char	ospath[MAX_OSPATH];
+	int	pakfile;
+	byte	*buf;
+	double	start;
+
+	start = Sys_DoubleTime ();
+
+/* look for it in the filesystem or pack files */
+	search = FS_FindFile (path, &pakfile, ospath, sizeof(ospath));
+	if (!search)
+		return NULL;
+	if (path_id)
+		*path_id = search->path_id;
+
+	buf = FS_LoadFound (search, pakfile, ospath, path, usehunk);
+
+	fs_stats.loads++;
+	fs_stats.loadbytes += fs_filesize;
+	fs_stats.time += Sys_DoubleTime () - start;
+	return buf;
+}
+
 byte *FS_LoadHunkFile (const char *path, unsigned int *path_id)
 {
 	return FS_LoadFile (path, LOADFILE_HUNK, path_id);
@@ -983,6 +1152,214 @@ byte *FS_LoadMallocFile (const char *path, unsigned int *path_id)
 }
 
 
+/*
+============
+FS_OpenView
+
+Gives read only access to a whole file.  Files in a mapped pak are
+handed out straight from the mapping, anything else is read into
+malloc'd memory.
+============
+*/
+const byte *FS_OpenView (const char *path, fsview_t *view, unsigned int *path_id)
+{
+	searchpath_t	*search;
+	char	ospath[MAX_OSPATH];
+	int	pakfile;
+	const byte	*mapped;
+	double	start;
+
+	start = Sys_DoubleTime ();
+
+	view->data = view->copy = NULL;
+	view->size = 0;
+
+	search = FS_FindFile (path, &pakfile, ospath, sizeof(ospath));
+	if (!search)
+		return NULL;
+	if (path_id)
+		*path_id = search->path_id;
+
+	fs_stats.views++;
+	fs_stats.viewbytes += fs_filesize;
+	view->size = fs_filesize;
+
+	/* the loaders cast the data to structures, so it must be
+	 * aligned the way FS_LoadFile's allocations are.  */
+	mapped = FS_MappedFile (search, pakfile);
+	if (mapped && !((intptr_t)mapped & 3))
+		view->data = mapped;
+	else
+	{
+		fs_stats.viewcopies++;
+		view->copy = FS_LoadFound (search, pakfile, ospath, path, LOADFILE_MALLOC);
+		view->data = view->copy;
+	}
+
+	fs_stats.time += Sys_DoubleTime () - start;
+	return view->data;
+}
+
+/*
+============
+FS_CloseView
+============
+*/
+void FS_CloseView (fsview_t *view)
+{
+	if (view->copy)
+		free (view->copy);
+	view->data = view->copy = NULL;
+	view->size = 0;
+}
+
+
+/*
+==============================================================================
+
+FILESYSTEM STATISTICS
+
+==============================================================================
+*/
+
+/*
+============
+FS_StatsMapChange
+
+Called when a map change starts and when it is done, so that fsstats
+can tell how long it took and what it loaded.
+============
+*/
+void FS_StatsMapChange (qboolean done)
+{
+	if (!done)
+	{
+		fs_mapstart = fs_stats;
+		fs_mapstarttime = Sys_DoubleTime ();
+		return;
+	}
+
+	fs_maptime = Sys_DoubleTime () - fs_mapstarttime;
+	fs_mapstats.opens = fs_stats.opens - fs_mapstart.opens;
+	fs_mapstats.loads = fs_stats.loads - fs_mapstart.loads;
+	fs_mapstats.loadbytes = fs_stats.loadbytes - fs_mapstart.loadbytes;
+	fs_mapstats.views = fs_stats.views - fs_mapstart.views;
+	fs_mapstats.viewcopies = fs_stats.viewcopies - fs_mapstart.viewcopies;
+	fs_mapstats.viewbytes = fs_stats.viewbytes - fs_mapstart.viewbytes;
+	fs_mapstats.time = fs_stats.time - fs_mapstart.time;
+}
+
+/*
+============
+FS_ResidentSize
+
+Current and peak resident set size in kilobytes, or -1 where the
+platform doesn't tell.
+============
+*/
+static void FS_ResidentSize (long *rss, long *peak)
+{
+#if defined(__linux__)
+	FILE	*f;
+	char	line[128];
+
+	*rss = *peak = -1;
+	f = fopen ("/proc/self/status", "r");
+	if (!f)
+		return;
+	while (fgets(line, sizeof(line), f))
+	{
+		if (!strncmp(line, "VmRSS:", 6))
+			*rss = atol (line + 6);
+		else if (!strncmp(line, "VmHWM:", 6))
+			*peak = atol (line + 6);
+	}
+	fclose (f);
+#else
+	*rss = *peak = -1;
+#endif
+}
+
+static void FS_PrintStats (const char *what, const fsstats_t *st)
+{
+	Con_Printf ("%s: %d loads (%.1f KB copied), %d views (%.1f KB, %d copied), %d stdio opens, %.1f ms\n",
+			what, st->loads, st->loadbytes / 1024.0, st->views, st->viewbytes / 1024.0,
+			st->viewcopies, st->opens, st->time * 1000.0);
+}
+
+/*
+============
+FS_Stats_f
+============
+*/
+static void FS_Stats_f (void)
+{
+	searchpath_t	*search;
+	int	paks, mapped;
+	double	mapbytes;
+	long	rss, peak;
+
+	paks = mapped = 0;
+	mapbytes = 0;
+	for (search = fs_searchpaths ; search ; search = search->next)
+	{
+		if (!search->pack)
+			continue;
+		paks++;
+		if (search->pack->mapbase)
+		{
+			mapped++;
+			mapbytes += search->pack->mapsize;
+		}
+	}
+
+	Con_Printf ("%d paks, %d mapped (%.1f MB)\n", paks, mapped, mapbytes / (1024.0 * 1024.0));
+	FS_PrintStats ("total", &fs_stats);
+	if (fs_maptime > 0)
+	{
+		Con_Printf ("last map change took %.1f ms\n", fs_maptime * 1000.0);
+		FS_PrintStats ("during it", &fs_mapstats);
+	}
+
+	FS_ResidentSize (&rss, &peak);
+	if (rss >= 0)
+		Con_Printf ("resident %.1f MB, peak %.1f MB\n", rss / 1024.0, peak / 1024.0);
+}
+
+
+/*
+===========
+FS_ForEachPackFile
+===========
+*/
+void FS_ForEachPackFile (const char *prefix, const char *suffix, void (*func) (const char *name))
+{
+	searchpath_t	*search;
+	const char	*name;
+	size_t		prelen, suflen, len;
+	int		i;
+
+	prelen = strlen (prefix);
+	suflen = strlen (suffix);
+
+	for (search = fs_searchpaths ; search ; search = search->next)
+	{
+		if (!search->pack)
+			continue;
+		for (i = 0 ; i < search->pack->numfiles ; i++)
+		{
+			name = search->pack->files[i].name;
+			len = strlen (name);
+			if (len < prelen + suflen || strncmp (name, prefix, prelen) != 0)
+				continue;
+			if (q_strcasecmp (name + len - suflen, suffix) != 0)
+				continue;
+			func (name);
+		}
+	}
+}
+
+
 /*
 ==============================================================================
 
@@ -1192,6 +1569,10 @@ void FS_Init (void)
 	Cvar_RegisterVariable (&registered);
 
 	Cmd_AddCommand ("path", FS_Path_f);
+	Cmd_AddCommand ("fsstats", FS_Stats_f);
+
+	if (COM_CheckParm ("-nommap"))
+		fs_nommap = true;
 #if !defined(SERVERONLY)
 	Cmd_AddCommand ("maplist", FS_Maplist_f);
 #endif
@@ -1322,11 +1703,8 @@ void FS_Init (void)
 			{
 				if (fs_searchpaths->pack)
 				{
-					fclose (fs_searchpaths->pack->handle);
-					Z_Free (fs_searchpaths->pack->files);
-					Hash_Free(&fs_searchpaths->pack->hash);
-					Z_Free (fs_searchpaths->pack);
 					Sys_Printf ("Removed packfile %s\n", fs_searchpaths->pack->filename);
+					FS_ClosePack (fs_searchpaths->pack);
 				}
 				else
 				{
@@ -99,6 +99,11 @@ qboolean FS_FileInGamedir (const char *filename);
 	/* Reports the existance of a file with read permissions in
 	 * fs_gamedir or fs_userdir. *NOT* for files in pakfiles!  */
 
+void FS_ForEachPackFile (const char *prefix, const char *suffix, void (*func) (const char *name));
+	/* Calls func with the name of each file in the pakfiles of the search
+	 * path that starts with prefix and ends with suffix.  A name in more than
+	 * one pak comes up once for each.  */
+
 /* these procedures open a file using FS_OpenFile and loads it into a proper
  * buffer. the buffer is allocated with a total size of fs_filesize + 1. the
  * procedures differ by their buffer allocation method.  */
@@ -121,6 +126,25 @@ void  FS_LoadCacheFile (const char *path, struct cache_user_s *cu,
 							unsigned int *path_id);
 	/* uses cache mem for allocating the buffer.  */
 
+typedef struct
+{
+	const byte	*data;
+	long		size;
+	byte		*copy;	/* malloc'd when data isn't mapped */
+} fsview_t;
+
+const byte *FS_OpenView (const char *path, fsview_t *view, unsigned int *path_id);
+	/* gives read only access to the whole file, straight out of the pak
+	 * if it is mapped, without a copy.  returns view->data, or NULL if
+	 * the file isn't found.  the data is *not* nul terminated, must not
+	 * be written to, and the view must be closed before the search path
+	 * changes.  */
+void FS_CloseView (fsview_t *view);
+
+void FS_StatsMapChange (qboolean done);
+	/* call with false when a map change starts and with true when it's
+	 * done: the fsstats command reports on it.  */
+
 #define	FS_BASEDIR	0	/* host_parms->basedir (i.e.:  fs_basedir) */
 #define	FS_USERBASE	1	/* host_parms->userdir */
 #define	FS_GAMEDIR	2	/* host_parms->basedir/gamedir (fs_gamedir) */
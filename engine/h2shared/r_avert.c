@@ -0,0 +1,844 @@
+/* r_avert.c -- alias model vertex transform, lighting and projection
+ *
+ * Copyright (C) 1996-1997  Id Software, Inc.
+ * Copyright (C) 1997-1998  Raven Software Corp.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "quakedef.h"
+#include "r_local.h"
+
+/*
+===============================================================================
+
+The C builds transform, light and project the vertices of an alias model
+here, four at a time with SSE2 or AArch64 NEON, and one at a time
+otherwise.  The vector code does the same float operations in the same
+order as the scalar code, which is kept as the reference: "r_aliascheck 1"
+runs both on every model drawn and reports any vertex that comes out
+different, and "aliasbench" times and compares both over every model in
+the pak files.
+
+With r_lerpmodels, r_alias.c points r_alerpverts at the pose the entity is
+blending from, and the vertices are blended by r_alerpfrac on the way in.
+
+===============================================================================
+*/
+
+trivertx_t	*r_alerpverts;	// pose blended from, NULL when not blending
+float		r_alerpfrac;	// 0 is r_alerpverts, 1 is r_apverts
+
+#if !id386 && !id68k
+
+#if defined(__SSE2__) && (BYTE_ORDER == LITTLE_ENDIAN)
+#include <emmintrin.h>
+#define	ALIAS_SIMD	"SSE2"
+typedef __m128		vecf_t;
+typedef __m128i		veci_t;
+#define	VF_SET1(x)	_mm_set1_ps (x)
+#define	VF_LOAD(p)	_mm_loadu_ps (p)
+#define	VF_STORE(p,a)	_mm_storeu_ps (p, a)
+#define	VF_ADD(a,b)	_mm_add_ps (a, b)
+#define	VF_SUB(a,b)	_mm_sub_ps (a, b)
+#define	VF_MUL(a,b)	_mm_mul_ps (a, b)
+#define	VF_DIV(a,b)	_mm_div_ps (a, b)
+#define	VF_LT(a,b)	_mm_castps_si128 (_mm_cmplt_ps (a, b))
+#define	VF_TOI(a)	_mm_cvttps_epi32 (a)
+#define	VI_TOF(a)	_mm_cvtepi32_ps (a)
+#define	VI_SET1(x)	_mm_set1_epi32 (x)
+#define	VI_LOAD(p)	_mm_loadu_si128 ((const __m128i *)(p))
+#define	VI_STORE(p,a)	_mm_storeu_si128 ((__m128i *)(p), a)
+#define	VI_ADD(a,b)	_mm_add_epi32 (a, b)
+#define	VI_AND(a,b)	_mm_and_si128 (a, b)
+#define	VI_GT(a,b)	_mm_cmpgt_epi32 (a, b)
+#define	VI_SHR(a,n)	_mm_srli_epi32 (a, n)
+#elif defined(__aarch64__) && (defined(__ARM_NEON) || defined(__ARM_NEON__)) && (BYTE_ORDER == LITTLE_ENDIAN)
+#include <arm_neon.h>
+#define	ALIAS_SIMD	"NEON"
+typedef float32x4_t	vecf_t;
+typedef int32x4_t	veci_t;
+#define	VF_SET1(x)	vdupq_n_f32 (x)
+#define	VF_LOAD(p)	vld1q_f32 (p)
+#define	VF_STORE(p,a)	vst1q_f32 (p, a)
+#define	VF_ADD(a,b)	vaddq_f32 (a, b)
+#define	VF_SUB(a,b)	vsubq_f32 (a, b)
+#define	VF_MUL(a,b)	vmulq_f32 (a, b)
+#define	VF_DIV(a,b)	vdivq_f32 (a, b)
+#define	VF_LT(a,b)	vreinterpretq_s32_u32 (vcltq_f32 (a, b))
+#define	VF_TOI(a)	vcvtq_s32_f32 (a)
+#define	VI_TOF(a)	vcvtq_f32_s32 (a)
+#define	VI_SET1(x)	vdupq_n_s32 (x)
+#define	VI_LOAD(p)	vreinterpretq_s32_u32 (vld1q_u32 ((const uint32_t *)(p)))
+#define	VI_STORE(p,a)	vst1q_s32 (p, a)
+#define	VI_ADD(a,b)	vaddq_s32 (a, b)
+#define	VI_AND(a,b)	vandq_s32 (a, b)
+#define	VI_GT(a,b)	vreinterpretq_s32_u32 (vcgtq_s32 (a, b))
+#define	VI_SHR(a,n)	vreinterpretq_s32_u32 (vshrq_n_u32 (vreinterpretq_u32_s32 (a), n))
+#endif
+
+
+/*
+===============================================================================
+
+SCALAR REFERENCE
+
+===============================================================================
+*/
+
+/*
+================
+R_AliasVertPos
+
+Model space position of vertex i, blended if there is a pose to blend from
+================
+*/
+static inline void R_AliasVertPos (int i, float *pos)
+{
+	float	a, b;
+	int	k;
+
+	for (k = 0 ; k < 3 ; k++)
+	{
+		b = r_apverts[i].v[k];
+		if (r_alerpverts)
+		{
+			a = r_alerpverts[i].v[k];
+			b = a + (b - a) * r_alerpfrac;
+		}
+		pos[k] = b;
+	}
+}
+
+/*
+================
+R_AliasVertNormal
+
+Index of the normal vertex i is lit with: a blended vertex takes the normal
+of the nearer pose
+================
+*/
+static inline int R_AliasVertNormal (int i)
+{
+	if (r_alerpverts && r_alerpfrac < 0.5)
+		return r_alerpverts[i].lightnormalindex;
+	return r_apverts[i].lightnormalindex;
+}
+
+/*
+================
+R_AliasVertLight
+================
+*/
+static inline int R_AliasVertLight (int normal)
+{
+	const float	*plightnormal;
+	float		lightcos;
+	int		temp;
+
+	plightnormal = r_avertexnormals[normal];
+	lightcos = DotProduct (plightnormal, r_plightvec);
+	temp = r_ambientlight;
+
+	if (lightcos < 0)
+	{
+		temp += (int)(r_shadelight * lightcos);
+
+	// clamp; because we limited the minimum ambient and shading light, we
+	// don't have to clamp low light, just bright
+		if (temp < 0)
+			temp = 0;
+	}
+
+	return temp;
+}
+
+/*
+================
+R_AliasProjectVertsC
+
+Vertices first to first+count-1 of the trivially accepted case, where
+aliastransform already scales x and y to the screen and z down by 2**31
+================
+*/
+static void R_AliasProjectVertsC (finalvert_t *fv, const stvert_t *pstverts, int first, int count)
+{
+	float	pos[3], zi;
+	int	i;
+
+	fv += first;
+	pstverts += first;
+	for (i = first ; i < first + count ; i++, fv++, pstverts++)
+	{
+		R_AliasVertPos (i, pos);
+
+	// transform and project
+		zi = 1.0 / (DotProduct(pos, aliastransform[2]) + aliastransform[2][3]);
+
+	// x, y, and z are scaled down by 1/2**31 in the transform, so 1/z is
+	// scaled up by 1/2**31, and the scaling cancels out for x and y in the
+	// projection
+		fv->v[5] = zi;
+
+		fv->v[0] = ((DotProduct(pos, aliastransform[0]) +
+				aliastransform[0][3]) * zi) + aliasxcenter;
+		fv->v[1] = ((DotProduct(pos, aliastransform[1]) +
+				aliastransform[1][3]) * zi) + aliasycenter;
+
+		fv->v[2] = pstverts->s;
+		fv->v[3] = pstverts->t;
+		fv->flags = pstverts->onseam;
+
+		fv->v[4] = R_AliasVertLight (R_AliasVertNormal (i));
+	}
+}
+
+/*
+================
+R_AliasClipVertsC
+
+Vertices first to first+count-1 of the general case: viewspace into av,
+and the projection and clip flags of the ones in front of the near plane
+into fv
+================
+*/
+static void R_AliasClipVertsC (finalvert_t *fv, auxvert_t *av, float ziscale, int first, int count)
+{
+	float	pos[3], zi;
+	int	i;
+
+	fv += first;
+	av += first;
+	for (i = first ; i < first + count ; i++, fv++, av++)
+	{
+		R_AliasVertPos (i, pos);
+
+		av->fv[0] = DotProduct(pos, aliastransform[0]) + aliastransform[0][3];
+		av->fv[1] = DotProduct(pos, aliastransform[1]) + aliastransform[1][3];
+		av->fv[2] = DotProduct(pos, aliastransform[2]) + aliastransform[2][3];
+
+		fv->v[4] = R_AliasVertLight (R_AliasVertNormal (i));
+
+		fv->flags = 0;
+		if (av->fv[2] < ALIAS_Z_CLIP_PLANE)
+		{
+			fv->flags |= ALIAS_Z_CLIP;
+			continue;
+		}
+
+		zi = 1.0 / av->fv[2];
+
+		fv->v[5] = zi * ziscale;
+
+		fv->v[0] = (av->fv[0] * aliasxscale * zi) + aliasxcenter;
+		fv->v[1] = (av->fv[1] * aliasyscale * zi) + aliasycenter;
+
+		if (fv->v[0] < r_refdef.aliasvrect.x)
+			fv->flags |= ALIAS_LEFT_CLIP;
+		if (fv->v[1] < r_refdef.aliasvrect.y)
+			fv->flags |= ALIAS_TOP_CLIP;
+		if (fv->v[0] > r_refdef.aliasvrectright)
+			fv->flags |= ALIAS_RIGHT_CLIP;
+		if (fv->v[1] > r_refdef.aliasvrectbottom)
+			fv->flags |= ALIAS_BOTTOM_CLIP;
+	}
+}
+
+
+#ifdef ALIAS_SIMD
+/*
+===============================================================================
+
+FOUR AT A TIME
+
+===============================================================================
+*/
+
+/*
+================
+R_AliasUnpack4
+
+Model space positions of four trivertx_t loaded as ints
+================
+*/
+static inline void R_AliasUnpack4 (veci_t w, vecf_t *pos)
+{
+	veci_t	mask = VI_SET1 (0xff);
+
+	pos[0] = VI_TOF (VI_AND (w, mask));
+	pos[1] = VI_TOF (VI_AND (VI_SHR (w, 8), mask));
+	pos[2] = VI_TOF (VI_AND (VI_SHR (w, 16), mask));
+}
+
+/*
+================
+R_AliasLoad4
+
+Model space positions and normal indices of vertices i to i+3
+================
+*/
+static inline void R_AliasLoad4 (int i, vecf_t *pos, int *normals)
+{
+	veci_t	a, b;
+	vecf_t	from[3], frac;
+	int	k;
+
+	b = VI_LOAD (&r_apverts[i]);	// trivertx_t is four bytes
+	R_AliasUnpack4 (b, pos);
+
+	if (!r_alerpverts)
+	{
+		VI_STORE (normals, VI_SHR (b, 24));
+		return;
+	}
+
+	a = VI_LOAD (&r_alerpverts[i]);
+	R_AliasUnpack4 (a, from);
+	frac = VF_SET1 (r_alerpfrac);
+	for (k = 0 ; k < 3 ; k++)
+		pos[k] = VF_ADD (from[k], VF_MUL (VF_SUB (pos[k], from[k]), frac));
+	VI_STORE (normals, VI_SHR ((r_alerpfrac < 0.5) ? a : b, 24));
+}
+
+/*
+================
+R_AliasTransform4
+
+One row of aliastransform applied to four positions, summed in the order
+DotProduct does
+================
+*/
+static inline vecf_t R_AliasTransform4 (const vecf_t *pos, const float *row)
+{
+	return VF_ADD (VF_ADD (VF_ADD (VF_MUL (pos[0], VF_SET1 (row[0])),
+					VF_MUL (pos[1], VF_SET1 (row[1]))),
+				VF_MUL (pos[2], VF_SET1 (row[2]))),
+			VF_SET1 (row[3]));
+}
+
+/*
+================
+R_AliasLight4
+================
+*/
+static inline veci_t R_AliasLight4 (const int *normals)
+{
+	float	n[3][4];
+	vecf_t	lightcos;
+	veci_t	temp, zero;
+	int	i;
+
+	for (i = 0 ; i < 4 ; i++)
+	{
+		n[0][i] = r_avertexnormals[normals[i]][0];
+		n[1][i] = r_avertexnormals[normals[i]][1];
+		n[2][i] = r_avertexnormals[normals[i]][2];
+	}
+
+	lightcos = VF_ADD (VF_ADD (VF_MUL (VF_LOAD (n[0]), VF_SET1 (r_plightvec[0])),
+				VF_MUL (VF_LOAD (n[1]), VF_SET1 (r_plightvec[1]))),
+			VF_MUL (VF_LOAD (n[2]), VF_SET1 (r_plightvec[2])));
+
+	zero = VI_SET1 (0);
+	temp = VF_TOI (VF_MUL (VF_SET1 (r_shadelight), lightcos));
+	temp = VI_AND (temp, VF_LT (lightcos, VF_SET1 (0)));
+	temp = VI_ADD (temp, VI_SET1 (r_ambientlight));
+	return VI_AND (temp, VI_GT (temp, zero));
+}
+
+/*
+================
+R_AliasProjectVertsSIMD
+================
+*/
+static void R_AliasProjectVertsSIMD (finalvert_t *fv, const stvert_t *pstverts)
+{
+	vecf_t	pos[3], zi;
+	int	normals[4], u[4], v[4], z[4], light[4];
+	int	i, j, count;
+
+	count = r_anumverts & ~3;
+	for (i = 0 ; i < count ; i += 4)
+	{
+		R_AliasLoad4 (i, pos, normals);
+
+		zi = VF_DIV (VF_SET1 (1.0f), R_AliasTransform4 (pos, aliastransform[2]));
+		VI_STORE (z, VF_TOI (zi));
+		VI_STORE (u, VF_TOI (VF_ADD (VF_MUL (R_AliasTransform4 (pos, aliastransform[0]), zi),
+						VF_SET1 (aliasxcenter))));
+		VI_STORE (v, VF_TOI (VF_ADD (VF_MUL (R_AliasTransform4 (pos, aliastransform[1]), zi),
+						VF_SET1 (aliasycenter))));
+		VI_STORE (light, R_AliasLight4 (normals));
+
+		for (j = 0 ; j < 4 ; j++, fv++, pstverts++)
+		{
+			fv->v[0] = u[j];
+			fv->v[1] = v[j];
+			fv->v[2] = pstverts->s;
+			fv->v[3] = pstverts->t;
+			fv->v[4] = light[j];
+			fv->v[5] = z[j];
+			fv->flags = pstverts->onseam;
+		}
+	}
+
+	fv -= count;
+	pstverts -= count;
+	R_AliasProjectVertsC (fv, pstverts, count, r_anumverts - count);
+}
+
+/*
+================
+R_AliasClipVertsSIMD
+================
+*/
+static void R_AliasClipVertsSIMD (finalvert_t *fv, auxvert_t *av, float ziscale)
+{
+	vecf_t	pos[3], zi;
+	float	x[4], y[4], z[4];
+	int	normals[4], u[4], v[4], iz[4], light[4];
+	int	i, j, count, flags;
+
+	count = r_anumverts & ~3;
+	for (i = 0 ; i < count ; i += 4)
+	{
+		R_AliasLoad4 (i, pos, normals);
+
+		VF_STORE (x, R_AliasTransform4 (pos, aliastransform[0]));
+		VF_STORE (y, R_AliasTransform4 (pos, aliastransform[1]));
+		VF_STORE (z, R_AliasTransform4 (pos, aliastransform[2]));
+
+	// vertices behind the near plane get projected, too, but those
+	// results are thrown away below
+		zi = VF_DIV (VF_SET1 (1.0f), VF_LOAD (z));
+		VI_STORE (iz, VF_TOI (VF_MUL (zi, VF_SET1 (ziscale))));
+		VI_STORE (u, VF_TOI (VF_ADD (VF_MUL (VF_MUL (VF_LOAD (x), VF_SET1 (aliasxscale)), zi),
+						VF_SET1 (aliasxcenter))));
+		VI_STORE (v, VF_TOI (VF_ADD (VF_MUL (VF_MUL (VF_LOAD (y), VF_SET1 (aliasyscale)), zi),
+						VF_SET1 (aliasycenter))));
+		VI_STORE (light, R_AliasLight4 (normals));
+
+		for (j = 0 ; j < 4 ; j++, fv++, av++)
+		{
+			av->fv[0] = x[j];
+			av->fv[1] = y[j];
+			av->fv[2] = z[j];
+			fv->v[4] = light[j];
+
+			if (z[j] < ALIAS_Z_CLIP_PLANE)
+			{
+				fv->flags = ALIAS_Z_CLIP;
+				continue;
+			}
+
+			fv->v[0] = u[j];
+			fv->v[1] = v[j];
+			fv->v[5] = iz[j];
+
+			flags = 0;
+			if (u[j] < r_refdef.aliasvrect.x)
+				flags |= ALIAS_LEFT_CLIP;
+			if (v[j] < r_refdef.aliasvrect.y)
+				flags |= ALIAS_TOP_CLIP;
+			if (u[j] > r_refdef.aliasvrectright)
+				flags |= ALIAS_RIGHT_CLIP;
+			if (v[j] > r_refdef.aliasvrectbottom)
+				flags |= ALIAS_BOTTOM_CLIP;
+			fv->flags = flags;
+		}
+	}
+
+	fv -= count;
+	av -= count;
+	R_AliasClipVertsC (fv, av, ziscale, count, r_anumverts - count);
+}
+#endif	/* ALIAS_SIMD */
+
+
+#ifdef ALIAS_SIMD
+/*
+===============================================================================
+
+CHECKING
+
+===============================================================================
+*/
+
+static finalvert_t	r_checkfv[MAXALIASVERTS];
+static auxvert_t	r_checkav[MAXALIASVERTS];
+
+/*
+================
+R_AliasCompareVerts
+
+Number of vertices that differ between two runs; the projection of a
+vertex behind the near plane is left unset by both paths, so it is only
+compared for the clipped case when the vertex is in front.
+================
+*/
+static int R_AliasCompareVerts (const finalvert_t *fv0, const auxvert_t *av0,
+				const finalvert_t *fv1, const auxvert_t *av1)
+{
+	int	i, bad;
+
+	bad = 0;
+	for (i = 0 ; i < r_anumverts ; i++, fv0++, fv1++)
+	{
+		if (fv0->flags != fv1->flags || fv0->v[4] != fv1->v[4])
+			bad++;
+		else if (av0 && memcmp (&av0[i], &av1[i], sizeof(auxvert_t)))
+			bad++;
+		else if (av0 && (fv0->flags & ALIAS_Z_CLIP))
+			continue;
+		else if (fv0->v[0] != fv1->v[0] || fv0->v[1] != fv1->v[1] || fv0->v[5] != fv1->v[5])
+			bad++;
+		else if (!av0 && (fv0->v[2] != fv1->v[2] || fv0->v[3] != fv1->v[3]))
+			bad++;
+	}
+
+	return bad;
+}
+
+/*
+================
+R_AliasCheckVerts
+
+Runs the scalar path on the model just done for r_aliascheck, and reports
+a model whose vertices came out different, at most once a second.
+================
+*/
+static void R_AliasCheckVerts (const finalvert_t *fv, const auxvert_t *av, const stvert_t *pstverts, float ziscale)
+{
+	static double	lastreport;
+	int		bad;
+
+	if (av)
+	{
+		R_AliasClipVertsC (r_checkfv, r_checkav, ziscale, 0, r_anumverts);
+		bad = R_AliasCompareVerts (r_checkfv, r_checkav, fv, av);
+	}
+	else
+	{
+		R_AliasProjectVertsC (r_checkfv, pstverts, 0, r_anumverts);
+		bad = R_AliasCompareVerts (r_checkfv, NULL, fv, NULL);
+	}
+
+	if (bad && realtime - lastreport >= 1.0)
+	{
+		lastreport = realtime;
+		Con_Printf ("aliascheck: %s: %d of %d vertices differ\n",
+				currententity->model->name, bad, r_anumverts);
+	}
+}
+#endif	/* ALIAS_SIMD */
+
+
+/*
+===============================================================================
+
+ENTRY POINTS
+
+===============================================================================
+*/
+
+/*
+================
+R_AliasTransformAndProjectFinalVerts
+
+Trivially accepted case
+================
+*/
+void R_AliasTransformAndProjectFinalVerts (finalvert_t *fv, stvert_t *pstverts)
+{
+#ifdef ALIAS_SIMD
+	if (r_aliassimd.integer)
+	{
+		R_AliasProjectVertsSIMD (fv, pstverts);
+		if (r_aliascheck.integer)
+			R_AliasCheckVerts (fv, NULL, pstverts, 0);
+		return;
+	}
+#endif
+	R_AliasProjectVertsC (fv, pstverts, 0, r_anumverts);
+}
+
+/*
+================
+R_AliasTransformClipVerts
+
+General clipped case
+================
+*/
+void R_AliasTransformClipVerts (finalvert_t *fv, auxvert_t *av, float ziscale)
+{
+#ifdef ALIAS_SIMD
+	if (r_aliassimd.integer)
+	{
+		R_AliasClipVertsSIMD (fv, av, ziscale);
+		if (r_aliascheck.integer)
+			R_AliasCheckVerts (fv, av, NULL, ziscale);
+		return;
+	}
+#endif
+	R_AliasClipVertsC (fv, av, ziscale, 0, r_anumverts);
+}
+
+#endif	/* !id386 && !id68k */
+
+
+/*
+===============================================================================
+
+BENCHMARK
+
+"aliasbench [passes]" loads every model in the pak files, and runs each
+pose of each of them through the scalar and the vector code, both the
+trivially accepted and the clipped way, unblended and blended halfway to
+the next pose.  The transform puts the model in front of the view and then
+straddling the near plane.  Both runs of every pose are compared, and the
+vertices that differ are counted.
+
+===============================================================================
+*/
+
+#if !id386 && !id68k && defined(ALIAS_SIMD)
+
+#define	BENCH_MAXPOSES	1024
+
+static trivertx_t	*bench_poses[BENCH_MAXPOSES];
+static int		bench_numposes;
+static double		bench_time[2][2];	// [clipped][simd]
+static int		bench_verts[2];		// per pass, [clipped]
+static int		bench_bad, bench_models, bench_passes;
+static qmodel_t		*bench_done[MAX_MODELS];	// each model once, even
+static int		bench_numdone;			//  if in more than one pak
+static finalvert_t	bench_fv[2][MAXALIASVERTS];
+static auxvert_t	bench_av[2][MAXALIASVERTS];
+
+/*
+================
+R_BenchTransform
+
+A transform with the model depth units beyond the near plane; trivial
+scales it the way R_AliasSetUpTransform does for trivial accepts.
+================
+*/
+static void R_BenchTransform (newmdl_t *mdl, float depth, qboolean trivial)
+{
+	int	i;
+
+	memset (aliastransform, 0, sizeof(aliastransform));
+	aliastransform[0][1] = -mdl->scale[1];
+	aliastransform[0][3] = -mdl->scale_origin[1];
+	aliastransform[1][2] = -mdl->scale[2];
+	aliastransform[1][3] = -mdl->scale_origin[2];
+	aliastransform[2][0] = mdl->scale[0];
+	aliastransform[2][1] = mdl->scale[1] * 0.25;
+	aliastransform[2][3] = mdl->scale_origin[0] + depth;
+
+	if (trivial)
+	{
+		for (i = 0 ; i < 4 ; i++)
+		{
+			aliastransform[0][i] *= aliasxscale * (1.0 / ((float)0x8000 * 0x10000));
+			aliastransform[1][i] *= aliasyscale * (1.0 / ((float)0x8000 * 0x10000));
+			aliastransform[2][i] *= 1.0 / ((float)0x8000 * 0x10000);
+		}
+	}
+}
+
+/*
+================
+R_BenchPose
+
+Times and compares one pose, the way the model is set up now
+================
+*/
+static void R_BenchPose (const stvert_t *pstverts, qboolean clipped)
+{
+	float	ziscale = (float)0x8000 * (float)0x10000;
+	double	start;
+	int	pass, simd;
+
+	for (simd = 0 ; simd < 2 ; simd++)
+	{
+		start = Sys_DoubleTime ();
+		for (pass = 0 ; pass < bench_passes ; pass++)
+		{
+			if (clipped && simd)
+				R_AliasClipVertsSIMD (bench_fv[1], bench_av[1], ziscale);
+			else if (clipped)
+				R_AliasClipVertsC (bench_fv[0], bench_av[0], ziscale, 0, r_anumverts);
+			else if (simd)
+				R_AliasProjectVertsSIMD (bench_fv[1], pstverts);
+			else
+				R_AliasProjectVertsC (bench_fv[0], pstverts, 0, r_anumverts);
+		}
+		bench_time[clipped][simd] += Sys_DoubleTime () - start;
+	}
+
+	if (clipped)
+		bench_bad += R_AliasCompareVerts (bench_fv[0], bench_av[0], bench_fv[1], bench_av[1]);
+	else
+		bench_bad += R_AliasCompareVerts (bench_fv[0], NULL, bench_fv[1], NULL);
+	bench_verts[clipped] += r_anumverts;
+}
+
+/*
+================
+R_BenchModel
+================
+*/
+static void R_BenchModel (const char *name)
+{
+	qmodel_t		*mod;
+	aliashdr_t		*hdr;
+	newmdl_t		*mdl;
+	maliasgroup_t		*group;
+	const stvert_t		*pstverts;
+	int			i, p, bad;
+
+	mod = Mod_ForName (name, false);
+	if (!mod || mod->type != mod_alias)
+		return;
+	for (i = 0 ; i < bench_numdone ; i++)
+	{
+		if (bench_done[i] == mod)
+			return;
+	}
+	if (bench_numdone == MAX_MODELS)
+		return;
+	bench_done[bench_numdone++] = mod;
+
+	hdr = (aliashdr_t *) Mod_Extradata (mod);
+	mdl = (newmdl_t *)((byte *)hdr + hdr->model);
+	if (mdl->numverts > MAXALIASVERTS)
+		return;
+
+	bench_numposes = 0;
+	for (i = 0 ; i < mdl->numframes && bench_numposes < BENCH_MAXPOSES ; i++)
+	{
+		if (hdr->frames[i].type == ALIAS_SINGLE)
+		{
+			bench_poses[bench_numposes++] = (trivertx_t *)((byte *)hdr + hdr->frames[i].frame);
+			continue;
+		}
+		group = (maliasgroup_t *)((byte *)hdr + hdr->frames[i].frame);
+		for (p = 0 ; p < group->numframes && bench_numposes < BENCH_MAXPOSES ; p++)
+			bench_poses[bench_numposes++] = (trivertx_t *)((byte *)hdr + group->frames[p].frame);
+	}
+
+	pstverts = (stvert_t *)((byte *)hdr + hdr->stverts);
+	r_anumverts = mdl->numverts;
+	bad = bench_bad;
+
+	for (p = 0 ; p < bench_numposes ; p++)
+	{
+		r_apverts = bench_poses[p];
+
+		r_alerpverts = NULL;
+		R_BenchTransform (mdl, 2 * mdl->size + 64, true);
+		R_BenchPose (pstverts, false);
+		R_BenchTransform (mdl, 0, false);
+		R_BenchPose (pstverts, true);
+
+		r_alerpverts = bench_poses[(p + 1) % bench_numposes];
+		r_alerpfrac = 0.375;
+		R_BenchTransform (mdl, 2 * mdl->size + 64, true);
+		R_BenchPose (pstverts, false);
+		R_BenchTransform (mdl, 0, false);
+		R_BenchPose (pstverts, true);
+	}
+
+	r_alerpverts = NULL;
+	bench_models++;
+
+	if (bench_bad != bad)
+		Con_Printf ("%s: %d vertices differ\n", name, bench_bad - bad);
+}
+
+/*
+================
+R_BenchReport
+================
+*/
+static void R_BenchReport (const char *what, int clipped)
+{
+	double	scalar, simd;
+
+	double	verts;
+
+	verts = (double)bench_verts[clipped] * bench_passes / 1000000.0;
+	scalar = bench_time[clipped][0];
+	simd = bench_time[clipped][1];
+	Con_Printf ("%-9s %8.1f %8.1f %7.2fx\n", what,
+			scalar > 0 ? verts / scalar : 0,
+			simd > 0 ? verts / simd : 0,
+			simd > 0 ? scalar / simd : 0);
+}
+#endif	/* ALIAS_SIMD */
+
+/*
+================
+R_AliasBench_f
+================
+*/
+void R_AliasBench_f (void)
+{
+#if !id386 && !id68k && defined(ALIAS_SIMD)
+	float		oldplightvec[3];
+	int		oldambient;
+	float		oldshade;
+
+	bench_passes = (Cmd_Argc () > 1) ? atoi (Cmd_Argv (1)) : 20;
+	if (bench_passes < 1)
+		bench_passes = 1;
+
+	VectorCopy (r_plightvec, oldplightvec);
+	oldambient = r_ambientlight;
+	oldshade = r_shadelight;
+	r_plightvec[0] = -0.6f;
+	r_plightvec[1] = 0.48f;
+	r_plightvec[2] = -0.64f;
+	r_ambientlight = 40;
+	r_shadelight = 80 * VID_GRADES;
+
+	memset (bench_time, 0, sizeof(bench_time));
+	memset (bench_verts, 0, sizeof(bench_verts));
+	bench_bad = bench_models = bench_numdone = 0;
+
+	FS_ForEachPackFile ("models/", ".mdl", R_BenchModel);
+
+	VectorCopy (oldplightvec, r_plightvec);
+	r_ambientlight = oldambient;
+	r_shadelight = oldshade;
+
+	if (!bench_models)
+	{
+		Con_Printf ("no alias models in the pak files\n");
+		return;
+	}
+
+	Con_Printf ("%d models, %d vertices a way, %d passes\n",
+			bench_models, bench_verts[0], bench_passes);
+	Con_Printf ("%-9s %8s %8s %8s\n", "Mverts/s", "C", ALIAS_SIMD, "speedup");
+	R_BenchReport ("accepted", 0);
+	R_BenchReport ("clipped", 1);
+	Con_Printf ("%d vertices differ\n", bench_bad);
+#else
+	Con_Printf ("%s: no vector alias code in this build\n", Cmd_Argv (0));
+#endif
+}
@@ -38,7 +38,8 @@
 edge_t	*auxedges;
 edge_t	*r_edges, *edge_p, *edge_max;
 
-surf_t	*surfaces, *surface_p, *surf_max;
+R_TLS surf_t	*surfaces, *surface_p;
+surf_t	*surf_max;
 
 // surfaces are generated in back to front order by the bsp, so if a surf
 // pointer is greater than another one, it should be drawn in front
@@ -48,19 +49,19 @@ edge_t	*newedges[MAXHEIGHT];
 edge_t	*removeedges[MAXHEIGHT];
 
 ASM_LINKAGE_BEGIN
-espan_t *span_p;
+R_TLS espan_t *span_p;
 
-float	fv;
+R_TLS float	fv;
 
-int	current_iv;
+R_TLS int	current_iv;
 
-int	edge_head_u_shift20, edge_tail_u_shift20;
+R_TLS int	edge_head_u_shift20, edge_tail_u_shift20;
 ASM_LINKAGE_END
 
-edge_t	edge_head;
-edge_t	edge_tail;
-edge_t	edge_aftertail;
-edge_t	edge_sentinel;
+R_TLS edge_t	edge_head;
+R_TLS edge_t	edge_tail;
+R_TLS edge_t	edge_aftertail;
+R_TLS edge_t	edge_sentinel;
 
 int		TransCount;
 
@@ -947,33 +948,19 @@ static void R_GenerateSpansBackward (void)
 static qboolean TransList[SCAN_SIZE];
 static espan_t *max_span_p;
 
+#if R_BANDTHREADS
+static qboolean R_ScanBands (qboolean Translucent);
+#endif
+
 /*
 ==============
-R_ScanEdges
+R_ClearActiveEdges
 
-Input: newedges[] array
-	this has links to edges, which have links to surfaces
-Output:
-	Each surface has a linked list of its visible spans
+Clears the active edges to just the background edges around the whole screen
 ==============
 */
-void R_ScanEdges (qboolean Translucent)
+static void R_ClearActiveEdges (void)
 {
-	int		iv, bottom;
-	byte	basespans[MAXSPANS*sizeof(espan_t)+CACHE_SIZE];
-	espan_t	*basespan_p;
-	surf_t	*s;
-
-	if (Translucent && r_draworder.integer)
-		return;
-
-	basespan_p = (espan_t *)
-			((intptr_t)(basespans + CACHE_SIZE - 1) & ~(CACHE_SIZE - 1));
-	max_span_p = &basespan_p[MAXSPANS - r_refdef.vrect.width];
-
-	span_p = basespan_p;
-
-// clear active edges to just the background edges around the whole screen
 // FIXME: most of this only needs to be set up once
 	edge_head.u = r_refdef.vrect.x << 20;
 	edge_head_u_shift20 = edge_head.u >> 20;
@@ -999,6 +986,40 @@ void R_ScanEdges (qboolean Translucent)
 // FIXME: do we need this now that we clamp x in r_draw.c?
 	edge_sentinel.u = 32767 << 16;		// make sure nothing sorts past this
 	edge_sentinel.prev = &edge_aftertail;
+}
+
+/*
+==============
+R_ScanEdges
+
+Input: newedges[] array
+	this has links to edges, which have links to surfaces
+Output:
+	Each surface has a linked list of its visible spans
+==============
+*/
+void R_ScanEdges (qboolean Translucent)
+{
+	int		iv, bottom;
+	byte	basespans[MAXSPANS*sizeof(espan_t)+CACHE_SIZE];
+	espan_t	*basespan_p;
+	surf_t	*s;
+
+	if (Translucent && r_draworder.integer)
+		return;
+
+#if R_BANDTHREADS
+	if (R_ScanBands (Translucent))
+		return;
+#endif
+
+	basespan_p = (espan_t *)
+			((intptr_t)(basespans + CACHE_SIZE - 1) & ~(CACHE_SIZE - 1));
+	max_span_p = &basespan_p[MAXSPANS - r_refdef.vrect.width];
+
+	span_p = basespan_p;
+
+	R_ClearActiveEdges ();
 
 //
 // process all scan lines
@@ -1098,3 +1119,454 @@ void R_ScanEdges (qboolean Translucent)
 	}
 }
 
+
+
+/*
+===============================================================================
+
+BANDED SCANNING
+
+With r_threads above 1, the refresh window is cut into that many horizontal
+bands, and each band is scanned by a job of its own.  A job works on its own
+copies of the edges and surfaces: it steps the active edge table down to its
+first line without generating any spans, which leaves the table exactly as
+the serial scan has it there, since only the edges go into it.  Then it
+generates the spans of its lines into span chunks of its own, which are
+never flushed.  D_DrawSurfaceBands draws all bands once they are scanned.
+
+Every pixel is covered by just one span of one band, and the spans are the
+same as the serial scan makes, so the frame comes out identical to the
+single threaded one.
+
+===============================================================================
+*/
+
+#if R_BANDTHREADS
+
+#define	MAX_BANDS	32
+#define	MAX_BANDCHUNKS	64	// of MAXSPANS spans each
+
+typedef struct
+{
+	int		top, bottom;	// lines top to bottom-1
+	edge_t		*edges;		// copy of r_edges
+	int		maxedges;
+	surf_t		*surfs;		// copy of surfaces
+	int		maxsurfs;
+	espan_t		*chunks[MAX_BANDCHUNKS];
+	int		numchunks;	// allocated so far
+	int		transcount;
+	qboolean	overflow;	// ran out of span chunks
+} rband_t;
+
+static rband_t	r_bands[MAX_BANDS];
+static qboolean	r_bandtrans;
+static surf_t	*r_bandsurfaces;	// the main thread's surfaces, which
+static int	r_bandnumsurfs;		//  the jobs can't see through surfaces
+static int	r_benchbands;		// band count forced by timebands
+
+/*
+==============
+R_BandEdge
+
+The band's copy of edge
+==============
+*/
+static edge_t *R_BandEdge (rband_t *band, edge_t *edge)
+{
+	if (!edge)
+		return NULL;
+	return band->edges + (edge - r_edges);
+}
+
+/*
+==============
+R_BandChunk
+
+Points span_p to the start of the band's chunk'th span chunk, and returns
+how far a scan may fill it, or NULL if there is no such chunk.
+==============
+*/
+static espan_t *R_BandChunk (rband_t *band, int chunk)
+{
+	if (chunk == MAX_BANDCHUNKS)
+		return NULL;
+
+	if (chunk == band->numchunks)
+	{
+		band->chunks[chunk] = (espan_t *) malloc (MAXSPANS * sizeof(espan_t));
+		if (!band->chunks[chunk])
+			return NULL;
+		band->numchunks++;
+	}
+
+	span_p = band->chunks[chunk];
+	return &span_p[MAXSPANS - r_refdef.vrect.width];
+}
+
+/*
+==============
+R_ScanBandJob
+==============
+*/
+static void R_ScanBandJob (void *data, int job)
+{
+	rband_t		*band = &r_bands[job];
+	surf_t		*oldsurfaces, *oldsurface_p;
+	edge_t		*edge;
+	espan_t		*bandmax_span_p;
+	int		iv, chunk, numedges;
+
+	numedges = edge_p - r_edges;
+	memcpy (band->edges, r_edges, numedges * sizeof(edge_t));
+	for (edge = band->edges ; edge < &band->edges[numedges] ; edge++)
+	{
+		edge->next = R_BandEdge (band, edge->next);
+		edge->nextremove = R_BandEdge (band, edge->nextremove);
+	}
+
+	memcpy (band->surfs, r_bandsurfaces, r_bandnumsurfs * sizeof(surf_t));
+
+	oldsurfaces = surfaces;
+	oldsurface_p = surface_p;
+	surfaces = band->surfs;
+	surface_p = &band->surfs[r_bandnumsurfs];
+
+	band->transcount = 0;
+	band->overflow = false;
+
+	R_ClearActiveEdges ();
+
+// bring the active edges down to the top of the band
+	for (iv = r_refdef.vrect.y ; iv < band->top ; iv++)
+	{
+		if (newedges[iv])
+			R_InsertNewEdges (R_BandEdge (band, newedges[iv]), edge_head.next);
+
+		if (removeedges[iv])
+			R_RemoveEdges (R_BandEdge (band, removeedges[iv]));
+
+		if (edge_head.next != &edge_tail)
+			R_StepActiveU (edge_head.next);
+	}
+
+	chunk = 0;
+	bandmax_span_p = R_BandChunk (band, chunk);
+	if (!bandmax_span_p)
+		band->overflow = true;
+
+	for ( ; bandmax_span_p ; iv++)
+	{
+		current_iv = iv;
+		fv = (float)iv;
+
+	// mark that the head (background start) span is pre-included
+		surfaces[1].spanstate = 1;
+
+		if (newedges[iv])
+			R_InsertNewEdges (R_BandEdge (band, newedges[iv]), edge_head.next);
+
+		if (!r_bandtrans)
+		{
+			(*pdrawfunc) ();
+			TransList[iv] = FoundTrans;
+			band->transcount += FoundTrans;
+		}
+		else if (TransList[iv])
+		{
+			(*pdrawTfunc) ();
+		}
+
+		if (iv == band->bottom - 1)
+			break;
+
+	// go on in a new chunk if there may not be enough spans left in this
+	// one for the next scan
+		if (span_p >= bandmax_span_p)
+		{
+			bandmax_span_p = R_BandChunk (band, ++chunk);
+			if (!bandmax_span_p)
+				band->overflow = true;
+		}
+
+		if (removeedges[iv])
+			R_RemoveEdges (R_BandEdge (band, removeedges[iv]));
+
+		if (edge_head.next != &edge_tail)
+			R_StepActiveU (edge_head.next);
+	}
+
+	surfaces = oldsurfaces;
+	surface_p = oldsurface_p;
+}
+
+/*
+==============
+R_ScanBands
+
+Scans and draws the frame in bands, or returns false if it is to be done
+the serial way.
+==============
+*/
+static qboolean R_ScanBands (qboolean Translucent)
+{
+	surf_t		*bandsurfs[MAX_BANDS];
+	rband_t		*band;
+	int		i, numbands, numedges, numsurfs, height;
+
+	numbands = r_benchbands ? r_benchbands : r_threads.integer;
+	if (numbands > MAX_BANDS)
+		numbands = MAX_BANDS;
+	height = r_refdef.vrectbottom - r_refdef.vrect.y;
+	if (numbands > height)
+		numbands = height;
+	if (numbands < 2)
+		return false;
+
+	numedges = edge_p - r_edges;
+	numsurfs = surface_p - surfaces;
+
+	for (i = 0, band = r_bands ; i < numbands ; i++, band++)
+	{
+		if (band->maxedges < numedges)
+		{
+			free (band->edges);
+			band->maxedges = numedges + 256;
+			band->edges = (edge_t *) malloc (band->maxedges * sizeof(edge_t));
+		}
+		if (band->maxsurfs < numsurfs)
+		{
+			free (band->surfs);
+			band->maxsurfs = numsurfs + 64;
+			band->surfs = (surf_t *) malloc (band->maxsurfs * sizeof(surf_t));
+		}
+		if (!band->edges || !band->surfs)
+		{
+			free (band->edges);
+			free (band->surfs);
+			band->edges = NULL;
+			band->surfs = NULL;
+			band->maxedges = band->maxsurfs = 0;
+			return false;
+		}
+
+		band->top = r_refdef.vrect.y + height * i / numbands;
+		band->bottom = r_refdef.vrect.y + height * (i + 1) / numbands;
+		bandsurfs[i] = band->surfs;
+	}
+
+	r_bandtrans = Translucent;
+	r_bandsurfaces = surfaces;
+	r_bandnumsurfs = numsurfs;
+
+	Thread_RunJobs (R_ScanBandJob, NULL, numbands);
+
+	for (i = 0 ; i < numbands ; i++)
+	{
+		if (r_bands[i].overflow)
+			return false;	// nothing drawn yet, so rescan serially
+	}
+
+	if (!Translucent)
+	{
+		TransCount = 0;
+		for (i = 0 ; i < numbands ; i++)
+			TransCount += r_bands[i].transcount;
+	}
+
+	D_DrawSurfaceBands (bandsurfs, numbands, numsurfs, Translucent);
+
+	return true;
+}
+
+#endif	/* R_BANDTHREADS */
+
+/*
+==============
+R_Threads_f
+
+Callback for r_threads: asks for a worker per band past the first.  The
+server's threads share the workers, so the pool is never smaller than
+what they want, either.
+==============
+*/
+void R_Threads_f (cvar_t *var)
+{
+#if R_BANDTHREADS
+	int	count = var->integer;
+
+	if (count > MAX_BANDS)
+		count = MAX_BANDS;
+	Thread_WantWorkers (THREAD_RENDER, count - 1);
+#endif
+}
+
+
+/*
+===============================================================================
+
+BAND BENCHMARK
+
+"timebands <demo> [threads]" plays the demo as a timedemo, and renders every
+frame of it once for each band count from 1 to threads.  Each count is
+timed, and its view is compared with the single banded one, which is the
+serial renderer.  The results are printed when the timedemo is done.
+
+===============================================================================
+*/
+
+#if R_BANDTHREADS
+static int	tb_maxbands;		// 0 when not benchmarking
+static int	tb_frames;
+static double	tb_time[MAX_BANDS + 1];
+static int	tb_mismatch[MAX_BANDS + 1];
+static byte	*tb_view;		// the view as rendered serially
+static int	tb_viewsize;
+
+/*
+==============
+R_CompareBenchView
+
+Saves the view when save is set, otherwise returns whether it is the same
+as the saved one.
+==============
+*/
+static qboolean R_CompareBenchView (qboolean save)
+{
+	byte	*src, *dst;
+	int	v, size;
+
+	size = r_refdef.vrect.width * r_refdef.vrect.height;
+	if (save && size > tb_viewsize)
+	{
+		free (tb_view);
+		tb_view = (byte *) malloc (size);
+		tb_viewsize = tb_view ? size : 0;
+	}
+	if (!tb_view)
+		return true;
+
+	src = vid.buffer + r_refdef.vrect.y * vid.rowbytes + r_refdef.vrect.x;
+	dst = tb_view;
+	for (v = 0 ; v < r_refdef.vrect.height ; v++)
+	{
+		if (save)
+			memcpy (dst, src, r_refdef.vrect.width);
+		else if (memcmp (dst, src, r_refdef.vrect.width))
+			return false;
+		src += vid.rowbytes;
+		dst += r_refdef.vrect.width;
+	}
+
+	return true;
+}
+#endif	/* R_BANDTHREADS */
+
+/*
+==============
+R_TimeBands_f
+==============
+*/
+void R_TimeBands_f (void)
+{
+#if R_BANDTHREADS
+	int	count;
+	char	demo[MAX_OSPATH];
+
+	if (Cmd_Argc () != 2 && Cmd_Argc () != 3)
+	{
+		Con_Printf ("timebands <demoname> [threads] : times the banded renderer\n");
+		return;
+	}
+
+	count = (Cmd_Argc () == 3) ? atoi (Cmd_Argv (2)) : Thread_GetNumCPUS ();
+	if (count < 1)
+		count = 1;
+	else if (count > MAX_BANDS)
+		count = MAX_BANDS;
+	Thread_WantWorkers (THREAD_RENDER, count - 1);
+
+	q_strlcpy (demo, Cmd_Argv (1), sizeof(demo));
+	Cmd_ExecuteString (va("timedemo %s", demo), src_command);
+	if (!cls.timedemo)
+	{	// back to what r_threads wants
+		R_Threads_f (&r_threads);
+		return;
+	}
+
+	tb_maxbands = count;
+	tb_frames = 0;
+	memset (tb_time, 0, sizeof(tb_time));
+	memset (tb_mismatch, 0, sizeof(tb_mismatch));
+#else
+	Con_Printf ("%s: no banded rendering in this build\n", Cmd_Argv (0));
+#endif
+}
+
+/*
+==============
+R_TimeBandsView
+
+Renders the view once per band count when timebands is running, and
+returns whether it did.
+==============
+*/
+qboolean R_TimeBandsView (void (*render) (void))
+{
+#if R_BANDTHREADS
+	double	start;
+	int	count;
+
+	if (!tb_maxbands || !cls.timedemo)
+		return false;
+
+	for (count = 1 ; count <= tb_maxbands ; count++)
+	{
+		r_benchbands = count;
+		start = Sys_DoubleTime ();
+		render ();
+		tb_time[count] += Sys_DoubleTime () - start;
+
+		if (!R_CompareBenchView (count == 1))
+			tb_mismatch[count]++;
+	}
+	r_benchbands = 0;
+	tb_frames++;
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+/*
+==============
+R_TimeBandsDone
+==============
+*/
+void R_TimeBandsDone (void)
+{
+#if R_BANDTHREADS
+	int	count;
+
+	if (!tb_maxbands)
+		return;
+
+	if (tb_frames)
+	{
+		Con_Printf ("%d frames at %dx%d\n", tb_frames,
+				r_refdef.vrect.width, r_refdef.vrect.height);
+		Con_Printf ("threads ms/frame speedup mismatched\n");
+		for (count = 1 ; count <= tb_maxbands ; count++)
+		{
+			Con_Printf ("%7d %8.3f %7.2f %10d\n", count,
+					tb_time[count] * 1000.0 / tb_frames,
+					tb_time[count] ? tb_time[1] / tb_time[count] : 0.0,
+					tb_mismatch[count]);
+		}
+	}
+
+	tb_maxbands = 0;
+	R_Threads_f (&r_threads);
+#endif
+}
@@ -85,6 +85,7 @@ extern cvar_t	r_teamcolor;
 #endif
 extern cvar_t	r_texture_external;
 extern cvar_t	r_dynamic;
+extern cvar_t	r_threads;
 
 #define XCENTERING	(1.0 / 2.0)
 #define YCENTERING	(1.0 / 2.0)
@@ -230,6 +231,26 @@ ASM_LINKAGE_END
 
 void R_AliasProjectFinalVert (finalvert_t *, auxvert_t *);
 
+// r_avert.c
+#if !id386 && !id68k
+void R_AliasTransformAndProjectFinalVerts (finalvert_t *fv, stvert_t *pstverts);
+void R_AliasTransformClipVerts (finalvert_t *fv, auxvert_t *av, float ziscale);
+#endif
+void R_AliasBench_f (void);
+
+extern	cvar_t		r_aliassimd, r_aliascheck, r_lerpmodels;
+
+ASM_LINKAGE_BEGIN
+extern	trivertx_t	*r_apverts;
+extern	int		r_anumverts;
+extern	float		aliastransform[3][4];
+extern	vec3_t		r_plightvec;
+extern	int		r_ambientlight;
+extern	float		r_shadelight;
+ASM_LINKAGE_END
+extern	trivertx_t	*r_alerpverts;
+extern	float		r_alerpfrac;
+
 
 extern	int	c_faceclip;
 extern	int	r_polycount;
@@ -244,11 +265,13 @@ ASM_LINKAGE_BEGIN
 extern	int	ubasestep, errorterm, erroradjustup, erroradjustdown;
 extern	int	vstartscan;
 
-extern	fixed16_t	sadjust, tadjust;
-extern	fixed16_t	bbextents, bbextentt;
+extern	R_TLS fixed16_t	sadjust, tadjust;
+extern	R_TLS fixed16_t	bbextents, bbextentt;
 
 ASM_LINKAGE_END
 
+extern	R_TLS drawsurf_t	r_drawsurf;
+
 #define MAXBVERTINDEXES	1000	// new clipped vertices when clipping bmodels
 								//  to the world BSP
 extern	mvertex_t	*r_ptverts, *r_ptvertsmax;
@@ -314,10 +337,10 @@ extern	edge_t	*removeedges[MAXHEIGHT];
 extern	int	screenwidth;
 
 // FIXME: make stack vars when debugging done
-extern	edge_t	edge_head;
-extern	edge_t	edge_tail;
-extern	edge_t	edge_aftertail;
-extern	int	r_bmodelactive;
+extern	R_TLS edge_t	edge_head;
+extern	R_TLS edge_t	edge_tail;
+extern	R_TLS edge_t	edge_aftertail;
+extern	R_TLS int	r_bmodelactive;
 ASM_LINKAGE_END
 
 extern	vrect_t	*pconupdate;
@@ -355,12 +378,15 @@ extern	int	r_dlightframecount;
 extern	qboolean	r_fov_greater_than_90;
 
 ASM_LINKAGE_BEGIN
-extern	int	FoundTrans;
+extern	R_TLS int	FoundTrans;
 extern	int	TransCount;
 ASM_LINKAGE_END
 
 void R_StoreEfrags (efrag_t **ppefrag);
 void R_TimeRefresh_f (void);
+void R_Threads_f (cvar_t *var);
+void R_TimeBands_f (void);
+qboolean R_TimeBandsView (void (*render) (void));
 void R_TimeGraph (void);
 #ifdef H2W
 void R_ZGraph (void);
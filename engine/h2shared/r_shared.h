@@ -26,8 +26,22 @@
 
 #ifndef GLQUAKE
 
+#include "threads.h"
+
 // FIXME: clean up and move into d_iface.h
 
+// with r_threads > 1 the screen is cut into bands which are scanned and
+// drawn on worker threads, so the span generation and span drawing state
+// is per thread.  the assembly scanners and drawers use that state as
+// plain globals, so those builds stay single threaded.
+#if !id386 && !id68k && defined(THREAD_LOCAL)
+#define	R_BANDTHREADS	1
+#define	R_TLS		THREAD_LOCAL
+#else
+#define	R_BANDTHREADS	0
+#define	R_TLS
+#endif
+
 #define	MAXVERTS	16		// max points in a surface polygon
 
 #define MAXWORKINGVERTS	(MAXVERTS+4)	// max points in an intermediate
@@ -52,8 +66,8 @@ extern void	R_DrawLine (polyvert_t *polyvert0, polyvert_t *polyvert1);
 
 
 ASM_LINKAGE_BEGIN
-extern	int	cachewidth;
-extern	pixel_t	*cacheblock;
+extern	R_TLS int	cachewidth;
+extern	R_TLS pixel_t	*cacheblock;
 extern	int	screenwidth;
 ASM_LINKAGE_END
 
@@ -114,7 +128,8 @@ typedef struct surf_s
 } surf_t;
 
 ASM_LINKAGE_BEGIN
-extern	surf_t	*surfaces, *surface_p, *surf_max;
+extern	R_TLS surf_t	*surfaces, *surface_p;
+extern	surf_t	*surf_max;
 ASM_LINKAGE_END
 
 // surfaces are generated in back to front order by the bsp, so if a surf
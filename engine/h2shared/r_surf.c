@@ -22,24 +22,26 @@
 #include "quakedef.h"
 #include "r_local.h"
 
-drawsurf_t	r_drawsurf;
+// the surface cache entries of a frame may be built on worker threads,
+// so all the state of a build is per thread
+R_TLS drawsurf_t	r_drawsurf;
 
 ASM_LINKAGE_BEGIN
-int		lightleft, sourcesstep, blocksize, sourcetstep;
-int		lightdelta, lightdeltastep;
-int		lightright, lightleftstep, lightrightstep, blockdivshift;
-unsigned int	blockdivmask;
-void		*prowdestbase;
-unsigned char	*pbasesource;
-int		surfrowbytes;	// used by ASM files
-unsigned int	*r_lightptr;
-int		r_stepback;
-int		r_lightwidth;
-int		r_numhblocks, r_numvblocks;
-unsigned char	*r_source, *r_sourcemax;
+R_TLS int		lightleft, sourcesstep, blocksize, sourcetstep;
+R_TLS int		lightdelta, lightdeltastep;
+R_TLS int		lightright, lightleftstep, lightrightstep, blockdivshift;
+R_TLS unsigned int	blockdivmask;
+R_TLS void		*prowdestbase;
+R_TLS unsigned char	*pbasesource;
+R_TLS int		surfrowbytes;	// used by ASM files
+R_TLS unsigned int	*r_lightptr;
+R_TLS int		r_stepback;
+R_TLS int		r_lightwidth;
+R_TLS int		r_numhblocks, r_numvblocks;
+R_TLS unsigned char	*r_source, *r_sourcemax;
 ASM_LINKAGE_END
 
-static unsigned int	blocklights[18*18];
+static R_TLS unsigned int	blocklights[18*18];
 
 #if !id386 && !id68k
 static void R_DrawSurfaceBlock16 (void);
@@ -189,9 +191,9 @@ static void R_BuildLightMap (void)
 		return;
 	}
 
-	if ((currententity->drawflags & MLS_ABSLIGHT) == MLS_ABSLIGHT)
+	if ((r_drawsurf.drawflags & MLS_ABSLIGHT) == MLS_ABSLIGHT)
 	{
-		light = (255-currententity->abslight)<<VID_CBITS;
+		light = (255-r_drawsurf.abslight)<<VID_CBITS;
 		for (i = 0; i < size; i++)
 			blocklights[i] = light;	// 0 - 16383, 0 = full bright
 		return;
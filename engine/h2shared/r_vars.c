@@ -20,6 +20,7 @@
  */
 
 #include	"quakedef.h"
+#include	"r_local.h"
 
 #if	!id386
 
@@ -33,8 +34,8 @@
 // FIXME: make into one big structure, like cl or sv
 // FIXME: do separately for refresh engine and driver
 
-int		r_bmodelactive;
+R_TLS int	r_bmodelactive;
 
-int		FoundTrans;
+R_TLS int	FoundTrans;
 
 #endif	/* !id386 */
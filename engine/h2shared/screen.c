@@ -100,6 +100,8 @@ static	cvar_t	scr_showram = {"showram", "1", CVAR_NONE};
 static	cvar_t	scr_showturtle = {"showturtle", "0", CVAR_NONE};
 static	cvar_t	scr_showpause = {"showpause", "1", CVAR_NONE};
 static	cvar_t	scr_showfps = {"showfps", "0", CVAR_NONE};
+static	cvar_t	scr_surfcachestats = {"r_surfcachestats", "0", CVAR_NONE};
+static	cvar_t	scr_particlestats = {"r_particlestats", "0", CVAR_NONE};
 
 #if !defined(H2W)
 static qboolean	scr_drawloading;
@@ -492,6 +494,8 @@ void SCR_Init (void)
 	Cvar_RegisterVariable (&scr_showturtle);
 	Cvar_RegisterVariable (&scr_showpause);
 	Cvar_RegisterVariable (&scr_showfps);
+	Cvar_RegisterVariable (&scr_surfcachestats);
+	Cvar_RegisterVariable (&scr_particlestats);
 	Cvar_RegisterVariable (&scr_centertime);
 
 	Cmd_AddCommand ("screenshot",SCR_ScreenShot_f);
@@ -604,6 +608,52 @@ static void SCR_DrawFPS (void)
 	Draw_String(x, y, st);
 }
 
+/*
+==============
+SCR_DrawSurfCacheStats
+
+Surface cache lookups of the last frame
+==============
+*/
+static void SCR_DrawSurfCacheStats (void)
+{
+	char	st[64];
+	int	y;
+
+	if (!scr_surfcachestats.integer)
+		return;
+
+	y = vid.height - sb_lines - 16;
+	q_snprintf (st, sizeof(st), "surfcache %ik", d_cachestats.size / 1024);
+	Draw_String (8, y, st);
+	q_snprintf (st, sizeof(st), "%4i hit %4i miss %4i evict",
+			d_cachestats.hits, d_cachestats.misses, d_cachestats.evictions);
+	Draw_String (8, y + 8, st);
+}
+
+/*
+==============
+SCR_DrawParticleStats
+
+Particles of the last frame
+==============
+*/
+static void SCR_DrawParticleStats (void)
+{
+	char	st[64];
+	int	y;
+
+	if (!scr_particlestats.integer)
+		return;
+
+	y = vid.height - sb_lines - 16 - 16;
+	q_snprintf (st, sizeof(st), "particles %i", r_partstats.active);
+	Draw_String (8, y, st);
+	q_snprintf (st, sizeof(st), "%4i new %4i drop %4i cull",
+			r_partstats.spawned, r_partstats.dropped, r_partstats.culled);
+	Draw_String (8, y + 8, st);
+}
+
 /*
 ==============
 DrawPause
@@ -1409,6 +1459,8 @@ void SCR_UpdateScreen (void)
 		SCR_CheckDrawCenterString();
 		Sbar_Draw();
 		SCR_DrawFPS();
+		SCR_DrawSurfCacheStats();
+		SCR_DrawParticleStats();
 
 		Plaque_Draw(plaquemessage, false);
 		SCR_DrawConsole();
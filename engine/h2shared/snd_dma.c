@@ -92,6 +92,9 @@ cvar_t		sfxvolume = {"volume", "0.7", CVAR_ARCHIVE};
 
 cvar_t		precache = {"precache", "1", CVAR_NONE};
 cvar_t		loadas8bit = {"loadas8bit", "0", CVAR_NONE};
+cvar_t		snd_mixsimd = {"snd_mixsimd", "1", CVAR_NONE};
+cvar_t		snd_resample = {"snd_resample", "0", CVAR_ARCHIVE};	// 1: windowed sinc
+cvar_t		snd_resamplecache = {"snd_resamplecache", "1", CVAR_ARCHIVE};
 
 static	cvar_t	sfx_mutedvol = {"sfx_mutedvol", "0", CVAR_ARCHIVE};
 static	cvar_t	bgm_mutedvol = {"bgm_mutedvol", "0", CVAR_ARCHIVE};
@@ -162,6 +165,19 @@ static void SND_Callback_sfxvolume (cvar_t *var)
 	SND_InitScaletable ();
 }
 
+static void SND_Callback_resample (cvar_t *var)
+{
+	int		i;
+
+// drop the sounds resampled the other way, S_LoadSound
+// does them again as they are played.
+	for (i = 0; i < num_sfx; i++)
+	{
+		if (Cache_Check (&known_sfx[i].cache))
+			Cache_Free (&known_sfx[i].cache);
+	}
+}
+
 
 /*
 ================
@@ -256,6 +272,12 @@ void S_Init (void)
 	Cvar_RegisterVariable(&snd_noextraupdate);
 	Cvar_RegisterVariable(&snd_show);
 	Cvar_RegisterVariable(&_snd_mixahead);
+	Cvar_RegisterVariable(&snd_mixsimd);
+	Cvar_RegisterVariable(&snd_resample);
+	Cvar_RegisterVariable(&snd_resamplecache);
+
+	// the benchmark has a buffer of its own, it needs no device
+	Cmd_AddCommand("sndbench", S_SoundBench_f);
 
 	if (safemode || COM_CheckParm("-nosound") || COM_CheckParm("-s"))
 		return;
@@ -292,6 +314,7 @@ void S_Init (void)
 		Cvar_SetQuick(&bgmvolume, "1");
 
 	Cvar_SetCallback(&sfxvolume, SND_Callback_sfxvolume);
+	Cvar_SetCallback(&snd_resample, SND_Callback_resample);
 
 	// lock the early-read cvars until Host_Init is finished
 	for (i = 0; i < num_readvars; i++)
@@ -22,6 +22,259 @@
 
 #include "quakedef.h"
 
+/*
+===============================================================================
+
+WINDOWED SINC RESAMPLING
+
+With snd_resample 1, a sound that isn't at the mixing rate is resampled
+through a Blackman windowed sinc rather than by picking the nearest source
+sample.  The filter is tabulated at SINC_PHASES positions between two
+source samples, and its cutoff comes down to the output's nyquist when the
+sound is decimated.  Looping sounds are filtered around their loop point,
+so that the loop doesn't click.
+
+Filtering a level's worth of sounds is slow enough to be felt, so with
+snd_resamplecache the result is written to sndcache/ under the user's
+directory, along with the size and crc of the samples it was made from so
+that a changed wav isn't taken from a stale file.
+
+===============================================================================
+*/
+
+#define	SINC_PHASES	256
+#define	SINC_ZEROS	16	// zero crossings on each side at full band
+
+static float	*sinc_table;	// [SINC_PHASES + 1][sinc_taps]
+static int	sinc_taps;
+static float	sinc_stepscale = -1;	// what the table was built for
+
+/*
+================
+SND_BuildSincTable
+================
+*/
+static void SND_BuildSincTable (float stepscale)
+{
+	double	cutoff, x, w, sum;
+	float	*row;
+	int	half, p, k;
+
+	if (sinc_table && sinc_stepscale == stepscale)
+		return;
+
+	cutoff = (stepscale > 1) ? 1.0 / stepscale : 1.0;
+	half = (int) ceil(SINC_ZEROS / cutoff);
+
+	free (sinc_table);
+	sinc_taps = half * 2;
+	sinc_table = (float *) malloc ((SINC_PHASES + 1) * sinc_taps * sizeof(float));
+	if (!sinc_table)
+		Sys_Error ("%s: out of memory", __thisfunc__);
+	sinc_stepscale = stepscale;
+
+	for (p = 0; p <= SINC_PHASES; p++)
+	{
+		row = sinc_table + p * sinc_taps;
+		sum = 0;
+		for (k = 0; k < sinc_taps; k++)
+		{	// tap k is source sample (int)pos - half + 1 + k
+			x = (k - half + 1) - (double)p / SINC_PHASES;
+			if (fabs(x) >= half)
+			{
+				row[k] = 0;
+				continue;
+			}
+			w = 0.42 + 0.5 * cos(M_PI * x / half) + 0.08 * cos(2 * M_PI * x / half);
+			if (x == 0)
+				row[k] = cutoff * w;
+			else
+				row[k] = sin(M_PI * cutoff * x) / (M_PI * x) * w;
+			sum += row[k];
+		}
+		for (k = 0; k < sinc_taps; k++)	// unity gain at dc
+			row[k] /= sum;
+	}
+}
+
+/*
+================
+SND_ResampleSinc
+
+Filters the source into sc, which has its output length already.  The
+source is widened into a float buffer padded with what the filter sees
+past either end: silence, or the loop again past the end of a looping
+sound.
+================
+*/
+static void SND_ResampleSinc (sfxcache_t *sc, int inlength, int inloopstart,
+				float stepscale, int inwidth, byte *data)
+{
+	float	*in, *row;
+	double	pos, sum;
+	int	half, i, j, k, src, sample;
+
+	SND_BuildSincTable (stepscale);
+	half = sinc_taps / 2;
+
+	in = (float *) malloc ((inlength + sinc_taps * 2) * sizeof(float));
+	if (!in)
+		Sys_Error ("%s: out of memory", __thisfunc__);
+
+	for (j = -half; j < inlength + half + sinc_taps; j++)
+	{
+		src = j;
+		if (src >= inlength && inloopstart >= 0 && inloopstart < inlength)
+			src = inloopstart + (src - inloopstart) % (inlength - inloopstart);
+		if (src < 0 || src >= inlength)
+			sample = 0;
+		else if (inwidth == 2)
+			sample = LittleShort (((short *)data)[src]);
+		else
+			sample = (int)((unsigned char)(data[src]) - 128) << 8;
+		in[j + half] = sample;
+	}
+
+	for (i = 0; i < sc->length; i++)
+	{
+		pos = i * (double)stepscale;
+		j = (int) pos;
+		row = sinc_table + (int)((pos - j) * SINC_PHASES + 0.5) * sinc_taps;
+		// in[j + 1] is source sample j - half + 1
+		sum = 0;
+		for (k = 0; k < sinc_taps; k++)
+			sum += row[k] * in[j + 1 + k];
+
+		sample = (int) floor(sum + 0.5);
+		if (sample > 32767)
+			sample = 32767;
+		else if (sample < -32768)
+			sample = -32768;
+		if (sc->width == 2)
+			((short *)sc->data)[i] = sample;
+		else
+			((signed char *)sc->data)[i] = sample >> 8;
+	}
+
+	free (in);
+}
+
+#define	SNDCACHE_IDENT		(('C'<<24) + ('S'<<16) + ('N'<<8) + 'H')
+#define	SNDCACHE_VERSION	1
+
+typedef struct
+{
+	int	ident;
+	int	version;
+	int	srclength, srcwidth, srcrate, srccrc;
+	int	length, loopstart, speed, width;
+} sndcachehdr_t;
+
+/*
+================
+SND_CacheHeader
+
+What the cache file of sc has to start with
+================
+*/
+static void SND_CacheHeader (sndcachehdr_t *hdr, sfxcache_t *sc, int inlength,
+				int inwidth, int inrate, byte *data)
+{
+	hdr->ident = LittleLong (SNDCACHE_IDENT);
+	hdr->version = LittleLong (SNDCACHE_VERSION);
+	hdr->srclength = LittleLong (inlength);
+	hdr->srcwidth = LittleLong (inwidth);
+	hdr->srcrate = LittleLong (inrate);
+	hdr->srccrc = LittleLong (CRC_Block (data, inlength * inwidth));
+	hdr->length = LittleLong (sc->length);
+	hdr->loopstart = LittleLong (sc->loopstart);
+	hdr->speed = LittleLong (sc->speed);
+	hdr->width = LittleLong (sc->width);
+}
+
+/*
+================
+SND_ByteSwapSfx
+
+The cache files are little endian
+================
+*/
+static void SND_ByteSwapSfx (sfxcache_t *sc)
+{
+#if (BYTE_ORDER != LITTLE_ENDIAN)
+	int		i;
+
+	if (sc->width != 2)
+		return;
+	for (i = 0; i < sc->length; i++)
+		((short *)sc->data)[i] = LittleShort (((short *)sc->data)[i]);
+#endif
+}
+
+/*
+================
+SND_ReadResampled
+
+Fills sc from its cache file, returns false if there is no file or the
+file is stale
+================
+*/
+static qboolean SND_ReadResampled (const char *name, sfxcache_t *sc, sndcachehdr_t *hdr)
+{
+	char		path[MAX_OSPATH];
+	sndcachehdr_t	filehdr;
+	FILE		*f;
+	qboolean	ok;
+	int		err;
+
+	FS_MakePath_VABUF (FS_USERDIR, &err, path, sizeof(path), "sndcache/%s.%d", name, sc->speed);
+	if (err)
+		return false;
+	f = fopen (path, "rb");
+	if (!f)
+		return false;
+
+	ok = (fread (&filehdr, sizeof(filehdr), 1, f) == 1 &&
+		!memcmp (&filehdr, hdr, sizeof(filehdr)) &&
+		fread (sc->data, sc->width, sc->length, f) == (size_t)sc->length);
+	fclose (f);
+
+	if (ok)
+		SND_ByteSwapSfx (sc);
+	return ok;
+}
+
+/*
+================
+SND_WriteResampled
+================
+*/
+static void SND_WriteResampled (const char *name, sfxcache_t *sc, sndcachehdr_t *hdr)
+{
+	char		path[MAX_OSPATH];
+	FILE		*f;
+	int		err;
+
+	FS_MakePath_VABUF (FS_USERDIR, &err, path, sizeof(path), "sndcache/%s.%d", name, sc->speed);
+	if (err || FS_CreatePath (path))
+		return;
+	f = fopen (path, "wb");
+	if (!f)
+	{
+		Con_DPrintf ("Couldn't write %s\n", path);
+		return;
+	}
+
+	SND_ByteSwapSfx (sc);
+	if (fwrite (hdr, sizeof(*hdr), 1, f) != 1 ||
+	    fwrite (sc->data, sc->width, sc->length, f) != (size_t)sc->length)
+		Con_DPrintf ("Couldn't write %s\n", path);
+	SND_ByteSwapSfx (sc);
+	fclose (f);
+}
+
+//=============================================================================
+
 /*
 ================
 ResampleSfx
@@ -34,7 +287,9 @@ static void ResampleSfx (sfx_t *sfx, int inrate, int inwidth, byte *data)
 	float	stepscale;
 	int		i;
 	int		sample, samplefrac, fracstep;
+	int		inlength, inloopstart;
 	sfxcache_t	*sc;
+	sndcachehdr_t	hdr;
 
 	sc = (sfxcache_t *) Cache_Check (&sfx->cache);
 	if (!sc)
@@ -42,6 +297,8 @@ static void ResampleSfx (sfx_t *sfx, int inrate, int inwidth, byte *data)
 
 	stepscale = (float)inrate / shm->speed;	// this is usually 0.5, 1, or 2
 
+	inlength = sc->length;
+	inloopstart = sc->loopstart;
 	outcount = sc->length / stepscale;
 	sc->length = outcount;
 	if (sc->loopstart != -1)
@@ -62,6 +319,18 @@ static void ResampleSfx (sfx_t *sfx, int inrate, int inwidth, byte *data)
 		for (i = 0; i < outcount; i++)
 			((signed char *)sc->data)[i] = (int)( (unsigned char)(data[i]) - 128);
 	}
+	else if (stepscale != 1 && snd_resample.integer)
+	{
+		if (snd_resamplecache.integer)
+		{
+			SND_CacheHeader (&hdr, sc, inlength, inwidth, inrate, data);
+			if (SND_ReadResampled (sfx->name, sc, &hdr))
+				return;
+		}
+		SND_ResampleSinc (sc, inlength, inloopstart, stepscale, inwidth, data);
+		if (snd_resamplecache.integer)
+			SND_WriteResampled (sfx->name, sc, &hdr);
+	}
 	else
 	{
 // general case
@@ -98,7 +367,7 @@ sfxcache_t *S_LoadSound (sfx_t *s)
 	int		len;
 	float	stepscale;
 	sfxcache_t	*sc;
-	byte	stackbuf[1*1024];		// avoid dirtying the cache heap
+	fsview_t	view;
 
 // see if still in memory
 	sc = (sfxcache_t *) Cache_Check (&s->cache);
@@ -113,7 +382,8 @@ sfxcache_t *S_LoadSound (sfx_t *s)
 
 //	Con_Printf ("loading %s\n",namebuffer);
 
-	data = FS_LoadStackFile(namebuffer, stackbuf, sizeof(stackbuf), NULL);
+// the wav is only read, straight out of the pak when it can be
+	data = (byte *) FS_OpenView(namebuffer, &view, NULL);
 
 	if (!data)
 	{
@@ -121,17 +391,18 @@ sfxcache_t *S_LoadSound (sfx_t *s)
 		return NULL;
 	}
 
-	info = GetWavinfo (s->name, data, fs_filesize);
+	sc = NULL;
+	info = GetWavinfo (s->name, data, view.size);
 	if (info.channels != 1)
 	{
 		Con_Printf ("%s is a stereo sample\n",s->name);
-		return NULL;
+		goto done;
 	}
 
 	if (info.width != 1 && info.width != 2)
 	{
 		Con_Printf("%s is not 8 or 16 bit\n", s->name);
-		return NULL;
+		goto done;
 	}
 
 	stepscale = (float)info.rate / shm->speed;
@@ -142,12 +413,12 @@ sfxcache_t *S_LoadSound (sfx_t *s)
 	if (info.samples == 0 || len == 0)
 	{
 		Con_Printf("%s has zero samples\n", s->name);
-		return NULL;
+		goto done;
 	}
 
 	sc = (sfxcache_t *) Cache_Alloc ( &s->cache, len + sizeof(sfxcache_t), s->name);
 	if (!sc)
-		return NULL;
+		goto done;
 
 	sc->length = info.samples;
 	sc->loopstart = info.loopstart;
@@ -157,6 +428,8 @@ sfxcache_t *S_LoadSound (sfx_t *s)
 
 	ResampleSfx (s, sc->speed, sc->width, data + info.dataofs);
 
+done:
+	FS_CloseView (&view);
 	return sc;
 }
 
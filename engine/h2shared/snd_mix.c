@@ -30,6 +30,15 @@ short		*snd_out;
 ASM_LINKAGE_END
 
 static int	snd_vol;
+static int	snd_usesimd;	// snd_mixsimd, latched for a whole paint
+
+#if defined(__SSE2__) && (BYTE_ORDER == LITTLE_ENDIAN)
+#include <emmintrin.h>
+#define	MIX_SIMD	"SSE2"
+#elif defined(__aarch64__) && (defined(__ARM_NEON) || defined(__ARM_NEON__)) && (BYTE_ORDER == LITTLE_ENDIAN)
+#include <arm_neon.h>
+#define	MIX_SIMD	"NEON"
+#endif
 
 #if	!id386
 static void Snd_WriteLinearBlastStereo16 (void)
@@ -58,6 +67,44 @@ static void Snd_WriteLinearBlastStereo16 (void)
 }
 #endif
 
+#if defined(MIX_SIMD)
+/* same as above, eight samples at a time: the saturating pack clamps
+ * exactly the way the compares do. */
+static void Snd_WriteLinearBlastStereo16_SIMD (void)
+{
+	int		i;
+	int		val;
+
+	for (i = 0; i + 8 <= snd_linear_count; i += 8)
+	{
+#if defined(__SSE2__)
+		__m128i	a, b;
+
+		a = _mm_srai_epi32 (_mm_loadu_si128 ((const __m128i *)(snd_p + i)), 8);
+		b = _mm_srai_epi32 (_mm_loadu_si128 ((const __m128i *)(snd_p + i + 4)), 8);
+		_mm_storeu_si128 ((__m128i *)(snd_out + i), _mm_packs_epi32 (a, b));
+#else
+		int16x4_t	a, b;
+
+		a = vqmovn_s32 (vshrq_n_s32 (vld1q_s32 (snd_p + i), 8));
+		b = vqmovn_s32 (vshrq_n_s32 (vld1q_s32 (snd_p + i + 4), 8));
+		vst1q_s16 (snd_out + i, vcombine_s16 (a, b));
+#endif
+	}
+
+	for ( ; i < snd_linear_count; i++)
+	{
+		val = snd_p[i] >> 8;
+		if (val > 0x7fff)
+			snd_out[i] = 0x7fff;
+		else if (val < (short)0x8000)
+			snd_out[i] = (short)0x8000;
+		else
+			snd_out[i] = val;
+	}
+}
+#endif	/* MIX_SIMD */
+
 static void S_TransferStereo16 (int endtime)
 {
 	int		lpos;
@@ -80,6 +127,11 @@ static void S_TransferStereo16 (int endtime)
 		snd_linear_count <<= 1;
 
 	// write a linear blast of samples
+#if defined(MIX_SIMD)
+		if (snd_usesimd)
+			Snd_WriteLinearBlastStereo16_SIMD ();
+		else
+#endif
 		Snd_WriteLinearBlastStereo16 ();
 
 		snd_p += snd_linear_count;
@@ -166,6 +218,15 @@ static void S_TransferPaintBuffer (int endtime)
 
 CHANNEL MIXING
 
+Each pass of S_PaintChannels mixes a block of up to PAINTBUFFER_SIZE
+samples: the paint buffer is cleared or filled from the streaming source,
+every active channel is added into it in turn while the block stays in the
+cache, and the block is clipped out into the dma buffer.
+
+With snd_mixsimd in an SSE2 or NEON build, the channels are added and the
+block is clipped with vector code, which gives the very same samples as
+the C.  "sndbench" times and compares the two.
+
 ===============================================================================
 */
 
@@ -173,15 +234,76 @@ CHANNEL MIXING
 static void SND_PaintChannelFrom8 (channel_t *ch, sfxcache_t *sc, int endtime);
 #endif
 static void SND_PaintChannelFrom16 (channel_t *ch, sfxcache_t *sc, int endtime);
+#if defined(MIX_SIMD)
+static void SND_PaintChannelFrom8_SIMD (channel_t *ch, sfxcache_t *sc, int count);
+static void SND_PaintChannelFrom16_SIMD (channel_t *ch, sfxcache_t *sc, int count);
+#endif
+
+/*
+================
+SND_MixChannel
+
+Paints a channel into the paint buffer from ltime up to end, restarting
+it at its loop point or stopping it when it runs out
+================
+*/
+static void SND_MixChannel (channel_t *ch, sfxcache_t *sc, int ltime, int end)
+{
+	int		count;
+
+	while (ltime < end)
+	{	// paint up to end
+		if (ch->end < end)
+			count = ch->end - ltime;
+		else
+			count = end - ltime;
+
+		if (count > 0)
+		{
+#if defined(MIX_SIMD)
+			if (snd_usesimd)
+			{
+				if (sc->width == 1)
+					SND_PaintChannelFrom8_SIMD(ch, sc, count);
+				else
+					SND_PaintChannelFrom16_SIMD(ch, sc, count);
+			}
+			else
+#endif
+			if (sc->width == 1)
+				SND_PaintChannelFrom8(ch, sc, count);
+			else
+				SND_PaintChannelFrom16(ch, sc, count);
+
+			ltime += count;
+		}
+
+	// if at end of loop, restart
+		if (ltime >= ch->end)
+		{
+			if (sc->loopstart >= 0)
+			{
+				ch->pos = sc->loopstart;
+				ch->end = ltime + sc->length - ch->pos;
+			}
+			else
+			{	// channel just stopped
+				ch->sfx = NULL;
+				break;
+			}
+		}
+	}
+}
 
 void S_PaintChannels (int endtime)
 {
 	int		i;
-	int		end, ltime, count;
+	int		end;
 	channel_t	*ch;
 	sfxcache_t	*sc;
 
 	snd_vol = sfxvolume.value * 256;
+	snd_usesimd = snd_mixsimd.integer;
 
 	while (paintedtime < endtime)
 	{
@@ -230,40 +352,7 @@ void S_PaintChannels (int endtime)
 			if (!sc)
 				continue;
 
-			ltime = paintedtime;
-
-			while (ltime < end)
-			{	// paint up to end
-				if (ch->end < end)
-					count = ch->end - ltime;
-				else
-					count = end - ltime;
-
-				if (count > 0)
-				{
-					if (sc->width == 1)
-						SND_PaintChannelFrom8(ch, sc, count);
-					else
-						SND_PaintChannelFrom16(ch, sc, count);
-
-					ltime += count;
-				}
-
-			// if at end of loop, restart
-				if (ltime >= ch->end)
-				{
-					if (sc->loopstart >= 0)
-					{
-						ch->pos = sc->loopstart;
-						ch->end = ltime + sc->length - ch->pos;
-					}
-					else
-					{	// channel just stopped
-						ch->sfx = NULL;
-						break;
-					}
-				}
-			}
+			SND_MixChannel (ch, sc, paintedtime, end);
 		}
 
 	// transfer out according to DMA format
@@ -355,3 +444,338 @@ static void SND_PaintChannelFrom16 (channel_t *ch, sfxcache_t *sc, int count)
 
 	ch->pos += count;
 }
+
+
+#if defined(MIX_SIMD)
+
+#if defined(__SSE2__)
+#define	MIX_ADD4(p,v)	_mm_storeu_si128 ((__m128i *)(p), _mm_add_epi32 (_mm_loadu_si128 ((const __m128i *)(p)), v))
+#endif
+
+/*
+================
+SND_PaintChannelFrom8_SIMD
+
+Every entry of a snd_scaletable row is the sample times entry 1 of the
+row, so the samples are multiplied by that instead of looked up.
+================
+*/
+static void SND_PaintChannelFrom8_SIMD (channel_t *ch, sfxcache_t *sc, int count)
+{
+	int		lscale, rscale;
+	signed char	*sfx;
+	int		*out;
+	int		i;
+
+	if (ch->leftvol > 255)
+		ch->leftvol = 255;
+	if (ch->rightvol > 255)
+		ch->rightvol = 255;
+
+	lscale = snd_scaletable[ch->leftvol >> 3][1];
+	rscale = snd_scaletable[ch->rightvol >> 3][1];
+	sfx = (signed char *)sc->data + ch->pos;
+	out = (int *)paintbuffer;
+	i = 0;
+
+#if defined(__SSE2__)
+/* there is no 32 bit multiply in SSE2: the scale is split into its high
+ * and low bytes and madd sums (sample << 8) * high + sample * low, which
+ * is exact as long as the high part fits a short. */
+	if ((lscale >> 8) == (short)(lscale >> 8) && (rscale >> 8) == (short)(rscale >> 8))
+	{
+		__m128i	zero, lmul, rmul, b, d8, d, lo, hi, l, r;
+
+		zero = _mm_setzero_si128 ();
+		lmul = _mm_set1_epi32 (((lscale & 255) << 16) | ((lscale >> 8) & 0xffff));
+		rmul = _mm_set1_epi32 (((rscale & 255) << 16) | ((rscale >> 8) & 0xffff));
+
+		for ( ; i + 8 <= count; i += 8)
+		{
+			b = _mm_loadl_epi64 ((const __m128i *)(sfx + i));
+			d8 = _mm_unpacklo_epi8 (zero, b);	// sample << 8
+			d = _mm_srai_epi16 (d8, 8);
+			lo = _mm_unpacklo_epi16 (d8, d);
+			hi = _mm_unpackhi_epi16 (d8, d);
+
+			l = _mm_madd_epi16 (lo, lmul);
+			r = _mm_madd_epi16 (lo, rmul);
+			MIX_ADD4 (out + i*2, _mm_unpacklo_epi32 (l, r));
+			MIX_ADD4 (out + i*2 + 4, _mm_unpackhi_epi32 (l, r));
+			l = _mm_madd_epi16 (hi, lmul);
+			r = _mm_madd_epi16 (hi, rmul);
+			MIX_ADD4 (out + i*2 + 8, _mm_unpacklo_epi32 (l, r));
+			MIX_ADD4 (out + i*2 + 12, _mm_unpackhi_epi32 (l, r));
+		}
+	}
+#else
+	for ( ; i + 8 <= count; i += 8)
+	{
+		int16x8_t	d;
+		int32x4_t	lo, hi;
+		int32x4x2_t	acc;
+
+		d = vmovl_s8 (vld1_s8 (sfx + i));
+		lo = vmovl_s16 (vget_low_s16 (d));
+		hi = vmovl_s16 (vget_high_s16 (d));
+
+		acc = vld2q_s32 (out + i*2);
+		acc.val[0] = vmlaq_n_s32 (acc.val[0], lo, lscale);
+		acc.val[1] = vmlaq_n_s32 (acc.val[1], lo, rscale);
+		vst2q_s32 (out + i*2, acc);
+		acc = vld2q_s32 (out + i*2 + 8);
+		acc.val[0] = vmlaq_n_s32 (acc.val[0], hi, lscale);
+		acc.val[1] = vmlaq_n_s32 (acc.val[1], hi, rscale);
+		vst2q_s32 (out + i*2 + 8, acc);
+	}
+#endif
+
+	for ( ; i < count; i++)
+	{
+		out[i*2] += sfx[i] * lscale;
+		out[i*2+1] += sfx[i] * rscale;
+	}
+
+	ch->pos += count;
+}
+
+/*
+================
+SND_PaintChannelFrom16_SIMD
+
+The vector multiplies are 16 bit, volumes that don't fit are left to the
+C loop.
+================
+*/
+static void SND_PaintChannelFrom16_SIMD (channel_t *ch, sfxcache_t *sc, int count)
+{
+	int		leftvol, rightvol;
+	signed short	*sfx;
+	int		*out;
+	int		i;
+
+	leftvol = ch->leftvol * snd_vol;
+	rightvol = ch->rightvol * snd_vol;
+	leftvol >>= 8;
+	rightvol >>= 8;
+	sfx = (signed short *)sc->data + ch->pos;
+	out = (int *)paintbuffer;
+	i = 0;
+
+	if (leftvol == (short)leftvol && rightvol == (short)rightvol)
+	{
+#if defined(__SSE2__)
+	/* each sample is spread over four lanes against leftvol, 0,
+	 * rightvol, 0 so that madd gives its left and right in place. */
+		__m128i	mul, d, x, y;
+
+		mul = _mm_set_epi16 (0, rightvol, 0, leftvol, 0, rightvol, 0, leftvol);
+
+		for ( ; i + 8 <= count; i += 8)
+		{
+			d = _mm_loadu_si128 ((const __m128i *)(sfx + i));
+			x = _mm_unpacklo_epi16 (d, d);
+			y = _mm_unpackhi_epi16 (d, d);
+
+			MIX_ADD4 (out + i*2, _mm_madd_epi16 (_mm_unpacklo_epi32 (x, x), mul));
+			MIX_ADD4 (out + i*2 + 4, _mm_madd_epi16 (_mm_unpackhi_epi32 (x, x), mul));
+			MIX_ADD4 (out + i*2 + 8, _mm_madd_epi16 (_mm_unpacklo_epi32 (y, y), mul));
+			MIX_ADD4 (out + i*2 + 12, _mm_madd_epi16 (_mm_unpackhi_epi32 (y, y), mul));
+		}
+#else
+		for ( ; i + 8 <= count; i += 8)
+		{
+			int16x8_t	d;
+			int32x4x2_t	acc;
+
+			d = vld1q_s16 (sfx + i);
+
+			acc = vld2q_s32 (out + i*2);
+			acc.val[0] = vmlal_n_s16 (acc.val[0], vget_low_s16 (d), leftvol);
+			acc.val[1] = vmlal_n_s16 (acc.val[1], vget_low_s16 (d), rightvol);
+			vst2q_s32 (out + i*2, acc);
+			acc = vld2q_s32 (out + i*2 + 8);
+			acc.val[0] = vmlal_n_s16 (acc.val[0], vget_high_s16 (d), leftvol);
+			acc.val[1] = vmlal_n_s16 (acc.val[1], vget_high_s16 (d), rightvol);
+			vst2q_s32 (out + i*2 + 8, acc);
+		}
+#endif
+	}
+
+	for ( ; i < count; i++)
+	{
+		out[i*2] += sfx[i] * leftvol;
+		out[i*2+1] += sfx[i] * rightvol;
+	}
+
+	ch->pos += count;
+}
+
+#endif	/* MIX_SIMD */
+
+
+/*
+===============================================================================
+
+MIXER BENCHMARK
+
+"sndbench [channels] [seconds]" mixes that many channels of looping noise,
+every other one 8 bit, for that many seconds at the mixing rate into a 16
+bit stereo buffer of its own rather than the device's.  It doesn't need a
+sound device: it works with the null driver and with -nosound, so that the
+mixer can be timed on a headless machine.  Both the C and the vector mix
+are timed and their output is compared.
+
+===============================================================================
+*/
+
+#define	BENCH_SFXSAMPLES	(1 << 15)
+#if defined(MIX_SIMD)
+#define	BENCH_SIMD		MIX_SIMD
+#else
+#define	BENCH_SIMD		"none"
+#endif
+
+static channel_t	bench_chans[MAX_CHANNELS];
+
+/*
+================
+SND_BenchMix
+
+Mixes numsamples samples of the channels into shm, returns the time taken
+================
+*/
+static double SND_BenchMix (channel_t *chans, int numchans, sfxcache_t **sc, int numsamples)
+{
+	double	start;
+	int	i, end;
+
+	start = Sys_DoubleTime ();
+
+	paintedtime = 0;
+	while (paintedtime < numsamples)
+	{
+		end = paintedtime + PAINTBUFFER_SIZE;
+		if (end > numsamples)
+			end = numsamples;
+
+		memset(paintbuffer, 0, (end - paintedtime) * sizeof(portable_samplepair_t));
+		for (i = 0; i < numchans; i++)
+			SND_MixChannel (&chans[i], sc[i & 1], paintedtime, end);
+
+		S_TransferPaintBuffer(end);
+		paintedtime = end;
+	}
+
+	return Sys_DoubleTime () - start;
+}
+
+/*
+================
+S_SoundBench_f
+================
+*/
+void S_SoundBench_f (void)
+{
+	static sfx_t	bench_sfx;	// anything not NULL for ch->sfx
+	volatile dma_t	*oldshm;
+	dma_t		dma;
+	channel_t	chans[MAX_CHANNELS];
+	sfxcache_t	*sc[2];
+	unsigned char	*out[2];
+	double		time[2];
+	int		numchans, seconds, numsamples;
+	int		oldpaintedtime, passes, pass, i;
+
+	numchans = (Cmd_Argc() > 1) ? atoi(Cmd_Argv(1)) : 32;
+	numchans = q_max(1, q_min(numchans, MAX_CHANNELS));
+	seconds = (Cmd_Argc() > 2) ? atoi(Cmd_Argv(2)) : 10;
+	seconds = q_max(1, q_min(seconds, 60));
+
+	memset (&dma, 0, sizeof(dma));
+	dma.channels = 2;
+	dma.samplebits = 16;
+	dma.speed = (shm) ? shm->speed : desired_speed;
+	dma.submission_chunk = 1;
+	numsamples = seconds * dma.speed;
+	for (dma.samples = 2; dma.samples < numsamples * 2; dma.samples <<= 1)
+		;	// big enough not to wrap
+
+	out[0] = (unsigned char *) calloc (dma.samples, 2);
+	out[1] = (unsigned char *) calloc (dma.samples, 2);
+	sc[0] = (sfxcache_t *) malloc (sizeof(sfxcache_t) + BENCH_SFXSAMPLES);
+	sc[1] = (sfxcache_t *) malloc (sizeof(sfxcache_t) + BENCH_SFXSAMPLES * 2);
+	if (!out[0] || !out[1] || !sc[0] || !sc[1])
+	{
+		Con_Printf ("%s: out of memory\n", Cmd_Argv(0));
+		goto done;
+	}
+
+	for (i = 0; i < 2; i++)
+	{
+		sc[i]->length = BENCH_SFXSAMPLES;
+		sc[i]->loopstart = 0;
+		sc[i]->speed = dma.speed;
+		sc[i]->width = i + 1;
+		sc[i]->stereo = 0;
+	}
+	for (i = 0; i < BENCH_SFXSAMPLES; i++)
+	{
+		((signed char *)sc[0]->data)[i] = (rand() & 0xff) - 0x80;
+		((short *)sc[1]->data)[i] = (rand() & 0xffff) - 0x8000;
+	}
+
+	memset (chans, 0, sizeof(chans));
+	for (i = 0; i < numchans; i++)
+	{
+		chans[i].sfx = &bench_sfx;
+		chans[i].leftvol = 1 + rand() % 255;
+		chans[i].rightvol = 1 + rand() % 255;
+		chans[i].pos = rand() % BENCH_SFXSAMPLES;
+		chans[i].end = BENCH_SFXSAMPLES - chans[i].pos;
+	}
+
+	passes = 1;
+#if defined(MIX_SIMD)
+	passes = 2;
+#endif
+
+// keep the device away from the mixer while shm is ours
+	S_BlockSound ();
+	oldshm = shm;
+	oldpaintedtime = paintedtime;
+	shm = &dma;
+
+	SND_InitScaletable ();
+	snd_vol = sfxvolume.value * 256;
+
+	for (pass = 0; pass < passes; pass++)
+	{
+		memcpy (bench_chans, chans, numchans * sizeof(channel_t));
+		snd_usesimd = pass;
+		dma.buffer = out[pass];
+		time[pass] = SND_BenchMix (bench_chans, numchans, sc, numsamples);
+	}
+
+	shm = oldshm;
+	paintedtime = oldpaintedtime;
+	S_UnblockSound ();
+
+	Con_Printf ("%d channels, %d seconds at %d Hz\n", numchans, seconds, dma.speed);
+	for (pass = 0; pass < passes; pass++)
+	{
+		Con_Printf ("%-5s %8.1f ms %8.1fx realtime", (pass) ? BENCH_SIMD : "C",
+				time[pass] * 1000.0, (time[pass] > 0) ? seconds / time[pass] : 0);
+		if (pass)
+			Con_Printf (" %6.2fx", (time[pass] > 0) ? time[0] / time[pass] : 0);
+		Con_Printf ("\n");
+	}
+	if (passes > 1)
+		Con_Printf ("output %s\n", memcmp(out[0], out[1], dma.samples * 2) ? "differs" : "matches");
+
+done:
+	free (sc[1]);
+	free (sc[0]);
+	free (out[1]);
+	free (out[0]);
+}
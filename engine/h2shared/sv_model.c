@@ -30,7 +30,7 @@
 static qmodel_t*	loadmodel;
 static char	loadname[MAX_QPATH];	/* for hunk tags */
 
-static void Mod_LoadBrushModel (qmodel_t *mod, void *buffer);
+static void Mod_LoadBrushModel (qmodel_t *mod, fsview_t *view);
 static qmodel_t *Mod_LoadModel (qmodel_t *mod, qboolean crash);
 
 static cvar_t	external_ents = {"external_ents", "1", CVAR_ARCHIVE};
@@ -189,7 +189,7 @@ Loads a model into the cache
 */
 static qmodel_t *Mod_LoadModel (qmodel_t *mod, qboolean crash)
 {
-	byte	*buf;
+	fsview_t	view;
 
 	if (mod->needload == NL_PRESENT)
 		return mod;
@@ -197,8 +197,7 @@ static qmodel_t *Mod_LoadModel (qmodel_t *mod, qboolean crash)
 //
 // load the file
 //
-	buf = FS_LoadTempFile (mod->name, & mod->path_id);
-	if (!buf)
+	if (!FS_OpenView (mod->name, &view, & mod->path_id))
 	{
 		if (crash)
 			Host_Error ("%s: %s not found", __thisfunc__, mod->name);
@@ -219,7 +218,8 @@ static qmodel_t *Mod_LoadModel (qmodel_t *mod, qboolean crash)
 // call the apropriate loader
 	mod->needload = NL_PRESENT;
 
-	Mod_LoadBrushModel (mod, buf);
+	Mod_LoadBrushModel (mod, &view);
+	FS_CloseView (&view);
 
 	return mod;
 }
@@ -249,7 +249,7 @@ qmodel_t *Mod_ForName (const char *name, qboolean crash)
 ===============================================================================
 */
 
-static byte	*mod_base;
+static byte	*mod_base;	// a read only file view: never write through it
 
 
 /*
@@ -1110,18 +1110,20 @@ static void Mod_LoadPlanes (lump_t *l)
 Mod_LoadBrushModel
 =================
 */
-static void Mod_LoadBrushModel (qmodel_t *mod, void *buffer)
+static void Mod_LoadBrushModel (qmodel_t *mod, fsview_t *view)
 {
 	int			i, j;
-	dheader_t	*header;
+	dheader_t	header;
 	dmodel_t	*bm;
 	qboolean	bsp2 = false;
 
 	loadmodel->type = mod_brush;
 
-	header = (dheader_t *)buffer;
+	if (view->size < (long) sizeof(dheader_t))
+		Host_Error ("%s: %s is too short", __thisfunc__, mod->name);
+	memcpy (&header, view->data, sizeof(dheader_t));
 
-	i = LittleLong (header->version);
+	i = LittleLong (header.version);
 #ifndef ENABLE_BSP2
 	(void) bsp2;
 #else
@@ -1133,27 +1135,33 @@ static void Mod_LoadBrushModel (qmodel_t *mod, void *buffer)
 		Host_Error ("%s: %s has unsupported version %i", __thisfunc__, mod->name, i);
 
 // swap all the lumps
-	mod_base = (byte *)header;
+	mod_base = (byte *)view->data;
 
 	for (i = 0; i < (int) sizeof(dheader_t) / 4; i++)
-		((int *)header)[i] = LittleLong ( ((int *)header)[i]);
+		((int *)&header)[i] = LittleLong ( ((int *)&header)[i]);
+	for (i = 0; i < HEADER_LUMPS; i++)
+	{
+		if (header.lumps[i].fileofs < 0 || header.lumps[i].filelen < 0 ||
+		    header.lumps[i].fileofs > view->size - header.lumps[i].filelen)
+			Host_Error ("%s: %s has a bad lump %i", __thisfunc__, mod->name, i);
+	}
 
 // load into heap
-	Mod_LoadVertexes (&header->lumps[LUMP_VERTEXES]);
-	Mod_LoadEdges (&header->lumps[LUMP_EDGES], bsp2);
-	Mod_LoadSurfedges (&header->lumps[LUMP_SURFEDGES]);
-	Mod_LoadLighting (&header->lumps[LUMP_LIGHTING]);
-	Mod_LoadPlanes (&header->lumps[LUMP_PLANES]);
-	Mod_LoadTexinfo (&header->lumps[LUMP_TEXINFO]);
-	Mod_LoadFaces (&header->lumps[LUMP_FACES], bsp2);
+	Mod_LoadVertexes (&header.lumps[LUMP_VERTEXES]);
+	Mod_LoadEdges (&header.lumps[LUMP_EDGES], bsp2);
+	Mod_LoadSurfedges (&header.lumps[LUMP_SURFEDGES]);
+	Mod_LoadLighting (&header.lumps[LUMP_LIGHTING]);
+	Mod_LoadPlanes (&header.lumps[LUMP_PLANES]);
+	Mod_LoadTexinfo (&header.lumps[LUMP_TEXINFO]);
+	Mod_LoadFaces (&header.lumps[LUMP_FACES], bsp2);
 	surfedges = NULL;
 	edges = NULL;
-	Mod_LoadVisibility (&header->lumps[LUMP_VISIBILITY]);
-	Mod_LoadLeafs (&header->lumps[LUMP_LEAFS], bsp2);
-	Mod_LoadNodes (&header->lumps[LUMP_NODES], bsp2);
-	Mod_LoadClipnodes (&header->lumps[LUMP_CLIPNODES], bsp2);
-	Mod_LoadEntities (&header->lumps[LUMP_ENTITIES]);
-	Mod_LoadSubmodels (&header->lumps[LUMP_MODELS]);
+	Mod_LoadVisibility (&header.lumps[LUMP_VISIBILITY]);
+	Mod_LoadLeafs (&header.lumps[LUMP_LEAFS], bsp2);
+	Mod_LoadNodes (&header.lumps[LUMP_NODES], bsp2);
+	Mod_LoadClipnodes (&header.lumps[LUMP_CLIPNODES], bsp2);
+	Mod_LoadEntities (&header.lumps[LUMP_ENTITIES]);
+	Mod_LoadSubmodels (&header.lumps[LUMP_MODELS]);
 
 	Mod_MakeHull0 ();
 
@@ -0,0 +1,455 @@
+/* threads.c -- worker threads for splitting up work within a frame
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "quakedef.h"
+#include "threads.h"
+
+#if defined(PLATFORM_WINDOWS)
+#include <windows.h>
+#include <process.h>
+#define	HAVE_THREADS	1
+#elif defined(USE_PTHREADS)
+#include <pthread.h>
+#include <unistd.h>
+#define	HAVE_THREADS	1
+#endif
+
+#define	MAX_WORKERS	32
+
+static	int		numworkers;
+
+
+/*
+===============================================================================
+
+PLATFORM PRIMITIVES
+
+===============================================================================
+*/
+
+#if defined(PLATFORM_WINDOWS)
+
+static	CRITICAL_SECTION	job_lock;
+static	HANDLE		job_wake;	/* semaphore, one count per worker and batch */
+static	HANDLE		job_done;	/* auto-reset event */
+static	HANDLE		workers[MAX_WORKERS];
+static	unsigned int	worker_ids[MAX_WORKERS];
+static	qboolean	lock_init;
+
+#define	JOB_LOCK()	EnterCriticalSection (&job_lock)
+#define	JOB_UNLOCK()	LeaveCriticalSection (&job_lock)
+#define	JOB_FINISHED()	SetEvent (job_done)
+
+int Thread_GetNumCPUS (void)
+{
+	SYSTEM_INFO info;
+
+	GetSystemInfo (&info);
+	return (info.dwNumberOfProcessors < 1) ? 1 : (int) info.dwNumberOfProcessors;
+}
+
+qboolean Thread_InWorker (void)
+{
+	DWORD	id = GetCurrentThreadId ();
+	int	i;
+
+	for (i = 0; i < numworkers; i++)
+	{
+		if (worker_ids[i] == id)
+			return true;
+	}
+	return false;
+}
+
+#elif defined(USE_PTHREADS)
+
+static	pthread_mutex_t	job_lock = PTHREAD_MUTEX_INITIALIZER;
+static	pthread_cond_t	job_wake = PTHREAD_COND_INITIALIZER;
+static	pthread_cond_t	job_done = PTHREAD_COND_INITIALIZER;
+static	pthread_t	workers[MAX_WORKERS];
+
+#define	JOB_LOCK()	pthread_mutex_lock (&job_lock)
+#define	JOB_UNLOCK()	pthread_mutex_unlock (&job_lock)
+#define	JOB_FINISHED()	pthread_cond_signal (&job_done)
+
+int Thread_GetNumCPUS (void)
+{
+#if defined(_SC_NPROCESSORS_ONLN)
+	long	numcpus = sysconf (_SC_NPROCESSORS_ONLN);
+	return (numcpus < 1) ? 1 : (int) numcpus;
+#else
+	return 1;
+#endif
+}
+
+qboolean Thread_InWorker (void)
+{
+	pthread_t	self = pthread_self ();
+	int	i;
+
+	for (i = 0; i < numworkers; i++)
+	{
+		if (pthread_equal (workers[i], self))
+			return true;
+	}
+	return false;
+}
+
+#else	/* no threads */
+
+int Thread_GetNumCPUS (void)
+{
+	return 1;
+}
+
+qboolean Thread_InWorker (void)
+{
+	return false;
+}
+
+#endif
+
+
+/*
+===============================================================================
+
+WORKERS
+
+===============================================================================
+*/
+
+#if defined(HAVE_THREADS)
+
+/* the current batch, protected by the job lock */
+static	threadfunc_t	job_func;
+static	void		*job_data;
+static	int		job_count;
+static	int		job_next;
+static	int		job_pending;
+static	int		job_generation;
+static	qboolean	workers_quit;
+
+/*
+=============
+Thread_DoJobs
+
+Takes jobs off the current batch until there are none left.
+Called and returns with the job lock held.
+=============
+*/
+static void Thread_DoJobs (void)
+{
+	int		job;
+
+	while (job_next < job_count)
+	{
+		job = job_next++;
+		JOB_UNLOCK ();
+		job_func (job_data, job);
+		JOB_LOCK ();
+		if (--job_pending == 0)
+			JOB_FINISHED ();
+	}
+}
+
+#if defined(PLATFORM_WINDOWS)
+static unsigned int __stdcall Thread_Worker (void *arg)
+{
+	while (1)
+	{
+		WaitForSingleObject (job_wake, INFINITE);
+		JOB_LOCK ();
+		if (workers_quit)
+		{
+			JOB_UNLOCK ();
+			break;
+		}
+		Thread_DoJobs ();
+		JOB_UNLOCK ();
+	}
+	return 0;
+}
+#else
+static void *Thread_Worker (void *arg)
+{
+	int		generation;
+
+	JOB_LOCK ();
+	generation = job_generation;
+	while (1)
+	{
+		while (job_generation == generation && !workers_quit)
+			pthread_cond_wait (&job_wake, &job_lock);
+		if (workers_quit)
+			break;
+		generation = job_generation;
+		Thread_DoJobs ();
+	}
+	JOB_UNLOCK ();
+	return NULL;
+}
+#endif
+
+static void Thread_StopWorkers (void)
+{
+	int		i;
+
+	if (!numworkers)
+		return;
+
+	JOB_LOCK ();
+	workers_quit = true;
+#if defined(PLATFORM_WINDOWS)
+	JOB_UNLOCK ();
+	ReleaseSemaphore (job_wake, numworkers, NULL);
+	for (i = 0; i < numworkers; i++)
+	{
+		WaitForSingleObject (workers[i], INFINITE);
+		CloseHandle (workers[i]);
+	}
+#else
+	pthread_cond_broadcast (&job_wake);
+	JOB_UNLOCK ();
+	for (i = 0; i < numworkers; i++)
+		pthread_join (workers[i], NULL);
+#endif
+	numworkers = 0;
+	workers_quit = false;
+}
+
+/*
+=============
+Thread_SetWorkers
+=============
+*/
+static void Thread_SetWorkers (int count)
+{
+	if (count < 0)
+		count = 0;
+	else if (count > MAX_WORKERS)
+		count = MAX_WORKERS;
+	if (count == numworkers)
+		return;
+
+	Thread_StopWorkers ();
+
+#if defined(PLATFORM_WINDOWS)
+	if (!lock_init)
+	{
+		InitializeCriticalSection (&job_lock);
+		job_wake = CreateSemaphore (NULL, 0, 0x7fffffff, NULL);
+		job_done = CreateEvent (NULL, FALSE, FALSE, NULL);
+		if (!job_wake || !job_done)
+			Sys_Error ("%s: couldn't create sync objects", __thisfunc__);
+		lock_init = true;
+	}
+	for ( ; numworkers < count; numworkers++)
+	{
+		workers[numworkers] = (HANDLE) _beginthreadex (NULL, 0, Thread_Worker, NULL,
+							0, &worker_ids[numworkers]);
+		if (!workers[numworkers])
+		{
+			Con_Printf ("%s: only %d workers started\n", __thisfunc__, numworkers);
+			break;
+		}
+	}
+#else
+	for ( ; numworkers < count; numworkers++)
+	{
+		if (pthread_create (&workers[numworkers], NULL, Thread_Worker, NULL) != 0)
+		{
+			Con_Printf ("%s: only %d workers started\n", __thisfunc__, numworkers);
+			break;
+		}
+	}
+#endif
+}
+
+/*
+=============
+Thread_RunJobs
+=============
+*/
+void Thread_RunJobs (threadfunc_t func, void *data, int numjobs)
+{
+	int		i;
+
+	if (!numworkers || numjobs < 2)
+	{
+		for (i = 0; i < numjobs; i++)
+			func (data, i);
+		return;
+	}
+
+	JOB_LOCK ();
+	job_func = func;
+	job_data = data;
+	job_count = numjobs;
+	job_next = 0;
+	job_pending = numjobs;
+	job_generation++;
+#if defined(PLATFORM_WINDOWS)
+	ReleaseSemaphore (job_wake, numworkers, NULL);
+#else
+	pthread_cond_broadcast (&job_wake);
+#endif
+
+	Thread_DoJobs ();
+
+	// a stale signal from an earlier batch just goes round again
+	while (job_pending > 0)
+	{
+#if defined(PLATFORM_WINDOWS)
+		JOB_UNLOCK ();
+		WaitForSingleObject (job_done, INFINITE);
+		JOB_LOCK ();
+#else
+		pthread_cond_wait (&job_done, &job_lock);
+#endif
+	}
+	JOB_UNLOCK ();
+}
+
+#else	/* no threads */
+
+static void Thread_SetWorkers (int count)
+{
+}
+
+void Thread_RunJobs (threadfunc_t func, void *data, int numjobs)
+{
+	int		i;
+
+	for (i = 0; i < numjobs; i++)
+		func (data, i);
+}
+
+#endif	/* HAVE_THREADS */
+
+static	int		workers_wanted[THREAD_NUMUSERS];
+
+/*
+=============
+Thread_WantWorkers
+=============
+*/
+void Thread_WantWorkers (int user, int count)
+{
+	int		i, most;
+
+	if (user < 0 || user >= THREAD_NUMUSERS)
+		Sys_Error ("%s: bad user %d", __thisfunc__, user);
+
+	workers_wanted[user] = count;
+	most = 0;
+	for (i = 0; i < THREAD_NUMUSERS; i++)
+	{
+		if (workers_wanted[i] > most)
+			most = workers_wanted[i];
+	}
+	Thread_SetWorkers (most);
+}
+
+int Thread_NumWorkers (void)
+{
+	return numworkers;
+}
+
+
+/*
+===============================================================================
+
+BACKGROUND TASK
+
+===============================================================================
+*/
+
+static	threadfunc_t	task_func;
+static	void		*task_data;
+
+#if defined(PLATFORM_WINDOWS)
+
+static	HANDLE		task_thread;
+
+static unsigned int __stdcall Thread_Task (void *arg)
+{
+	task_func (task_data, 0);
+	return 0;
+}
+
+void Thread_WaitTask (void)
+{
+	if (!task_thread)
+		return;
+	WaitForSingleObject (task_thread, INFINITE);
+	CloseHandle (task_thread);
+	task_thread = NULL;
+}
+
+void Thread_StartTask (threadfunc_t func, void *data)
+{
+	Thread_WaitTask ();
+	task_func = func;
+	task_data = data;
+	task_thread = (HANDLE) _beginthreadex (NULL, 0, Thread_Task, NULL, 0, NULL);
+	if (!task_thread)
+		func (data, 0);
+}
+
+#elif defined(USE_PTHREADS)
+
+static	pthread_t	task_thread;
+static	qboolean	task_running;
+
+static void *Thread_Task (void *arg)
+{
+	task_func (task_data, 0);
+	return NULL;
+}
+
+void Thread_WaitTask (void)
+{
+	if (!task_running)
+		return;
+	pthread_join (task_thread, NULL);
+	task_running = false;
+}
+
+void Thread_StartTask (threadfunc_t func, void *data)
+{
+	Thread_WaitTask ();
+	task_func = func;
+	task_data = data;
+	if (pthread_create (&task_thread, NULL, Thread_Task, NULL) == 0)
+		task_running = true;
+	else	func (data, 0);
+}
+
+#else	/* no threads */
+
+void Thread_WaitTask (void)
+{
+}
+
+void Thread_StartTask (threadfunc_t func, void *data)
+{
+	func (data, 0);
+}
+
+#endif
+
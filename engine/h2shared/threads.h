@@ -0,0 +1,80 @@
+/* threads.h -- worker threads for splitting up work within a frame
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __HX2_THREADS_H
+#define __HX2_THREADS_H
+
+/*
+
+The workers sleep until Thread_RunJobs hands them a batch, and the
+calling thread works on the batch, too.  A job must not touch anything
+another job of the same batch writes, and must not print, call
+Host_Error or run progs code: none of that is thread safe.
+
+A task is a single job that runs in the background, on a thread of its
+own, until it is waited for.
+
+On platforms without thread support everything runs on the caller.
+
+*/
+
+typedef void (*threadfunc_t) (void *data, int job);
+
+int Thread_GetNumCPUS (void);
+
+/* the users of the shared workers */
+#define	THREAD_RENDER		0	/* r_threads bands */
+#define	THREAD_PHYSICS		1	/* sv_physthreads */
+#define	THREAD_SEND		2	/* sv_sendthreads */
+#define	THREAD_NUMUSERS		3
+
+void Thread_WantWorkers (int user, int count);
+// records how many workers user wants, and starts or stops workers so
+// that as many are running as the most any user wants, clamped to what
+// the platform can do.  This is the only way to size the pool, so that
+// one user can't take another's workers away.
+
+int Thread_NumWorkers (void);
+
+void Thread_RunJobs (threadfunc_t func, void *data, int numjobs);
+// calls func (data, job) for each job in 0..numjobs-1, in no particular
+// order and on any thread, and returns when all of them are done.
+
+qboolean Thread_InWorker (void);
+// true when called from a job running on a worker
+
+void Thread_StartTask (threadfunc_t func, void *data);
+// calls func (data, 0) on a thread of its own and returns right away.
+// There is one task at a time: an unfinished one is waited for first.
+// The rules for jobs apply, and the task must not touch anything the
+// caller writes before Thread_WaitTask.
+// Without thread support, func is done before this returns.
+
+void Thread_WaitTask (void);
+// returns when the last started task is done.
+
+/* THREAD_LOCAL gives each thread its own copy of a global, for state the
+   jobs of a batch would otherwise share.  It is left undefined where there
+   are no threads, or the compiler has no keyword for it. */
+#if defined(PLATFORM_WINDOWS) && (defined(_MSC_VER) || defined(__WATCOMC__))
+#define	THREAD_LOCAL	__declspec(thread)
+#elif (defined(PLATFORM_WINDOWS) || defined(USE_PTHREADS)) && defined(__GNUC__)
+#define	THREAD_LOCAL	__thread
+#endif
+
+#endif	/* __HX2_THREADS_H */
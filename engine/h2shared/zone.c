@@ -32,11 +32,11 @@
 
 #define	ZONE_MINSIZE	0x40000
 #define	ZONE_MAXSIZE	0x200000
-#if defined(SERVERONLY)
+#if defined(SERVERONLY) && !defined(H2W)
 #define	ZONE_DEFSIZE	0x40000
-#else
+#else	/* clients, and the hexenworld server: its find index is MAX_EDICTS sized */
 #define	ZONE_DEFSIZE	0x60000
-#endif	/* SERVERONLY */
+#endif	/* SERVERONLY && !H2W */
 #define	ZMAGIC		0x1d4a11
 #define	ZMAGIC2		0xf382da
 #define	HUNK_SENTINAL	0x1df001ed
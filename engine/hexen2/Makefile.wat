@@ -406,6 +406,7 @@ SOFTOBJS = &
 	d_zpoint.obj &
 	r_aclip.obj &
 	r_alias.obj &
+	r_avert.obj &
 	r_bsp.obj &
 	r_draw.obj &
 	r_edge.obj &
@@ -493,6 +494,7 @@ COMMONOBJS = &
 	world.obj &
 	zone.obj &
 	hashindex.obj &
+	threads.obj &
 	$(SYSOBJ_SYS)
 
 all: $(BUILD_TARGET)
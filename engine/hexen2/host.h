@@ -52,6 +52,7 @@ extern	cvar_t		sys_nostdout;
 extern	cvar_t		developer;
 
 extern	cvar_t		pausable;
+extern	cvar_t		sv_savebinary;
 
 extern	qboolean	host_initialized;	// true if into command execution
 extern	double		host_frametime;
@@ -79,6 +80,8 @@ void Host_ShutdownServer (qboolean crash);
 
 void Host_ClearMemory (void);
 
+int Host_WriteGamestate (const char *name, byte *data, int size);
+int Host_WaitGamestate (const char *name);
 void Host_RemoveGIPFiles (const char *path);
 void Host_DeleteSave (const char *savepath);
 int Host_CopyFiles(const char *source, const char *pat, const char *dest);
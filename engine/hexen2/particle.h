@@ -87,7 +87,6 @@ typedef struct particle_s
 	vec3_t		org;
 	float		color;
 /* drivers never touch the following fields */
-	struct particle_s	*next;
 	vec3_t		vel;
 	vec3_t		min_org;
 	vec3_t		max_org;
@@ -53,6 +53,8 @@ static vec3_t		alias_forward, alias_right, alias_up;
 
 static maliasskindesc_t	*pskindesc;
 
+static int		alerpframe;	// pose to blend from, -1 for none
+
 int			r_amodels_drawn;
 ASM_LINKAGE_BEGIN
 int			r_anumverts;
@@ -77,12 +79,12 @@ static aedge_t	aedges[12] =
 };
 
 
-#if !id386 && !id68k
-static void R_AliasTransformAndProjectFinalVerts (finalvert_t *fv, stvert_t *pstverts);
-#endif
 static void R_AliasSetUpTransform (int trivial_accept);
+static void R_AliasSetupLerp (aliashdr_t *pahdr, int frame, entlerp_t *lerp);
 #if !id68k
 static void R_AliasTransformVector (vec3_t in, vec3_t out);
+#endif
+#if id386
 static void R_AliasTransformFinalVert (finalvert_t *fv, auxvert_t *av, trivertx_t *pverts);
 #endif
 
@@ -97,6 +99,7 @@ qboolean R_AliasCheckBBox (void)
 	int			i, flags, frame, numv;
 	aliashdr_t		*pahdr;
 	float			zi, basepts[8][3], v0, v1, frac;
+	float			bmin[3], bmax[3];
 	finalvert_t		*pv0, *pv1, viewpts[16];
 	auxvert_t		*pa0, *pa1, viewaux[16];
 	maliasframedesc_t	*pframedesc;
@@ -123,42 +126,61 @@ qboolean R_AliasCheckBBox (void)
 	}
 
 	pframedesc = &pahdr->frames[frame];
+	for (i = 0 ; i < 3 ; i++)
+	{
+		bmin[i] = pframedesc->bboxmin.v[i];
+		bmax[i] = pframedesc->bboxmax.v[i];
+	}
+
+// a blended pose lies between the two, so their boxes together cover it
+	R_AliasSetupLerp (pahdr, frame, &currententity->lerp);
+	if (alerpframe >= 0)
+	{
+		pframedesc = &pahdr->frames[alerpframe];
+		for (i = 0 ; i < 3 ; i++)
+		{
+			if (bmin[i] > pframedesc->bboxmin.v[i])
+				bmin[i] = pframedesc->bboxmin.v[i];
+			if (bmax[i] < pframedesc->bboxmax.v[i])
+				bmax[i] = pframedesc->bboxmax.v[i];
+		}
+	}
 
 // x worldspace coordinates
 	basepts[0][0] =
 		basepts[1][0] =
 		basepts[2][0] =
 		basepts[3][0] =
-			(float)pframedesc->bboxmin.v[0];
+			bmin[0];
 	basepts[4][0] =
 		basepts[5][0] =
 		basepts[6][0] =
 		basepts[7][0] =
-			(float)pframedesc->bboxmax.v[0];
+			bmax[0];
 
 // y worldspace coordinates
 	basepts[0][1] =
 		basepts[3][1] =
 		basepts[5][1] =
 		basepts[6][1] =
-			(float)pframedesc->bboxmin.v[1];
+			bmin[1];
 	basepts[1][1] =
 		basepts[2][1] =
 		basepts[4][1] =
 		basepts[7][1] =
-			(float)pframedesc->bboxmax.v[1];
+			bmax[1];
 
 // z worldspace coordinates
 	basepts[0][2] =
 		basepts[1][2] =
 		basepts[4][2] =
 		basepts[5][2] =
-			(float)pframedesc->bboxmin.v[2];
+			bmin[2];
 	basepts[2][2] =
 		basepts[3][2] =
 		basepts[6][2] =
 		basepts[7][2] =
-			(float)pframedesc->bboxmax.v[2];
+			bmax[2];
 
 	zclipped = false;
 	zfullyclipped = true;
@@ -295,13 +317,18 @@ static void R_AliasPreparePoints (void)
 {
 	int			i;
 	stvert_t	*pstverts;
+#if id386 || id68k
 	finalvert_t	*fv;
 	auxvert_t	*av;
+#endif
 	mtriangle_t	*ptri;
 	finalvert_t	*pfv[3];
 
 	pstverts = (stvert_t *)((byte *)paliashdr + paliashdr->stverts);
 	r_anumverts = pmdl->numverts;
+#if !id386 && !id68k
+	R_AliasTransformClipVerts (pfinalverts, pauxverts, ziscale);
+#else
 	fv = pfinalverts;
 	av = pauxverts;
 
@@ -327,6 +354,7 @@ static void R_AliasPreparePoints (void)
 				fv->flags |= ALIAS_BOTTOM_CLIP;
 		}
 	}
+#endif
 
 //
 // clip and draw all triangles
@@ -557,7 +585,7 @@ static void R_AliasSetUpTransform (int trivial_accept)
 }
 
 
-#if !id68k
+#if id386
 /*
 ================
 R_AliasTransformFinalVert
@@ -593,64 +621,6 @@ static void R_AliasTransformFinalVert (finalvert_t *fv, auxvert_t *av, trivertx_
 #endif
 
 
-#if	!id386 && !id68k
-
-/*
-================
-R_AliasTransformAndProjectFinalVerts
-================
-*/
-static void R_AliasTransformAndProjectFinalVerts (finalvert_t *fv, stvert_t *pstverts)
-{
-	int		i, temp;
-	float		lightcos, zi;
-	const float *plightnormal;
-	const trivertx_t *pverts;
-
-	pverts = r_apverts;
-
-	for (i = 0 ; i < r_anumverts ; i++, fv++, pverts++, pstverts++)
-	{
-	// transform and project
-		zi = 1.0 / (DotProduct(pverts->v, aliastransform[2]) +
-						aliastransform[2][3]);
-
-	// x, y, and z are scaled down by 1/2**31 in the transform, so 1/z is
-	// scaled up by 1/2**31, and the scaling cancels out for x and y in the
-	// projection
-		fv->v[5] = zi;
-
-		fv->v[0] = ((DotProduct(pverts->v, aliastransform[0]) +
-				aliastransform[0][3]) * zi) + aliasxcenter;
-		fv->v[1] = ((DotProduct(pverts->v, aliastransform[1]) +
-				aliastransform[1][3]) * zi) + aliasycenter;
-
-		fv->v[2] = pstverts->s;
-		fv->v[3] = pstverts->t;
-		fv->flags = pstverts->onseam;
-
-	// lighting
-		plightnormal = r_avertexnormals[pverts->lightnormalindex];
-		lightcos = DotProduct (plightnormal, r_plightvec);
-		temp = r_ambientlight;
-
-		if (lightcos < 0)
-		{
-			temp += (int)(r_shadelight * lightcos);
-
-		// clamp; because we limited the minimum ambient and shading
-		// light, we don't have to clamp low light, just bright
-			if (temp < 0)
-				temp = 0;
-		}
-
-		fv->v[4] = temp;
-	}
-}
-
-#endif
-
-
 /*
 ================
 R_AliasProjectFinalVert
@@ -872,11 +842,58 @@ static void R_AliasSetupLighting (alight_t *plighting)
 	r_plightvec[2] = DotProduct (plighting->plightvec, alias_up);
 }
 
+/*
+=================
+R_AliasSetupLerp
+
+Note frame changes in lerp, and find the pose to blend from into alerpframe
+and r_alerpfrac.  Both single poses are blended over a tenth of a second,
+the usual animation rate; frame groups are never blended.  It has to see
+every frame the entity is drawn with, but may be called more than once.
+=================
+*/
+static void R_AliasSetupLerp (aliashdr_t *pahdr, int frame, entlerp_t *lerp)
+{
+	int		from;
+
+	alerpframe = -1;
+	if (!lerp)
+		return;
+
+	if (lerp->model != currententity->model)
+	{
+		lerp->model = currententity->model;
+		lerp->frames[0] = lerp->frames[1] = frame;
+		lerp->start = 0;
+	}
+	else if (lerp->frames[1] != frame)
+	{
+		lerp->frames[0] = lerp->frames[1];
+		lerp->frames[1] = frame;
+		lerp->start = cl.time;
+	}
+
+	from = lerp->frames[0];
+	if (!r_lerpmodels.integer || from == frame)
+		return;
+	if (from < 0 || from >= pmdl->numframes)
+		return;
+	if (pahdr->frames[frame].type != ALIAS_SINGLE ||
+	    pahdr->frames[from].type != ALIAS_SINGLE)
+		return;
+
+	r_alerpfrac = (cl.time - lerp->start) * 10;
+	if (r_alerpfrac < 0 || r_alerpfrac >= 1)
+		return;
+
+	alerpframe = from;
+}
+
 /*
 =================
 R_AliasSetupFrame
 
-set r_apverts
+set r_apverts, and r_alerpverts if blending
 =================
 */
 static void R_AliasSetupFrame (void)
@@ -892,10 +909,16 @@ static void R_AliasSetupFrame (void)
 		frame = 0;
 	}
 
+	R_AliasSetupLerp (paliashdr, frame, &currententity->lerp);
+	r_alerpverts = NULL;
+
 	if (paliashdr->frames[frame].type == ALIAS_SINGLE)
 	{
 		r_apverts = (trivertx_t *)
 				((byte *)paliashdr + paliashdr->frames[frame].frame);
+		if (alerpframe >= 0)
+			r_alerpverts = (trivertx_t *)
+				((byte *)paliashdr + paliashdr->frames[alerpframe].frame);
 		return;
 	}
 
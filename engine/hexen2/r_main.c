@@ -163,10 +163,14 @@ cvar_t	r_numedges = {"r_numedges", "0", CVAR_NONE};
 cvar_t	r_aliastransbase = {"r_aliastransbase", "200", CVAR_NONE};
 cvar_t	r_aliastransadj = {"r_aliastransadj", "100", CVAR_NONE};
 cvar_t	r_aliasmip = {"r_aliasmip", "80", CVAR_NONE};
+cvar_t	r_aliassimd = {"r_aliassimd", "1", CVAR_NONE};
+cvar_t	r_aliascheck = {"r_aliascheck", "0", CVAR_NONE};
+cvar_t	r_lerpmodels = {"r_lerpmodels", "0", CVAR_ARCHIVE};
 cvar_t	r_wholeframe = {"r_wholeframe", "1", CVAR_ARCHIVE};
 cvar_t	r_transwater = {"r_transwater", "1", CVAR_ARCHIVE};
 cvar_t	r_texture_external = {"r_texture_external", "0", CVAR_ARCHIVE};
 cvar_t	r_dynamic = {"r_dynamic", "1", CVAR_NONE};
+cvar_t	r_threads = {"r_threads", "1", CVAR_ARCHIVE};
 
 //void CreatePassages (void);
 //void SetVisibilityByPassages (void);
@@ -242,7 +246,9 @@ void R_Init (void)
 	R_InitTurb ();
 
 	Cmd_AddCommand ("timerefresh", R_TimeRefresh_f);
+	Cmd_AddCommand ("timebands", R_TimeBands_f);
 	Cmd_AddCommand ("pointfile", R_ReadPointFile_f);
+	Cmd_AddCommand ("aliasbench", R_AliasBench_f);
 
 	Cvar_RegisterVariable (&r_draworder);
 	Cvar_RegisterVariable (&r_speeds);
@@ -266,10 +272,15 @@ void R_Init (void)
 	Cvar_RegisterVariable (&r_aliastransbase);
 	Cvar_RegisterVariable (&r_aliastransadj);
 	Cvar_RegisterVariable (&r_aliasmip);
+	Cvar_RegisterVariable (&r_aliassimd);
+	Cvar_RegisterVariable (&r_aliascheck);
+	Cvar_RegisterVariable (&r_lerpmodels);
 	Cvar_RegisterVariable (&r_wholeframe);
 	Cvar_RegisterVariable (&r_transwater);
 	Cvar_RegisterVariable (&r_texture_external);
 	Cvar_RegisterVariable (&r_dynamic);
+	Cvar_RegisterVariable (&r_threads);
+	Cvar_SetCallback (&r_threads, R_Threads_f);
 
 	Cvar_SetValueQuick (&r_maxedges, (float)NUMSTACKEDGES);
 	Cvar_SetValueQuick (&r_maxsurfs, (float)NUMSTACKSURFACES);
@@ -1371,6 +1382,9 @@ void R_RenderView (void)
 	if ( (intptr_t)(&r_warpbuffer) & 3 )
 		Sys_Error ("Globals are missaligned");
 
+	if (R_TimeBandsView (R_RenderView_))
+		return;
+
 	R_RenderView_ ();
 }
 
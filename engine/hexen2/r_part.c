@@ -55,9 +55,69 @@ static int ramp12[8] = { 136, 137, 138, 139, 140, 141, 142, 143 };
 
 //=============================================================================
 
-particle_t	*active_particles, *free_particles;
-particle_t	*particles;
-static int	r_numparticles;
+/*
+===============================================================================
+
+PARTICLE STORE
+
+Live particles are kept apart by type, each type as a structure of arrays,
+so R_UpdateParticles can run the rules of a type over plain float arrays
+instead of chasing a list and switching on every particle.  The spawning
+code still fills in the particle_t that AllocParticle hands out; it is
+moved into the arrays of its type when the next one is asked for, or
+before the particles are updated or drawn.  The arrays of a type grow as
+needed, up to r_numparticles live particles in all.
+
+===============================================================================
+*/
+
+#define	NUM_PTYPES		(pt_redfire + 1)
+#define	PGROUP_MINSIZE		64	// first allocation for a type
+#define	PDEPTH_BATCH		256	// particles depth tested at a time
+
+#ifdef GLQUAKE
+#define	PCULL_Z			4	// NEARCLIP in gl_rmain.c
+#else
+#define	PCULL_Z			PARTICLE_Z_CLIP	// as D_DrawParticle ()
+#endif
+
+// float arrays of a type
+enum
+{
+	PF_ORG,				// x, y, z
+	PF_VEL = PF_ORG + 3,		// x, y, z
+	PF_COLOR = PF_VEL + 3,
+	PF_RAMP,
+	PF_DIE,
+	PF_MINORG,			// pt_snow bounds, x, y, z
+	PF_MAXORG = PF_MINORG + 3,	// x, y, z
+	PF_NUMFLOATS = PF_MAXORG + 3
+};
+
+// byte arrays of a type
+enum
+{
+	PB_FLAGS,			// pt_snow SFL_ flags
+	PB_COUNT,			// pt_snow flake size
+	PB_NUMBYTES
+};
+
+typedef struct
+{
+	int		num, max;
+	int		numfloats, numbytes;	// arrays this type needs
+	float		*f[PF_NUMFLOATS];	// f[0] starts the allocation
+	byte		*b[PB_NUMBYTES];
+} pgroup_t;
+
+static pgroup_t		pgroups[NUM_PTYPES];
+static int		r_numparticles;	// most live particles at once
+static int		r_numactive;	// live particles, newparticle included
+static particle_t	newparticle;	// being filled in by a spawner
+static qboolean		newpending;
+
+particlestats_t		r_partstats;
+static particlestats_t	r_partframe;	// counted since the last update
 
 vec3_t		r_pright, r_pup, r_ppn;
 static	vec3_t	rider_origin;
@@ -98,7 +158,13 @@ void R_InitParticles (void)
 		r_numparticles = MAX_PARTICLES;
 	}
 
-	particles = (particle_t *) Hunk_AllocName (r_numparticles * sizeof(particle_t), "particles");
+	for (i = 0; i < NUM_PTYPES; i++)
+	{
+		pgroups[i].numfloats = PF_MINORG;
+		pgroups[i].numbytes = 0;
+	}
+	pgroups[pt_snow].numfloats = PF_NUMFLOATS;
+	pgroups[pt_snow].numbytes = PB_NUMBYTES;
 
 	Cvar_RegisterVariable (&leak_color);
 	//JFM: snow test
@@ -150,6 +216,285 @@ void R_DarkFieldParticles (entity_t *ent)
 }
 
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define	PART_SIMD
+typedef __m128		pvec_t;
+#define	PV_SET1(x)	_mm_set1_ps (x)
+#define	PV_LOAD(p)	_mm_loadu_ps (p)
+#define	PV_STORE(p,a)	_mm_storeu_ps (p, a)
+#define	PV_ADD(a,b)	_mm_add_ps (a, b)
+#define	PV_SUB(a,b)	_mm_sub_ps (a, b)
+#define	PV_MUL(a,b)	_mm_mul_ps (a, b)
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define	PART_SIMD
+typedef float32x4_t	pvec_t;
+#define	PV_SET1(x)	vdupq_n_f32 (x)
+#define	PV_LOAD(p)	vld1q_f32 (p)
+#define	PV_STORE(p,a)	vst1q_f32 (p, a)
+#define	PV_ADD(a,b)	vaddq_f32 (a, b)
+#define	PV_SUB(a,b)	vsubq_f32 (a, b)
+#define	PV_MUL(a,b)	vmulq_f32 (a, b)
+#endif
+
+/*
+===============
+R_PartAxpy
+
+y[i] += x[i] * a for n floats, x may be y
+===============
+*/
+static void R_PartAxpy (float *y, const float *x, float a, int n)
+{
+	int		i;
+#ifdef PART_SIMD
+	pvec_t		va;
+
+	va = PV_SET1 (a);
+	for (i = 0 ; i + 4 <= n ; i += 4)
+		PV_STORE (y + i, PV_ADD (PV_LOAD (y + i), PV_MUL (PV_LOAD (x + i), va)));
+#else
+	i = 0;
+#endif
+	for ( ; i < n ; i++)
+		y[i] += x[i] * a;
+}
+
+/*
+===============
+R_PartAdd
+
+y[i] += a for n floats
+===============
+*/
+static void R_PartAdd (float *y, float a, int n)
+{
+	int		i;
+#ifdef PART_SIMD
+	pvec_t		va;
+
+	va = PV_SET1 (a);
+	for (i = 0 ; i + 4 <= n ; i += 4)
+		PV_STORE (y + i, PV_ADD (PV_LOAD (y + i), va));
+#else
+	i = 0;
+#endif
+	for ( ; i < n ; i++)
+		y[i] += a;
+}
+
+/*
+===============
+R_PartScale
+
+y[i] *= a for n floats
+===============
+*/
+static void R_PartScale (float *y, float a, int n)
+{
+	int		i;
+#ifdef PART_SIMD
+	pvec_t		va;
+
+	va = PV_SET1 (a);
+	for (i = 0 ; i + 4 <= n ; i += 4)
+		PV_STORE (y + i, PV_MUL (PV_LOAD (y + i), va));
+#else
+	i = 0;
+#endif
+	for ( ; i < n ; i++)
+		y[i] *= a;
+}
+
+/*
+===============
+R_PartDepths
+
+Distance in front of the view of particles first to first+n-1 of a type
+===============
+*/
+static void R_PartDepths (const pgroup_t *g, int first, int n, float *depth)
+{
+	const float	*x, *y, *z;
+	int		i;
+#ifdef PART_SIMD
+	pvec_t		ox, oy, oz, nx, ny, nz;
+
+	ox = PV_SET1 (r_origin[0]);
+	oy = PV_SET1 (r_origin[1]);
+	oz = PV_SET1 (r_origin[2]);
+	nx = PV_SET1 (vpn[0]);
+	ny = PV_SET1 (vpn[1]);
+	nz = PV_SET1 (vpn[2]);
+#endif
+
+	x = g->f[PF_ORG + 0] + first;
+	y = g->f[PF_ORG + 1] + first;
+	z = g->f[PF_ORG + 2] + first;
+#ifdef PART_SIMD
+	for (i = 0 ; i + 4 <= n ; i += 4)
+	{
+		PV_STORE (depth + i, PV_ADD (PV_ADD (
+				PV_MUL (PV_SUB (PV_LOAD (x + i), ox), nx),
+				PV_MUL (PV_SUB (PV_LOAD (y + i), oy), ny)),
+				PV_MUL (PV_SUB (PV_LOAD (z + i), oz), nz)));
+	}
+#else
+	i = 0;
+#endif
+	for ( ; i < n ; i++)
+	{
+		depth[i] = (x[i] - r_origin[0]) * vpn[0] +
+			   (y[i] - r_origin[1]) * vpn[1] +
+			   (z[i] - r_origin[2]) * vpn[2];
+	}
+}
+
+/*
+===============
+R_GrowParticleGroup
+
+Doubles the arrays of a type, false if out of memory
+===============
+*/
+static qboolean R_GrowParticleGroup (pgroup_t *g)
+{
+	byte		*mem, *old;
+	int		k, newmax;
+
+	newmax = (g->max) ? g->max * 2 : PGROUP_MINSIZE;
+	mem = (byte *) malloc (newmax * (g->numfloats * sizeof(float) + g->numbytes));
+	if (!mem)
+		return false;
+
+	old = (byte *) g->f[0];
+	for (k = 0 ; k < g->numfloats ; k++)
+	{
+		if (g->num)
+			memcpy (mem, g->f[k], g->num * sizeof(float));
+		g->f[k] = (float *) mem;
+		mem += newmax * sizeof(float);
+	}
+	for (k = 0 ; k < g->numbytes ; k++)
+	{
+		if (g->num)
+			memcpy (mem, g->b[k], g->num);
+		g->b[k] = mem;
+		mem += newmax;
+	}
+	free (old);
+
+	g->max = newmax;
+	return true;
+}
+
+/*
+===============
+R_CommitParticle
+
+Moves the particle a spawner has filled in into the arrays of its type
+===============
+*/
+static void R_CommitParticle (void)
+{
+	pgroup_t	*g;
+	int		i, k;
+
+	if (!newpending)
+		return;
+	newpending = false;
+
+	// types the update doesn't know just move, like pt_static
+	g = &pgroups[(newparticle.type < NUM_PTYPES) ? newparticle.type : pt_static];
+	if (g->num == g->max && !R_GrowParticleGroup (g))
+	{
+		r_numactive--;
+		r_partframe.spawned--;
+		r_partframe.dropped++;
+		return;
+	}
+
+	i = g->num++;
+	for (k = 0 ; k < 3 ; k++)
+	{
+		g->f[PF_ORG + k][i] = newparticle.org[k];
+		g->f[PF_VEL + k][i] = newparticle.vel[k];
+	}
+	g->f[PF_COLOR][i] = newparticle.color;
+	g->f[PF_RAMP][i] = newparticle.ramp;
+	g->f[PF_DIE][i] = newparticle.die;
+
+	if (g->numbytes)
+	{
+		for (k = 0 ; k < 3 ; k++)
+		{
+			g->f[PF_MINORG + k][i] = newparticle.min_org[k];
+			g->f[PF_MAXORG + k][i] = newparticle.max_org[k];
+		}
+		g->b[PB_FLAGS][i] = newparticle.flags;
+		g->b[PB_COUNT][i] = newparticle.count;
+	}
+}
+
+/*
+===============
+R_KillParticles
+
+Drops the particles of a type whose time is up, keeping the others in order
+===============
+*/
+static void R_KillParticles (pgroup_t *g)
+{
+	const float	*die;
+	int		i, j, k;
+
+	die = g->f[PF_DIE];
+	for (i = 0 ; i < g->num && die[i] >= cl.time ; i++)
+		;
+
+	for (j = i ; i < g->num ; i++)
+	{
+		if (die[i] < cl.time)
+			continue;
+		for (k = 0 ; k < g->numfloats ; k++)
+			g->f[k][j] = g->f[k][i];
+		for (k = 0 ; k < g->numbytes ; k++)
+			g->b[k][j] = g->b[k][i];
+		j++;
+	}
+
+	r_numactive -= g->num - j;
+	g->num = j;
+}
+
+/*
+===============
+R_PartRamp
+
+Steps the particles of a type through a color ramp, killing those that
+run off its first len entries
+===============
+*/
+static void R_PartRamp (pgroup_t *g, float step, const int *table, int len, int base)
+{
+	float		*ramp, *color, *die;
+	int		i;
+
+	ramp = g->f[PF_RAMP];
+	color = g->f[PF_COLOR];
+	die = g->f[PF_DIE];
+
+	R_PartAdd (ramp, step, g->num);
+	for (i = 0 ; i < g->num ; i++)
+	{
+		if ((int)ramp[i] >= len)
+			die[i] = -1;
+		else
+			color[i] = table[(int)ramp[i]] + base;
+	}
+}
+
 /*
 ===============
 AllocParticle
@@ -157,17 +502,20 @@ AllocParticle
 */
 static particle_t *AllocParticle (void)
 {
-	particle_t	*p;
+	R_CommitParticle ();
 
-	if (!free_particles)
+	if (r_numactive >= r_numparticles)
+	{
+		r_partframe.dropped++;
 		return NULL;
+	}
 
-	p = free_particles;
-	free_particles = p->next;
-	p->next = active_particles;
-	active_particles = p;
+	r_numactive++;
+	r_partframe.spawned++;
+	newpending = true;
+	memset (&newparticle, 0, sizeof(particle_t));
 
-	return p;
+	return &newparticle;
 }
 
 /*
@@ -179,14 +527,10 @@ void R_ClearParticles (void)
 {
 	int		i;
 
-	if (!r_numparticles)
-		return;
-	free_particles = &particles[0];
-	active_particles = NULL;
-
-	for (i = 0; i < r_numparticles-1; i++)
-		particles[i].next = &particles[i+1];
-	particles[r_numparticles-1].next = NULL;
+	for (i = 0; i < NUM_PTYPES; i++)
+		pgroups[i].num = 0;
+	newpending = false;
+	r_numactive = 0;
 }
 
 
@@ -1364,13 +1708,37 @@ void R_ColoredParticleExplosion (vec3_t org, int color, int radius, int counter)
 	}
 }
 
+extern	cvar_t	sv_gravity;
+
 /*
 ===============
-R_DrawParticles
+R_CullParticle
+
+True if particle k of a type, at depth in front of the view, can't be seen.
+Rain is drawn as a trail along its velocity, so both ends have to be out.
 ===============
 */
-extern	cvar_t	sv_gravity;
+static qboolean R_CullParticle (const pgroup_t *g, int type, int k, float depth)
+{
+	if (depth >= PCULL_Z)
+		return false;
+	if (type == pt_rain)
+	{
+		depth += .004 * (g->f[PF_VEL + 0][k] * vpn[0] +
+				 g->f[PF_VEL + 1][k] * vpn[1] +
+				 g->f[PF_VEL + 2][k] * vpn[2]);
+		if (depth >= PCULL_Z)
+			return false;
+	}
+	r_partframe.culled++;
+	return true;
+}
 
+/*
+===============
+R_DrawParticles
+===============
+*/
 #if defined(GLQUAKE)
 static const float ptex_coord[4][3][2] =
 {
@@ -1382,13 +1750,15 @@ static const float ptex_coord[4][3][2] =
 
 void R_DrawParticles (void)
 {
-	int		i, color;
-	particle_t	*p;
-	float		scale;
-#define	SCALE_BASE	((p->type == pt_snow) ? p->count/10 : 1)
+	pgroup_t	*g;
+	int		t, i, j, k, n, count, color, tex;
+	float		depth[PDEPTH_BATCH], scale, base;
+	vec3_t		org;
+
+	R_CommitParticle ();
 
 	//ericw -- avoid empty glBegin/glEnd pair below.
-	if (!active_particles)
+	if (!r_numactive)
 		return;
 
 	GL_Bind(particletexture);
@@ -1399,45 +1769,61 @@ void R_DrawParticles (void)
 	VectorScale (vup, 1.5, r_pup);
 	VectorScale (vright, 1.5, r_pright);
 
-	for (p = active_particles ; p ; p = p->next)
+	for (t = 0 ; t < NUM_PTYPES ; t++)
 	{
-		// hack a scale up to keep particles from disapearing
-		scale = (p->org[0] - r_origin[0])*vpn[0] +
-			(p->org[1] - r_origin[1])*vpn[1] +
-			(p->org[2] - r_origin[2])*vpn[2];
-		if (scale < 20)
-			scale = SCALE_BASE;
-		else
-			scale = SCALE_BASE + scale * 0.004;
-
-	/* clamp color to 0-511: particle->type 10 and 11 (pt_c_explode
-	 * and pt_c_explode2, e.g. Crusader's ice particles hitting a
-	 * wall) lead to negative values, because R_UpdateParticles ()
-	 * decrements their color against time. */
-		color = ((int)p->color) & 0x01ff;
-		if (color < 256)
-			glColor3ubv_fp ((byte *)&d_8to24table[color]);
-		else
-			glColor4ubv_fp ((byte *)&d_8to24TranslucentTable[color-256]);
-
-		// setup texture coordinates
-		i = 0;
-		if (p->type == pt_snow)
+		g = &pgroups[t];
+		for (i = 0 ; i < g->num ; i += PDEPTH_BATCH)
 		{
-			if (p->count >= 69)
-				i = 3;	// happy snow!
-			else if (p->count >= 40)
-				i = 2;
-			else if (p->count >= 30)
-				i = 1;
-		}
+			n = q_min(g->num - i, PDEPTH_BATCH);
+			R_PartDepths (g, i, n, depth);
 
-		glTexCoord2fv_fp (ptex_coord[i][0]);
-		glVertex3fv_fp (p->org);
-		glTexCoord2fv_fp (ptex_coord[i][1]);
-		glVertex3f_fp (p->org[0] + r_pup[0]*scale, p->org[1] + r_pup[1]*scale, p->org[2] + r_pup[2]*scale);
-		glTexCoord2fv_fp (ptex_coord[i][2]);
-		glVertex3f_fp (p->org[0] + r_pright[0]*scale, p->org[1] + r_pright[1]*scale, p->org[2] + r_pright[2]*scale);
+			for (j = 0 ; j < n ; j++)
+			{
+				k = i + j;
+				if (R_CullParticle (g, t, k, depth[j]))
+					continue;
+
+				org[0] = g->f[PF_ORG + 0][k];
+				org[1] = g->f[PF_ORG + 1][k];
+				org[2] = g->f[PF_ORG + 2][k];
+				count = (t == pt_snow) ? g->b[PB_COUNT][k] : 0;
+
+				// hack a scale up to keep particles from disapearing
+				base = (t == pt_snow) ? count/10 : 1;
+				scale = depth[j];
+				if (scale < 20)
+					scale = base;
+				else
+					scale = base + scale * 0.004;
+
+			/* clamp color to 0-511: particle->type 10 and 11 (pt_c_explode
+			 * and pt_c_explode2, e.g. Crusader's ice particles hitting a
+			 * wall) lead to negative values, because R_UpdateParticles ()
+			 * decrements their color against time. */
+				color = ((int)g->f[PF_COLOR][k]) & 0x01ff;
+				if (color < 256)
+					glColor3ubv_fp ((byte *)&d_8to24table[color]);
+				else
+					glColor4ubv_fp ((byte *)&d_8to24TranslucentTable[color-256]);
+
+				// setup texture coordinates
+				if (count >= 69)
+					tex = 3;	// happy snow!
+				else if (count >= 40)
+					tex = 2;
+				else if (count >= 30)
+					tex = 1;
+				else
+					tex = 0;
+
+				glTexCoord2fv_fp (ptex_coord[tex][0]);
+				glVertex3fv_fp (org);
+				glTexCoord2fv_fp (ptex_coord[tex][1]);
+				glVertex3f_fp (org[0] + r_pup[0]*scale, org[1] + r_pup[1]*scale, org[2] + r_pup[2]*scale);
+				glTexCoord2fv_fp (ptex_coord[tex][2]);
+				glVertex3f_fp (org[0] + r_pright[0]*scale, org[1] + r_pright[1]*scale, org[2] + r_pright[2]*scale);
+			}
+		}
 	}
 
 	glEnd_fp ();
@@ -1447,12 +1833,62 @@ void R_DrawParticles (void)
 
 #else	/* !GLQUAKE */
 
-void R_DrawParticles (void)
+/*
+===============
+R_DrawSnowFlake
+
+A flake of count particles: the one at p->org, then one to the right of
+it, above, to the left and below
+===============
+*/
+static void R_DrawSnowFlake (particle_t *p, int count)
 {
-	particle_t	*p;
+	vec3_t		save_org;
 	int		i;
+
+	VectorCopy (p->org, save_org);
+	D_DrawParticle (p);
+
+	for (i = 1; i < count; i++)
+	{
+		switch (i)
+		{
+		// FIXME:  More translucency
+		//	   on outside particles?
+		case 1:
+		// One to right
+			VectorAdd (save_org, vright, p->org);
+			break;
+		case 2:
+		// One above
+			VectorAdd (save_org, vup, p->org);
+			break;
+		case 3:
+		// One to left
+			VectorSubtract (save_org, vright, p->org);
+			break;
+		case 4:
+		// One below
+			VectorSubtract (save_org, vup, p->org);
+			break;
+		default:
+			Con_Printf ("count too big!\n");
+			break;
+		}
+		D_DrawParticle (p);
+	}
+	VectorCopy (save_org, p->org);	// Restore origin
+}
+
+void R_DrawParticles (void)
+{
+	pgroup_t	*g;
+	particle_t	dp;	// what D_DrawParticle () looks at
+	int		t, i, j, k, n, m;
+	float		depth[PDEPTH_BATCH];
 	float		vel0, vel1, vel2;
-	vec3_t		save_org;
+
+	R_CommitParticle ();
 
 	D_StartParticles ();
 
@@ -1460,79 +1896,51 @@ void R_DrawParticles (void)
 	VectorScale (vup, yscaleshrink, r_pup);
 	VectorCopy (vpn, r_ppn);
 
-	for (p = active_particles ; p ; p = p->next)
+	for (t = 0 ; t < NUM_PTYPES ; t++)
 	{
-		switch (p->type)
+		g = &pgroups[t];
+		for (i = 0 ; i < g->num ; i += PDEPTH_BATCH)
 		{
-		case pt_snow:
-			VectorCopy(p->org, save_org);
-			D_DrawParticle (p);
+			n = q_min(g->num - i, PDEPTH_BATCH);
+			R_PartDepths (g, i, n, depth);
 
-			for (i = 1; i < p->count; i++)
+			for (j = 0 ; j < n ; j++)
 			{
-				switch (i)
+				k = i + j;
+				if (R_CullParticle (g, t, k, depth[j]))
+					continue;
+
+				dp.org[0] = g->f[PF_ORG + 0][k];
+				dp.org[1] = g->f[PF_ORG + 1][k];
+				dp.org[2] = g->f[PF_ORG + 2][k];
+				dp.color = g->f[PF_COLOR][k];
+
+				switch (t)
 				{
-				// FIXME:  More translucency
-				//	   on outside particles?
-
-			//	case 0:
-			//	// original
-			//		break;
-				case 1:
-				// One to right
-					p->org[0] = save_org[0] + vright[0];
-					p->org[1] = save_org[1] + vright[1];
-					p->org[2] = save_org[2] + vright[2];
-					break;
-				case 2:
-				// One above
-					p->org[0] = save_org[0] + vup[0];
-					p->org[1] = save_org[1] + vup[1];
-					p->org[2] = save_org[2] + vup[2];
+				case pt_snow:
+					R_DrawSnowFlake (&dp, g->b[PB_COUNT][k]);
 					break;
-				case 3:
-				// One to left
-					p->org[0] = save_org[0] - vright[0];
-					p->org[1] = save_org[1] - vright[1];
-					p->org[2] = save_org[2] - vright[2];
-					break;
-				case 4:
-				// One below
-					p->org[0] = save_org[0] - vup[0];
-					p->org[1] = save_org[1] - vup[1];
-					p->org[2] = save_org[2] - vup[2];
+
+				case pt_rain:
+					vel0 = g->f[PF_VEL + 0][k]*.001;
+					vel1 = g->f[PF_VEL + 1][k]*.001;
+					vel2 = g->f[PF_VEL + 2][k]*.001;
+
+					for (m = 0; m < 4; m++)
+					{
+						D_DrawParticle (&dp);
+						dp.org[0] += vel0;
+						dp.org[1] += vel1;
+						dp.org[2] += vel2;
+					}
+					D_DrawParticle (&dp);
 					break;
+
 				default:
-					Con_Printf ("count too big!\n");
+					D_DrawParticle (&dp);
 					break;
 				}
-				D_DrawParticle (p);
 			}
-			VectorCopy(save_org, p->org);	// Restore origin
-			break;
-
-		case pt_rain:
-			VectorCopy(p->org, save_org);
-
-			vel0 = p->vel[0]*.001;
-			vel1 = p->vel[1]*.001;
-			vel2 = p->vel[2]*.001;
-
-			for (i = 0; i < 4; i++)
-			{
-				D_DrawParticle(p);
-				p->org[0] += vel0;
-				p->org[1] += vel1;
-				p->org[2] += vel2;
- 			}
-			D_DrawParticle(p);
-
-			VectorCopy(save_org, p->org);	// Restore origin
-			break;
-
-		default:
-			D_DrawParticle (p);
-			break;
 		}
 	}
 
@@ -1541,479 +1949,424 @@ void R_DrawParticles (void)
 #endif	/* R_DrawParticles */
 
 
-void R_UpdateParticles (void)
+/*
+===============
+R_UpdateSnow
+
+Moves pt_snow particles: flakes drift about, and ones that hit something
+stop and fade out
+===============
+*/
+static void R_UpdateSnow (pgroup_t *g, float frametime)
 {
-	particle_t	*p, *kill;
-	float		grav, grav2, percent;
-	int		i;
-	float		time2, time3, time4;
-	float		time1;
-	float		dvel;
-	float		frametime;
-	float		vel0, vel1, vel2;
-	float		colindex;
-	vec3_t		diff;
-//	vec3_t		save_org;
-//	float		speed;
-//	qboolean	in_solid;
+	float		*color, *ramp, *die;
+	byte		*flags;
+	vec3_t		org, vel, diff, save_vel;
+	float		snow_speed;
+	mleaf_t		*l;
+	int		i, j, k;
 
-	if (cls.state == ca_disconnected)
-		return;
+	color = g->f[PF_COLOR];
+	ramp = g->f[PF_RAMP];
+	die = g->f[PF_DIE];
+	flags = g->b[PB_FLAGS];
 
-	frametime = cl.time - cl.oldtime;
-//	Con_Printf("%10.5f\n", frametime);
-	time4 = frametime * 20;
-	time3 = frametime * 15;
-	time2 = frametime * 10;
-	time1 = frametime * 5;
-	grav = frametime * sv_gravity.value * 0.05;
-	grav2 = frametime * sv_gravity.value * 0.025;
-	dvel = 4 * frametime;
-	percent = (frametime / HX_FRAME_TIME);
-
-	for ( ;; )
+	for (i = 0 ; i < g->num ; i++)
 	{
-		kill = active_particles;
-		if (kill && kill->die < cl.time)
+		for (k = 0 ; k < 3 ; k++)
 		{
-			active_particles = kill->next;
-			kill->next = free_particles;
-			free_particles = kill;
-			continue;
+			org[k] = g->f[PF_ORG + k][i];
+			vel[k] = g->f[PF_VEL + k][i];
 		}
-		break;
-	}
 
-	for (p = active_particles ; p ; p = p->next)
-	{
-		for ( ;; )
+		if (vel[0] == 0 && vel[1] == 0 && vel[2] == 0)
 		{
-			kill = p->next;
-			if (kill && kill->die < cl.time)
+		// Stopped moving
+			if (color[i] == 256 + 31)	// Most translucent white
 			{
-				p->next = kill->next;
-				kill->next = free_particles;
-				free_particles = kill;
-				continue;
+			// Go away
+				die[i] = -1;
 			}
-			break;
+			else
+			{
+			// Count fifty and fade in translucency
+			// once each time
+				ramp[i] += 1;
+				if (ramp[i] >= 7)
+				{
+					color[i] += 1;	//Get more translucent
+					ramp[i] = 0;
+				}
+			}
+			continue;
 		}
 
-		if (p->type == pt_rain)
+		// FIXME: If flake going fast enough, can go through,
+		//	  do a check in increments ot 10, max?
+		if (snow_flurry.integer == 1 && (rand() & 31))
 		{
-			vel0 = p->vel[0]*.001;
-			vel1 = p->vel[1]*.001;
-			vel2 = p->vel[2]*.001;
-			for (i = 0; i < 4; i++)
+		// Add flurry movement
+			snow_speed = Q_sqrt(DotProduct(vel, vel));
+
+			VectorCopy(vel, save_vel);
+
+			save_vel[0] += ( (rand() * (2.0 / RAND_MAX)) - 1 ) * 30;
+			save_vel[1] += ( (rand() * (2.0 / RAND_MAX)) - 1 ) * 30;
+			if ((rand() & 7) || vel[2] > 10)
+				save_vel[2] += ( (rand() * (2.0 / RAND_MAX)) - 1 ) * 30;
+
+			VectorNormalizeFast(save_vel);
+			VectorScale(save_vel, snow_speed, vel);	// retain speed but use new dir
+		}
+
+		VectorScale(vel, frametime, diff);
+		VectorAdd(org, diff, org);
+
+		if (flags[i] & SFL_IN_BOUNDS)
+		{
+		// Always stay inside the boundry!
+			for (k = 0 ; k < 3 ; k++)
 			{
-				p->org[0] += vel0;
-				p->org[1] += vel1;
-				p->org[2] += vel2;
+				if (org[k] < g->f[PF_MINORG + k][i] ||
+				    org[k] > g->f[PF_MAXORG + k][i])
+					die[i] = -1;
 			}
-			p->org[0] += p->vel[0] * (frametime - .004);
-			p->org[1] += p->vel[1] * (frametime - .004);
-			p->org[2] += p->vel[2] * (frametime - .004);
 		}
-		else if (p->type == pt_snow)
+		else
 		{
-			if (p->vel[0] == 0 && p->vel[1] == 0 && p->vel[2] == 0)
+			// if hit solid, go to last position,
+			// no velocity, fade out.
+			l = Mod_PointInLeaf (org, cl.worldmodel);
+			if (l->contents != CONTENTS_EMPTY)
 			{
-			// Stopped moving
-				if (p->color == 256 + 31)	// Most translucent white
+				if (flags[i] & SFL_NO_MELT)
 				{
-				// Go away
-					p->die = -1;
+				// Don't melt, just die
+					die[i] = -1;
 				}
 				else
 				{
-				// Count fifty and fade in translucency
-				// once each time
-					p->ramp += 1;
-					if (p->ramp >= 7)
+				// still have small prob of snow melting on emitter
+					VectorScale(diff, 0.2, vel);
+					j = 6;
+					while (l->contents != CONTENTS_EMPTY)
 					{
-						p->color += 1;	//Get more translucent
-						p->ramp = 0;
+						VectorSubtract (org, vel, org);
+						j--; //no infinite loops
+						if (!j)
+						{
+							die[i] = -1;	//should never happen now!
+							break;
+						}
+						l = Mod_PointInLeaf (org, cl.worldmodel);
 					}
+					VectorClear (vel);
+					ramp[i] = 0;
 				}
 			}
-			else
-			{
-			// FIXME: If flake going fast enough, can go through,
-			//	  do a check in increments ot 10, max?
-			// if not in_bounds Get length of diff, add in
-			// increments of 4 & check solid
-				mleaf_t		*l;
+		}
 
-				if (snow_flurry.integer == 1)
-				{
-				    if (rand() & 31)
-				    {
-				// Add flurry movement
-					float			snow_speed;
-					vec3_t			save_vel;
-					snow_speed = p->vel[0] * p->vel[0] +
-							p->vel[1] * p->vel[1] +
-							p->vel[2] * p->vel[2];
-					snow_speed = Q_sqrt(snow_speed);
-
-					VectorCopy(p->vel, save_vel);
-
-					save_vel[0] += ( (rand() * (2.0 / RAND_MAX)) - 1 ) * 30;
-					save_vel[1] += ( (rand() * (2.0 / RAND_MAX)) - 1 ) * 30;
-					if ((rand() & 7) || p->vel[2] > 10)
-						save_vel[2] += ( (rand() * (2.0 / RAND_MAX)) - 1 ) * 30;
-
-					VectorNormalizeFast(save_vel);
-					VectorScale(save_vel, snow_speed, p->vel);	// retain speed but use new dir
-				    }
-				}
+		for (k = 0 ; k < 3 ; k++)
+		{
+			g->f[PF_ORG + k][i] = org[k];
+			g->f[PF_VEL + k][i] = vel[k];
+		}
+	}
+}
 
-				/*
-				VectorScale(p->vel, frametime, diff);
-				speed = VectorNormalize(diff);
-				in_solid = false;
-				if (!(p->flags & SFL_IN_BOUNDS))
-				{
-				// Not cut off by bounds
-					if (speed >= 8)
-					{
-					// Moving more than 8 pixels this turn
-						for (i = 4; i < speed; i += 4)
-						{
-						// Check for solid in increments of 4
-							VectorScale(diff, i, save_org);
-							VectorAdd(p->org, save_org, save_org);
-						//	if (SV_PointContents(save_org) != CONTENTS_EMPTY)
-								l = Mod_PointInLeaf (save_org, cl.worldmodel);
-							if (l->contents != CONTENTS_EMPTY)
-							{
-								in_solid = true;
-								VectorCopy(save_org, p->org);
-								break;
-							}
-						}
-					}
-				}
+void R_UpdateParticles (void)
+{
+	pgroup_t	*g;
+	float		*org[3], *vel[3], *color, *ramp, *die;
+	float		grav, grav2, percent;
+	int		t, i, k, n;
+	float		time2, time3, time4;
+	float		time1;
+	float		dvel;
+	float		frametime;
+	float		colindex, f;
+	vec3_t		diff;
 
-				if (!in_solid)
-				*/
-				{
-					VectorScale(p->vel, frametime, diff);
-					VectorAdd(p->org, diff, p->org);
-				}
+	if (cls.state == ca_disconnected)
+		return;
 
-				if (p->flags & SFL_IN_BOUNDS)
-				{
-				// Always stay inside the boundry!
-					if ( p->org[0] < p->min_org[0]	||
-						p->org[0] > p->max_org[0] ||
-						p->org[1] < p->min_org[1] ||
-						p->org[1] > p->max_org[1] ||
-						p->org[2] < p->min_org[2] ||
-						p->org[2] > p->max_org[2] )
-					{
-						p->die = -1;
-					}
-				}
-				else
-				{
-					// if hit solid, go to last position,
-					// no velocity, fade out.
-					l = Mod_PointInLeaf (p->org, cl.worldmodel);
-					if (l->contents != CONTENTS_EMPTY) // || in_solid == true
-					{
-						if (p->flags & SFL_NO_MELT)
-						{
-						// Don't melt, just die
-							p->die = -1;
-						}
-						else
-						{
-						// still have small prob of snow melting on emitter
-							VectorScale(diff, 0.2, p->vel);
-							i = 6;
-							while (l->contents != CONTENTS_EMPTY)
-							{
-								p->org[0] -= p->vel[0];
-								p->org[1] -= p->vel[1];
-								p->org[2] -= p->vel[2];
-								i--; //no infinite loops
-								if (!i)
-								{
-									p->die = -1;	//should never happen now!
-									break;
-								}
-								l = Mod_PointInLeaf (p->org, cl.worldmodel);
-							}
-							p->vel[0] = p->vel[1] = p->vel[2] = 0;
-							p->ramp = 0;
-						}
-					}
-				}
-			}
+	R_CommitParticle ();
+	r_partstats = r_partframe;
+	memset (&r_partframe, 0, sizeof(r_partframe));
+
+	frametime = cl.time - cl.oldtime;
+//	Con_Printf("%10.5f\n", frametime);
+	time4 = frametime * 20;
+	time3 = frametime * 15;
+	time2 = frametime * 10;
+	time1 = frametime * 5;
+	grav = frametime * sv_gravity.value * 0.05;
+	grav2 = frametime * sv_gravity.value * 0.025;
+	dvel = 4 * frametime;
+	percent = (frametime / HX_FRAME_TIME);
+
+	for (t = 0 ; t < NUM_PTYPES ; t++)
+	{
+		g = &pgroups[t];
+		R_KillParticles (g);
+
+		n = g->num;
+		if (!n)
+			continue;
+
+		for (k = 0 ; k < 3 ; k++)
+		{
+			org[k] = g->f[PF_ORG + k];
+			vel[k] = g->f[PF_VEL + k];
 		}
+		color = g->f[PF_COLOR];
+		ramp = g->f[PF_RAMP];
+		die = g->f[PF_DIE];
+
+		if (t == pt_snow)
+			R_UpdateSnow (g, frametime);
 		else
 		{
-			p->org[0] += p->vel[0] * frametime;
-			p->org[1] += p->vel[1] * frametime;
-			p->org[2] += p->vel[2] * frametime;
+			for (k = 0 ; k < 3 ; k++)
+				R_PartAxpy (org[k], vel[k], frametime, n);
 		}
 
-		switch (p->type)
+		switch (t)
 		{
 		case pt_static:
+		case pt_rain:
+		case pt_snow:
 			break;
 
 		case pt_fire:
-			p->ramp += time1;
-			if ((int)p->ramp >= 6)
-				p->die = -1;
-			else
-				p->color = ramp3[(int)p->ramp];
-			p->vel[2] += grav;
+			R_PartRamp (g, time1, ramp3, 6, 0);
+			R_PartAdd (vel[2], grav, n);
 			break;
 
 		case pt_explode:
-			p->ramp += time2;
-			if ((int)p->ramp >= 8)
-				p->die = -1;
-			else
-				p->color = ramp1[(int)p->ramp];
-			for (i = 0; i < 3; i++)
-				p->vel[i] += p->vel[i]*dvel;
-			p->vel[2] -= grav;
+			R_PartRamp (g, time2, ramp1, 8, 0);
+			for (k = 0 ; k < 3 ; k++)
+				R_PartAxpy (vel[k], vel[k], dvel, n);
+			R_PartAdd (vel[2], -grav, n);
 			break;
 
 		case pt_explode2:
-			p->ramp += time3;
-			if ((int)p->ramp >= 8)
-				p->die = -1;
-			else
-				p->color = ramp2[(int)p->ramp];
-			for (i = 0; i < 3; i++)
-				p->vel[i] -= p->vel[i] * frametime;
-			p->vel[2] -= grav;
+			R_PartRamp (g, time3, ramp2, 8, 0);
+			for (k = 0 ; k < 3 ; k++)
+				R_PartAxpy (vel[k], vel[k], -frametime, n);
+			R_PartAdd (vel[2], -grav, n);
 			break;
 
 		case pt_c_explode:
-			p->ramp += time2;
-			if ((int)p->ramp >= 8)
-				p->die = -1;
-			else if (time2)
-				p->color--;
-			for (i = 0; i < 3; i++)
-				p->vel[i] += p->vel[i]*dvel;
-			p->vel[2] -= grav;
+			R_PartAdd (ramp, time2, n);
+			for (i = 0 ; i < n ; i++)
+			{
+				if ((int)ramp[i] >= 8)
+					die[i] = -1;
+				else if (time2)
+					color[i]--;
+			}
+			for (k = 0 ; k < 3 ; k++)
+				R_PartAxpy (vel[k], vel[k], dvel, n);
+			R_PartAdd (vel[2], -grav, n);
 			break;
 
 		case pt_c_explode2:
-			p->ramp += time3;
-			if ((int)p->ramp >= 8)
-				p->die = -1;
-			else if (time3)
-				p->color -= 2;
-			for (i = 0; i < 3; i++)
-				p->vel[i] -= p->vel[i] * frametime;
-			p->vel[2] -= grav;
+			R_PartAdd (ramp, time3, n);
+			for (i = 0 ; i < n ; i++)
+			{
+				if ((int)ramp[i] >= 8)
+					die[i] = -1;
+				else if (time3)
+					color[i] -= 2;
+			}
+			for (k = 0 ; k < 3 ; k++)
+				R_PartAxpy (vel[k], vel[k], -frametime, n);
+			R_PartAdd (vel[2], -grav, n);
 			break;
 
 		case pt_grav:
 #ifdef QUAKE2
-			p->vel[2] -= grav * 20;
+			R_PartAdd (vel[2], -grav * 20, n);
 			break;
 #endif
 		case pt_slowgrav:
-			p->vel[2] -= grav;
+			R_PartAdd (vel[2], -grav, n);
 			break;
 
 		case pt_fastgrav:
-			p->vel[2] -= grav * 4;
-			break;
-
-		case pt_rain:
-			break;
-
-		case pt_snow:
+			R_PartAdd (vel[2], -grav * 4, n);
 			break;
 
 		case pt_fireball:
-			p->ramp += time3;
-			if ((int)p->ramp >= 16)
-				p->die = -1;
-			else
-				p->color = ramp4[(int)p->ramp];
+			R_PartRamp (g, time3, ramp4, 16, 0);
 			break;
 
 		case pt_acidball:
-			p->ramp += time4 * 1.4;
-			if ((int)p->ramp >= 23)
-				p->die = -1;
-			else if ((int)p->ramp >= 15)
-				p->color = ramp11[(int)p->ramp - 15];
-			else
-				p->color = ramp10[(int)p->ramp];
-			p->vel[2] -= grav;
+			R_PartAdd (ramp, time4 * 1.4, n);
+			for (i = 0 ; i < n ; i++)
+			{
+				if ((int)ramp[i] >= 23)
+					die[i] = -1;
+				else if ((int)ramp[i] >= 15)
+					color[i] = ramp11[(int)ramp[i] - 15];
+				else
+					color[i] = ramp10[(int)ramp[i]];
+			}
+			R_PartAdd (vel[2], -grav, n);
 			break;
 
 		case pt_spit:
-			p->ramp += time3;
-			if ((int)p->ramp >= 16)
-				p->die = -1;
-			else
-				p->color = ramp6[(int)p->ramp];
-		//	p->vel[2] += grav * 2;
+			R_PartRamp (g, time3, ramp6, 16, 0);
 			break;
 
 		case pt_ice:
-			p->ramp += time4;
-			if ((int)p->ramp >= 16)
-				p->die = -1;
-			else
-				p->color = ramp5[(int)p->ramp];
-			p->vel[2] -= grav;
+			R_PartRamp (g, time4, ramp5, 16, 0);
+			R_PartAdd (vel[2], -grav, n);
 			break;
 
 		case pt_spell:
-			p->ramp += time2;
-			if ((int)p->ramp >= 16)
-				p->die = -1;
-			else
-				p->color = ramp7[(int)p->ramp];
-		//	p->vel[2] += grav * 2;
+			R_PartRamp (g, time2, ramp7, 16, 0);
 			break;
 
 		case pt_test:
-			p->vel[2] += 1.3;
-			p->ramp += time3;
-			if ((int)p->ramp >= 13 || ((int)p->ramp > 10 && (int)p->vel[2] < 20) )
-				p->die = -1;
-			else
-				p->color = ramp8[(int)p->ramp];
+			R_PartAdd (vel[2], 1.3, n);
+			R_PartAdd (ramp, time3, n);
+			for (i = 0 ; i < n ; i++)
+			{
+				if ((int)ramp[i] >= 13 || ((int)ramp[i] > 10 && (int)vel[2][i] < 20) )
+					die[i] = -1;
+				else
+					color[i] = ramp8[(int)ramp[i]];
+			}
 			break;
 
 		case pt_quake:
-			p->vel[0] *= 1.05;
-			p->vel[1] *= 1.05;
-			p->vel[2] -= grav * 4;
+			R_PartScale (vel[0], 1.05, n);
+			R_PartScale (vel[1], 1.05, n);
+			R_PartAdd (vel[2], -grav * 4, n);
 			break;
 
 		case pt_rd:
 			if (!frametime)
 				break;
 
-			p->ramp += percent;
-			if ((int)p->ramp > 50)
+			R_PartAdd (ramp, percent, n);
+			for (i = 0 ; i < n ; i++)
 			{
-				p->ramp = 50;
-				p->die = -1;
-			}
-			p->color = 256 + 16 + 16 - (p->ramp / (50/16));
-
-			VectorSubtract(rider_origin, p->org, diff);
-
-			/*
-			p->org[0] += diff[0] * p->ramp / 80;
-			p->org[1] += diff[1] * p->ramp / 80;
-			p->org[2] += diff[2] * p->ramp / 80;
-			*/
-			vel0 = 1 / (51 - p->ramp);
-			p->org[0] += diff[0] * vel0;
-			p->org[1] += diff[1] * vel0;
-			p->org[2] += diff[2] * vel0;
+				if ((int)ramp[i] > 50)
+				{
+					ramp[i] = 50;
+					die[i] = -1;
+				}
+				color[i] = 256 + 16 + 16 - (ramp[i] / (50/16));
 
+				f = 1 / (51 - ramp[i]);
+				for (k = 0 ; k < 3 ; k++)
+				{
+					diff[k] = rider_origin[k] - org[k][i];
+					org[k][i] += diff[k] * f;
+				}
+			}
 			break;
 
 		case pt_gravwell:
 			if (!frametime)
 				break;
 
-			p->ramp += percent;
-			if ((int)p->ramp > 35)
+			R_PartAdd (ramp, percent, n);
+			for (i = 0 ; i < n ; i++)
 			{
-				p->ramp = 35;
-				p->die = -1;
-			}
-
-			VectorSubtract(rider_origin, p->org, diff);
-			/*
-			p->org[0] += diff[0] * p->ramp / 80;
-			p->org[1] += diff[1] * p->ramp / 80;
-			p->org[2] += diff[2] * p->ramp / 80;
-			*/
-
-			vel0 = 1 / (36 - p->ramp);
-			p->org[0] += diff[0] * vel0;
-			p->org[1] += diff[1] * vel0;
-			p->org[2] += diff[2] * vel0;
+				if ((int)ramp[i] > 35)
+				{
+					ramp[i] = 35;
+					die[i] = -1;
+				}
 
+				f = 1 / (36 - ramp[i]);
+				for (k = 0 ; k < 3 ; k++)
+				{
+					diff[k] = rider_origin[k] - org[k][i];
+					org[k][i] += diff[k] * f;
+				}
+			}
 			break;
 
 		case pt_vorpal:
-			--p->color;
-			if ((int)p->color <= 37 + 256)
-				p->die = -1;
+			R_PartAdd (color, -1, n);
+			for (i = 0 ; i < n ; i++)
+			{
+				if ((int)color[i] <= 37 + 256)
+					die[i] = -1;
+			}
 			break;
 
 		case pt_setstaff:
-			p->ramp += time1;
-			if ((int)p->ramp >= 16)
-				p->die = -1;
-			else
-				p->color = ramp9[(int)p->ramp];
-
-			p->vel[0] *= 1.08 * percent;
-			p->vel[1] *= 1.08 * percent;
-			p->vel[2] -= grav2;
+			R_PartRamp (g, time1, ramp9, 16, 0);
+			R_PartScale (vel[0], 1.08 * percent, n);
+			R_PartScale (vel[1], 1.08 * percent, n);
+			R_PartAdd (vel[2], -grav2, n);
 			break;
 
 		case pt_redfire:
-			p->ramp += frametime * 3;
-			if ((int)p->ramp >= 8)
-				p->die = -1;
-			else
-				p->color = ramp12[(int)p->ramp] + 256;
-
-			p->vel[0] *= .9;
-			p->vel[1] *= .9;
-			p->vel[2] += grav/2;
+			R_PartRamp (g, frametime * 3, ramp12, 8, 256);
+			R_PartScale (vel[0], .9, n);
+			R_PartScale (vel[1], .9, n);
+			R_PartAdd (vel[2], grav/2, n);
 			break;
 
 		case pt_magicmissile:
-			--p->color;
-			if ((int)p->color < 149)
-				p->color = 149;
-			p->ramp += time1;
-			if ((int)p->ramp > 16)
-				p->die = -1;
+			R_PartAdd (color, -1, n);
+			R_PartAdd (ramp, time1, n);
+			for (i = 0 ; i < n ; i++)
+			{
+				if ((int)color[i] < 149)
+					color[i] = 149;
+				if ((int)ramp[i] > 16)
+					die[i] = -1;
+			}
 			break;
 
 		case pt_boneshard:
-			--p->color;
-			if ((int)p->color < 368)
-				p->die = -1;
+			R_PartAdd (color, -1, n);
+			for (i = 0 ; i < n ; i++)
+			{
+				if ((int)color[i] < 368)
+					die[i] = -1;
+			}
 			break;
 
 		case pt_scarab:
-			--p->color;
-			if ((int)p->color < 250)
-				p->die = -1;
+			R_PartAdd (color, -1, n);
+			for (i = 0 ; i < n ; i++)
+			{
+				if ((int)color[i] < 250)
+					die[i] = -1;
+			}
 			break;
 
 		case pt_darken:
-			p->vel[2] -= grav;	//Also gravity
-			--p->color;
-			colindex = 0;
-			while (colindex < 224)
+			R_PartAdd (vel[2], -grav, n);	//Also gravity
+			R_PartAdd (color, -1, n);
+			for (i = 0 ; i < n ; i++)
 			{
-				if (colindex == 192 || colindex == 200)
-					colindex += 8;
-				else
-					colindex += 16;
-				if (p->color == colindex)
-					p->die = -1;
+				colindex = 0;
+				while (colindex < 224)
+				{
+					if (colindex == 192 || colindex == 200)
+						colindex += 8;
+					else
+						colindex += 16;
+					if (color[i] == colindex)
+						die[i] = -1;
+				}
 			}
-		    break;
+			break;
+
+		default:
+			break;
 		}
 	}
-}
 
+	r_partstats.active = r_numactive;
+}
@@ -39,6 +39,13 @@ typedef struct efrag_s
 } efrag_t;
 
 
+typedef struct
+{
+	struct qmodel_s		*model;		// model the frames belong to
+	int			frames[2];	// frame blended from, current frame
+	double			start;		// time the current frame came in
+} entlerp_t;
+
 typedef struct entity_s
 {
 	qboolean		forcelink;	// model changed
@@ -63,6 +70,7 @@ typedef struct entity_s
 	int			scale;		// for Alias models
 	int			drawflags;	// for Alias models
 	int			abslight;	// for Alias models
+	entlerp_t		lerp;		// for Alias model pose blending
 	int			visframe;	// last frame this entity was
 						// found in an active leaf
 
@@ -152,6 +160,8 @@ void R_InitSky (struct texture_s *mt);	// called at level load
 
 void R_PushDlights (void);
 
+void R_TimeBandsDone (void);	// software renderer: called when a timedemo ends
+
 void R_AddEfrags (entity_t *ent);
 void R_RemoveEfrags (entity_t *ent);
 
@@ -162,10 +172,34 @@ void R_RemoveEfrags (entity_t *ent);
 extern	qboolean	r_cache_thrash;
 				// set if thrashing the surface cache
 
+typedef struct
+{
+	int		hits;		// lookups last frame that found a valid entry
+	int		misses;		// ..that had to build one
+	int		evictions;	// entries thrown out to make room
+	int		size;		// current cache size, in bytes
+} surfcachestats_t;
+
+extern	surfcachestats_t	d_cachestats;	// software renderer only
+
+//
+// particles
+//
+typedef struct
+{
+	int		active;		// particles alive after the last update
+	int		spawned;	// added since the update before
+	int		dropped;	// turned away for want of room
+	int		culled;		// skipped last frame, behind the view
+} particlestats_t;
+
+extern	particlestats_t		r_partstats;
+
 int  D_SurfaceCacheForRes (int width, int height);
 void D_FlushCaches (void);
 void D_DeleteSurfaceCache (void);
 void D_InitCaches (void *buffer, int size);
+void D_AdaptCaches (void);	// grows a thrashing cache, once a frame
 void R_SetVrect (vrect_t *pvrect, vrect_t *pvrectin, int lineadj);
 
 #endif	/* RENDER_H_ */
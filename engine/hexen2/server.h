@@ -272,6 +272,7 @@ void SV_DropClient (qboolean crash);
 void SV_Edicts (const char *Name);
 
 void SV_SendClientMessages (void);
+void SV_ClearSendList (void);
 void SV_ClearDatagram (void);
 
 int SV_ModelIndex (const char *name);
@@ -287,6 +288,8 @@ void SV_ClientPrintf (unsigned int unused, const char *fmt, ...) FUNC_PRINTF(2,3
 void SV_BroadcastPrintf (const char *fmt, ...) FUNC_PRINTF(1,2);
 
 void SV_Physics (void);
+void SV_PhysThreads_f (cvar_t *var);
+void SV_PhysHash_f (void);
 
 qboolean SV_CheckBottom (edict_t *ent);
 qboolean SV_movestep (edict_t *ent, vec3_t move, qboolean relink, qboolean noenemy,
@@ -305,6 +308,7 @@ const char *SV_GetLevelname (void);
 
 void SV_ParseEffect (sizebuf_t *sb);
 void SV_UpdateEffects (sizebuf_t *sb);
+void SV_ClearEffects (void);
 void SV_SaveEffects (FILE *FH);
 void SV_LoadEffects (FILE *FH);
 
@@ -111,6 +111,7 @@ OBJECTS = &
 	mathlib.obj &
 	zone.obj &
 	hashindex.obj &
+	threads.obj &
 	$(SYSOBJ_NET) &
 	net_dgrm.obj &
 	net_main.obj &
@@ -24,6 +24,7 @@
 
 #include "quakedef.h"
 #include "debuglog.h"
+#include "threads.h"
 
 /*
  * Memory is cleared / released when a server or client begins, not when
@@ -64,6 +65,9 @@ cvar_t	pausable = {"pausable", "1", CVAR_NONE};
 
 cvar_t	temp1 = {"temp1", "0", CVAR_NONE};
 
+cvar_t	sv_savebinary = {"sv_savebinary", "1", CVAR_ARCHIVE};
+static	cvar_t	sv_savethread = {"sv_savethread", "1", CVAR_ARCHIVE};
+
 
 /*
 ===============================================================================
@@ -73,12 +77,93 @@ SAVEGAME FILES HANDLING
 ===============================================================================
 */
 
+/* a gamestate file being written in the background */
+static struct
+{
+	char	name[MAX_OSPATH];
+	byte	*data;
+	int		size;
+	int		error;
+	qboolean	pending;
+} gip_write;
+
+static void Host_WriteGIPTask (void *unused, int job)
+{
+	FILE	*f;
+
+	f = fopen (gip_write.name, "wb");
+	if (!f)
+	{
+		gip_write.error = 1;
+		return;
+	}
+	if (fwrite (gip_write.data, 1, gip_write.size, f) != (size_t) gip_write.size)
+		gip_write.error = 1;
+	if (fclose (f) != 0)
+		gip_write.error = 1;
+}
+
+/*
+===============
+Host_WaitGamestate
+
+Returns when the gamestate file being written is on disk, non-zero if
+it couldn't be written.  With a name, only waits if that is the file.
+===============
+*/
+int Host_WaitGamestate (const char *name)
+{
+	if (!gip_write.pending)
+		return 0;
+	if (name && strcmp(name, gip_write.name))
+		return 0;
+
+	Thread_WaitTask ();
+	gip_write.pending = false;
+	free (gip_write.data);
+	gip_write.data = NULL;
+	if (gip_write.error)
+		Con_Printf ("%s: Unable to write %s!\n", __thisfunc__, gip_write.name);
+	return gip_write.error;
+}
+
+/*
+===============
+Host_WriteGamestate
+
+Writes a gamestate file with a single write, on a thread of its own if
+sv_savethread is set.  Takes over the malloc'ed data.  Anything that
+reads, copies or removes gamestate files must call Host_WaitGamestate
+first: Host_RemoveGIPFiles and Host_CopyFiles do.
+===============
+*/
+int Host_WriteGamestate (const char *name, byte *data, int size)
+{
+	Host_WaitGamestate (NULL);
+
+	q_strlcpy (gip_write.name, name, sizeof(gip_write.name));
+	gip_write.data = data;
+	gip_write.size = size;
+	gip_write.error = 0;
+	gip_write.pending = true;
+
+	if (sv_savethread.integer)
+	{
+		Thread_StartTask (Host_WriteGIPTask, NULL);
+		return 0;
+	}
+	Host_WriteGIPTask (NULL, 0);
+	return Host_WaitGamestate (NULL);
+}
+
 void Host_RemoveGIPFiles (const char *path)
 {
 	const char	*name;
 	char	tempdir[MAX_OSPATH], *p;
 	size_t	len;
 
+	Host_WaitGamestate (NULL);
+
 	if (path)
 		q_strlcpy(tempdir, path, MAX_OSPATH);
 	else	q_strlcpy(tempdir, FS_GetUserdir(), MAX_OSPATH);
@@ -120,6 +205,8 @@ int Host_CopyFiles (const char *source, const char *pat, const char *dest)
 	char	tempdir[MAX_OSPATH], tempdir2[MAX_OSPATH];
 	int	error;
 
+	Host_WaitGamestate (NULL);
+
 	name = Sys_FindFirstFile(source, pat);
 	error = 0;
 
@@ -264,6 +351,9 @@ static void Host_InitLocal (void)
 
 	Cvar_RegisterVariable (&temp1);
 
+	Cvar_RegisterVariable (&sv_savebinary);
+	Cvar_RegisterVariable (&sv_savethread);
+
 	Host_FindMaxClients ();
 }
 
@@ -414,6 +504,7 @@ void SV_DropClient (qboolean crash)
 	ED_ClearEdict(host_client->edict);
 	host_client->send_all_v = true;
 	net_activeconnections--;
+	SV_ClearSendList ();	// the progs may have changed what is visible
 
 // send notification to all clients
 	for (i = 0, client = svs.clients; i < svs.maxclients; i++, client++)
@@ -706,6 +797,8 @@ void Host_Shutdown(void)
 	}
 	isdown = true;
 
+	Host_WaitGamestate (NULL);
+
 	NET_Shutdown ();
 	LOG_Close ();
 }
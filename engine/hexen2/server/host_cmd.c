@@ -338,6 +338,10 @@ static void Host_Changelevel2_f (void)
 			Host_Error ("%s: cannot run map %s", __thisfunc__, level);
 		RestoreClients (0);
 	}
+
+	// the old level's state may still have been going to disk
+	if (Host_WaitGamestate (NULL) != 0)
+		Host_Error ("%s: The game could not be saved properly!", __thisfunc__);
 }
 
 /*
@@ -491,6 +495,11 @@ static void Host_Savegame_f (void)
 	// don't bother doing more if SaveGamestate failed
 	if (error_state)
 		return;
+	if (Host_WaitGamestate (NULL) != 0)
+	{
+		Host_Error ("%s: The game could not be saved properly!", __thisfunc__);
+		return;
+	}
 
 	FS_MakePath_BUF (FS_USERDIR, &error_state, savename, sizeof(savename), p);
 	if (error_state)
@@ -729,6 +738,275 @@ static void Host_Loadgame_f (void)
 	sv.loadgame = true;
 }
 
+/*
+===============================================================================
+
+BINARY GAMESTATES
+
+With sv_savebinary set, the .gip files are snapshots of the edicts and
+globals that load with a few memcpys instead of parsing every field.
+They only load with the progs and engine build that wrote them, so text
+gamestates are still read, and sv_savebinary 0 writes those for saves
+that have to move between versions.
+
+===============================================================================
+*/
+
+#define	GAMESTATE_IDENT		(('S'<<24)+('G'<<16)+('X'<<8)+'H')	// little-endian "HXGS"
+#define	GAMESTATE_VERSION	1
+
+typedef struct
+{
+	int		ident;
+	int		version;
+	int		crc;		// pr_crc of the progs that wrote it
+	int		entityfields;
+	int		effectsize;	// sizeof(struct EffectT)
+	int		clientsonly;
+	float		skill;
+	float		time;
+	char		mapname[MAX_QPATH];
+	char		comment[SAVEGAME_COMMENT_LENGTH+1];
+} gamestate_t;
+
+static int SaveGamestateSnap (qboolean ClientsOnly)
+{
+	gamestate_t	header;
+	edsnap_t	snap;
+	edict_t		*ent;
+	int		i, size;
+
+	memset (&header, 0, sizeof(header));
+	header.ident = GAMESTATE_IDENT;
+	header.version = GAMESTATE_VERSION;
+	header.crc = pr_crc;
+	header.entityfields = progs->entityfields;
+	header.effectsize = sizeof(struct EffectT);
+	header.clientsonly = ClientsOnly;
+	if (!ClientsOnly)
+	{
+		Host_SavegameComment (header.comment);
+		header.skill = skill.value;
+		q_strlcpy (header.mapname, sv.name, sizeof(header.mapname));
+		header.time = sv.time;
+	}
+
+	ED_SnapBegin (&snap);
+	memcpy (ED_SnapSpace(&snap, sizeof(header)), &header, sizeof(header));
+
+	if (!ClientsOnly)
+	{
+		for (i = 0; i < MAX_LIGHTSTYLES; i++)
+			ED_SnapWriteString (&snap, sv.lightstyles[i] ? sv.lightstyles[i] : "m");
+
+		for (i = size = 0; i < MAX_EFFECTS; i++)
+		{
+			if (sv.Effects[i].type)
+				size++;
+		}
+		*(int *)ED_SnapSpace (&snap, 4) = size;
+		for (i = 0; i < MAX_EFFECTS; i++)
+		{
+			if (!sv.Effects[i].type)
+				continue;
+			*(int *)ED_SnapSpace (&snap, 4) = i;
+			memcpy (ED_SnapSpace(&snap, sizeof(struct EffectT)), &sv.Effects[i], sizeof(struct EffectT));
+		}
+
+		ED_SnapWriteGlobals (&snap);
+	}
+
+	// the same edicts as the text version
+	host_client = svs.clients;
+	for (i = 1; i < (ClientsOnly ? svs.maxclients + 1 : sv.num_edicts); i++)
+	{
+		ent = EDICT_NUM(i);
+		if ((int)ent->v.flags & FL_ARCHIVE_OVERRIDE)
+			continue;
+		if (ClientsOnly)
+		{
+			if (host_client->active)
+				ED_SnapWriteEdict (&snap, ent);
+			host_client++;
+		}
+		else
+		{
+			ED_SnapWriteEdict (&snap, ent);
+		}
+	}
+
+	size = ED_SnapEnd (&snap);
+	if (Host_WriteGamestate(savename, snap.data, size) != 0)
+	{
+		Host_Error ("%s: The game could not be saved properly!", __thisfunc__);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+===============
+RestoreEdict
+
+Links a loaded edict.  Returns true if its modelindex had to be fixed.
+===============
+*/
+static qboolean RestoreEdict (edict_t *ent, int entnum, int ClientsMode)
+{
+	int		i;
+
+	if (ClientsMode == 1 || ClientsMode == 2 || ClientsMode == 3)
+		ent->v.stats_restored = true;
+
+	// link it into the bsp tree
+	if (ent->free)
+		return false;
+
+	if (entnum >= sv.num_edicts)
+	{
+	/* This is necessary to restore "generated" edicts which were
+	 * not available during the map parsing by ED_LoadFromFile().
+	 * This includes items dropped by monsters, items "dropped" by
+	 * an item_spawner such as the "prizes" in the Temple of Mars
+	 * (romeric5), a health sphere generated by the Crusader's
+	 * Holy Strength ability, or a respawning-candidate killed
+	 * monster in the expansion pack's nightmare mode. -- THOMAS */
+	/* Moved this into the if (!ent->free) construct: less debug
+	 * chatter.  Even if this skips a free edict in between, the
+	 * skipped free edict wasn't parsed by ED_LoadFromFile() and
+	 * it will remain as a freed edict. (There is no harm because
+	 * we are dealing with extra edicts not originally present in
+	 * the map.)  -- O.S. */
+		Con_DPrintf("%s: entnum %d >= sv.num_edicts (%d)\n",
+				__thisfunc__, entnum, sv.num_edicts);
+		sv.num_edicts = entnum + 1;
+	}
+
+	SV_LinkEdict (ent, false);
+	if (ent->v.modelindex && ent->v.model)
+	{
+		i = SV_ModelIndex(PR_GetString(ent->v.model));
+		if (i != ent->v.modelindex)
+		{
+			ent->v.modelindex = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+===============
+LoadGamestateSnap
+
+Returns 0 if savename isn't a binary gamestate, 1 if it was loaded,
+-1 if its map couldn't be.
+===============
+*/
+static int LoadGamestateSnap (const char *startspot, int ClientsMode, float *playtime, qboolean *auto_correct)
+{
+	FILE	*f;
+	gamestate_t	header;
+	edsnap_t	snap;
+	byte		*data;
+	int		i, size, count, entnum;
+
+	f = fopen (savename, "rb");
+	if (!f)
+		return 0;
+	if (fread(&header, 1, sizeof(header), f) != sizeof(header) ||
+	    header.ident != GAMESTATE_IDENT)
+	{
+		fclose (f);
+		return 0;
+	}
+	fseek (f, 0, SEEK_END);
+	size = (int) ftell (f);
+	fseek (f, 0, SEEK_SET);
+	data = (byte *) malloc (size);
+	if (!data)
+		Sys_Error ("%s: out of memory", __thisfunc__);
+	i = (int) fread (data, 1, size, f);
+	fclose (f);
+	if (i != size)
+		goto fail;
+
+	if (header.version != GAMESTATE_VERSION ||
+	    header.effectsize != (int) sizeof(struct EffectT) ||
+	    header.clientsonly != (ClientsMode == 1))
+		goto badversion;
+
+	if (ClientsMode != 1)
+	{
+		Cvar_SetValue ("skill", header.skill);
+		header.mapname[sizeof(header.mapname) - 1] = 0;
+		SV_SpawnServer (header.mapname, startspot);
+		if (!sv.active)
+		{
+			free (data);
+			Con_Printf ("Couldn't load map\n");
+			return -1;
+		}
+	}
+
+	// the progs of the map are loaded by now
+	if (header.crc != pr_crc || header.entityfields != progs->entityfields)
+		goto badversion;
+
+	// the strings go to the hunk, which SV_SpawnServer has cleared
+	if (!ED_SnapOpen(&snap, data, size))
+		goto fail;
+	ED_SnapRead (&snap, &header, sizeof(header));
+
+	if (ClientsMode != 1)
+	{
+		for (i = 0; i < MAX_LIGHTSTYLES; i++)
+			sv.lightstyles[i] = (const char *)Hunk_Strdup (ED_SnapReadString(&snap), "lightstyles");
+
+		SV_ClearEffects ();
+		count = 0;
+		ED_SnapRead (&snap, &count, 4);
+		for ( ; count > 0 && !snap.badread; count--)
+		{
+			ED_SnapRead (&snap, &i, 4);
+			if (i < 0 || i >= MAX_EFFECTS)
+				snap.badread = true;
+			else
+				ED_SnapRead (&snap, &sv.Effects[i], sizeof(struct EffectT));
+		}
+
+		if (ED_SnapReadGlobals(&snap))
+		{
+			// Need to restore this
+			*sv_globals.startspot = PR_SetEngineString(sv.startspot);
+		}
+	}
+
+	while (!snap.badread && (entnum = ED_SnapReadEdict(&snap)) >= 0)
+	{
+		if (RestoreEdict(EDICT_NUM(entnum), entnum, ClientsMode))
+			*auto_correct = true;
+	}
+
+	ED_SnapClose (&snap);
+	free (data);
+	if (snap.badread)
+		Host_Error ("%s: %s is corrupt", __thisfunc__, savename);
+
+	*playtime = header.time;
+	return 1;
+
+badversion:
+	free (data);
+	Host_Error ("%s was saved by another version of the game or progs.  "
+		    "Save with sv_savebinary 0 to move games between versions.", savename);
+	return -1;
+fail:
+	free (data);
+	Host_Error ("%s: The game could not be loaded properly!", __thisfunc__);
+	return -1;
+}
+
 int SaveGamestate (qboolean ClientsOnly)
 {
 	FILE	*f;
@@ -762,6 +1040,10 @@ int SaveGamestate (qboolean ClientsOnly)
 		}
 	}
 
+	if (sv_savebinary.integer)
+		return SaveGamestateSnap (ClientsOnly);
+
+	Host_WaitGamestate (savename);
 	f = fopen (savename, "w");
 	if (!f)
 	{
@@ -857,6 +1139,7 @@ static void RestoreClients (int ClientsMode)
 			//ent->v.colormap = NUM_FOR_EDICT(ent);
 			ent->v.team = (host_client->colors & 15) + 1;
 			ent->v.netname = PR_SetEngineString(host_client->name);
+			ED_FindDirty (ent);
 			ent->v.playerclass = host_client->playerclass;
 
 			// copy spawn parms out of the client_t
@@ -914,6 +1197,19 @@ static int LoadGamestate (const char *level, const char *startspot, int ClientsM
 			Con_Printf ("Loading game from %s...\n", savename);
 	}
 
+	if (Host_WaitGamestate (savename) != 0)
+	{
+		Host_Error ("%s: %s was not saved properly!", __thisfunc__, savename);
+		return -1;
+	}
+	switch (LoadGamestateSnap(startspot, ClientsMode, &playtime, &auto_correct))
+	{
+	case 1:
+		goto restore;
+	case -1:
+		return -1;
+	}
+
 	f = fopen (savename, "r");
 	if (!f)
 	{
@@ -1018,48 +1314,14 @@ static int LoadGamestate (const char *level, const char *startspot, int ClientsM
 			 * because SaveGamestate() doesn't write entnum 0 */
 			ED_ParseEdict (start, ent);
 
-			if (ClientsMode == 1 || ClientsMode == 2 || ClientsMode == 3)
-				ent->v.stats_restored = true;
-
-			// link it into the bsp tree
-			if (!ent->free)
-			{
-				if (entnum >= sv.num_edicts)
-				{
-				/* This is necessary to restore "generated" edicts which were
-				 * not available during the map parsing by ED_LoadFromFile().
-				 * This includes items dropped by monsters, items "dropped" by
-				 * an item_spawner such as the "prizes" in the Temple of Mars
-				 * (romeric5), a health sphere generated by the Crusader's
-				 * Holy Strength ability, or a respawning-candidate killed
-				 * monster in the expansion pack's nightmare mode. -- THOMAS */
-				/* Moved this into the if (!ent->free) construct: less debug
-				 * chatter.  Even if this skips a free edict in between, the
-				 * skipped free edict wasn't parsed by ED_LoadFromFile() and
-				 * it will remain as a freed edict. (There is no harm because
-				 * we are dealing with extra edicts not originally present in
-				 * the map.)  -- O.S. */
-					Con_DPrintf("%s: entnum %d >= sv.num_edicts (%d)\n",
-							__thisfunc__, entnum, sv.num_edicts);
-					sv.num_edicts = entnum + 1;
-				}
-
-				SV_LinkEdict (ent, false);
-				if (ent->v.modelindex && ent->v.model)
-				{
-					i = SV_ModelIndex(PR_GetString(ent->v.model));
-					if (i != ent->v.modelindex)
-					{
-						ent->v.modelindex = i;
-						auto_correct = true;
-					}
-				}
-			}
+			if (RestoreEdict(ent, entnum, ClientsMode))
+				auto_correct = true;
 		}
 	}
 
 	fclose (f);
 
+restore:
 	if (ClientsMode == 0)
 	{
 		sv.time = playtime;
@@ -1124,6 +1386,7 @@ static void Host_Name_f (void)
 			Con_Printf ("%s renamed to %s\n", host_client->name, newName);
 	strcpy (host_client->name, newName);
 	host_client->edict->v.netname = PR_SetEngineString(host_client->name);
+	ED_FindDirty (host_client->edict);
 
 // send notification to all clients
 	MSG_WriteByte (&sv.reliable_datagram, svc_updatename);
@@ -1505,6 +1768,7 @@ static void Host_Spawn_f (void)
 			//ent->v.colormap = NUM_FOR_EDICT(ent);
 			ent->v.team = (host_client->colors & 15) + 1;
 			ent->v.netname = PR_SetEngineString(host_client->name);
+			ED_FindDirty (ent);
 			ent->v.playerclass = host_client->playerclass;
 
 			// copy spawn parms out of the client_t
@@ -47,7 +47,7 @@ extern cvar_t	sv_ce_max_size;
 // CODE --------------------------------------------------------------------
 
 
-static void SV_ClearEffects (void)
+void SV_ClearEffects (void)
 {
 	memset(sv.Effects, 0, sizeof(sv.Effects));
 }
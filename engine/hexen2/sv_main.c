@@ -21,6 +21,7 @@
  */
 
 #include "quakedef.h"
+#include "threads.h"
 
 server_t	sv;
 server_static_t	svs;
@@ -38,6 +39,12 @@ static	cvar_t	sv_update_misc		= {"sv_update_misc", "1", CVAR_ARCHIVE};
 cvar_t	sv_ce_scale		= {"sv_ce_scale", "0", CVAR_ARCHIVE};
 cvar_t	sv_ce_max_size		= {"sv_ce_max_size", "0", CVAR_ARCHIVE};
 
+static	cvar_t	sv_pvsmem		= {"sv_pvsmem", "16", CVAR_NONE};
+						/* megabytes of decompressed PVS rows */
+
+cvar_t	sv_sendthreads		= {"sv_sendthreads", "0", CVAR_ARCHIVE};
+						/* entity building jobs, see SV_BuildClientEntities */
+
 extern	cvar_t	sv_maxvelocity;
 extern	cvar_t	sv_gravity;
 extern	cvar_t	sv_nostep;
@@ -52,6 +59,7 @@ extern	cvar_t	sv_idealrollscale;
 extern	cvar_t	sv_aim;
 extern	cvar_t	sv_walkpitch;
 extern	cvar_t	sv_flypitch;
+extern	cvar_t	sv_physthreads;
 
 int		current_skill;
 int		sv_protocol = PROTOCOL_VERSION;	/* protocol version to use */
@@ -64,6 +72,7 @@ extern float	scr_centertime_off;
 
 
 static void Sv_Edicts_f(void);
+static void SV_PVSStats_f (void);
 
 /*
 ===============
@@ -92,6 +101,10 @@ void SV_Init (void)
 	Cvar_RegisterVariable (&sv_nostep);
 	Cvar_RegisterVariable (&sv_walkpitch);
 	Cvar_RegisterVariable (&sv_flypitch);
+	Cvar_RegisterVariable (&sv_physthreads);
+	Cvar_SetCallback (&sv_physthreads, SV_PhysThreads_f);
+	Cvar_RegisterVariable (&sv_sendthreads);
+	Cvar_SetCallback (&sv_sendthreads, SV_PhysThreads_f);
 	Cvar_RegisterVariable (&sv_sound_distance);
 	Cvar_RegisterVariable (&sv_update_player);
 	Cvar_RegisterVariable (&sv_update_monsters);
@@ -99,10 +112,14 @@ void SV_Init (void)
 	Cvar_RegisterVariable (&sv_update_misc);
 	Cvar_RegisterVariable (&sv_ce_scale);
 	Cvar_RegisterVariable (&sv_ce_max_size);
+	Cvar_RegisterVariable (&sv_pvsmem);
 
 	SV_UserInit ();
 
 	Cmd_AddCommand ("sv_edicts", Sv_Edicts_f);	
+	Cmd_AddCommand ("specstats", SV_SpecStats_f);
+	Cmd_AddCommand ("physhash", SV_PhysHash_f);
+	Cmd_AddCommand ("pvsstats", SV_PVSStats_f);
 
 	for (i = 0; i < MAX_MODELS; i++)
 		sprintf (localmodels[i], "*%i", i);
@@ -618,21 +635,262 @@ void SV_ClearDatagram (void)
 /*
 =============================================================================
 
+PVS CACHE
+
+The rows of the world's PVS are decompressed once when the map is loaded,
+instead of every time a client's fat PVS is built.  When the whole matrix
+would take more than sv_pvsmem megabytes (huge BSP2 maps), only as many
+rows as fit are kept and a missing row is decompressed on demand into the
+least recently used slot.
+
+Rows are indexed by leaf number and padded to 32 bit words, so that they
+can be or'ed a word at a time.
+
+=============================================================================
+*/
+
+#define	MIN_PVS_SLOTS	64
+
+typedef struct
+{
+	int		leafnum;	// -1 if empty
+	int		prev, next;	// lru ring, pvs_lru is the most recent
+} pvsslot_t;
+
+static	int		pvs_rowwords;
+static	int		pvs_numrows;	// numleafs + 1, leaf 0 included
+static	unsigned int	*pvs_rows;	// [slots][pvs_rowwords]
+static	pvsslot_t	*pvs_slots;	// NULL when every row is resident
+static	int		*pvs_leafslot;	// [pvs_numrows], -1 if not resident
+static	int		pvs_numslots;
+static	int		pvs_lru;
+
+static	struct
+{
+	double		decompressed;
+} pvs_stats;
+
+static void SV_DecompressPVSRow (int leafnum, unsigned int *dest)
+{
+	memset (dest, 0, pvs_rowwords * 4);
+	memcpy (dest, Mod_LeafPVS(sv.worldmodel->leafs + leafnum, sv.worldmodel),
+					(sv.worldmodel->numleafs + 7) >> 3);
+	pvs_stats.decompressed++;
+}
+
+/*
+=============
+SV_LeafPVSRow
+
+The returned row stays valid until the next call.
+=============
+*/
+static unsigned int *SV_LeafPVSRow (int leafnum)
+{
+	pvsslot_t	*slot;
+	int		s;
+
+	if (!pvs_slots)
+		return pvs_rows + leafnum * pvs_rowwords;
+
+	s = pvs_leafslot[leafnum];
+	if (s < 0)
+	{	// take over the least recently used slot
+		s = pvs_slots[pvs_lru].prev;
+		slot = &pvs_slots[s];
+		if (slot->leafnum >= 0)
+			pvs_leafslot[slot->leafnum] = -1;
+		slot->leafnum = leafnum;
+		pvs_leafslot[leafnum] = s;
+		SV_DecompressPVSRow (leafnum, pvs_rows + s * pvs_rowwords);
+	}
+
+	if (s != pvs_lru)
+	{	// move to the front of the ring
+		slot = &pvs_slots[s];
+		pvs_slots[slot->prev].next = slot->next;
+		pvs_slots[slot->next].prev = slot->prev;
+		slot->next = pvs_lru;
+		slot->prev = pvs_slots[pvs_lru].prev;
+		pvs_slots[slot->prev].next = s;
+		pvs_slots[pvs_lru].prev = s;
+		pvs_lru = s;
+	}
+
+	return pvs_rows + s * pvs_rowwords;
+}
+
+static void SV_InitFatPVS (void);
+
+/*
+=============
+SV_InitPVSCache
+
+Called after the world model is loaded.
+=============
+*/
+static void SV_InitPVSCache (void)
+{
+	size_t		rowbytes, maxbytes;
+	int		i;
+
+	free (pvs_rows);
+	free (pvs_slots);
+	free (pvs_leafslot);
+	pvs_rows = NULL;
+	pvs_slots = NULL;
+	pvs_leafslot = NULL;
+
+	pvs_numrows = sv.worldmodel->numleafs + 1;
+	pvs_rowwords = (sv.worldmodel->numleafs + 31) >> 5;
+	rowbytes = pvs_rowwords * 4;
+	maxbytes = (sv_pvsmem.value > 0) ? (size_t)(sv_pvsmem.value * 1024 * 1024) : 0;
+
+	if (rowbytes * pvs_numrows <= maxbytes)
+	{
+		pvs_numslots = pvs_numrows;
+		pvs_rows = (unsigned int *) malloc (rowbytes * pvs_numslots);
+		if (!pvs_rows)
+			Sys_Error ("%s: couldn't allocate %lu bytes", __thisfunc__,
+					(unsigned long)(rowbytes * pvs_numslots));
+		for (i = 0; i < pvs_numrows; i++)
+			SV_DecompressPVSRow (i, pvs_rows + i * pvs_rowwords);
+	}
+	else
+	{
+		pvs_numslots = (int)(maxbytes / rowbytes);
+		if (pvs_numslots < MIN_PVS_SLOTS)
+			pvs_numslots = MIN_PVS_SLOTS;
+		pvs_rows = (unsigned int *) malloc (rowbytes * pvs_numslots);
+		pvs_slots = (pvsslot_t *) malloc (pvs_numslots * sizeof(pvsslot_t));
+		pvs_leafslot = (int *) malloc (pvs_numrows * sizeof(int));
+		if (!pvs_rows || !pvs_slots || !pvs_leafslot)
+			Sys_Error ("%s: couldn't allocate %lu bytes", __thisfunc__,
+					(unsigned long)(rowbytes * pvs_numslots));
+		for (i = 0; i < pvs_numslots; i++)
+		{
+			pvs_slots[i].leafnum = -1;
+			pvs_slots[i].prev = (i + pvs_numslots - 1) % pvs_numslots;
+			pvs_slots[i].next = (i + 1) % pvs_numslots;
+		}
+		for (i = 0; i < pvs_numrows; i++)
+			pvs_leafslot[i] = -1;
+		pvs_lru = 0;
+	}
+
+	Con_DPrintf ("PVS cache: %i of %i rows, %lu bytes\n", (pvs_slots) ? pvs_numslots : pvs_numrows,
+				pvs_numrows, (unsigned long)(rowbytes * pvs_numslots));
+
+	SV_InitFatPVS ();
+}
+
+/*
+=============================================================================
+
 The PVS must include a small area around the client to allow head bobbing
 or other small motion on the client side.  Otherwise, a bob might cause an
 entity that should be visible to not show up, especially when the bob
 crosses a waterline.
 
+Most clients touch the same few leafs frame after frame, and clients near
+each other touch the same ones, so the fat PVS is memoized by the list of
+leafs it is made of.  The list is in tree order, so the same set of leafs
+always gives the same list.
+
+Each send job has a workspace of its own, see SV_BuildClientEntities.
+
 =============================================================================
 */
 
-static int	fatbytes;
-static byte	fatpvs[MAX_MAP_LEAFS/8];
+#define	MAX_FAT_LEAFS	32	// bigger fat PVSes are built directly
+#define	FAT_MEMO_SETS	32
+#define	FAT_MEMO_WAYS	4
+
+#define	MAX_SEND_JOBS	8
+
+typedef struct
+{
+	int		numleafs;	// -1 if unused
+	int		leafs[MAX_FAT_LEAFS];
+	unsigned int	used;
+	unsigned int	*pvs;
+} fatmemo_t;
 
-static void SV_AddToFatPVS (vec3_t org, mnode_t *node)
+typedef struct
+{
+	fatmemo_t	memo[FAT_MEMO_SETS][FAT_MEMO_WAYS];
+	unsigned int	*memorows;
+	unsigned int	clock;
+
+	int		leafs[MAX_FAT_LEAFS];
+	int		numleafs;
+	qboolean	direct;	// or the rows into fatpvs right away
+	unsigned int	fatpvs[MAX_MAP_LEAFS/32 + 1];
+
+	double		hits, misses, single, overflows;
+} fatwork_t;
+
+static	fatwork_t	fat_work[MAX_SEND_JOBS];
+static	int		fat_numwork;	// workspaces with memo rows for this map
+
+static void SV_InitFatPVS (void)
 {
 	int		i;
-	byte	*pvs;
+
+	for (i = 0; i < fat_numwork; i++)
+	{
+		free (fat_work[i].memorows);
+		fat_work[i].memorows = NULL;
+	}
+	fat_numwork = 0;
+}
+
+/*
+=============
+SV_FatWorkspace
+
+Workspaces get their memo rows when they are first used on a map.
+Only called from the main thread.
+=============
+*/
+static fatwork_t *SV_FatWorkspace (int job)
+{
+	fatwork_t	*w;
+	int		i, j;
+
+	while (fat_numwork <= job)
+	{
+		w = &fat_work[fat_numwork];
+		w->memorows = (unsigned int *) malloc (FAT_MEMO_SETS * FAT_MEMO_WAYS * pvs_rowwords * 4);
+		if (!w->memorows)
+			Sys_Error ("%s: couldn't allocate fat PVS memo", __thisfunc__);
+		for (i = 0; i < FAT_MEMO_SETS; i++)
+		{
+			for (j = 0; j < FAT_MEMO_WAYS; j++)
+			{
+				w->memo[i][j].numleafs = -1;
+				w->memo[i][j].used = 0;
+				w->memo[i][j].pvs = w->memorows + (i * FAT_MEMO_WAYS + j) * pvs_rowwords;
+			}
+		}
+		w->clock = 0;
+		fat_numwork++;
+	}
+
+	return &fat_work[job];
+}
+
+static void SV_OrPVSRow (unsigned int *dest, const unsigned int *src)
+{
+	int		i;
+
+	for (i = 0; i < pvs_rowwords; i++)
+		dest[i] |= src[i];
+}
+
+static void SV_AddToFatPVS (fatwork_t *w, vec3_t org, mnode_t *node)
+{
+	int		leafnum;
 	mplane_t	*plane;
 	float	d;
 
@@ -643,9 +901,13 @@ static void SV_AddToFatPVS (vec3_t org, mnode_t *node)
 		{
 			if (node->contents != CONTENTS_SOLID)
 			{
-				pvs = Mod_LeafPVS ( (mleaf_t *)node, sv.worldmodel);
-				for (i = 0; i < fatbytes; i++)
-					fatpvs[i] |= pvs[i];
+				leafnum = (mleaf_t *)node - sv.worldmodel->leafs;
+				if (w->direct)
+					SV_OrPVSRow (w->fatpvs, SV_LeafPVSRow(leafnum));
+				else if (w->numleafs < MAX_FAT_LEAFS)
+					w->leafs[w->numleafs++] = leafnum;
+				else
+					w->numleafs = MAX_FAT_LEAFS + 1;
 			}
 			return;
 		}
@@ -658,7 +920,7 @@ static void SV_AddToFatPVS (vec3_t org, mnode_t *node)
 			node = node->children[1];
 		else
 		{	// go down both
-			SV_AddToFatPVS (org, node->children[0]);
+			SV_AddToFatPVS (w, org, node->children[0]);
 			node = node->children[1];
 		}
 	}
@@ -669,21 +931,186 @@ static void SV_AddToFatPVS (vec3_t org, mnode_t *node)
 SV_FatPVS
 
 Calculates a PVS that is the inclusive or of all leafs within 8 pixels of the
-given point.
+given point.  The result stays valid until the next call with the same
+workspace.
 =============
 */
-static byte *SV_FatPVS (vec3_t org)
+static byte *SV_FatPVS (fatwork_t *w, vec3_t org)
 {
-	fatbytes = (sv.worldmodel->numleafs+31)>>3;
-	memset (fatpvs, 0, fatbytes);
-	SV_AddToFatPVS (org, sv.worldmodel->nodes);
-	return fatpvs;
+	fatmemo_t	*set, *memo;
+	unsigned int	hash;
+	int		i;
+
+	w->numleafs = 0;
+	w->direct = false;
+	SV_AddToFatPVS (w, org, sv.worldmodel->nodes);
+
+	if (w->numleafs > MAX_FAT_LEAFS)
+	{
+		w->overflows++;
+		memset (w->fatpvs, 0, pvs_rowwords * 4);
+		w->direct = true;
+		SV_AddToFatPVS (w, org, sv.worldmodel->nodes);
+		return (byte *)w->fatpvs;
+	}
+	if (w->numleafs == 1)
+	{	// nothing to or together
+		w->single++;
+		return (byte *)SV_LeafPVSRow (w->leafs[0]);
+	}
+
+	hash = w->numleafs;
+	for (i = 0; i < w->numleafs; i++)
+		hash = hash * 31 + w->leafs[i];
+	set = w->memo[(hash ^ (hash >> 5)) & (FAT_MEMO_SETS - 1)];
+
+	w->clock++;
+	memo = &set[0];
+	for (i = 0; i < FAT_MEMO_WAYS; i++)
+	{
+		if (set[i].numleafs == w->numleafs &&
+		    !memcmp(set[i].leafs, w->leafs, w->numleafs * sizeof(int)))
+		{
+			w->hits++;
+			set[i].used = w->clock;
+			return (byte *)set[i].pvs;
+		}
+		if (set[i].used < memo->used)
+			memo = &set[i];
+	}
+
+	w->misses++;
+	memo->numleafs = w->numleafs;
+	memcpy (memo->leafs, w->leafs, w->numleafs * sizeof(int));
+	memo->used = w->clock;
+	memset (memo->pvs, 0, pvs_rowwords * 4);
+	for (i = 0; i < w->numleafs; i++)
+		SV_OrPVSRow (memo->pvs, SV_LeafPVSRow(w->leafs[i]));
+	return (byte *)memo->pvs;
+}
+
+static void SV_PVSStats_f (void)
+{
+	double	hits = 0, misses = 0, single = 0, overflows = 0;
+	int	i;
+
+	if (!sv.active)
+		return;
+	Con_Printf ("pvs cache: %i of %i rows resident, %.0f rows decompressed\n",
+			pvs_slots ? pvs_numslots : pvs_numrows, pvs_numrows, pvs_stats.decompressed);
+	for (i = 0; i < MAX_SEND_JOBS; i++)
+	{
+		hits += fat_work[i].hits;
+		misses += fat_work[i].misses;
+		single += fat_work[i].single;
+		overflows += fat_work[i].overflows;
+	}
+	Con_Printf ("fat pvs: %.0f memo hits, %.0f misses, %.0f single leaf, %.0f built directly, %i workspaces\n",
+			hits, misses, single, overflows, fat_numwork);
+}
+
+/*
+=============================================================================
+
+SEND LIST
+
+Which edicts can be sent at all, and which sv_update_* class they belong
+to, is the same for every client, so it is worked out once per frame.
+Each client then only walks the send list merged with its reference frame
+(both are in edict order) and its own edict, instead of every edict.
+
+Progs code run when a client is dropped can change what is sendable, so
+SV_DropClient throws the list away and the next client rebuilds it.
+
+=============================================================================
+*/
+
+#define	UPDATE_PLAYER	0
+#define	UPDATE_MONSTER	1
+#define	UPDATE_MISSILE	2
+#define	UPDATE_MISC	3
+
+typedef struct
+{
+	int		num;
+	int		updateclass;
+	short	classmodel[MAX_PLAYER_CLASS+1];	// FL_CLASS_DEPENDENT model per class, -1 until looked up
+} sendent_t;
+
+static	sendent_t	sv_sendents[MAX_EDICTS];
+static	int		sv_numsendents;
+static	qboolean	sv_sendents_valid;
+
+static int SV_UpdateClass (edict_t *ent)
+{
+	long	flagtest = (long)ent->v.flags;
+
+	if (flagtest & FL_CLIENT)
+		return UPDATE_PLAYER;
+	if (flagtest & FL_MONSTER)
+		return UPDATE_MONSTER;
+	if (ent->v.movetype == MOVETYPE_FLYMISSILE ||
+	    ent->v.movetype == MOVETYPE_BOUNCEMISSILE ||
+	    ent->v.movetype == MOVETYPE_BOUNCE)
+		return UPDATE_MISSILE;
+	return UPDATE_MISC;
+}
+
+static int SV_ClassModelIndex (edict_t *ent, char classchar)
+{
+	char	NewName[MAX_QPATH];
+
+	if (strlen(PR_GetString(ent->v.model)) < 5)
+		return ent->v.modelindex;
+	strcpy (NewName, PR_GetString(ent->v.model));
+	NewName[strlen(NewName)-5] = classchar;
+	return SV_ModelIndex (NewName);
+}
+
+static void SV_BuildSendList (void)
+{
+	sendent_t	*send;
+	edict_t	*ent;
+	int		e;
+
+	sv_numsendents = 0;
+	ent = NEXT_EDICT(sv.edicts);
+	for (e = 1; e < sv.num_edicts; e++, ent = NEXT_EDICT(ent))
+	{
+		// don't send if flagged for NODRAW and there are no lighting effects
+		if (ent->v.effects == EF_NODRAW)
+			continue;
+		// ignore ents without visible models
+		if (!ent->v.modelindex || !*PR_GetString(ent->v.model))
+			continue;
+
+		send = &sv_sendents[sv_numsendents++];
+		send->num = e;
+		send->updateclass = SV_UpdateClass (ent);
+		memset (send->classmodel, 0xff, sizeof(send->classmodel));
+	}
+
+	sv_sendents_valid = true;
+}
+
+void SV_ClearSendList (void)
+{
+	sv_sendents_valid = false;
 }
 
 #define CLIENT_FRAME_INIT	255
 #define CLIENT_FRAME_RESET	254
 
-static void SV_PrepareClientEntities (client_t *client, edict_t	*clent, sizebuf_t *msg)
+/*
+=============
+SV_PrepareClientEntities
+
+Returns an edict with invalid flags instead of calling Host_Error,
+so that it can run on a send job.  clentmodel is the class model of
+clent when it was looked up beforehand, -1 if it wasn't.
+=============
+*/
+static edict_t *SV_PrepareClientEntities (client_t *client, edict_t *clent, int clentmodel, sizebuf_t *msg, fatwork_t *w)
 {
 	int		e, i;
 	int		bits;
@@ -692,14 +1119,17 @@ static void SV_PrepareClientEntities (client_t *client, edict_t	*clent, sizebuf_
 	float	miss;
 	edict_t	*ent;
 	int		temp_index;
-	char	NewName[MAX_QPATH];
 	long	flagtest;
 	int			position = 0;
-	int			client_num;
+	int			client_num, clent_num;
+	int			nextsend, lastnum;
+	char			classchar;
+	sendent_t		*send;
 	client_frames_t	*reference, *build;
 	client_state2_t	*state;
 	entity_state2_t	*ref_ent, *set_ent, build_ent;
-	qboolean		FoundInList,DoRemove,DoPlayer,DoMonsters,DoMissiles,DoMisc,IgnoreEnt;
+	qboolean		FoundInList,DoRemove,IgnoreEnt;
+	qboolean		DoUpdate[4];
 	short			RemoveList[MAX_CLIENT_STATES],NumToRemove;
 
 	client_num = client-svs.clients;
@@ -754,16 +1184,16 @@ static void SV_PrepareClientEntities (client_t *client, edict_t	*clent, sizebuf_
 			client->current_frame = MAX_FRAMES+1;
 	}
 
-	DoPlayer = DoMonsters = DoMissiles = DoMisc = false;
+	memset (DoUpdate, 0, sizeof(DoUpdate));
 
 	if (sv_update_player.integer)
-		DoPlayer = (client->current_sequence % sv_update_player.integer) == 0;
+		DoUpdate[UPDATE_PLAYER] = (client->current_sequence % sv_update_player.integer) == 0;
 	if (sv_update_monsters.integer)
-		DoMonsters = (client->current_sequence % sv_update_monsters.integer) == 0;
+		DoUpdate[UPDATE_MONSTER] = (client->current_sequence % sv_update_monsters.integer) == 0;
 	if (sv_update_missiles.integer)
-		DoMissiles = (client->current_sequence % sv_update_missiles.integer) == 0;
+		DoUpdate[UPDATE_MISSILE] = (client->current_sequence % sv_update_missiles.integer) == 0;
 	if (sv_update_misc.integer)
-		DoMisc = (client->current_sequence % sv_update_misc.integer) == 0;
+		DoUpdate[UPDATE_MISC] = (client->current_sequence % sv_update_misc.integer) == 0;
 
 	build = &state->frames[client->current_frame];
 	memset(build, 0, sizeof(*build));
@@ -783,29 +1213,51 @@ static void SV_PrepareClientEntities (client_t *client, edict_t	*clent, sizebuf_
 	else
 		VectorAdd (clent->v.origin, clent->v.view_ofs, org);
 
-	pvs = SV_FatPVS (org);
+	pvs = SV_FatPVS (w, org);
 
-	// send over all entities (except the client) that touch the pvs
-	ent = NEXT_EDICT(sv.edicts);
-	for (e = 1; e < sv.num_edicts; e++, ent = NEXT_EDICT(ent))
+	if (!sv_sendents_valid)
+		SV_BuildSendList ();
+	clent_num = NUM_FOR_EDICT(clent);
+	classchar = client->playerclass + 48;
+
+	// send over all entities (except the client) that touch the pvs.
+	// anything that is neither on the send list, in the reference
+	// frame nor the client would just be skipped.
+	nextsend = 0;
+	lastnum = 0;
+	while (1)
 	{
+		e = sv.num_edicts;
+		if (nextsend < sv_numsendents)
+			e = sv_sendents[nextsend].num;
+		while (position < reference->count &&
+			   reference->states[position].index <= lastnum)
+			position++;
+		if (position < reference->count && reference->states[position].index < e)
+			e = reference->states[position].index;
+		if (clent_num > lastnum && clent_num < e)
+			e = clent_num;
+		if (e >= sv.num_edicts)
+			break;
+		lastnum = e;
+		ent = EDICT_NUM(e);
+
+		send = NULL;
+		if (nextsend < sv_numsendents && sv_sendents[nextsend].num == e)
+			send = &sv_sendents[nextsend++];
+
 		DoRemove = false;
-		// don't send if flagged for NODRAW and there are no lighting effects
-		if (ent->v.effects == EF_NODRAW)
+		if (ent == clent)	// clent is ALWAYS sent
+		{	// unless flagged for NODRAW
+			if (ent->v.effects == EF_NODRAW)
+				DoRemove = true;
+		}
+		else if (!send)
 		{
 			DoRemove = true;
-			goto skipA;
 		}
-
-		// ignore if not touching a PV leaf
-		if (ent != clent)	// clent is ALWAYS sent
-		{	// ignore ents without visible models
-			if (!ent->v.modelindex || !*PR_GetString(ent->v.model))
-			{
-				DoRemove = true;
-				goto skipA;
-			}
-
+		else
+		{	// ignore if not touching a PV leaf
 			for (i = 0; i < ent->num_leafs; i++)
 			{
 				if (pvs[ent->leafnums[i] >> 3] & (1 << (ent->leafnums[i] & 7)) )
@@ -813,39 +1265,15 @@ static void SV_PrepareClientEntities (client_t *client, edict_t	*clent, sizebuf_
 			}
 
 			if (i == ent->num_leafs)
-			{
 				DoRemove = true;
-				goto skipA;
-			}
 		}
 
-skipA:
 		IgnoreEnt = false;
 		flagtest = (long)ent->v.flags;
 		if (!DoRemove)
 		{
-			if (flagtest & FL_CLIENT)
-			{
-				if (!DoPlayer)
-					IgnoreEnt = true;
-			}
-			else if (flagtest & FL_MONSTER)
-			{
-				if (!DoMonsters)
-					IgnoreEnt = true;
-			}
-			else if (ent->v.movetype == MOVETYPE_FLYMISSILE ||
-					 ent->v.movetype == MOVETYPE_BOUNCEMISSILE ||
-					 ent->v.movetype == MOVETYPE_BOUNCE)
-			{
-				if (!DoMissiles)
-					IgnoreEnt = true;
-			}
-			else
-			{
-				if (!DoMisc)
-					IgnoreEnt = true;
-			}
+			if (!DoUpdate[(send) ? send->updateclass : SV_UpdateClass(ent)])
+				IgnoreEnt = true;
 		}
 
 		bits = 0;
@@ -967,17 +1395,25 @@ skipA:
 
 	//	flagtest = (long)ent->v.flags;
 		if (flagtest & 0xff000000)
-		{
-			Host_Error("Invalid flags setting for class %s", PR_GetString(ent->v.classname));
-			return;
-		}
+			return ent;
 
 		temp_index = ent->v.modelindex;
 		if (((int)ent->v.flags & FL_CLASS_DEPENDENT) && ent->v.model)
 		{
-			strcpy (NewName, PR_GetString(ent->v.model));
-			NewName[strlen(NewName)-5] = client->playerclass + 48;
-			temp_index = SV_ModelIndex (NewName);
+			if (send && classchar >= '0' && classchar <= '0' + MAX_PLAYER_CLASS)
+			{
+				if (send->classmodel[classchar - '0'] < 0)
+					send->classmodel[classchar - '0'] = SV_ClassModelIndex (ent, classchar);
+				temp_index = send->classmodel[classchar - '0'];
+			}
+			else if (ent == clent && clentmodel >= 0)
+			{
+				temp_index = clentmodel;
+			}
+			else
+			{
+				temp_index = SV_ClassModelIndex (ent, classchar);
+			}
 		}
 
 		if (ref_ent->modelindex != temp_index)
@@ -1071,6 +1507,8 @@ skipA:
 	MSG_WriteByte (msg, NumToRemove);
 	for (i = 0; i < NumToRemove; i++)
 		MSG_WriteShort (msg, RemoveList[i]);
+
+	return NULL;
 }
 
 /*
@@ -1555,6 +1993,165 @@ end:
 	memcpy (&client->old_v, &ent->v, sizeof(client->old_v));
 }
 
+/*
+=============================================================================
+
+SEND JOBS
+
+With sv_sendthreads > 0 the entity part of each spawned client's datagram,
+which is most of the work of sending, is built on the worker threads before
+the clients are sent to one by one.  Each job takes every sv_sendjobs'th
+client and uses a fat PVS workspace of its own; the frames, states and
+ClearCounts written are the client's own.  The send list and the class
+dependent model lookups, those of the clients' own edicts included, are
+filled in before the jobs start, so the jobs only read shared state.
+Clients with a playerclass that has no class models are built serially.
+
+The svc_time and client data that start the datagram are still written in
+SV_SendClientDatagram, in client order, which then copies the entities in.
+A client dropped on the way doesn't rebuild the ones after it.
+
+When the PVS cache doesn't hold every row, rows are decompressed on demand,
+which isn't thread safe, so then the entities are built serially.
+
+=============================================================================
+*/
+
+typedef struct
+{
+	qboolean	built;
+	edict_t		*badent;
+	int		clentmodel;	// class model of the client's edict, or -1
+	sizebuf_t	msg;
+	byte		data[NET_MAXMESSAGE];
+} sendbuild_t;
+
+static	sendbuild_t	sv_sendbuild[MAX_CLIENTS];
+static	int		sv_sendclients[MAX_CLIENTS];
+static	int		sv_numsendclients;
+static	int		sv_sendjobs;
+
+static void SV_InvalidFlags (edict_t *ent)
+{
+	Host_Error("Invalid flags setting for class %s", PR_GetString(ent->v.classname));
+}
+
+static void SV_SendJob (void *data, int job)
+{
+	sendbuild_t	*b;
+	client_t	*client;
+	int		i;
+
+	for (i = job; i < sv_numsendclients; i += sv_sendjobs)
+	{
+		client = &svs.clients[sv_sendclients[i]];
+		b = &sv_sendbuild[sv_sendclients[i]];
+		SZ_Init (&b->msg, b->data, sizeof(b->data));
+		b->badent = SV_PrepareClientEntities (client, client->edict, b->clentmodel, &b->msg, &fat_work[job]);
+		b->built = true;
+	}
+}
+
+/*
+=============
+SV_FillClassModels
+
+Looks up the FL_CLASS_DEPENDENT models of the send list for every
+class that is about to be sent to, and those of the clients' own
+edicts, which needn't be on the send list.
+=============
+*/
+static void SV_FillClassModels (void)
+{
+	qboolean	used[MAX_PLAYER_CLASS+1];
+	sendent_t	*send;
+	sendbuild_t	*b;
+	client_t	*client;
+	edict_t		*ent;
+	int		i, c;
+
+	memset (used, 0, sizeof(used));
+	for (i = 0; i < sv_numsendclients; i++)
+	{
+		client = &svs.clients[sv_sendclients[i]];
+		c = (char)(client->playerclass + 48) - '0';	// as in SV_PrepareClientEntities
+		used[c] = true;
+
+		b = &sv_sendbuild[sv_sendclients[i]];
+		ent = client->edict;
+		b->clentmodel = -1;
+		if (((int)ent->v.flags & FL_CLASS_DEPENDENT) && ent->v.model)
+			b->clentmodel = SV_ClassModelIndex (ent, c + '0');
+	}
+
+	for (i = 0, send = sv_sendents; i < sv_numsendents; i++, send++)
+	{
+		ent = EDICT_NUM(send->num);
+		if (!((int)ent->v.flags & FL_CLASS_DEPENDENT) || !ent->v.model)
+			continue;
+		for (c = 0; c <= MAX_PLAYER_CLASS; c++)
+		{
+			if (used[c] && send->classmodel[c] < 0)
+				send->classmodel[c] = SV_ClassModelIndex (ent, c + '0');
+		}
+	}
+}
+
+/*
+=============
+SV_BuildClientEntities
+=============
+*/
+static void SV_BuildClientEntities (void)
+{
+	client_t	*client;
+	edict_t		*badent;
+	int		i, j;
+
+	for (i = 0; i < MAX_CLIENTS; i++)
+		sv_sendbuild[i].built = false;
+
+	if (sv_sendthreads.integer <= 0 || !Thread_NumWorkers() || pvs_slots)
+		return;
+
+	sv_numsendclients = 0;
+	for (i = 0, client = svs.clients; i < svs.maxclients; i++, client++)
+	{
+		if (client->active && client->spawned &&
+		    client->playerclass >= 0 && client->playerclass <= MAX_PLAYER_CLASS)
+			sv_sendclients[sv_numsendclients++] = i;
+	}
+	if (sv_numsendclients < 2)
+		return;
+
+	sv_sendjobs = sv_sendthreads.integer + 1;
+	if (sv_sendjobs > Thread_NumWorkers() + 1)
+		sv_sendjobs = Thread_NumWorkers() + 1;
+	if (sv_sendjobs > MAX_SEND_JOBS)
+		sv_sendjobs = MAX_SEND_JOBS;
+	if (sv_sendjobs > sv_numsendclients)
+		sv_sendjobs = sv_numsendclients;
+
+	if (!sv_sendents_valid)
+		SV_BuildSendList ();
+	SV_FillClassModels ();
+	for (i = 0; i < sv_sendjobs; i++)
+		SV_FatWorkspace (i);
+
+	Thread_RunJobs (SV_SendJob, NULL, sv_sendjobs);
+
+	for (i = 0; i < sv_numsendclients; i++)
+	{
+		badent = sv_sendbuild[sv_sendclients[i]].badent;
+		if (badent)
+		{
+			for (j = 0; j < MAX_CLIENTS; j++)
+				sv_sendbuild[j].built = false;
+			SV_InvalidFlags (badent);
+		}
+	}
+}
+
 /*
 =======================
 SV_SendClientDatagram
@@ -1564,6 +2161,8 @@ static qboolean SV_SendClientDatagram (client_t *client)
 {
 	byte		buf[NET_MAXMESSAGE];
 	sizebuf_t	msg;
+	sendbuild_t	*build;
+	edict_t		*badent;
 
 	SZ_Init (&msg, buf, sizeof(buf));
 
@@ -1573,7 +2172,18 @@ static qboolean SV_SendClientDatagram (client_t *client)
 // add the client specific data to the datagram
 	SV_WriteClientdataToMessage (client, client->edict, &msg);
 
-	SV_PrepareClientEntities (client, client->edict, &msg);
+	build = &sv_sendbuild[client - svs.clients];
+	if (build->built)
+	{
+		SZ_Write (&msg, build->data, build->msg.cursize);
+		build->built = false;
+	}
+	else
+	{
+		badent = SV_PrepareClientEntities (client, client->edict, -1, &msg, SV_FatWorkspace(0));
+		if (badent)
+			SV_InvalidFlags (badent);
+	}
 
 /*	if ((rand() & 0xff) < 200)
 	{
@@ -1682,6 +2292,9 @@ void SV_SendClientMessages (void)
 // update frags, names, etc
 	SV_UpdateToReliableMessages ();
 
+	SV_ClearSendList ();
+	SV_BuildClientEntities ();
+
 // build individual updates
 	for (i = 0, host_client = svs.clients; i < svs.maxclients; i++, host_client++)
 	{
@@ -1774,7 +2387,8 @@ int SV_ModelIndex (const char *name)
 
 	if (i == MAX_MODELS || !sv.model_precache[i])
 	{
-		Con_Printf("%s: model %s not precached\n", __thisfunc__, name);
+		if (!Thread_InWorker ())
+			Con_Printf("%s: model %s not precached\n", __thisfunc__, name);
 		return 0;
 	}
 
@@ -1945,6 +2559,7 @@ void SV_SpawnServer (const char *server, const char *startspot)
 #endif
 
 	Con_DPrintf ("%s: %s\n", __thisfunc__, server);
+	FS_StatsMapChange (false);
 	if (svs.changelevel_issued)
 	{
 		SaveGamestate(true);
@@ -2058,6 +2673,7 @@ void SV_SpawnServer (const char *server, const char *startspot)
 // clear world interaction links
 //
 	SV_ClearWorld ();
+	SV_InitPVSCache ();
 
 	sv.sound_precache[0] = dummy;
 	sv.model_precache[0] = dummy;
@@ -2119,6 +2735,7 @@ void SV_SpawnServer (const char *server, const char *startspot)
 	svs.changelevel_issued = false;		// now safe to issue another
 
 	Con_DPrintf ("Server spawned.\n");
+	FS_StatsMapChange (true);
 
 #if !defined(SERVERONLY)
 	total_loading_size = 0;
@@ -21,6 +21,7 @@
  */
 
 #include "quakedef.h"
+#include "threads.h"
 
 /*
 
@@ -49,6 +50,9 @@ cvar_t	sv_stopspeed		= { "sv_stopspeed", "100", CVAR_NONE };
 cvar_t	sv_friction		= { "sv_friction", "4", CVAR_NOTIFY|CVAR_SERVERINFO };
 cvar_t	sv_flypitch		= { "sv_flypitch", "20", CVAR_NONE };
 cvar_t	sv_walkpitch		= { "sv_walkpitch", "0", CVAR_NONE };
+cvar_t	sv_physthreads		= { "sv_physthreads", "0", CVAR_ARCHIVE };
+
+extern	cvar_t	sv_sendthreads;
 
 #ifdef QUAKE2
 static	vec3_t	vec_origin = {0.0, 0.0, 0.0};
@@ -2141,6 +2145,181 @@ static void SV_Physics_Step (edict_t *ent)
 
 //============================================================================
 
+/*
+================
+SV_PhysHash
+
+Records or checks the edict CRCs of a frame for SV_PhysHash_f
+================
+*/
+static FILE	*physhash_file;
+static qboolean	physhash_check;
+static int	physhash_frame;
+
+static void SV_PhysHash (void)
+{
+	int		i, count;
+	unsigned short	crc, old;
+	edict_t	*ent;
+
+	physhash_frame++;
+	if (physhash_check)
+	{
+		if (fread (&count, sizeof(count), 1, physhash_file) != 1)
+		{
+			Con_Printf ("physhash: recording ends at frame %d, no differences\n", physhash_frame);
+			goto done;
+		}
+		if (count != sv.num_edicts)
+		{
+			Con_Printf ("physhash: frame %d has %d edicts, recording has %d\n",
+					physhash_frame, sv.num_edicts, count);
+			goto done;
+		}
+	}
+	else
+	{
+		count = sv.num_edicts;
+		fwrite (&count, sizeof(count), 1, physhash_file);
+	}
+
+	for (i = 0, ent = sv.edicts; i < count; i++, ent = NEXT_EDICT(ent))
+	{
+		crc = ent->free ? 0 : CRC_Block ((byte *)&ent->v, progs->entityfields * 4);
+		if (!physhash_check)
+		{
+			fwrite (&crc, sizeof(crc), 1, physhash_file);
+			continue;
+		}
+		if (fread (&old, sizeof(old), 1, physhash_file) != 1)
+		{
+			Con_Printf ("physhash: recording is truncated\n");
+			goto done;
+		}
+		if (crc != old)
+		{
+			Con_Printf ("physhash: frame %d, edict %d (%s) differs\n",
+					physhash_frame, i, PR_GetString(ent->v.classname));
+			goto done;
+		}
+	}
+	return;
+
+done:
+	fclose (physhash_file);
+	physhash_file = NULL;
+}
+
+#ifndef QUAKE2
+/*
+=============
+SV_PredictMoves
+
+Works out where the freefalling step and toss edicts are headed before
+anything else runs this frame, so that their first move can be traced
+on the workers.  This has to follow SV_Physics_Step, SV_Physics_Toss and
+SV_PushEntity closely, but a wrong guess only wastes a trace: SV_Move
+checks every speculative move before it hands it out.
+=============
+*/
+static void SV_PredictMoves (void)
+{
+	int		i, type;
+	qboolean	step;
+	edict_t	*ent;
+	eval_t	*val;
+	float		w, ent_gravity, time_left;
+	vec3_t	vel, end;
+
+	ent = NEXT_EDICT(sv.edicts);
+	for (i = 1; i < sv.num_edicts; i++, ent = NEXT_EDICT(ent))
+	{
+		if (ent->free || i <= svs.maxclients)
+			continue;
+
+		if (ent->v.movetype == MOVETYPE_STEP || ent->v.movetype == MOVETYPE_PUSHPULL)
+		{
+			if ((int)ent->v.flags & (FL_ONGROUND | FL_FLY | FL_SWIM))
+				continue;
+			step = true;
+			type = MOVE_NORMAL;
+		}
+		else if (ent->v.movetype == MOVETYPE_TOSS
+				|| ent->v.movetype == MOVETYPE_BOUNCE
+				|| ent->v.movetype == MOVETYPE_BOUNCEMISSILE
+				|| ent->v.movetype == MOVETYPE_FLY
+				|| ent->v.movetype == MOVETYPE_FLYMISSILE
+				|| ent->v.movetype == MOVETYPE_SWIM)
+		{
+			if ((int)ent->v.flags & FL_ONGROUND)
+				continue;
+		// the think comes first and can change anything
+			if (!(ent->v.nextthink <= 0 || ent->v.nextthink > sv.time + host_frametime))
+				continue;
+			step = false;
+			if (ent->v.movetype == MOVETYPE_FLYMISSILE || ent->v.movetype == MOVETYPE_BOUNCEMISSILE)
+				type = MOVE_MISSILE;
+			else if (ent->v.solid == SOLID_TRIGGER || ent->v.solid == SOLID_NOT)
+				type = MOVE_NOMONSTERS;
+			else if (ent->v.movetype == MOVETYPE_SWIM)
+				type = MOVE_WATER;
+			else
+				type = MOVE_NORMAL;
+		}
+		else
+			continue;
+
+		if (IS_NAN(ent->v.velocity[0]) || IS_NAN(ent->v.velocity[1]) || IS_NAN(ent->v.velocity[2]) ||
+		    IS_NAN(ent->v.origin[0]) || IS_NAN(ent->v.origin[1]) || IS_NAN(ent->v.origin[2]))
+			continue;	// leave it to SV_CheckVelocity
+
+		VectorCopy (ent->v.velocity, vel);
+
+	// toss bounds the velocity before adding gravity, step after
+		if (!step)
+		{
+			w = VectorLength(vel);
+			if (w > sv_maxvelocity.value)
+				VectorScale (vel, sv_maxvelocity.value/w, vel);
+		}
+
+		if (ent->v.movetype != MOVETYPE_FLY
+				&& ent->v.movetype != MOVETYPE_BOUNCEMISSILE
+				&& ent->v.movetype != MOVETYPE_FLYMISSILE
+				&& ent->v.movetype != MOVETYPE_SWIM)
+		{
+			val = GetEdictFieldValue(ent, "gravity");
+			if (val && val->_float)
+				ent_gravity = val->_float;
+			else
+				ent_gravity = 1.0;
+			vel[2] -= ent_gravity * sv_gravity.value * host_frametime;
+		}
+
+		if (step)
+		{
+			w = VectorLength(vel);
+			if (w > sv_maxvelocity.value)
+				VectorScale (vel, sv_maxvelocity.value/w, vel);
+
+			if (!vel[0] && !vel[1] && !vel[2])
+				continue;	// SV_FlyMove won't move it
+			time_left = host_frametime;
+			end[0] = ent->v.origin[0] + time_left * vel[0];
+			end[1] = ent->v.origin[1] + time_left * vel[1];
+			end[2] = ent->v.origin[2] + time_left * vel[2];
+		}
+		else
+		{
+			VectorScale (vel, host_frametime, vel);
+			VectorAdd (ent->v.origin, vel, end);
+		}
+
+		SV_AddSpecMove (ent, end, type);
+	}
+}
+#endif	/* QUAKE2 */
+
 /*
 ================
 SV_Physics
@@ -2161,6 +2340,15 @@ void SV_Physics (void)
 
 	//SV_CheckAllEnts ();
 
+#ifndef QUAKE2
+// a forced retouch relinks everything, which no speculative move survives
+	if (sv_physthreads.integer > 0 && !*sv_globals.force_retouch)
+	{
+		SV_PredictMoves ();
+		SV_RunSpecMoves ();
+	}
+#endif
+
 //
 // treat each object in turn
 //
@@ -2245,10 +2433,80 @@ void SV_Physics (void)
 		}
 	}
 
+	SV_EndSpecMoves ();
+
 	if (*sv_globals.force_retouch)
 		(*sv_globals.force_retouch)--;
 
 	sv.time += host_frametime;
+
+	if (physhash_file)
+		SV_PhysHash ();
+}
+
+/*
+================
+SV_PhysThreads_f
+
+Callback for sv_physthreads and sv_sendthreads, which share the workers
+================
+*/
+void SV_PhysThreads_f (cvar_t *var)
+{
+	Thread_WantWorkers (THREAD_PHYSICS, sv_physthreads.integer);
+	Thread_WantWorkers (THREAD_SEND, sv_sendthreads.integer);
+}
+
+/*
+================
+SV_PhysHash_f
+
+physhash record <file> : write a CRC of every edict after each frame
+physhash check <file>  : compare each frame against such a recording
+physhash stop
+
+Replaying the same demo or timedemo with a recording made at
+sv_physthreads 0 checks that the threaded physics come out the same.
+================
+*/
+void SV_PhysHash_f (void)
+{
+	char	name[MAX_OSPATH];
+
+	if (physhash_file)
+	{
+		fclose (physhash_file);
+		physhash_file = NULL;
+		Con_Printf ("physhash: stopped after %d frames\n", physhash_frame);
+	}
+
+	if (Cmd_Argc() == 2 && !q_strcasecmp(Cmd_Argv(1), "stop"))
+		return;
+	if (Cmd_Argc() != 3)
+	{
+		Con_Printf ("Usage: physhash <record|check> <file>\n"
+			    "       physhash stop\n");
+		return;
+	}
+
+	if (!q_strcasecmp(Cmd_Argv(1), "record"))
+		physhash_check = false;
+	else if (!q_strcasecmp(Cmd_Argv(1), "check"))
+		physhash_check = true;
+	else
+	{
+		Con_Printf ("physhash: unknown mode %s\n", Cmd_Argv(1));
+		return;
+	}
+
+	FS_MakePath_BUF (FS_USERDIR, NULL, name, sizeof(name), Cmd_Argv(2));
+	physhash_file = fopen (name, physhash_check ? "rb" : "wb");
+	if (!physhash_file)
+	{
+		Con_Printf ("physhash: couldn't open %s\n", name);
+		return;
+	}
+	physhash_frame = 0;
 }
 
 
@@ -24,6 +24,7 @@
  */
 
 #include "quakedef.h"
+#include "threads.h"
 
 typedef struct
 {
@@ -50,10 +51,15 @@ HULL BOXES
 */
 
 
+typedef struct
+{
+	hull_t		hull;
+	mplane_t	planes[6];
+} boxhull_t;
+
 static	hull_t		box_hull;
 static	mclipnode_t	box_clipnodes[6];
 static	mplane_t	box_planes[6];
-static	int			move_type;
 
 /*
 ===================
@@ -97,18 +103,22 @@ SV_HullForBox
 
 To keep everything totally uniform, bounding boxes are turned into small
 BSP trees instead of being compared directly.
+The hull is built in the caller's box so that traces can run in parallel.
 ===================
 */
-static hull_t	*SV_HullForBox (vec3_t mins, vec3_t maxs)
+static hull_t	*SV_HullForBox (vec3_t mins, vec3_t maxs, boxhull_t *box)
 {
-	box_planes[0].dist = maxs[0];
-	box_planes[1].dist = mins[0];
-	box_planes[2].dist = maxs[1];
-	box_planes[3].dist = mins[1];
-	box_planes[4].dist = maxs[2];
-	box_planes[5].dist = mins[2];
-
-	return &box_hull;
+	memcpy (box->planes, box_planes, sizeof(box->planes));
+	box->planes[0].dist = maxs[0];
+	box->planes[1].dist = mins[0];
+	box->planes[2].dist = maxs[1];
+	box->planes[3].dist = mins[1];
+	box->planes[4].dist = maxs[2];
+	box->planes[5].dist = mins[2];
+
+	box->hull = box_hull;
+	box->hull.planes = box->planes;
+	return &box->hull;
 }
 
 
@@ -122,7 +132,7 @@ Offset is filled in to contain the adjustment that must be added to the
 testing object's origin to get a point to use with the returned hull.
 ================
 */
-static hull_t *SV_HullForEntity (edict_t *ent, vec3_t mins, vec3_t maxs, vec3_t offset, edict_t *move_ent)
+static hull_t *SV_HullForEntity (edict_t *ent, vec3_t mins, vec3_t maxs, vec3_t offset, edict_t *move_ent, boxhull_t *box)
 {
 	qmodel_t	*model;
 	vec3_t		size;
@@ -196,7 +206,7 @@ static hull_t *SV_HullForEntity (edict_t *ent, vec3_t mins, vec3_t maxs, vec3_t
 	{	// create a temp hull from bounding box sizes
 		VectorSubtract (ent->v.mins, maxs, hullmins);
 		VectorSubtract (ent->v.maxs, mins, hullmaxs);
-		hull = SV_HullForBox (hullmins, hullmaxs);
+		hull = SV_HullForBox (hullmins, hullmaxs, box);
 
 		VectorCopy (ent->v.origin, offset);
 	}
@@ -260,6 +270,276 @@ static areanode_t *SV_CreateAreaNode (int depth, vec3_t mins, vec3_t maxs)
 	return anode;
 }
 
+/*
+===============================================================================
+
+EDICT GRID
+
+A coarse hash grid over the bounding box centres of all edicts, used to
+find the candidates for the findradius builtin.  Edicts are marked dirty
+whenever they might have moved: when they are linked or unlinked, when
+they are cleared or parsed, or when progs take the address of their
+origin, mins or maxs.  Dirty edicts are rehashed by the next query, and
+every edict is rehashed on the first query of a server frame to catch
+anything that was changed behind our back.
+
+===============================================================================
+*/
+
+#define	GRID_CELLSIZE	256
+#define	GRID_LIMIT	(1 << 20)	/* cell coordinates are clamped to this */
+#define	GRID_HASHSIZE	512		/* must be a power of two */
+#define	GRID_NOCELL	GRID_HASHSIZE	/* bucket for NaN centres */
+#define	GRID_MAXCELLS	(GRID_HASHSIZE / 4)
+
+static	int		grid_head[GRID_HASHSIZE + 1];
+static	int		grid_next[MAX_EDICTS];
+static	int		grid_prev[MAX_EDICTS];
+static	int		grid_bucket[MAX_EDICTS];	// -1 if not in the grid
+static	int		grid_dirty[MAX_EDICTS];
+static	int		grid_numdirty;
+static	byte		grid_isdirty[MAX_EDICTS];
+static	unsigned int	grid_found[(MAX_EDICTS + 31) / 32];
+static	double		grid_synctime;
+static	double		grid_dirtytime;	// sv.time of the edicts on the dirty list
+
+gridstats_t	sv_gridstats;
+
+/*
+===============
+SV_ClearGrid
+
+===============
+*/
+static void SV_ClearGrid (void)
+{
+	int		i;
+
+	for (i = 0; i <= GRID_HASHSIZE; i++)
+		grid_head[i] = -1;
+	for (i = 0; i < MAX_EDICTS; i++)
+		grid_bucket[i] = -1;
+	memset (grid_isdirty, 0, sizeof(grid_isdirty));
+	grid_numdirty = 0;
+	grid_synctime = -1;
+	grid_dirtytime = -1;
+	memset (&sv_gridstats, 0, sizeof(sv_gridstats));
+}
+
+/*
+===============
+SV_GridCell
+
+===============
+*/
+static int SV_GridCell (double v)
+{
+	v = floor (v / GRID_CELLSIZE);
+	if (v < -GRID_LIMIT)
+		return -GRID_LIMIT;
+	if (v > GRID_LIMIT)
+		return GRID_LIMIT;
+	return (int) v;
+}
+
+static int SV_GridHash (int x, int y)
+{
+	return (int)(((unsigned int)x * 73856093U) ^ ((unsigned int)y * 19349663U)) & (GRID_HASHSIZE - 1);
+}
+
+/*
+===============
+SV_GridBucket
+
+Same centre as PF_findradius uses
+===============
+*/
+static int SV_GridBucket (edict_t *ent)
+{
+	double	c[2];
+	float	f;
+	int		i;
+
+	for (i = 0; i < 2; i++)
+	{
+		c[i] = ent->v.origin[i] + (ent->v.mins[i] + ent->v.maxs[i]) * 0.5;
+		f = (float) c[i];
+		if (IS_NAN(f))
+			return GRID_NOCELL;
+	}
+
+	return SV_GridHash (SV_GridCell(c[0]), SV_GridCell(c[1]));
+}
+
+/*
+===============
+SV_GridUpdate
+
+===============
+*/
+static void SV_GridUpdate (int num)
+{
+	edict_t	*ent;
+	int		bucket;
+
+	ent = EDICT_NUM(num);
+	if (ent->free || num >= sv.num_edicts)
+		bucket = -1;
+	else
+		bucket = SV_GridBucket (ent);
+
+	if (bucket == grid_bucket[num])
+		return;
+
+	if (grid_bucket[num] != -1)
+	{
+		if (grid_prev[num] != -1)
+			grid_next[grid_prev[num]] = grid_next[num];
+		else
+			grid_head[grid_bucket[num]] = grid_next[num];
+		if (grid_next[num] != -1)
+			grid_prev[grid_next[num]] = grid_prev[num];
+	}
+
+	grid_bucket[num] = bucket;
+	if (bucket != -1)
+	{
+		grid_prev[num] = -1;
+		grid_next[num] = grid_head[bucket];
+		if (grid_head[bucket] != -1)
+			grid_prev[grid_head[bucket]] = num;
+		grid_head[bucket] = num;
+	}
+}
+
+/*
+===============
+SV_GridDirty
+
+Called whenever ent might have moved
+===============
+*/
+void SV_GridDirty (edict_t *ent)
+{
+	int		i, num;
+
+	if (grid_dirtytime != sv.time)
+	{	// covered by the full update of the first sync in a frame
+		for (i = 0; i < grid_numdirty; i++)
+			grid_isdirty[grid_dirty[i]] = 0;
+		grid_numdirty = 0;
+		grid_dirtytime = sv.time;
+	}
+
+	num = ((byte *)ent - (byte *)sv.edicts) / pr_edict_size;
+	if (num <= 0 || num >= MAX_EDICTS || grid_isdirty[num])
+		return;
+	grid_isdirty[num] = 1;
+	grid_dirty[grid_numdirty++] = num;
+}
+
+/*
+===============
+SV_GridSync
+
+Dirty edicts stay dirty until the next frame: progs may take the
+address of a field, run a query and only then store to the field.
+===============
+*/
+static void SV_GridSync (void)
+{
+	int		i;
+
+	if (grid_synctime != sv.time)
+	{
+		for (i = 1; i < sv.num_edicts; i++)
+			SV_GridUpdate (i);
+		grid_synctime = sv.time;
+		return;
+	}
+
+	for (i = 0; i < grid_numdirty; i++)
+		SV_GridUpdate (grid_dirty[i]);
+}
+
+/*
+===============
+SV_GridFindRadius
+
+Fills list with the numbers of all edicts whose centre might be within
+rad units of org, in ascending order.  Returns the number of edicts in
+list, or -1 if the caller has to check all of them.
+===============
+*/
+int SV_GridFindRadius (const float *org, float rad, int *list)
+{
+	double	r;
+	int		x, y, x0, y0, x1, y1;
+	int		i, j, num, count;
+	unsigned int	bits;
+
+	sv_gridstats.queries++;
+
+	if (IS_NAN(rad) || IS_NAN(org[0]) || IS_NAN(org[1]))
+	{
+		sv_gridstats.fullscans++;
+		return -1;
+	}
+	// generous margin for the rounding in PF_findradius
+	r = fabs(rad) * 1.001 + 1;
+	x0 = SV_GridCell (org[0] - r);
+	x1 = SV_GridCell (org[0] + r);
+	y0 = SV_GridCell (org[1] - r);
+	y1 = SV_GridCell (org[1] + r);
+	if ((double)(x1 - x0 + 1) * (y1 - y0 + 1) > GRID_MAXCELLS)
+	{
+		sv_gridstats.fullscans++;
+		return -1;
+	}
+
+	SV_GridSync ();
+
+	// several cells may share a bucket, so collect into a bit set
+	memset (grid_found, 0, sizeof(grid_found));
+	for (x = x0; x <= x1; x++)
+	{
+		for (y = y0; y <= y1; y++)
+		{
+			for (num = grid_head[SV_GridHash(x, y)]; num != -1; num = grid_next[num])
+				grid_found[num >> 5] |= 1U << (num & 31);
+		}
+	}
+	for (num = grid_head[GRID_NOCELL]; num != -1; num = grid_next[num])
+		grid_found[num >> 5] |= 1U << (num & 31);
+
+	count = 0;
+	for (i = 0; i < (int)(sizeof(grid_found) / sizeof(grid_found[0])); i++)
+	{
+		for (bits = grid_found[i], j = 0; bits; bits >>= 1, j++)
+		{
+			if (bits & 1)
+				list[count++] = (i << 5) + j;
+		}
+	}
+
+	sv_gridstats.candidates += count;
+	return count;
+}
+
+/*
+===============
+SV_GridStats_f
+
+===============
+*/
+void SV_GridStats_f (void)
+{
+	Con_Printf ("findradius: %d queries, %d full scans\n",
+			sv_gridstats.queries, sv_gridstats.fullscans);
+	Con_Printf ("%.0f candidates examined, %.0f returned\n",
+			sv_gridstats.candidates, sv_gridstats.found);
+}
+
 /*
 ===============
 SV_ClearWorld
@@ -273,6 +553,8 @@ void SV_ClearWorld (void)
 	memset (sv_areanodes, 0, sizeof(sv_areanodes));
 	sv_numareanodes = 0;
 	SV_CreateAreaNode (0, sv.worldmodel->mins, sv.worldmodel->maxs);
+
+	SV_ClearGrid ();
 }
 
 
@@ -287,6 +569,7 @@ static link_t	**sv_link_prev;
 
 void SV_UnlinkEdict (edict_t *ent)
 {
+	SV_GridDirty (ent);
 	if (!ent->area.prev)
 		return;		// not linked in anywhere
 	RemoveLink (&ent->area);
@@ -441,6 +724,8 @@ void SV_LinkEdict (edict_t *ent, qboolean touch_triggers)
 {
 	areanode_t	*node;
 
+	SV_GridDirty (ent);
+
 	if (ent->area.prev)
 		SV_UnlinkEdict (ent);	// unlink from old position
 
@@ -789,7 +1074,8 @@ loc0: // optimized recursion
 		{
 			trace->fraction = midf;
 			VectorCopy (mid, trace->endpos);
-			Con_DPrintf ("backup past 0\n");
+			if (!Thread_InWorker ())
+				Con_DPrintf ("backup past 0\n");
 			return false;
 		}
 		midf = p1f + (p2f - p1f)*frac;
@@ -815,12 +1101,13 @@ Handles selection or creation of a clipping hull, and offseting (and
 eventually rotation) of the end points
 ==================
 */
-static trace_t SV_ClipMoveToEntity (edict_t *ent, vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, edict_t *move_ent)
+static trace_t SV_ClipMoveToEntity (edict_t *ent, vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, edict_t *move_ent, int move_type)
 {
 	trace_t		trace;
 	vec3_t		offset;
 	vec3_t		start_l, end_l;
 	hull_t		*hull;
+	boxhull_t	box;
 
 // fill in a default trace
 	memset (&trace, 0, sizeof(trace_t));
@@ -829,7 +1116,7 @@ static trace_t SV_ClipMoveToEntity (edict_t *ent, vec3_t start, vec3_t mins, vec
 	VectorCopy (end, trace.endpos);
 
 // get the clipping hull
-	hull = SV_HullForEntity (ent, mins, maxs, offset, move_ent);
+	hull = SV_HullForEntity (ent, mins, maxs, offset, move_ent, &box);
 
 	VectorSubtract (start, offset, start_l);
 	VectorSubtract (end, offset, end_l);
@@ -958,9 +1245,9 @@ loc0: // optimized recursion
 		}
 
 		if ((int)touch->v.flags & FL_MONSTER)
-			trace = SV_ClipMoveToEntity (touch, clip->start, clip->mins2, clip->maxs2, clip->end, touch);
+			trace = SV_ClipMoveToEntity (touch, clip->start, clip->mins2, clip->maxs2, clip->end, touch, clip->type);
 		else
-			trace = SV_ClipMoveToEntity (touch, clip->start, clip->mins, clip->maxs, clip->end, touch);
+			trace = SV_ClipMoveToEntity (touch, clip->start, clip->mins, clip->maxs, clip->end, touch, clip->type);
 		if (trace.allsolid || trace.startsolid || trace.fraction < clip->trace.fraction)
 		{
 			trace.ent = touch;
@@ -1029,10 +1316,10 @@ static void SV_MoveBounds (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, v
 
 /*
 ==================
-SV_Move
+SV_ClipMove
 ==================
 */
-trace_t SV_Move (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict)
+static trace_t SV_ClipMove (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict)
 {
 	moveclip_t	clip;
 	int			i;
@@ -1040,9 +1327,8 @@ trace_t SV_Move (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, e
 //	type = MOVE_WATER;
 	memset ( &clip, 0, sizeof ( moveclip_t ) );
 
-	move_type = type;
 // clip to world
-	clip.trace = SV_ClipMoveToEntity ( sv.edicts, start, mins, maxs, end, passedict );
+	clip.trace = SV_ClipMoveToEntity ( sv.edicts, start, mins, maxs, end, passedict, type );
 
 	clip.start = start;
 	clip.end = end;
@@ -1075,3 +1361,297 @@ trace_t SV_Move (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, e
 	return clip.trace;
 }
 
+
+/*
+===============================================================================
+
+SPECULATIVE MOVES
+
+SV_Physics can have the first move of some edicts traced on the worker
+threads before it starts running the edicts, against the world as it
+is at that point.  When the edict gets to make the move, the result is
+only used if the move and everything the trace looked at are still
+the same, otherwise the move is traced again.  Either way it comes out
+just like a serial trace.
+
+===============================================================================
+*/
+
+#define	SPEC_MAXTOUCH	16
+#define	SPEC_BATCH	8	// moves per job
+
+// everything about an edict that the clipping code looks at
+typedef struct
+{
+	float	solid, movetype, modelindex, flags, hull, spawnflags;
+	int		owner;
+	vec3_t	origin, angles, mins, maxs, size, absmin, absmax;
+} clipstate_t;
+
+typedef struct
+{
+	edict_t		*ent;
+	int			type;
+	vec3_t		start, mins, maxs, end;
+	qboolean	valid;
+	trace_t		trace;
+	clipstate_t	self;
+	int			numtouch;
+	edict_t		*touch[SPEC_MAXTOUCH];
+	clipstate_t	touchstate[SPEC_MAXTOUCH];
+} specmove_t;
+
+static	specmove_t	sv_specmoves[MAX_EDICTS];
+static	int		sv_numspecmoves;
+static	int		sv_specmove[MAX_EDICTS];	// specmoves index + 1
+static	clipstate_t	sv_specworld;
+static	qboolean	sv_specactive;
+
+specstats_t	sv_specstats;
+
+static void SV_GetClipState (edict_t *ent, clipstate_t *cs)
+{
+	cs->solid = ent->v.solid;
+	cs->movetype = ent->v.movetype;
+	cs->modelindex = ent->v.modelindex;
+	cs->flags = ent->v.flags;
+	cs->hull = ent->v.hull;
+	cs->spawnflags = ent->v.spawnflags;
+	cs->owner = ent->v.owner;
+	VectorCopy (ent->v.origin, cs->origin);
+	VectorCopy (ent->v.angles, cs->angles);
+	VectorCopy (ent->v.mins, cs->mins);
+	VectorCopy (ent->v.maxs, cs->maxs);
+	VectorCopy (ent->v.size, cs->size);
+	VectorCopy (ent->v.absmin, cs->absmin);
+	VectorCopy (ent->v.absmax, cs->absmax);
+}
+
+static qboolean SV_SameClipState (edict_t *ent, const clipstate_t *cs)
+{
+	clipstate_t	now;
+
+	SV_GetClipState (ent, &now);
+	return !memcmp (&now, cs, sizeof(clipstate_t));
+}
+
+/*
+====================
+SV_AreaTouches
+
+Lists the edicts SV_ClipToLinks would look at for a move with this
+bounding box, in the same order, whether they are solid or not.
+Returns -1 if there are more than max of them.
+====================
+*/
+static int SV_AreaTouches (areanode_t *node, vec3_t boxmins, vec3_t boxmaxs, edict_t *passedict, edict_t **list, int count, int max)
+{
+	link_t		*l;
+	edict_t		*touch;
+
+	while (1)
+	{
+		for (l = node->solid_edicts.next ; l != &node->solid_edicts ; l = l->next)
+		{
+			touch = EDICT_FROM_AREA(l);
+			if (touch == passedict)
+				continue;
+			if (boxmins[0] > touch->v.absmax[0]
+					|| boxmins[1] > touch->v.absmax[1]
+					|| boxmins[2] > touch->v.absmax[2]
+					|| boxmaxs[0] < touch->v.absmin[0]
+					|| boxmaxs[1] < touch->v.absmin[1]
+					|| boxmaxs[2] < touch->v.absmin[2] )
+				continue;
+			if (count == max)
+				return -1;
+			list[count++] = touch;
+		}
+
+		if (node->axis == -1)
+			return count;
+
+		if (boxmaxs[node->axis] > node->dist)
+		{
+			if (boxmins[node->axis] < node->dist)
+			{
+				count = SV_AreaTouches (node->children[1], boxmins, boxmaxs, passedict, list, count, max);
+				if (count < 0)
+					return -1;
+			}
+			node = node->children[0];
+		}
+		else if (boxmins[node->axis] < node->dist)
+			node = node->children[1];
+		else
+			return count;
+	}
+}
+
+static void SV_SpecBounds (specmove_t *spec, vec3_t boxmins, vec3_t boxmaxs)
+{
+	vec3_t	mins2, maxs2;
+
+	if (spec->type == MOVE_MISSILE || spec->type == MOVE_PHASE)
+	{
+		VectorSet (mins2, -15, -15, -15);
+		VectorSet (maxs2, 15, 15, 15);
+		SV_MoveBounds (spec->start, mins2, maxs2, spec->end, boxmins, boxmaxs);
+	}
+	else
+		SV_MoveBounds (spec->start, spec->mins, spec->maxs, spec->end, boxmins, boxmaxs);
+}
+
+static void SV_SpecMoveJob (void *data, int job)
+{
+	specmove_t	*spec;
+	vec3_t		boxmins, boxmaxs;
+	int			i, j, last;
+
+	last = (job + 1) * SPEC_BATCH;
+	if (last > sv_numspecmoves)
+		last = sv_numspecmoves;
+	for (i = job * SPEC_BATCH; i < last; i++)
+	{
+		spec = &sv_specmoves[i];
+		SV_SpecBounds (spec, boxmins, boxmaxs);
+		spec->numtouch = SV_AreaTouches (sv_areanodes, boxmins, boxmaxs, spec->ent,
+						spec->touch, 0, SPEC_MAXTOUCH);
+		if (spec->numtouch < 0)
+			continue;	// too crowded to check later
+		for (j = 0; j < spec->numtouch; j++)
+			SV_GetClipState (spec->touch[j], &spec->touchstate[j]);
+		SV_GetClipState (spec->ent, &spec->self);
+		spec->trace = SV_ClipMove (spec->start, spec->mins, spec->maxs, spec->end, spec->type, spec->ent);
+		spec->valid = true;
+	}
+}
+
+/*
+==================
+SV_AddSpecMove
+
+ent is expected to call SV_Move from its origin to end as its first
+move of the frame
+==================
+*/
+void SV_AddSpecMove (edict_t *ent, vec3_t end, int type)
+{
+	specmove_t	*spec;
+
+	if (sv_numspecmoves == MAX_EDICTS)
+		return;
+	spec = &sv_specmoves[sv_numspecmoves++];
+	spec->ent = ent;
+	spec->type = type;
+	VectorCopy (ent->v.origin, spec->start);
+	VectorCopy (ent->v.mins, spec->mins);
+	VectorCopy (ent->v.maxs, spec->maxs);
+	VectorCopy (end, spec->end);
+	spec->valid = false;
+}
+
+/*
+==================
+SV_RunSpecMoves
+
+Traces the moves given to SV_AddSpecMove and makes them available to
+SV_Move until SV_EndSpecMoves
+==================
+*/
+void SV_RunSpecMoves (void)
+{
+	int		i;
+
+	SV_GetClipState (sv.edicts, &sv_specworld);
+	Thread_RunJobs (SV_SpecMoveJob, NULL, (sv_numspecmoves + SPEC_BATCH - 1) / SPEC_BATCH);
+
+	for (i = 0; i < sv_numspecmoves; i++)
+	{
+		if (sv_specmoves[i].valid)
+			sv_specmove[NUM_FOR_EDICT(sv_specmoves[i].ent)] = i + 1;
+	}
+	sv_specstats.traced += sv_numspecmoves;
+	sv_specactive = true;
+}
+
+void SV_EndSpecMoves (void)
+{
+	int		i;
+
+	for (i = 0; i < sv_numspecmoves; i++)
+		sv_specmove[NUM_FOR_EDICT(sv_specmoves[i].ent)] = 0;
+	sv_numspecmoves = 0;
+	sv_specactive = false;
+}
+
+/*
+==================
+SV_SpecMoveValid
+
+Whether a serial trace of the move would come out as spec->trace
+==================
+*/
+static qboolean SV_SpecMoveValid (specmove_t *spec, vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type)
+{
+	edict_t		*touch[SPEC_MAXTOUCH];
+	vec3_t		boxmins, boxmaxs;
+	int			i, numtouch;
+
+	if (type != spec->type
+			|| memcmp(start, spec->start, sizeof(vec3_t))
+			|| memcmp(end, spec->end, sizeof(vec3_t))
+			|| memcmp(mins, spec->mins, sizeof(vec3_t))
+			|| memcmp(maxs, spec->maxs, sizeof(vec3_t)))
+		return false;
+	if (!SV_SameClipState(spec->ent, &spec->self) || !SV_SameClipState(sv.edicts, &sv_specworld))
+		return false;
+
+	SV_SpecBounds (spec, boxmins, boxmaxs);
+	numtouch = SV_AreaTouches (sv_areanodes, boxmins, boxmaxs, spec->ent, touch, 0, SPEC_MAXTOUCH);
+	if (numtouch != spec->numtouch)
+		return false;
+	for (i = 0; i < numtouch; i++)
+	{
+		if (touch[i] != spec->touch[i] || !SV_SameClipState(touch[i], &spec->touchstate[i]))
+			return false;
+	}
+	return true;
+}
+
+void SV_SpecStats_f (void)
+{
+	Con_Printf ("speculative moves: %.0f traced, %.0f used, %.0f retraced\n",
+			sv_specstats.traced, sv_specstats.used, sv_specstats.retraced);
+}
+
+
+/*
+==================
+SV_Move
+==================
+*/
+trace_t SV_Move (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict)
+{
+	specmove_t	*spec;
+	int			num;
+
+	if (sv_specactive && passedict)
+	{
+		num = NUM_FOR_EDICT(passedict);
+		if (sv_specmove[num])
+		{
+			spec = &sv_specmoves[sv_specmove[num] - 1];
+			sv_specmove[num] = 0;	// only the first move
+			if (SV_SpecMoveValid(spec, start, mins, maxs, end, type))
+			{
+				sv_specstats.used++;
+				return spec->trace;
+			}
+			sv_specstats.retraced++;
+		}
+	}
+
+	return SV_ClipMove (start, mins, maxs, end, type, passedict);
+}
+
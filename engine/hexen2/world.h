@@ -75,6 +75,30 @@ void SV_LinkEdict (edict_t *ent, qboolean touch_triggers);
 // sets ent->v.absmin and ent->v.absmax
 // if touchtriggers, calls prog functions for the intersected triggers
 
+typedef struct
+{
+	int		queries;
+	int		fullscans;	// queries which had to check every edict
+	double	candidates;	// edicts examined by findradius
+	double	found;		// edicts returned by findradius
+} gridstats_t;
+
+extern	gridstats_t	sv_gridstats;
+
+void SV_GridDirty (edict_t *ent);
+// call whenever ent might have moved without being relinked
+
+// progs took the address of origin, mins or maxs
+#define	SV_GRID_FIELD(ofs)						\
+	((unsigned int)((ofs) - (int)(offsetof(entvars_t, origin) / 4)) < 3 ||	\
+	 (unsigned int)((ofs) - (int)(offsetof(entvars_t, mins) / 4)) < 6)
+
+int SV_GridFindRadius (const float *org, float rad, int *list);
+// fills list with the edicts whose centre might be within rad units of
+// org, in ascending order.  returns -1 if all edicts have to be checked
+
+void SV_GridStats_f (void);
+
 int SV_PointContents (vec3_t p);
 #ifdef QUAKE2
 int SV_TruePointContents (vec3_t p);
@@ -98,6 +122,27 @@ trace_t SV_Move (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, e
 
 // passedict is explicitly excluded from clipping checks (normally NULL)
 
+typedef struct
+{
+	double	traced;		// moves traced ahead on the workers
+	double	used;		// of those, results SV_Move could use
+	double	retraced;	// ... and ones that had to be traced again
+} specstats_t;
+
+extern	specstats_t	sv_specstats;
+
+void SV_AddSpecMove (edict_t *ent, vec3_t end, int type);
+// ent's first SV_Move this frame is expected to go from its origin to
+// end, so trace it ahead of time
+
+void SV_RunSpecMoves (void);
+// traces the added moves on the worker threads.  SV_Move returns the
+// results as long as nothing they depend on has changed
+
+void SV_EndSpecMoves (void);
+
+void SV_SpecStats_f (void);
+
 
 ASM_LINKAGE_BEGIN
 #if id386
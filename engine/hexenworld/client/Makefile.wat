@@ -409,6 +409,7 @@ SOFTOBJS = &
 	d_zpoint.obj &
 	r_aclip.obj &
 	r_alias.obj &
+	r_avert.obj &
 	r_bsp.obj &
 	r_draw.obj &
 	r_edge.obj &
@@ -489,6 +490,7 @@ COMMONOBJS = &
 	pmovetst.obj &
 	zone.obj &
 	hashindex.obj &
+	threads.obj &
 	$(SYSOBJ_SYS)
 
 all: $(BUILD_TARGET)
@@ -462,6 +462,9 @@ static void CL_FinishTimeDemo (void)
 	if (!time)
 		time = 1;
 	Con_Printf ("%i frames %5.1f seconds %5.1f fps\n", frames, time, frames/time);
+#if !defined(GLQUAKE)
+	R_TimeBandsDone ();
+#endif
 }
 
 /*
@@ -224,16 +224,39 @@ static void ShowNetParseDelta(int x)
 	Con_Printf("\n");
 }
 
+/*
+==================
+CL_ParseEntityNumber
+
+Returns the entity number of a packetentities update, reading
+the escaped number that follows the flags word if the server
+uses the 'e' capability.
+==================
+*/
+static int CL_ParseEntityNumber (int word)
+{
+	int	num;
+
+	num = word & U_ENTNUM_MASK;
+	if (cl.entext && num == U_ENTNUM_ESCAPE)
+	{
+		num = (unsigned short)MSG_ReadShort ();
+		if (num >= MAX_EDICTS)
+			Host_EndGame ("%s: bad entity number %i", __thisfunc__, num);
+	}
+	return num;
+}
+
 static int	bitcounts[32];	/// just for protocol profiling
-static void CL_ParseDelta (entity_state_t *from, entity_state_t *to, int bits)
+static void CL_ParseDelta (entity_state_t *from, entity_state_t *to, int number, int bits)
 {
 	int	i;
 
 	// set everything to the state we are delta'ing from
 	*to = *from;
 
-	to->number = bits & 511;
-	bits &= ~511;
+	to->number = number;
+	bits &= ~U_ENTNUM_MASK;
 
 	if (bits & U_MOREBITS)
 	{	// read in the low order bits
@@ -327,7 +350,7 @@ static void FlushEntityPacket (void)
 		if (!word)
 			break;	// done
 
-		CL_ParseDelta (&olde, &newe, word);
+		CL_ParseDelta (&olde, &newe, CL_ParseEntityNumber (word), word);
 	}
 }
 
@@ -409,7 +432,7 @@ void CL_ParsePacketEntities (qboolean delta)
 			}
 			break;
 		}
-		newnum = word & 511;
+		newnum = CL_ParseEntityNumber (word);
 		oldnum = oldindex >= oldp->num_entities ? 9999 : oldp->entities[oldindex].number;
 
 		while (newnum > oldnum)
@@ -447,7 +470,7 @@ void CL_ParsePacketEntities (qboolean delta)
 			}
 			if (newindex >= MAX_PACKET_ENTITIES)
 				Host_EndGame ("%s: newindex == MAX_PACKET_ENTITIES", __thisfunc__);
-			CL_ParseDelta (&cl_baselines[newnum], &newp->entities[newindex], word);
+			CL_ParseDelta (&cl_baselines[newnum], &newp->entities[newindex], newnum, word);
 			newindex++;
 			continue;
 		}
@@ -465,7 +488,7 @@ void CL_ParsePacketEntities (qboolean delta)
 				continue;
 			}
 			//Con_Printf ("delta %i\n",newnum);
-			CL_ParseDelta (&oldp->entities[oldindex], &newp->entities[newindex], word);
+			CL_ParseDelta (&oldp->entities[oldindex], &newp->entities[newindex], newnum, word);
 			newindex++;
 			oldindex++;
 		}
@@ -690,6 +713,7 @@ static void CL_LinkPacketEntities (void)
 		cl_numvisedicts++;
 
 		ent->keynum = s1->number;
+		ent->lerp = &cl_entlerps[s1->number];
 		ent->model = model = cl.model_precache[s1->modelindex];
 
 		ent->sourcecolormap = vid.colormap;
@@ -1079,6 +1103,7 @@ static void CL_LinkProjectiles (void)
 		ent = &cl_visedicts[cl_numvisedicts];
 		cl_numvisedicts++;
 		ent->keynum = 0;
+		ent->lerp = NULL;
 
 		if (pr->modelindex < 1)
 			continue;
@@ -1182,6 +1207,7 @@ static void CL_LinkMissiles (void)
 		}
 		cl_numvisedicts++;
 		ent->keynum = 0;
+		ent->lerp = NULL;
 
 		if (pr->type == 1)
 		{	//ball
@@ -1475,6 +1501,7 @@ static void CL_LinkPlayers (void)
 			break;		// object list is full
 		ent = &cl_visedicts[cl_numvisedicts];
 		ent->keynum = 0;
+		ent->lerp = &cl_entlerps[j + 1];
 
 		ent->model = cl.model_precache[state->modelindex];
 		ent->skinnum = state->skinnum;
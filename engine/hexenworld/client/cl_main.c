@@ -80,8 +80,10 @@ client_static_t	cls;
 client_state_t	cl;
 
 entity_state_t	cl_baselines[MAX_EDICTS];
+static entity_state_t	cl_packet_states[UPDATE_BACKUP][MAX_PACKET_ENTITIES];
 efrag_t		cl_efrags[MAX_EFRAGS];
 entity_t	cl_static_entities[MAX_STATIC_ENTITIES];
+entlerp_t	cl_entlerps[MAX_EDICTS];	// by entity number, 0 for the view model
 lightstyle_t	cl_lightstyle[MAX_LIGHTSTYLES];
 dlight_t	cl_dlights[MAX_DLIGHTS];
 
@@ -341,6 +343,12 @@ void CL_ClearState (void)
 
 // wipe the entire cl structure
 	memset (&cl, 0, sizeof(cl));
+	for (i = 0; i < UPDATE_BACKUP; i++)
+	{
+		cl.frames[i].packet_entities.entities = cl_packet_states[i];
+		cl.frames[i].packet_entities.max_entities = MAX_PACKET_ENTITIES;
+	}
+	CL_ClearPrediction ();
 
 	SZ_Clear (&cls.netchan.message);
 
@@ -348,6 +356,7 @@ void CL_ClearState (void)
 	memset (cl_efrags, 0, sizeof(cl_efrags));
 	memset (cl_dlights, 0, sizeof(cl_dlights));
 	memset (cl_lightstyle, 0, sizeof(cl_lightstyle));
+	memset (cl_entlerps, 0, sizeof(cl_entlerps));
 
 //
 // allocate the efrags and chain together into a free list
@@ -415,6 +424,7 @@ void CL_Disconnect (void)
 
 		cls.demoplayback = cls.demorecording = cls.timedemo = false;
 	}
+	HuffResetTables ();
 	Cam_Reset();
 	cl.intermission = 0;
 }
@@ -571,6 +581,8 @@ static void CL_FullServerinfo_f (void)
 			server_version = v;
 		}
 	}
+
+	cl.entext = (strchr(Info_ValueForKey(cl.serverinfo, "*cap"), 'e') != NULL);
 }
 
 /*
@@ -1017,7 +1029,11 @@ void CL_Init (void)
 
 	// capabilities info (single char flags) -- adapted from QuakeForge:
 	// c: chunked connection sequence for sound/modellists (protocol 26)
-	Info_SetValueForStarKey (cls.userinfo, "*cap", "c", MAX_INFO_STRING);
+	// e: escaped entity numbers up to MAX_EDICTS, MAX_PACKET_ENTITIES
+	//    per frame.  only used if the serverinfo *cap has it, too.
+	// h: takes the huffman tables the server trains on its traffic
+	//    (svc_hufftable) and acknowledges them with "hufftable".
+	Info_SetValueForStarKey (cls.userinfo, "*cap", "ceh", MAX_INFO_STRING);
 
 	CL_InitInput ();
 	CL_InitTEnts ();
@@ -1329,6 +1345,10 @@ void Host_Frame (float time)
 	if (host_speeds.integer)
 		time2 = Sys_DoubleTime ();
 
+	// move the particles on, after drawing them as they were
+	if (cls.state == ca_active)
+		R_UpdateParticles ();
+
 	// update audio
 	BGM_Update();	// adds music raw samples and/or advances midi driver
 	if (cls.state == ca_active)
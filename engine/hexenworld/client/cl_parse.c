@@ -24,6 +24,7 @@
 #include "bgmusic.h"
 #include "cdaudio.h"
 #include "r_shared.h"
+#include "huffman.h"
 
 static const char *svc_strings[] =
 {
@@ -120,7 +121,8 @@ static const char *svc_strings[] =
 	"svc_nonehaskey",	// [byte]
 	"svc_isdoc",		// [byte] [byte]
 	"svc_nodoc",		// [byte]
-	"svc_playerskipped"	// [byte]
+	"svc_playerskipped",	// [byte]
+	"svc_hufftable",	// [byte] [short]*256
 	"NEW PROTOCOL",
 	"NEW PROTOCOL",
 	"NEW PROTOCOL",
@@ -845,10 +847,10 @@ static void CL_ParseStartSoundPacket(void)
 	for (i = 0; i < 3; i++)
 		pos[i] = MSG_ReadCoord ();
 
-	ent = (channel>>3)&1023;
+	ent = (channel>>3)&2047;
 	channel &= 7;
 
-	if (ent > MAX_EDICTS)
+	if (ent >= MAX_EDICTS)
 		Host_EndGame ("%s: ent = %i", __thisfunc__, ent);
 
 	S_StartSound (ent, channel, cl.sound_precache[sound_num], pos, volume/255.0, attenuation);
@@ -1114,6 +1116,34 @@ static void CL_ParticleExplosion(void)
 	R_ColoredParticleExplosion(org,color,radius,counter);
 }
 
+/*
+==================
+CL_ParseHuffTable
+
+the server trained a huffman table on its traffic (the 'h'
+capability): install it, code our packets with it and tell
+the server it can do the same.
+==================
+*/
+static void CL_ParseHuffTable (void)
+{
+	unsigned short	counts[256];
+	int		i, generation;
+
+	generation = MSG_ReadByte ();
+	for (i = 0; i < 256; i++)
+		counts[i] = (unsigned short) MSG_ReadShort ();
+	if (generation < 1)
+		Host_EndGame ("%s: bad generation %d", __thisfunc__, generation);
+
+	HuffSetTable (generation, counts);
+	if (cls.demoplayback)
+		return;
+	cls.netchan.huffgen = generation;
+	MSG_WriteByte (&cls.netchan.message, clc_stringcmd);
+	MSG_WriteString (&cls.netchan.message, va("hufftable %d", generation));
+}
+
 
 #if 0	/* for debugging. from fteqw. */
 static void CL_DumpPacket (void)
@@ -1303,7 +1333,7 @@ void CL_ParseServerMessage (void)
 			ent_num = channel >> 3;
 			channel &= 7;
 
-			if (ent_num > MAX_EDICTS)
+			if (ent_num >= MAX_EDICTS)
 				Host_Error ("svc_sound_update_pos: ent = %i", ent_num);
 
 			for (i = 0; i < 3; i++)
@@ -1404,6 +1434,8 @@ void CL_ParseServerMessage (void)
 
 		case svc_spawnbaseline:
 			i = MSG_ReadShort ();
+			if (i < 0 || i >= MAX_EDICTS)
+				Host_EndGame ("svc_spawnbaseline: ent = %i", i);
 			CL_ParseBaseline (&cl_baselines[i]);
 			break;
 		case svc_spawnstatic:
@@ -1508,6 +1540,10 @@ void CL_ParseServerMessage (void)
 			CL_SavePlayer ();
 			break;
 
+		case svc_hufftable:
+			CL_ParseHuffTable ();
+			break;
+
 		case svc_nails:
 			CL_ParseProjectiles ();
 			break;
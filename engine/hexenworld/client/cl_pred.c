@@ -27,10 +27,113 @@
 
 static	cvar_t	cl_nopred = {"cl_nopred", "0", CVAR_NONE};
 static	cvar_t	cl_pushlatency = {"pushlatency", "-50", CVAR_ARCHIVE};
+static	cvar_t	cl_predcache = {"cl_predcache", "1", CVAR_NONE};
 
 extern	frame_t		*view_frame;
 static	qboolean player_crouching;
 
+/*
+The moves predicted for the unacknowledged frames stay right for as
+long as nothing they started from changes: the acknowledged frame,
+the physents and the few player values pmove reads.  While that holds,
+CL_PredictMove only simulates the commands it hasn't done yet, instead
+of all of them on every rendered frame.
+*/
+typedef struct
+{
+	int		sequence;	// the acknowledged frame predicted from
+	int		numphysent;
+	physent_t	physents[MAX_PHYSENTS];
+	movevars_t	movevars;
+	qboolean	dead, crouching, spectator, teleported;
+	float		hasted, movetype;
+	float		teleport_time;
+} predkey_t;
+
+static	predkey_t	pred_key;
+static	int		pred_valid;	// frames up to this one are predicted
+
+// commands predicted and actually simulated, for predstats
+static	int		pred_cmds, pred_simulated;
+static	int		pred_lastcmds, pred_lastsimulated;
+static	double		pred_stattime;
+
+static qboolean CL_SamePhysents (const physent_t *a, const physent_t *b, int num)
+{
+	for ( ; num > 0; num--, a++, b++)
+	{
+		if (a->model != b->model || !VectorCompare(a->origin, b->origin))
+			return false;
+		if (a->model)
+		{
+			if (!VectorCompare(a->angles, b->angles))
+				return false;
+		}
+		else if (!VectorCompare(a->mins, b->mins) || !VectorCompare(a->maxs, b->maxs))
+			return false;
+	}
+	return true;
+}
+
+/*
+==============
+CL_CheckPredictionKey
+
+Forgets the predicted frames if anything they depend on changed.
+==============
+*/
+static void CL_CheckPredictionKey (void)
+{
+	predkey_t	*k = &pred_key;
+
+	if (cl_predcache.integer &&
+		k->sequence == cls.netchan.incoming_sequence &&
+		k->numphysent == pmove.numphysent &&
+		CL_SamePhysents (k->physents, pmove.physents, pmove.numphysent) &&
+		!memcmp (&k->movevars, &movevars, sizeof(movevars_t)) &&
+		k->dead == (cl.v.health <= 0) &&
+		k->crouching == player_crouching &&
+		k->spectator == cl.spectator &&
+		k->teleported == (cl.v.teleport_time < realtime) &&
+		k->hasted == cl.v.hasted &&
+		k->movetype == cl.v.movetype &&
+		k->teleport_time == cl.v.teleport_time)
+		return;
+
+	k->sequence = cls.netchan.incoming_sequence;
+	k->numphysent = pmove.numphysent;
+	memcpy (k->physents, pmove.physents, pmove.numphysent * sizeof(physent_t));
+	k->movevars = movevars;
+	k->dead = (cl.v.health <= 0);
+	k->crouching = player_crouching;
+	k->spectator = cl.spectator;
+	k->teleported = (cl.v.teleport_time < realtime);
+	k->hasted = cl.v.hasted;
+	k->movetype = cl.v.movetype;
+	k->teleport_time = cl.v.teleport_time;
+	pred_valid = cls.netchan.incoming_sequence;
+}
+
+/*
+==============
+CL_ClearPrediction
+
+Called with the cl structure wiped: nothing predicted is left.
+==============
+*/
+void CL_ClearPrediction (void)
+{
+	memset (&pred_key, 0, sizeof(pred_key));
+	pred_key.sequence = -1;
+	pred_valid = 0;
+}
+
+static void CL_PredStats_f (void)
+{
+	Con_Printf ("last second: %d commands predicted, %d simulated\n",
+			pred_lastcmds, pred_lastsimulated);
+}
+
 #if 0	/* not used */
 /*
 =================
@@ -173,15 +276,30 @@ void CL_PredictMove (void)
 	// predict forward until cl.time <= to->senttime
 	oldphysent = pmove.numphysent;
 	CL_SetSolidPlayers (cl.playernum);
+	CL_CheckPredictionKey ();
+
+	if (realtime - pred_stattime >= 1.0)
+	{
+		pred_lastcmds = pred_cmds;
+		pred_lastsimulated = pred_simulated;
+		pred_cmds = pred_simulated = 0;
+		pred_stattime = realtime;
+	}
 
 //	to = &cl.frames[cls.netchan.incoming_sequence & UPDATE_MASK];
 
 	for (i = 1; i < UPDATE_BACKUP-1 && cls.netchan.incoming_sequence + i < cls.netchan.outgoing_sequence; i++)
 	{
 		to = &cl.frames[(cls.netchan.incoming_sequence+i) & UPDATE_MASK];
-		CL_PredictUsercmd (&from->playerstate[cl.playernum],
-					&to->playerstate[cl.playernum],
-					&to->cmd, cl.spectator);
+		pred_cmds++;
+		if (cls.netchan.incoming_sequence + i > pred_valid)
+		{	// not done yet: the earlier frames are, so from is right
+			CL_PredictUsercmd (&from->playerstate[cl.playernum],
+						&to->playerstate[cl.playernum],
+						&to->cmd, cl.spectator);
+			pred_valid = cls.netchan.incoming_sequence + i;
+			pred_simulated++;
+		}
 
 		if (to->senttime >= cl.time)
 			break;
@@ -246,5 +364,9 @@ void CL_InitPrediction (void)
 {
 	Cvar_RegisterVariable (&cl_pushlatency);
 	Cvar_RegisterVariable (&cl_nopred);
+	Cvar_RegisterVariable (&cl_predcache);
+	Cmd_AddCommand ("predstats", CL_PredStats_f);
+
+	CL_ClearPrediction ();
 }
 
@@ -225,6 +225,7 @@ typedef struct
 							// first frame
 
 	int		protocol;
+	qboolean	entext;		// server accepted our 'e' capability
 	int		spectator;
 
 	double		last_ping_request;	// while showing scoreboard
@@ -410,6 +411,7 @@ extern	client_state_t	cl;
 extern	entity_state_t	cl_baselines[MAX_EDICTS];
 extern	efrag_t		cl_efrags[MAX_EFRAGS];
 extern	entity_t	cl_static_entities[MAX_STATIC_ENTITIES];
+extern	entlerp_t	cl_entlerps[MAX_EDICTS];
 extern	lightstyle_t	cl_lightstyle[MAX_LIGHTSTYLES];
 extern	dlight_t	cl_dlights[MAX_DLIGHTS];
 
@@ -572,6 +574,7 @@ void CL_SavePlayer (void);
 // cl_pred.c
 //
 void CL_InitPrediction (void);
+void CL_ClearPrediction (void);
 void CL_PredictMove (void);
 void CL_PredictUsercmd (player_state_t *from, player_state_t *to, usercmd_t *u, qboolean spectate);
 
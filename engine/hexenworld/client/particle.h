@@ -90,7 +90,6 @@ typedef struct particle_s
 	vec3_t		org;
 	float		color;
 /* drivers never touch the following fields */
-	struct particle_s	*next;
 	vec3_t		vel;
 	float		ramp;
 	float		die;
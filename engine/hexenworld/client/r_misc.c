@@ -670,6 +670,7 @@ void R_SetupFrame (void)
 
 	R_SetUpFrustumIndexes ();
 
+	D_AdaptCaches ();
 	r_cache_thrash = false;
 
 // clear frame counts
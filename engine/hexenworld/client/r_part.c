@@ -47,9 +47,57 @@ static int ramp13[16] ={ 144, 145, 146, 147, 148, 149, 150, 151, 152, 153, 154,
 
 //=============================================================================
 
-particle_t	*active_particles, *free_particles;
-particle_t	*particles;
-static int	r_numparticles;
+/*
+===============================================================================
+
+PARTICLE STORE
+
+Live particles are kept apart by type, each type as a structure of arrays,
+so R_UpdateParticles can run the rules of a type over plain float arrays
+instead of chasing a list and switching on every particle.  The spawning
+code still fills in the particle_t that AllocParticle hands out; it is
+moved into the arrays of its type when the next one is asked for, or
+before the particles are updated or drawn.  The arrays of a type grow as
+needed, up to r_numparticles live particles in all.
+
+===============================================================================
+*/
+
+#define	NUM_PTYPES		(pt_bluestep + 1)
+#define	PGROUP_MINSIZE		64	// first allocation for a type
+#define	PDEPTH_BATCH		256	// particles depth tested at a time
+
+#ifdef GLQUAKE
+#define	PCULL_Z			4	// NEARCLIP in gl_rmain.c
+#else
+#define	PCULL_Z			PARTICLE_Z_CLIP	// as D_DrawParticle ()
+#endif
+
+// float arrays of a type
+enum
+{
+	PF_ORG,				// x, y, z
+	PF_VEL = PF_ORG + 3,		// x, y, z
+	PF_COLOR = PF_VEL + 3,
+	PF_RAMP,
+	PF_DIE,
+	PF_NUMFLOATS
+};
+
+typedef struct
+{
+	int		num, max;
+	float		*f[PF_NUMFLOATS];	// f[0] starts the allocation
+} pgroup_t;
+
+static pgroup_t		pgroups[NUM_PTYPES];
+static int		r_numparticles;	// most live particles at once
+static int		r_numactive;	// live particles, newparticle included
+static particle_t	newparticle;	// being filled in by a spawner
+static qboolean		newpending;
+
+particlestats_t		r_partstats;
+static particlestats_t	r_partframe;	// counted since the last frame
 
 vec3_t		r_pright, r_pup, r_ppn;
 static	vec3_t	rider_origin;
@@ -88,8 +136,6 @@ void R_InitParticles (void)
 		r_numparticles = MAX_PARTICLES;
 	}
 
-	particles = (particle_t *) Hunk_AllocName (r_numparticles * sizeof(particle_t), "particles");
-
 	Cvar_RegisterVariable (&leak_color);
 }
 
@@ -137,6 +183,265 @@ void R_DarkFieldParticles (entity_t *ent)
 }
 
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define	PART_SIMD
+typedef __m128		pvec_t;
+#define	PV_SET1(x)	_mm_set1_ps (x)
+#define	PV_LOAD(p)	_mm_loadu_ps (p)
+#define	PV_STORE(p,a)	_mm_storeu_ps (p, a)
+#define	PV_ADD(a,b)	_mm_add_ps (a, b)
+#define	PV_SUB(a,b)	_mm_sub_ps (a, b)
+#define	PV_MUL(a,b)	_mm_mul_ps (a, b)
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define	PART_SIMD
+typedef float32x4_t	pvec_t;
+#define	PV_SET1(x)	vdupq_n_f32 (x)
+#define	PV_LOAD(p)	vld1q_f32 (p)
+#define	PV_STORE(p,a)	vst1q_f32 (p, a)
+#define	PV_ADD(a,b)	vaddq_f32 (a, b)
+#define	PV_SUB(a,b)	vsubq_f32 (a, b)
+#define	PV_MUL(a,b)	vmulq_f32 (a, b)
+#endif
+
+/*
+===============
+R_PartAxpy
+
+y[i] += x[i] * a for n floats, x may be y
+===============
+*/
+static void R_PartAxpy (float *y, const float *x, float a, int n)
+{
+	int		i;
+#ifdef PART_SIMD
+	pvec_t		va;
+
+	va = PV_SET1 (a);
+	for (i = 0 ; i + 4 <= n ; i += 4)
+		PV_STORE (y + i, PV_ADD (PV_LOAD (y + i), PV_MUL (PV_LOAD (x + i), va)));
+#else
+	i = 0;
+#endif
+	for ( ; i < n ; i++)
+		y[i] += x[i] * a;
+}
+
+/*
+===============
+R_PartAdd
+
+y[i] += a for n floats
+===============
+*/
+static void R_PartAdd (float *y, float a, int n)
+{
+	int		i;
+#ifdef PART_SIMD
+	pvec_t		va;
+
+	va = PV_SET1 (a);
+	for (i = 0 ; i + 4 <= n ; i += 4)
+		PV_STORE (y + i, PV_ADD (PV_LOAD (y + i), va));
+#else
+	i = 0;
+#endif
+	for ( ; i < n ; i++)
+		y[i] += a;
+}
+
+/*
+===============
+R_PartScale
+
+y[i] *= a for n floats
+===============
+*/
+static void R_PartScale (float *y, float a, int n)
+{
+	int		i;
+#ifdef PART_SIMD
+	pvec_t		va;
+
+	va = PV_SET1 (a);
+	for (i = 0 ; i + 4 <= n ; i += 4)
+		PV_STORE (y + i, PV_MUL (PV_LOAD (y + i), va));
+#else
+	i = 0;
+#endif
+	for ( ; i < n ; i++)
+		y[i] *= a;
+}
+
+/*
+===============
+R_PartDepths
+
+Distance in front of the view of particles first to first+n-1 of a type
+===============
+*/
+static void R_PartDepths (const pgroup_t *g, int first, int n, float *depth)
+{
+	const float	*x, *y, *z;
+	int		i;
+#ifdef PART_SIMD
+	pvec_t		ox, oy, oz, nx, ny, nz;
+
+	ox = PV_SET1 (r_origin[0]);
+	oy = PV_SET1 (r_origin[1]);
+	oz = PV_SET1 (r_origin[2]);
+	nx = PV_SET1 (vpn[0]);
+	ny = PV_SET1 (vpn[1]);
+	nz = PV_SET1 (vpn[2]);
+#endif
+
+	x = g->f[PF_ORG + 0] + first;
+	y = g->f[PF_ORG + 1] + first;
+	z = g->f[PF_ORG + 2] + first;
+#ifdef PART_SIMD
+	for (i = 0 ; i + 4 <= n ; i += 4)
+	{
+		PV_STORE (depth + i, PV_ADD (PV_ADD (
+				PV_MUL (PV_SUB (PV_LOAD (x + i), ox), nx),
+				PV_MUL (PV_SUB (PV_LOAD (y + i), oy), ny)),
+				PV_MUL (PV_SUB (PV_LOAD (z + i), oz), nz)));
+	}
+#else
+	i = 0;
+#endif
+	for ( ; i < n ; i++)
+	{
+		depth[i] = (x[i] - r_origin[0]) * vpn[0] +
+			   (y[i] - r_origin[1]) * vpn[1] +
+			   (z[i] - r_origin[2]) * vpn[2];
+	}
+}
+
+/*
+===============
+R_GrowParticleGroup
+
+Doubles the arrays of a type, false if out of memory
+===============
+*/
+static qboolean R_GrowParticleGroup (pgroup_t *g)
+{
+	byte		*mem, *old;
+	int		k, newmax;
+
+	newmax = (g->max) ? g->max * 2 : PGROUP_MINSIZE;
+	mem = (byte *) malloc (newmax * PF_NUMFLOATS * sizeof(float));
+	if (!mem)
+		return false;
+
+	old = (byte *) g->f[0];
+	for (k = 0 ; k < PF_NUMFLOATS ; k++)
+	{
+		if (g->num)
+			memcpy (mem, g->f[k], g->num * sizeof(float));
+		g->f[k] = (float *) mem;
+		mem += newmax * sizeof(float);
+	}
+	free (old);
+
+	g->max = newmax;
+	return true;
+}
+
+/*
+===============
+R_CommitParticle
+
+Moves the particle a spawner has filled in into the arrays of its type
+===============
+*/
+static void R_CommitParticle (void)
+{
+	pgroup_t	*g;
+	int		i, k;
+
+	if (!newpending)
+		return;
+	newpending = false;
+
+	// types the update doesn't know just move, like pt_static
+	g = &pgroups[((unsigned int)newparticle.type < NUM_PTYPES) ? newparticle.type : pt_static];
+	if (g->num == g->max && !R_GrowParticleGroup (g))
+	{
+		r_numactive--;
+		r_partframe.spawned--;
+		r_partframe.dropped++;
+		return;
+	}
+
+	i = g->num++;
+	for (k = 0 ; k < 3 ; k++)
+	{
+		g->f[PF_ORG + k][i] = newparticle.org[k];
+		g->f[PF_VEL + k][i] = newparticle.vel[k];
+	}
+	g->f[PF_COLOR][i] = newparticle.color;
+	g->f[PF_RAMP][i] = newparticle.ramp;
+	g->f[PF_DIE][i] = newparticle.die;
+}
+
+/*
+===============
+R_KillParticles
+
+Drops the particles of a type whose time is up, keeping the others in order
+===============
+*/
+static void R_KillParticles (pgroup_t *g)
+{
+	const float	*die;
+	int		i, j, k;
+
+	die = g->f[PF_DIE];
+	for (i = 0 ; i < g->num && die[i] >= cl.time ; i++)
+		;
+
+	for (j = i ; i < g->num ; i++)
+	{
+		if (die[i] < cl.time)
+			continue;
+		for (k = 0 ; k < PF_NUMFLOATS ; k++)
+			g->f[k][j] = g->f[k][i];
+		j++;
+	}
+
+	r_numactive -= g->num - j;
+	g->num = j;
+}
+
+/*
+===============
+R_PartRamp
+
+Steps the particles of a type through a color ramp, killing those that
+run off its first len entries
+===============
+*/
+static void R_PartRamp (pgroup_t *g, float step, const int *table, int len, int base)
+{
+	float		*ramp, *color, *die;
+	int		i;
+
+	ramp = g->f[PF_RAMP];
+	color = g->f[PF_COLOR];
+	die = g->f[PF_DIE];
+
+	R_PartAdd (ramp, step, g->num);
+	for (i = 0 ; i < g->num ; i++)
+	{
+		if ((int)ramp[i] >= len)
+			die[i] = -1;
+		else
+			color[i] = table[(int)ramp[i]] + base;
+	}
+}
+
 /*
 ===============
 AllocParticle
@@ -144,17 +449,20 @@ AllocParticle
 */
 static particle_t *AllocParticle (void)
 {
-	particle_t	*p;
+	R_CommitParticle ();
 
-	if (!free_particles)
+	if (r_numactive >= r_numparticles)
+	{
+		r_partframe.dropped++;
 		return NULL;
+	}
 
-	p = free_particles;
-	free_particles = p->next;
-	p->next = active_particles;
-	active_particles = p;
+	r_numactive++;
+	r_partframe.spawned++;
+	newpending = true;
+	memset (&newparticle, 0, sizeof(particle_t));
 
-	return p;
+	return &newparticle;
 }
 
 /*
@@ -166,14 +474,10 @@ void R_ClearParticles (void)
 {
 	int		i;
 
-	if (!r_numparticles)
-		return;
-	free_particles = &particles[0];
-	active_particles = NULL;
-
-	for (i = 0; i < r_numparticles-1; i++)
-		particles[i].next = &particles[i+1];
-	particles[r_numparticles-1].next = NULL;
+	for (i = 0; i < NUM_PTYPES; i++)
+		pgroups[i].num = 0;
+	newpending = false;
+	r_numactive = 0;
 }
 
 
@@ -1551,6 +1855,30 @@ void R_ColoredParticleExplosion (vec3_t org, int color, int radius, int counter)
 }
 
 
+/*
+===============
+R_CullParticle
+
+True if particle k of a type, at depth in front of the view, can't be seen.
+Rain is drawn as a trail along its velocity, so both ends have to be out.
+===============
+*/
+static qboolean R_CullParticle (const pgroup_t *g, int type, int k, float depth)
+{
+	if (depth >= PCULL_Z)
+		return false;
+	if (type == pt_rain)
+	{
+		depth += .004 * (g->f[PF_VEL + 0][k] * vpn[0] +
+				 g->f[PF_VEL + 1][k] * vpn[1] +
+				 g->f[PF_VEL + 2][k] * vpn[2]);
+		if (depth >= PCULL_Z)
+			return false;
+	}
+	r_partframe.culled++;
+	return true;
+}
+
 #ifdef GLQUAKE
 static qboolean		alphaTestEnabled;
 static vec3_t		up, right;
@@ -1628,41 +1956,25 @@ static void R_RenderParticle (particle_t *p)
 
 /*
 ===============
-R_DrawParticles
+R_UpdateParticles
+
+Moves the particles on by a frame.  Called once a frame by Host_Frame,
+not by R_DrawParticles, which may run more than once for a frame.
 ===============
 */
-void R_DrawParticles (void)
+void R_UpdateParticles (void)
 {
-	particle_t	*p, *kill, temp_p;
+	pgroup_t	*g;
+	float		*org[3], *vel[3], *color, *ramp, *die;
 	float		grav, grav2, percent;
-	int		i;
+	int		t, i, k, n, colindex;
 	float		time2, time3, time4;
 	float		time1;
 	float		dvel;
 	float		frametime;
-	float		vel0, vel1, vel2;
+	float		f;
 	vec3_t		diff;
 
-#ifdef GLQUAKE
-	GL_Bind(particletexture);
-	alphaTestEnabled = glIsEnabled_fp(GL_ALPHA_TEST);
-
-	if (alphaTestEnabled)
-		glDisable_fp(GL_ALPHA_TEST);
-	glEnable_fp (GL_BLEND);
-	glTexEnvf_fp(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
-	glBegin_fp (GL_TRIANGLES);
-
-	VectorScale (vup, 1.5, up);
-	VectorScale (vright, 1.5, right);
-#else
-	D_StartParticles ();
-
-	VectorScale (vright, xscaleshrink, r_pright);
-	VectorScale (vup, yscaleshrink, r_pup);
-	VectorCopy (vpn, r_ppn);
-#endif
-
 	frametime = host_frametime;
 	time4 = frametime * 20;
 	time3 = frametime * 15;
@@ -1673,327 +1985,361 @@ void R_DrawParticles (void)
 	dvel = 4 * frametime;
 	percent = (frametime / HX_FRAME_TIME);
 
-	/*
-	temp_p.org[0] = -1013;
-	temp_p.org[1] = -1863;
-	temp_p.org[2] = 50;
-	temp_p.color = 31;
-	R_RenderParticle(&temp_p);
-	*/
-	for ( ;; )
+	for (t = 0 ; t < NUM_PTYPES ; t++)
 	{
-		kill = active_particles;
-		if (kill && kill->die < cl.time)
-		{
-			active_particles = kill->next;
-			kill->next = free_particles;
-			free_particles = kill;
+		g = &pgroups[t];
+		n = g->num;
+		if (!n)
 			continue;
-		}
-		break;
-	}
-
-	for (p = active_particles ; p ; p = p->next)
-	{
-		for ( ;; )
-		{
-			kill = p->next;
-			if (kill && kill->die < cl.time)
-			{
-				p->next = kill->next;
-				kill->next = free_particles;
-				free_particles = kill;
-				continue;
-			}
-			break;
-		}
 
-		if (p->type == pt_rain)
+		for (k = 0 ; k < 3 ; k++)
 		{
-			temp_p = *p;
-
-			vel0 = temp_p.vel[0]*.001;
-			vel1 = temp_p.vel[1]*.001;
-			vel2 = temp_p.vel[2]*.001;
-			for (i = 0; i < 4; i++)
-			{
-				R_RenderParticle(&temp_p);
-
-				temp_p.org[0] += vel0;
-				temp_p.org[1] += vel1;
-				temp_p.org[2] += vel2;
- 			}
+			org[k] = g->f[PF_ORG + k];
+			vel[k] = g->f[PF_VEL + k];
+			R_PartAxpy (org[k], vel[k], frametime, n);
 		}
+		color = g->f[PF_COLOR];
+		ramp = g->f[PF_RAMP];
+		die = g->f[PF_DIE];
 
-		R_RenderParticle(p);
-		p->org[0] += p->vel[0] * frametime;
-		p->org[1] += p->vel[1] * frametime;
-		p->org[2] += p->vel[2] * frametime;
-
-		switch (p->type)
+		switch (t)
 		{
 		case pt_static:
+		case pt_rain:
 			break;
 
 		case pt_fire:
-			p->ramp += time1;
-			if ((int)p->ramp >= 6)
-				p->die = -1;
-			else
-				p->color = ramp3[(int)p->ramp];
-			p->vel[2] += grav;
+			R_PartRamp (g, time1, ramp3, 6, 0);
+			R_PartAdd (vel[2], grav, n);
 			break;
 
 		case pt_explode:
-			p->ramp += time2;
-			if ((int)p->ramp >= 8)
-				p->die = -1;
-			else
-				p->color = ramp1[(int)p->ramp];
-			for (i = 0; i < 3; i++)
-				p->vel[i] += p->vel[i]*dvel;
-			p->vel[2] -= grav;
+			R_PartRamp (g, time2, ramp1, 8, 0);
+			for (k = 0 ; k < 3 ; k++)
+				R_PartAxpy (vel[k], vel[k], dvel, n);
+			R_PartAdd (vel[2], -grav, n);
 			break;
 
 		case pt_explode2:
-			p->ramp += time3;
-			if ((int)p->ramp >= 8)
-				p->die = -1;
-			else
-				p->color = ramp2[(int)p->ramp];
-			for (i = 0; i < 3; i++)
-				p->vel[i] -= p->vel[i] * frametime;
-			p->vel[2] -= grav;
+			R_PartRamp (g, time3, ramp2, 8, 0);
+			for (k = 0 ; k < 3 ; k++)
+				R_PartAxpy (vel[k], vel[k], -frametime, n);
+			R_PartAdd (vel[2], -grav, n);
 			break;
 
 		case pt_c_explode:
-			p->ramp += time2;
-			if ((int)p->ramp >= 8 || p->color <= 0)
-				p->die = -1;
-			else if (time2)
-				p->color--;
-			for (i = 0; i < 3; i++)
-				p->vel[i] += p->vel[i]*dvel;
-			p->vel[2] -= grav;
+			R_PartAdd (ramp, time2, n);
+			for (i = 0 ; i < n ; i++)
+			{
+				if ((int)ramp[i] >= 8 || color[i] <= 0)
+					die[i] = -1;
+				else if (time2)
+					color[i]--;
+			}
+			for (k = 0 ; k < 3 ; k++)
+				R_PartAxpy (vel[k], vel[k], dvel, n);
+			R_PartAdd (vel[2], -grav, n);
 			break;
 
 		case pt_c_explode2:
-			p->ramp += time3;
-			if ((int)p->ramp >= 8 || p->color <= 1)
-				p->die = -1;
-			else if (time3)
-				p->color -= 2;
-			for (i = 0; i < 3; i++)
-				p->vel[i] -= p->vel[i] * frametime;
-			p->vel[2] -= grav;
+			R_PartAdd (ramp, time3, n);
+			for (i = 0 ; i < n ; i++)
+			{
+				if ((int)ramp[i] >= 8 || color[i] <= 1)
+					die[i] = -1;
+				else if (time3)
+					color[i] -= 2;
+			}
+			for (k = 0 ; k < 3 ; k++)
+				R_PartAxpy (vel[k], vel[k], -frametime, n);
+			R_PartAdd (vel[2], -grav, n);
 			break;
 
 		case pt_blob:
-			for (i = 0; i < 3; i++)
-				p->vel[i] += p->vel[i]*dvel;
-			p->vel[2] -= grav;
+			for (k = 0 ; k < 3 ; k++)
+				R_PartAxpy (vel[k], vel[k], dvel, n);
+			R_PartAdd (vel[2], -grav, n);
 			break;
 
 		case pt_blob2:
-			for (i = 0; i < 2; i++)
-				p->vel[i] -= p->vel[i]*dvel;
-			p->vel[2] -= grav;
+			for (k = 0 ; k < 2 ; k++)
+				R_PartAxpy (vel[k], vel[k], -dvel, n);
+			R_PartAdd (vel[2], -grav, n);
 			break;
 
 		case pt_grav:
 #ifdef QUAKE2
-			p->vel[2] -= grav * 20;
+			R_PartAdd (vel[2], -grav * 20, n);
 			break;
 #endif
 		case pt_slowgrav:
-			p->vel[2] -= grav;
+			R_PartAdd (vel[2], -grav, n);
 			break;
 
 		case pt_grensmoke:
-			p->vel[0] += time3 * ((rand() % 3) - 1);
-			p->vel[1] += time3 * ((rand() % 3) - 1);
-			p->vel[2] += time3 * ((rand() % 3) - 1);
+			for (i = 0 ; i < n ; i++)
+			{
+				vel[0][i] += time3 * ((rand() % 3) - 1);
+				vel[1][i] += time3 * ((rand() % 3) - 1);
+				vel[2][i] += time3 * ((rand() % 3) - 1);
+			}
 			break;
 
 		case pt_fastgrav:
-			p->vel[2] -= grav * 4;
-			break;
-
-		case pt_rain:
+			R_PartAdd (vel[2], -grav * 4, n);
 			break;
 
 		case pt_fireball:
-			p->ramp += time3;
-			if ((int)p->ramp >= 16)
-				p->die = -1;
-			else
-				p->color = ramp4[(int)p->ramp];
+			R_PartRamp (g, time3, ramp4, 16, 0);
 			break;
 
 		case pt_acidball:
-			p->ramp += time4 * 1.4;
-			if ((int)p->ramp >= 23)
-				p->die = -1;
-			else if ((int)p->ramp >= 15)
-				p->color = ramp11[(int)p->ramp - 15];
-			else
-				p->color = ramp10[(int)p->ramp];
-			p->vel[2] -= grav;
+			R_PartAdd (ramp, time4 * 1.4, n);
+			for (i = 0 ; i < n ; i++)
+			{
+				if ((int)ramp[i] >= 23)
+					die[i] = -1;
+				else if ((int)ramp[i] >= 15)
+					color[i] = ramp11[(int)ramp[i] - 15];
+				else
+					color[i] = ramp10[(int)ramp[i]];
+			}
+			R_PartAdd (vel[2], -grav, n);
 			break;
 
 		case pt_spit:
-			p->ramp += time3;
-			if ((int)p->ramp >= 16)
-				p->die = -1;
-			else
-				p->color = ramp6[(int)p->ramp];
-		//	p->vel[2] += grav * 2;
+			R_PartRamp (g, time3, ramp6, 16, 0);
 			break;
 
 		case pt_ice:
-			p->ramp += time4;
-			if ((int)p->ramp > 15)
-				p->die = -1;
-			else
-				p->color = ramp5[(int)p->ramp];
-			p->vel[2] -= grav;
+			R_PartRamp (g, time4, ramp5, 16, 0);
+			R_PartAdd (vel[2], -grav, n);
 			break;
 
 		case pt_spell:
-			p->ramp += time2;
-			if ((int)p->ramp >= 16)
-				p->die = -1;
-			else
-				p->color = ramp7[(int)p->ramp];
-		//	p->vel[2] += grav * 2;
+			R_PartRamp (g, time2, ramp7, 16, 0);
 			break;
 
 		case pt_test:
-			p->vel[2] += 1.3;
-			p->ramp += time3;
-			if ((int)p->ramp >= 13 || ((int)p->ramp > 10 && p->vel[2] < 20) )
-				p->die = -1;
-			else
-				p->color = ramp8[(int)p->ramp];
+			R_PartAdd (vel[2], 1.3, n);
+			R_PartAdd (ramp, time3, n);
+			for (i = 0 ; i < n ; i++)
+			{
+				if ((int)ramp[i] >= 13 || ((int)ramp[i] > 10 && vel[2][i] < 20) )
+					die[i] = -1;
+				else
+					color[i] = ramp8[(int)ramp[i]];
+			}
 			break;
 
 		case pt_quake:
-			p->vel[0] *= 1.05;
-			p->vel[1] *= 1.05;
-			p->vel[2] -= grav * 4;
-			if (p->color < 160 && p->color > 143)
-				p->color = 152 + 7 * ((p->die - cl.time) * 2.0);
-			if (p->color < 144 && p->color > 127)
-				p->color = 136 + 7 * ((p->die - cl.time) * 2.0);
+			R_PartScale (vel[0], 1.05, n);
+			R_PartScale (vel[1], 1.05, n);
+			R_PartAdd (vel[2], -grav * 4, n);
+			for (i = 0 ; i < n ; i++)
+			{
+				if (color[i] < 160 && color[i] > 143)
+					color[i] = 152 + 7 * ((die[i] - cl.time) * 2.0);
+				if (color[i] < 144 && color[i] > 127)
+					color[i] = 136 + 7 * ((die[i] - cl.time) * 2.0);
+			}
 			break;
 
 		case pt_rd:
 			if (!frametime)
 				break;
 
-			p->ramp += percent;
-			if ((int)p->ramp > 50)
+			R_PartAdd (ramp, percent, n);
+			for (i = 0 ; i < n ; i++)
 			{
-				p->ramp = 50;
-				p->die = -1;
-			}
-			p->color = 256 + 16 + 16 - (p->ramp / (50/16));
-
-			VectorSubtract(rider_origin, p->org, diff);
-
-			/*
-			p->org[0] += diff[0] * p->ramp / 80;
-			p->org[1] += diff[1] * p->ramp / 80;
-			p->org[2] += diff[2] * p->ramp / 80;
-			*/
-			vel0 = 1 / (51 - p->ramp);
-			p->org[0] += diff[0] * vel0;
-			p->org[1] += diff[1] * vel0;
-			p->org[2] += diff[2] * vel0;
+				if ((int)ramp[i] > 50)
+				{
+					ramp[i] = 50;
+					die[i] = -1;
+				}
+				color[i] = 256 + 16 + 16 - (ramp[i] / (50/16));
 
+				f = 1 / (51 - ramp[i]);
+				for (k = 0 ; k < 3 ; k++)
+				{
+					diff[k] = rider_origin[k] - org[k][i];
+					org[k][i] += diff[k] * f;
+				}
+			}
 			break;
 
 		case pt_vorpal:
-			--p->color;
-			if ((int)p->color <= 37 + 256)
-				p->die = -1;
+			R_PartAdd (color, -1, n);
+			for (i = 0 ; i < n ; i++)
+			{
+				if ((int)color[i] <= 37 + 256)
+					die[i] = -1;
+			}
 			break;
 
 		case pt_setstaff:
-			p->ramp += time1;
-			if ((int)p->ramp >= 16)
-				p->die = -1;
-			else
-				p->color = ramp9[(int)p->ramp];
-
-			p->vel[0] *= 1.08 * percent;
-			p->vel[1] *= 1.08 * percent;
-			p->vel[2] -= grav2;
+			R_PartRamp (g, time1, ramp9, 16, 0);
+			R_PartScale (vel[0], 1.08 * percent, n);
+			R_PartScale (vel[1], 1.08 * percent, n);
+			R_PartAdd (vel[2], -grav2, n);
 			break;
 
 		case pt_redfire:
-			p->ramp += frametime * 3;
-			if ((int)p->ramp >= 8)
-				p->die = -1;
-			else
-				p->color = ramp12[(int)p->ramp] + 256;
-
-			p->vel[0] *= .9;
-			p->vel[1] *= .9;
-			p->vel[2] += grav/2;
+			R_PartRamp (g, frametime * 3, ramp12, 8, 256);
+			R_PartScale (vel[0], .9, n);
+			R_PartScale (vel[1], .9, n);
+			R_PartAdd (vel[2], grav/2, n);
 			break;
 
 		case pt_bluestep:
-			p->ramp += frametime * 8;
-			if ((int)p->ramp >= 16)
-				p->die = -1;
-			else
-				p->color = ramp13[(int)p->ramp] + 256;
-
-			p->vel[0] *= .9;
-			p->vel[1] *= .9;
-			p->vel[2] += grav;
+			R_PartRamp (g, frametime * 8, ramp13, 16, 256);
+			R_PartScale (vel[0], .9, n);
+			R_PartScale (vel[1], .9, n);
+			R_PartAdd (vel[2], grav, n);
 			break;
 
 		case pt_magicmissile:
-			--p->color;
-			if ((int)p->color < 149)
-				p->color = 149;
-			p->ramp += time1;
-			if ((int)p->ramp > 16)
-				p->die = -1;
+			R_PartAdd (color, -1, n);
+			R_PartAdd (ramp, time1, n);
+			for (i = 0 ; i < n ; i++)
+			{
+				if ((int)color[i] < 149)
+					color[i] = 149;
+				if ((int)ramp[i] > 16)
+					die[i] = -1;
+			}
 			break;
 
 		case pt_boneshard:
-			--p->color;
-			if ((int)p->color < 368)
-				p->die = -1;
+			R_PartAdd (color, -1, n);
+			for (i = 0 ; i < n ; i++)
+			{
+				if ((int)color[i] < 368)
+					die[i] = -1;
+			}
 			break;
 
 		case pt_scarab:
-			--p->color;
-			if ((int)p->color < 250)
-				p->die = -1;
+			R_PartAdd (color, -1, n);
+			for (i = 0 ; i < n ; i++)
+			{
+				if ((int)color[i] < 250)
+					die[i] = -1;
+			}
 			break;
 
 		case pt_darken:
-		    {
-			int	colindex;
-			p->vel[2] -= grav * 2;	// Also gravity
-			if (rand() & 1)
-				--p->color;
-			colindex = 0;
-			while (colindex < 224)
+			R_PartAdd (vel[2], -grav * 2, n);	// Also gravity
+			for (i = 0 ; i < n ; i++)
 			{
-				if (colindex == 192 || colindex == 200)
-					colindex += 8;
-				else
-					colindex += 16;
-				if (p->color == colindex)
-					p->die = -1;
+				if (rand() & 1)
+					--color[i];
+				colindex = 0;
+				while (colindex < 224)
+				{
+					if (colindex == 192 || colindex == 200)
+						colindex += 8;
+					else
+						colindex += 16;
+					if (color[i] == colindex)
+						die[i] = -1;
+				}
+			}
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	r_partstats.active = r_numactive;
+}
+
+/*
+===============
+R_DrawParticles
+
+Draws the particles, then moves them on by a frame
+===============
+*/
+void R_DrawParticles (void)
+{
+	pgroup_t	*g;
+	particle_t	dp;	// what R_RenderParticle () looks at
+	int		t, i, j, k, n, m;
+	float		depth[PDEPTH_BATCH];
+	float		vel0, vel1, vel2;
+
+	R_CommitParticle ();
+	r_partstats = r_partframe;
+	memset (&r_partframe, 0, sizeof(r_partframe));
+
+#ifdef GLQUAKE
+	GL_Bind(particletexture);
+	alphaTestEnabled = glIsEnabled_fp(GL_ALPHA_TEST);
+
+	if (alphaTestEnabled)
+		glDisable_fp(GL_ALPHA_TEST);
+	glEnable_fp (GL_BLEND);
+	glTexEnvf_fp(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+	glBegin_fp (GL_TRIANGLES);
+
+	VectorScale (vup, 1.5, up);
+	VectorScale (vright, 1.5, right);
+#else
+	D_StartParticles ();
+
+	VectorScale (vright, xscaleshrink, r_pright);
+	VectorScale (vup, yscaleshrink, r_pup);
+	VectorCopy (vpn, r_ppn);
+#endif
+
+	memset (&dp, 0, sizeof(dp));
+
+	for (t = 0 ; t < NUM_PTYPES ; t++)
+	{
+		g = &pgroups[t];
+		R_KillParticles (g);
+
+		dp.type = (ptype_t) t;
+		for (i = 0 ; i < g->num ; i += PDEPTH_BATCH)
+		{
+			n = q_min(g->num - i, PDEPTH_BATCH);
+			R_PartDepths (g, i, n, depth);
+
+			for (j = 0 ; j < n ; j++)
+			{
+				k = i + j;
+				if (R_CullParticle (g, t, k, depth[j]))
+					continue;
+
+				dp.color = g->f[PF_COLOR][k];
+				dp.ramp = g->f[PF_RAMP][k];
+
+				if (t == pt_rain)
+				{
+					dp.org[0] = g->f[PF_ORG + 0][k];
+					dp.org[1] = g->f[PF_ORG + 1][k];
+					dp.org[2] = g->f[PF_ORG + 2][k];
+
+					vel0 = g->f[PF_VEL + 0][k]*.001;
+					vel1 = g->f[PF_VEL + 1][k]*.001;
+					vel2 = g->f[PF_VEL + 2][k]*.001;
+					for (m = 0; m < 4; m++)
+					{
+						R_RenderParticle(&dp);
+
+						dp.org[0] += vel0;
+						dp.org[1] += vel1;
+						dp.org[2] += vel2;
+					}
+				}
+
+				dp.org[0] = g->f[PF_ORG + 0][k];
+				dp.org[1] = g->f[PF_ORG + 1][k];
+				dp.org[2] = g->f[PF_ORG + 2][k];
+				R_RenderParticle(&dp);
 			}
-		    }
-		    break;
 		}
 	}
 
@@ -2007,4 +2353,3 @@ void R_DrawParticles (void)
 	D_EndParticles ();
 #endif
 }
-
@@ -23,6 +23,7 @@
 #define __R_PART_H
 
 void R_DrawParticles (void);
+void R_UpdateParticles (void);
 void R_InitParticles (void);
 void R_ClearParticles (void);
 
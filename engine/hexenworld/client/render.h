@@ -37,6 +37,13 @@ typedef struct efrag_s
 } efrag_t;
 
 
+typedef struct
+{
+	struct qmodel_s		*model;		// model the frames belong to
+	int			frames[2];	// frame blended from, current frame
+	double			start;		// time the current frame came in
+} entlerp_t;
+
 typedef struct entity_s
 {
 	int			keynum;		// for matching entities in different frames
@@ -51,6 +58,8 @@ typedef struct entity_s
 	int			scale;		// for Alias models
 	int			drawflags;	// for Alias models
 	int			abslight;	// for Alias models
+	entlerp_t		*lerp;		// for Alias model pose blending,
+						// NULL = none
 
 	struct player_info_s	*scoreboard;	// identify player
 
@@ -149,6 +158,8 @@ void R_DrawName (vec3_t origin, const char *name, int siegestatus);
 
 void R_PushDlights (void);
 
+void R_TimeBandsDone (void);	// software renderer: called when a timedemo ends
+
 void R_AddEfrags (entity_t *ent);
 void R_RemoveEfrags (entity_t *ent);
 
@@ -159,10 +170,34 @@ void R_RemoveEfrags (entity_t *ent);
 extern	qboolean	r_cache_thrash;
 				// set if thrashing the surface cache
 
+typedef struct
+{
+	int		hits;		// lookups last frame that found a valid entry
+	int		misses;		// ..that had to build one
+	int		evictions;	// entries thrown out to make room
+	int		size;		// current cache size, in bytes
+} surfcachestats_t;
+
+extern	surfcachestats_t	d_cachestats;	// software renderer only
+
+//
+// particles
+//
+typedef struct
+{
+	int		active;		// particles alive after the last update
+	int		spawned;	// added since the update before
+	int		dropped;	// turned away for want of room
+	int		culled;		// skipped last frame, behind the view
+} particlestats_t;
+
+extern	particlestats_t		r_partstats;
+
 int  D_SurfaceCacheForRes (int width, int height);
 void D_FlushCaches (void);
 void D_DeleteSurfaceCache (void);
 void D_InitCaches (void *buffer, int size);
+void D_AdaptCaches (void);	// grows a thrashing cache, once a frame
 void R_SetVrect (vrect_t *pvrect, vrect_t *pvrectin, int lineadj);
 
 #endif	/* RENDER_H_ */
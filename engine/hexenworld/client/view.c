@@ -1014,6 +1014,7 @@ static void V_CalcRefdef (void)
 	else
 		view->model = cl.model_precache[cl.stats[STAT_WEAPON]];
 	view->frame = view_message->weaponframe;
+	view->lerp = &cl_entlerps[0];	// the world never needs its own
 	if (!view->colorshade)
 	{
 		view->colormap = vid.colormap;
@@ -115,6 +115,7 @@ OBJECTS = &
 	mathlib.obj &
 	zone.obj &
 	hashindex.obj &
+	threads.obj &
 	huffman.obj &
 	net_udp.obj &
 	net_chan.obj &
@@ -117,7 +117,7 @@ typedef struct
 	// reply
 	double			senttime;
 	float			ping_time;
-	packet_entities_t	entities;
+	packet_entities_t	entities;	// grown on demand, see SV_FreePacketEntities
 } client_frame_t;
 
 typedef struct client_s
@@ -125,6 +125,10 @@ typedef struct client_s
 	client_state_t	state;
 
 	int		protocol;
+	qboolean	entext;		// 'e' capability: escaped entity numbers,
+					// MAX_PACKET_ENTITIES per frame
+	qboolean	hufftables;	// 'h' capability: takes svc_hufftable
+	int		huffsent;	// generation of the last svc_hufftable, 0 for none
 
 	int		spectator;	// non-interactive
 
@@ -421,6 +425,10 @@ void SV_SendServerinfo (client_t *client);
 void SV_ExtractFromUserinfo (client_t *cl);
 
 
+extern	int	sv_huffgen;
+void SV_InitHuffTable (void);
+void SV_WriteHuffTable (client_t *cl);
+
 void Master_Heartbeat (void);
 void Master_Packet (void);
 
@@ -449,7 +457,9 @@ void SV_SetMoveVars (void);
 // sv_send.c
 //
 extern unsigned int	clients_multicast;
+extern	cvar_t	sv_sendthreads;
 
+void SV_SendThreads_f (cvar_t *var);
 void SV_SendClientMessages (void);
 
 void SV_Multicast (vec3_t origin, int to);
@@ -473,6 +483,8 @@ void SV_FindModelNumbers (void);
 //
 void SV_ExecuteClientMessage (client_t *cl);
 void SV_UserInit (void);
+void SV_PmoveRecord_f (void);
+void SV_PmoveBench_f (void);
 
 //
 // svonly.c
@@ -495,7 +507,14 @@ void SV_EndRedirect (void);
 //
 // sv_ents.c
 //
-void SV_WriteEntitiesToClient (client_t *client, sizebuf_t *msg);
+#define	MAX_SEND_JOBS	8	// workspaces for building datagrams at once
+
+void SV_InitFatPVS (void);
+void SV_PVSStats_f (void);
+void SV_PrepareSendWork (int numjobs);
+void SV_CheckSendWork (int numjobs);
+void SV_FreePacketEntities (client_t *client);
+void SV_WriteEntitiesToClient (client_t *client, sizebuf_t *msg, int job);
 void SV_WriteInventory (client_t *host_cl, edict_t *ent, sizebuf_t *msg);
 
 //
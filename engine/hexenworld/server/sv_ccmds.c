@@ -921,5 +921,8 @@ void SV_InitOperatorCommands (void)
 	Cmd_AddCommand ("sv_gamedir", SV_Gamedir);
 	Cmd_AddCommand ("floodprot", SV_Floodprot_f);
 	Cmd_AddCommand ("floodprotmsg", SV_Floodprotmsg_f);
+	Cmd_AddCommand ("pvsstats", SV_PVSStats_f);
+	Cmd_AddCommand ("pmrecord", SV_PmoveRecord_f);
+	Cmd_AddCommand ("pmbench", SV_PmoveBench_f);
 }
 
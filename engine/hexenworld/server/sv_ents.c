@@ -29,16 +29,185 @@ or other small motion on the client side.  Otherwise, a bob might cause an
 entity that should be visible to not show up, especially when the bob
 crosses a waterline.
 
+The rows come from the decompressed sv.pvs built by SV_CalcPHS and are
+or'ed a word at a time.  Most clients touch the same few leafs frame after
+frame, and clients near each other touch the same ones, so the fat PVS is
+memoized by the list of leafs it is made of.  The list is in tree order,
+so the same set of leafs always gives the same list.
+
 =============================================================================
 */
 
-static int	fatbytes;
-static byte	fatpvs[MAX_MAP_LEAFS/8];
+#define	MAX_FAT_LEAFS	32	// bigger fat PVSes are built directly
+#define	FAT_MEMO_SETS	32
+#define	FAT_MEMO_WAYS	4
+
+#define	MAX_MISSILES	32
+
+typedef struct
+{
+	int		numleafs;	// -1 if unused
+	int		leafs[MAX_FAT_LEAFS];
+	unsigned int	used;
+	unsigned int	*pvs;
+} fatmemo_t;
+
+typedef struct
+{
+	int	start, end;	// the encoded update in entbuf
+	int	oldindex;	// -1 for a new entity
+	int	newindex;	// -1 for a remove
+	float	priority;	// lower ones are kept first
+	qboolean	keep;
+} entupdate_t;
+
+typedef struct
+{
+	int	num;
+	float	dist;
+} entcand_t;
+
+/*
+Everything SV_WriteEntitiesToClient works with besides the client itself
+lives in a workspace, so that SV_SendClientMessages can build several
+clients' datagrams at once, one workspace per send job.
+*/
+typedef struct
+{
+	fatmemo_t	memo[FAT_MEMO_SETS][FAT_MEMO_WAYS];
+	unsigned int	*memorows;	// NULL until first used on a map
+	unsigned int	clock;
+	int		leafs[MAX_FAT_LEAFS];
+	int		numleafs;
+	qboolean	direct;	// or the rows into fatpvs right away
+	unsigned int	fatpvs[MAX_MAP_LEAFS/32 + 1];
+	double		hits, misses, single, overflows;
+
+	edict_t		*missiles[MAX_MISSILES];
+	edict_t		*ravens[MAX_MISSILES];
+	edict_t		*raven2s[MAX_MISSILES];
+	int		nummissiles, numravens, numraven2s;
+
+	entupdate_t	entupdates[MAX_PACKET_ENTITIES * 2];
+	entupdate_t	*entorder[MAX_PACKET_ENTITIES * 2];
+	byte		entbuf[MAX_PACKET_ENTITIES * 40];
+	entcand_t	entcands[MAX_EDICTS];
+	float		entdist[MAX_PACKET_ENTITIES];
+
+	char		error[MAX_QPATH + 64];	// for SV_Error after the job
+} sendwork_t;
+
+static	sendwork_t	*sv_sendwork[MAX_SEND_JOBS];
+
+/*
+=============
+SV_InitFatPVS
 
-static void SV_AddToFatPVS (vec3_t org, mnode_t *node)
+Called after SV_CalcPHS, throws away the memos of the last map.
+=============
+*/
+void SV_InitFatPVS (void)
 {
 	int		i;
-	byte	*pvs;
+
+	for (i = 0; i < MAX_SEND_JOBS; i++)
+	{
+		if (sv_sendwork[i])
+		{
+			free (sv_sendwork[i]->memorows);
+			sv_sendwork[i]->memorows = NULL;
+		}
+	}
+}
+
+/*
+=============
+SV_PrepareSendWork
+
+Sets up the workspaces of numjobs send jobs.  Main thread only.
+=============
+*/
+void SV_PrepareSendWork (int numjobs)
+{
+	sendwork_t	*w;
+	int		i, j, k, rowwords;
+
+	rowwords = (sv.worldmodel->numleafs + 31) >> 5;
+	for (k = 0; k < numjobs; k++)
+	{
+		w = sv_sendwork[k];
+		if (!w)
+		{
+			w = sv_sendwork[k] = (sendwork_t *) calloc (1, sizeof(sendwork_t));
+			if (!w)
+				Sys_Error ("%s: couldn't allocate workspace", __thisfunc__);
+		}
+		if (w->memorows)
+			continue;
+		w->memorows = (unsigned int *) malloc (FAT_MEMO_SETS * FAT_MEMO_WAYS * rowwords * 4);
+		if (!w->memorows)
+			Sys_Error ("%s: couldn't allocate fat PVS memo", __thisfunc__);
+		for (i = 0; i < FAT_MEMO_SETS; i++)
+		{
+			for (j = 0; j < FAT_MEMO_WAYS; j++)
+			{
+				w->memo[i][j].numleafs = -1;
+				w->memo[i][j].used = 0;
+				w->memo[i][j].pvs = w->memorows + (i * FAT_MEMO_WAYS + j) * rowwords;
+			}
+		}
+		w->clock = 0;
+	}
+}
+
+/*
+=============
+SV_CheckSendWork
+
+Jobs can't call SV_Error, so they leave it for this.  Main thread only.
+=============
+*/
+void SV_CheckSendWork (int numjobs)
+{
+	char	error[sizeof(sv_sendwork[0]->error)];
+	int	i;
+
+	for (i = 0; i < numjobs; i++)
+	{
+		if (sv_sendwork[i]->error[0])
+		{
+			q_strlcpy (error, sv_sendwork[i]->error, sizeof(error));
+			sv_sendwork[i]->error[0] = 0;
+			SV_Error ("%s", error);
+		}
+	}
+}
+
+static void SV_SendWorkError (sendwork_t *w, const char *fmt, ...)
+{
+	va_list		argptr;
+
+	if (w->error[0])
+		return;
+	va_start (argptr, fmt);
+	q_vsnprintf (w->error, sizeof(w->error), fmt, argptr);
+	va_end (argptr);
+}
+
+static void SV_OrPVSRow (unsigned int *dest, int leafnum)
+{
+	unsigned int	*src;
+	int		i, rowwords;
+
+	rowwords = (sv.worldmodel->numleafs + 31) >> 5;
+	src = (unsigned int *)sv.pvs + leafnum * rowwords;
+	for (i = 0; i < rowwords; i++)
+		dest[i] |= src[i];
+}
+
+static void SV_AddToFatPVS (sendwork_t *w, vec3_t org, mnode_t *node)
+{
+	int		leafnum;
 	mplane_t	*plane;
 	float	d;
 
@@ -49,9 +218,13 @@ static void SV_AddToFatPVS (vec3_t org, mnode_t *node)
 		{
 			if (node->contents != CONTENTS_SOLID)
 			{
-				pvs = Mod_LeafPVS ( (mleaf_t *)node, sv.worldmodel);
-				for (i = 0; i < fatbytes; i++)
-					fatpvs[i] |= pvs[i];
+				leafnum = (mleaf_t *)node - sv.worldmodel->leafs;
+				if (w->direct)
+					SV_OrPVSRow (w->fatpvs, leafnum);
+				else if (w->numleafs < MAX_FAT_LEAFS)
+					w->leafs[w->numleafs++] = leafnum;
+				else
+					w->numleafs = MAX_FAT_LEAFS + 1;
 			}
 			return;
 		}
@@ -64,7 +237,7 @@ static void SV_AddToFatPVS (vec3_t org, mnode_t *node)
 			node = node->children[1];
 		else
 		{	// go down both
-			SV_AddToFatPVS (org, node->children[0]);
+			SV_AddToFatPVS (w, org, node->children[0]);
 			node = node->children[1];
 		}
 	}
@@ -75,18 +248,83 @@ static void SV_AddToFatPVS (vec3_t org, mnode_t *node)
 SV_FatPVS
 
 Calculates a PVS that is the inclusive or of all leafs within 8 pixels of the
-given point.
+given point.  The result must not be written to.
 =============
 */
-static byte *SV_FatPVS (vec3_t org)
+static byte *SV_FatPVS (sendwork_t *w, vec3_t org)
 {
-	fatbytes = (sv.worldmodel->numleafs+31)>>3;
-	memset (fatpvs, 0, fatbytes);
-	SV_AddToFatPVS (org, sv.worldmodel->nodes);
-	return fatpvs;
+	fatmemo_t	*set, *memo;
+	unsigned int	hash;
+	int		i, rowwords;
+
+	rowwords = (sv.worldmodel->numleafs + 31) >> 5;
+	w->numleafs = 0;
+	w->direct = false;
+	SV_AddToFatPVS (w, org, sv.worldmodel->nodes);
+
+	if (w->numleafs > MAX_FAT_LEAFS)
+	{
+		w->overflows++;
+		memset (w->fatpvs, 0, rowwords * 4);
+		w->direct = true;
+		SV_AddToFatPVS (w, org, sv.worldmodel->nodes);
+		return (byte *)w->fatpvs;
+	}
+	if (w->numleafs == 1)
+	{	// nothing to or together
+		w->single++;
+		return sv.pvs + w->leafs[0] * rowwords * 4;
+	}
+
+	hash = w->numleafs;
+	for (i = 0; i < w->numleafs; i++)
+		hash = hash * 31 + w->leafs[i];
+	set = w->memo[(hash ^ (hash >> 5)) & (FAT_MEMO_SETS - 1)];
+
+	w->clock++;
+	memo = &set[0];
+	for (i = 0; i < FAT_MEMO_WAYS; i++)
+	{
+		if (set[i].numleafs == w->numleafs &&
+		    !memcmp(set[i].leafs, w->leafs, w->numleafs * sizeof(int)))
+		{
+			w->hits++;
+			set[i].used = w->clock;
+			return (byte *)set[i].pvs;
+		}
+		if (set[i].used < memo->used)
+			memo = &set[i];
+	}
+
+	w->misses++;
+	memo->numleafs = w->numleafs;
+	memcpy (memo->leafs, w->leafs, w->numleafs * sizeof(int));
+	memo->used = w->clock;
+	memset (memo->pvs, 0, rowwords * 4);
+	for (i = 0; i < w->numleafs; i++)
+		SV_OrPVSRow (memo->pvs, w->leafs[i]);
+	return (byte *)memo->pvs;
+}
+
+void SV_PVSStats_f (void)
+{
+	double	hits = 0, misses = 0, single = 0, overflows = 0;
+	int	i, numwork = 0;
+
+	for (i = 0; i < MAX_SEND_JOBS; i++)
+	{
+		if (!sv_sendwork[i])
+			continue;
+		hits += sv_sendwork[i]->hits;
+		misses += sv_sendwork[i]->misses;
+		single += sv_sendwork[i]->single;
+		overflows += sv_sendwork[i]->overflows;
+		numwork++;
+	}
+	Con_Printf ("fat pvs: %.0f memo hits, %.0f misses, %.0f single leaf, %.0f built directly, %i workspaces\n",
+			hits, misses, single, overflows, numwork);
 }
 
-//=============================================================================
 /*
 // because there can be a lot of nails, there is a special
 // network protocol for them
@@ -147,58 +385,53 @@ void SV_EmitNailUpdate (sizebuf_t *msg)
 }
 */
 
-#define	MAX_MISSILES	32
-static	edict_t	*missiles[MAX_MISSILES];
-static	edict_t	*ravens[MAX_MISSILES];
-static	edict_t	*raven2s[MAX_MISSILES];
-static	int	nummissiles, numravens, numraven2s;
 extern	int	sv_magicmissmodel, sv_playermodel[MAX_PLAYER_CLASS], sv_ravenmodel, sv_raven2model;
 
-static qboolean SV_AddMissileUpdate (edict_t *ent)
+static qboolean SV_AddMissileUpdate (sendwork_t *w, edict_t *ent)
 {
 	if (ent->v.modelindex == sv_magicmissmodel)
 	{
-		if (nummissiles == MAX_MISSILES)
+		if (w->nummissiles == MAX_MISSILES)
 			return true;
-		missiles[nummissiles] = ent;
-		nummissiles++;
+		w->missiles[w->nummissiles] = ent;
+		w->nummissiles++;
 		return true;
 	}
 	if (ent->v.modelindex == sv_ravenmodel)
 	{
-		if (numravens == MAX_MISSILES)
+		if (w->numravens == MAX_MISSILES)
 			return true;
-		ravens[numravens] = ent;
-		numravens++;
+		w->ravens[w->numravens] = ent;
+		w->numravens++;
 		return true;
 	}
 	if (ent->v.modelindex == sv_raven2model)
 	{
-		if (numraven2s == MAX_MISSILES)
+		if (w->numraven2s == MAX_MISSILES)
 			return true;
-		raven2s[numraven2s] = ent;
-		numraven2s++;
+		w->raven2s[w->numraven2s] = ent;
+		w->numraven2s++;
 		return true;
 	}
 	return false;
 }
 
-static void SV_EmitMissileUpdate (sizebuf_t *msg)
+static void SV_EmitMissileUpdate (sendwork_t *w, sizebuf_t *msg)
 {
 	byte	bits[5];	// [40 bits] xyz type 12 12 12 4
 	int		n, i;
 	edict_t	*ent;
 	int		x, y, z, type;
 
-	if (!nummissiles)
+	if (!w->nummissiles)
 		return;
 
 	MSG_WriteByte (msg, svc_packmissile);
-	MSG_WriteByte (msg, nummissiles);
+	MSG_WriteByte (msg, w->nummissiles);
 
-	for (n = 0; n < nummissiles; n++)
+	for (n = 0; n < w->nummissiles; n++)
 	{
-		ent = missiles[n];
+		ent = w->missiles[n];
 		x = (int)(ent->v.origin[0] + 4096) >> 1;
 		y = (int)(ent->v.origin[1] + 4096) >> 1;
 		z = (int)(ent->v.origin[2] + 4096) >> 1;
@@ -218,22 +451,22 @@ static void SV_EmitMissileUpdate (sizebuf_t *msg)
 	}
 }
 
-static void SV_EmitRavenUpdate (sizebuf_t *msg)
+static void SV_EmitRavenUpdate (sendwork_t *w, sizebuf_t *msg)
 {
 	byte	bits[6];	// [48 bits] xyzpy 12 12 12 4 8
 	int		n, i;
 	edict_t	*ent;
 	int		x, y, z, p, yaw, frame;
 
-	if ((!numravens) && (!numraven2s))
+	if ((!w->numravens) && (!w->numraven2s))
 		return;
 
 	MSG_WriteByte (msg, svc_nails);	//svc nails overloaded for ravens
-	MSG_WriteByte (msg, numravens);
+	MSG_WriteByte (msg, w->numravens);
 
-	for (n = 0; n < numravens; n++)
+	for (n = 0; n < w->numravens; n++)
 	{
-		ent = ravens[n];
+		ent = w->ravens[n];
 		x = (int)(ent->v.origin[0] + 4096) >> 1;
 		y = (int)(ent->v.origin[1] + 4096) >> 1;
 		z = (int)(ent->v.origin[2] + 4096) >> 1;
@@ -251,11 +484,11 @@ static void SV_EmitRavenUpdate (sizebuf_t *msg)
 		for (i = 0; i < 6; i++)
 			MSG_WriteByte (msg, bits[i]);
 	}
-	MSG_WriteByte (msg, numraven2s);
+	MSG_WriteByte (msg, w->numraven2s);
 
-	for (n = 0; n < numraven2s; n++)
+	for (n = 0; n < w->numraven2s; n++)
 	{
-		ent = raven2s[n];
+		ent = w->raven2s[n];
 		x = (int)(ent->v.origin[0] + 4096) >> 1;
 		y = (int)(ent->v.origin[1] + 4096) >> 1;
 		z = (int)(ent->v.origin[2] + 4096) >> 1;
@@ -274,15 +507,58 @@ static void SV_EmitRavenUpdate (sizebuf_t *msg)
 	}
 }
 
-static void SV_EmitPackedEntities(sizebuf_t *msg)
+static void SV_EmitPackedEntities (sendwork_t *w, sizebuf_t *msg)
 {
-	SV_EmitMissileUpdate(msg);
-	SV_EmitRavenUpdate(msg);
+	SV_EmitMissileUpdate (w, msg);
+	SV_EmitRavenUpdate (w, msg);
 }
 
 
 //=============================================================================
 
+/*
+==================
+SV_WriteEntityWord
+
+Writes the flags word that starts every packetentities update.
+Clients with the 'e' capability get numbers that don't fit in
+the nine bits escaped.
+==================
+*/
+static void SV_WriteEntityWord (client_t *client, sizebuf_t *msg, int number, int bits)
+{
+	if (client->entext && number >= U_ENTNUM_ESCAPE)
+	{
+		MSG_WriteShort (msg, U_ENTNUM_ESCAPE | bits);
+		MSG_WriteShort (msg, number);
+	}
+	else
+	{
+		MSG_WriteShort (msg, number | bits);
+	}
+}
+
+/*
+==================
+SV_ClassModelIndex
+
+SV_ModelIndex for the send jobs.
+==================
+*/
+static int SV_ClassModelIndex (sendwork_t *w, const char *name)
+{
+	int		i;
+
+	for (i = 0; i < MAX_MODELS && sv.model_precache[i]; i++)
+	{
+		if (!strcmp(sv.model_precache[i], name))
+			return i;
+	}
+
+	SV_SendWorkError (w, "SV_ModelIndex: model %s not precached", name);
+	return 0;
+}
+
 /*
 ==================
 SV_WriteDelta
@@ -291,7 +567,7 @@ Writes part of a packetentities message.
 Can delta from either a baseline or a previous packet_entity
 ==================
 */
-static void SV_WriteDelta (entity_state_t *from, entity_state_t *to, sizebuf_t *msg, qboolean force, edict_t *ent, client_t *client)
+static void SV_WriteDelta (sendwork_t *w, entity_state_t *from, entity_state_t *to, sizebuf_t *msg, qboolean force, edict_t *ent, client_t *client)
 {
 	int		bits;
 	int		i;
@@ -347,7 +623,7 @@ static void SV_WriteDelta (entity_state_t *from, entity_state_t *to, sizebuf_t *
 		{
 			NewName[strlen(NewName)-5] = client->playerclass + 48;
 		}
-		temp_index = SV_ModelIndex (NewName);
+		temp_index = SV_ClassModelIndex (w, NewName);
 	}
 
 	if (temp_index != from->modelindex )
@@ -384,16 +660,15 @@ static void SV_WriteDelta (entity_state_t *from, entity_state_t *to, sizebuf_t *
 	// write the message
 	//
 	if (!to->number)
-		SV_Error ("Unset entity number");
-	if (to->number >= 512)
-		SV_Error ("Entity number >= 512");
+		SV_SendWorkError (w, "Unset entity number");
+	if (to->number >= (client->entext ? MAX_EDICTS : U_ENTNUM_MASK + 1))
+		SV_SendWorkError (w, "Entity number %i out of range", to->number);
 
 	if (!bits && !force)
 		return;		// nothing to send!
-	i = to->number | (bits & ~511);
-	if (i & U_REMOVE)
+	if (bits & U_REMOVE)
 		Sys_Error ("U_REMOVE");
-	MSG_WriteShort (msg, i & 0xffff);
+	SV_WriteEntityWord (client, msg, to->number, bits & 0xffff & ~U_ENTNUM_MASK);
 
 	if (bits & U_MOREBITS)
 		MSG_WriteByte (msg, bits & 255);
@@ -440,21 +715,164 @@ static void SV_WriteDelta (entity_state_t *from, entity_state_t *to, sizebuf_t *
 		MSG_WriteShort (msg, to->wpn_sound);
 }
 
+/*
+=============================================================================
+
+PACKET ENTITIES
+
+Each client frame grows its own entity array on demand, so that
+the 'e' capability's MAX_PACKET_ENTITIES doesn't cost every
+frame of every client slot the full amount.
+
+=============================================================================
+*/
+
+/*
+=============
+SV_GrowPacketEntities
+=============
+*/
+static void SV_GrowPacketEntities (packet_entities_t *pack, int count)
+{
+	int	size;
+
+	if (count <= pack->max_entities)
+		return;
+	size = pack->max_entities ? pack->max_entities : 32;
+	while (size < count)
+		size <<= 1;
+	pack->entities = (entity_state_t *) realloc (pack->entities, size * sizeof(entity_state_t));
+	if (!pack->entities)
+		Sys_Error ("%s: failed on %i entities", __thisfunc__, size);
+	pack->max_entities = size;
+}
+
+/*
+=============
+SV_FreePacketEntities
+
+Called before a client slot is reused.
+=============
+*/
+void SV_FreePacketEntities (client_t *client)
+{
+	int	i;
+
+	for (i = 0; i < UPDATE_BACKUP; i++)
+	{
+		free (client->frames[i].entities.entities);
+		client->frames[i].entities.entities = NULL;
+		client->frames[i].entities.max_entities = 0;
+		client->frames[i].entities.num_entities = 0;
+	}
+}
+
+static int SV_CompareUpdates (const void *a, const void *b)
+{
+	const entupdate_t	*ua = *(const entupdate_t **)a;
+	const entupdate_t	*ub = *(const entupdate_t **)b;
+
+	if (ua->priority != ub->priority)
+		return ua->priority < ub->priority ? -1 : 1;
+	return (int)(ua - ub);
+}
+
+static int SV_CompareCandDist (const void *a, const void *b)
+{
+	const entcand_t	*ca = (const entcand_t *)a;
+	const entcand_t	*cb = (const entcand_t *)b;
+
+	if (ca->dist != cb->dist)
+		return ca->dist < cb->dist ? -1 : 1;
+	return ca->num - cb->num;
+}
+
+static int SV_CompareCandNum (const void *a, const void *b)
+{
+	return ((const entcand_t *)a)->num - ((const entcand_t *)b)->num;
+}
+
+/*
+=============
+SV_PackedEntitiesSize
+
+What SV_EmitPackedEntities is going to write.
+=============
+*/
+static int SV_PackedEntitiesSize (sendwork_t *w)
+{
+	int	size = 0;
+
+	if (w->nummissiles)
+		size += 2 + 5 * w->nummissiles;
+	if (w->numravens || w->numraven2s)
+		size += 3 + 6 * (w->numravens + w->numraven2s);
+	return size;
+}
+
+/*
+=============
+SV_SelectEntityUpdates
+
+The updates don't fit in the room left in the datagram: keep the
+removes, then as many of the closest entities as will fit.  An old
+entity that is left out keeps the state the client already has, a
+new one is dropped from the frame, so the frame stays a valid base
+for the next delta.
+=============
+*/
+static void SV_SelectEntityUpdates (sendwork_t *w, packet_entities_t *from, packet_entities_t *to, int numupdates, int room)
+{
+	entupdate_t	*u;
+	int		i, j, size;
+
+	for (i = 0; i < numupdates; i++)
+		w->entorder[i] = &w->entupdates[i];
+	qsort (w->entorder, numupdates, sizeof(w->entorder[0]), SV_CompareUpdates);
+
+	for (i = 0; i < numupdates; i++)
+	{
+		u = w->entorder[i];
+		size = u->end - u->start;
+		u->keep = (u->newindex == -1 || size <= room);
+		if (u->keep)
+		{
+			room -= size;
+			continue;
+		}
+		if (u->oldindex != -1)
+			to->entities[u->newindex] = from->entities[u->oldindex];
+		else	to->entities[u->newindex].number = 0;
+	}
+
+	for (i = j = 0; i < to->num_entities; i++)
+	{
+		if (to->entities[i].number)
+			to->entities[j++] = to->entities[i];
+	}
+	to->num_entities = j;
+}
+
 /*
 =============
 SV_EmitPacketEntities
 
 Writes a delta update of a packet_entities_t to the message.
+The updates are encoded into the workspace first so that they can
+be trimmed to the room that is left in the datagram.
 =============
 */
-static void SV_EmitPacketEntities (client_t *client, packet_entities_t *to, sizebuf_t *msg)
+static void SV_EmitPacketEntities (sendwork_t *w, client_t *client, packet_entities_t *to, sizebuf_t *msg)
 {
 	edict_t	*ent;
 	client_frame_t	*fromframe;
 	packet_entities_t *from;
+	entupdate_t	*u;
+	sizebuf_t	buf;
 	int		oldindex, newindex;
 	int		oldnum, newnum;
 	int		oldmax;
+	int		i, numupdates, room;
 
 	// this is the frame that we are going to delta update from
 	if (client->delta_sequence != -1)
@@ -474,6 +892,9 @@ static void SV_EmitPacketEntities (client_t *client, packet_entities_t *to, size
 		MSG_WriteByte (msg, svc_packetentities);
 	}
 
+	SZ_Init (&buf, w->entbuf, sizeof(w->entbuf));
+	numupdates = 0;
+
 	newindex = 0;
 	oldindex = 0;
 //	Con_Printf ("---%i to %i ----\n", client->delta_sequence & UPDATE_MASK,
@@ -483,31 +904,56 @@ static void SV_EmitPacketEntities (client_t *client, packet_entities_t *to, size
 		newnum = newindex >= to->num_entities ? 9999 : to->entities[newindex].number;
 		oldnum = oldindex >= oldmax ? 9999 : from->entities[oldindex].number;
 
+		u = &w->entupdates[numupdates++];
+		u->start = buf.cursize;
+
 		if (newnum == oldnum)
 		{	// delta update from old position
 		//	Con_Printf ("delta %i\n", newnum);
-			SV_WriteDelta (&from->entities[oldindex], &to->entities[newindex], msg, false, EDICT_NUM(newnum), client);
+			SV_WriteDelta (w, &from->entities[oldindex], &to->entities[newindex], &buf, false, EDICT_NUM(newnum), client);
+			u->oldindex = oldindex;
+			u->newindex = newindex;
+			u->priority = w->entdist[newindex];
 			oldindex++;
 			newindex++;
-			continue;
 		}
-
-		if (newnum < oldnum)
+		else if (newnum < oldnum)
 		{	// this is a new entity, send it from the baseline
 			ent = EDICT_NUM(newnum);
 		//	Con_Printf ("baseline %i\n", newnum);
-			SV_WriteDelta (&ent->baseline, &to->entities[newindex], msg, true, ent, client);
+			SV_WriteDelta (w, &ent->baseline, &to->entities[newindex], &buf, true, ent, client);
+			u->oldindex = -1;
+			u->newindex = newindex;
+			u->priority = w->entdist[newindex];
 			newindex++;
-			continue;
 		}
-
-		if (newnum > oldnum)
+		else
 		{	// the old entity isn't present in the new message
 		//	Con_Printf ("remove %i\n", oldnum);
-			MSG_WriteShort (msg, oldnum | U_REMOVE);
+			SV_WriteEntityWord (client, &buf, oldnum, U_REMOVE);
+			u->oldindex = oldindex;
+			u->newindex = -1;
+			u->priority = -1;
 			oldindex++;
-			continue;
 		}
+
+		u->end = buf.cursize;
+		u->keep = true;
+	}
+
+	// leave room for the terminator, the packed entities and
+	// the multicasts that follow
+	room = msg->maxsize - msg->cursize - 2 - SV_PackedEntitiesSize (w);
+	if (!client->datagram.overflowed)
+		room -= client->datagram.cursize;
+
+	if (buf.cursize > room)
+		SV_SelectEntityUpdates (w, from, to, numupdates, room);
+
+	for (i = 0, u = w->entupdates; i < numupdates; i++, u++)
+	{
+		if (u->keep)
+			SZ_Write (msg, w->entbuf + u->start, u->end - u->start);
 	}
 
 	MSG_WriteShort (msg, 0);	// end of packetentities
@@ -1388,11 +1834,13 @@ a svc_nails message and
 svc_playerinfo messages
 =============
 */
-void SV_WriteEntitiesToClient (client_t *client, sizebuf_t *msg)
+void SV_WriteEntitiesToClient (client_t *client, sizebuf_t *msg, int job)
 {
+	sendwork_t	*w = sv_sendwork[job];
 	int		e, i;
+	int		maxents, maxnum, numcands;
 	byte	*pvs;
-	vec3_t	org;
+	vec3_t	org, center;
 	edict_t	*ent;
 	packet_entities_t	*pack;
 	edict_t	*clent;
@@ -1405,7 +1853,7 @@ void SV_WriteEntitiesToClient (client_t *client, sizebuf_t *msg)
 	// find the client's PVS
 	clent = client->edict;
 	VectorAdd (clent->v.origin, clent->v.view_ofs, org);
-	pvs = SV_FatPVS (org);
+	pvs = SV_FatPVS (w, org);
 
 	// send over the players in the PVS
 	SV_WritePlayersToClient (client, clent, pvs, msg);
@@ -1414,10 +1862,22 @@ void SV_WriteEntitiesToClient (client_t *client, sizebuf_t *msg)
 	pack = &frame->entities;
 	pack->num_entities = 0;
 
+	if (client->entext)
+	{
+		maxents = MAX_PACKET_ENTITIES;
+		maxnum = MAX_EDICTS;
+	}
+	else
+	{
+		maxents = OLD_MAX_PACKET_ENTITIES;
+		maxnum = U_ENTNUM_MASK + 1;
+	}
+	numcands = 0;
+
 //	numnails = 0;
-	nummissiles = 0;
-	numravens = 0;
-	numraven2s = 0;
+	w->nummissiles = 0;
+	w->numravens = 0;
+	w->numraven2s = 0;
 
 	for (e = MAX_CLIENTS+1, ent = EDICT_NUM(e); e < sv.num_edicts; e++, ent = NEXT_EDICT(ent))
 	{
@@ -1442,15 +1902,35 @@ void SV_WriteEntitiesToClient (client_t *client, sizebuf_t *msg)
 
 //		if (SV_AddNailUpdate (ent))
 //			continue;
-		if (SV_AddMissileUpdate (ent))
+		if (SV_AddMissileUpdate (w, ent))
 			continue;	// added to the special update list
 
-		// add to the packetentities
-		if (pack->num_entities == MAX_PACKET_ENTITIES)
-			continue;	// all full
+		if (e >= maxnum)
+			continue;	// the client can't address it
 
-		state = &pack->entities[pack->num_entities];
-		pack->num_entities++;
+		VectorAdd (ent->v.absmin, ent->v.absmax, center);
+		VectorMA (center, -2, org, center);	// twice the offset, fine for sorting
+		w->entcands[numcands].num = e;
+		w->entcands[numcands].dist = DotProduct (center, center);
+		numcands++;
+	}
+
+	// too many for the packet: keep the closest ones
+	if (numcands > maxents)
+	{
+		qsort (w->entcands, numcands, sizeof(entcand_t), SV_CompareCandDist);
+		numcands = maxents;
+		qsort (w->entcands, numcands, sizeof(entcand_t), SV_CompareCandNum);
+	}
+
+	// add to the packetentities
+	SV_GrowPacketEntities (pack, numcands);
+	for (i = 0; i < numcands; i++)
+	{
+		e = w->entcands[i].num;
+		ent = EDICT_NUM(e);
+		state = &pack->entities[i];
+		w->entdist[i] = w->entcands[i].dist;
 
 		state->number = e;
 		state->flags = 0;
@@ -1467,14 +1947,15 @@ void SV_WriteEntitiesToClient (client_t *client, sizebuf_t *msg)
 		//clear sound so it doesn't send twice
 		state->wpn_sound = ent->v.wpn_sound;
 	}
+	pack->num_entities = numcands;
 
 	// encode the packet entities as a delta from the
 	// last packetentities acknowledged by the client
 
-	SV_EmitPacketEntities (client, pack, msg);
+	SV_EmitPacketEntities (w, client, pack, msg);
 
 	// now add the specialized nail update
 //	SV_EmitNailUpdate (msg);
-	SV_EmitPackedEntities (msg);
+	SV_EmitPackedEntities (w, msg);
 }
 
@@ -100,6 +100,10 @@ static void SV_CreateBaseline (void)
 		// and any other edict that has a visible model
 		if (entnum > MAX_CLIENTS && !svent->v.modelindex)
 			continue;
+		// clients only keep OLD_MAX_EDICTS baselines, the
+		// rest are sent from the zeroed one in the edict.
+		if (entnum >= OLD_MAX_EDICTS)
+			break;
 
 	//
 	// create entity baseline
@@ -228,14 +232,15 @@ static void SV_CalcPHS (void)
 	rowwords = (num+31)>>5;
 	rowbytes = rowwords*4;
 
-	sv.pvs = (byte *) Hunk_AllocName (rowbytes*num, "pvs");
+	// leafs are 0..num, the last one needs a row for SV_FatPVS, too
+	sv.pvs = (byte *) Hunk_AllocName (rowbytes*(num+1), "pvs");
 	scan = sv.pvs;
 	vcount = 0;
-	for (i = 0; i < num; i++, scan += rowbytes)
+	for (i = 0; i <= num; i++, scan += rowbytes)
 	{
 		memcpy (scan, Mod_LeafPVS(sv.worldmodel->leafs+i, sv.worldmodel),
 			rowbytes);
-		if (i == 0)
+		if (i == 0 || i == num)
 			continue;
 		for (j = 0; j < num; j++)
 		{
@@ -303,6 +308,7 @@ void SV_SpawnServer (const char *server, const char *startspot)
 	int			i;
 
 	Con_DPrintf ("%s: %s\n", __thisfunc__, server);
+	FS_StatsMapChange (false);
 
 	SV_SaveSpawnparms ();
 
@@ -354,6 +360,7 @@ void SV_SpawnServer (const char *server, const char *startspot)
 	q_snprintf (sv.modelname, sizeof(sv.modelname), "maps/%s.bsp", server);
 	sv.worldmodel = Mod_ForName (sv.modelname, true);
 	SV_CalcPHS ();
+	SV_InitFatPVS ();
 
 	//
 	// clear physics interaction links
@@ -455,8 +462,11 @@ void SV_SpawnServer (const char *server, const char *startspot)
 	SV_CreateBaseline ();
 	sv.signon_buffer_size[sv.num_signon_buffers-1] = sv.signon.cursize;
 
+	SV_InitHuffTable ();
+
 	Info_SetValueForKey (svs.info, "map", sv.name, MAX_SERVERINFO_STRING);
 	Con_DPrintf ("Server spawned.\n");
+	FS_StatsMapChange (true);
 
 	svs.changelevel_issued = false;	// now safe to issue another
 }
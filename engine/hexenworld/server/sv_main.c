@@ -21,7 +21,9 @@
  */
 
 #include "quakedef.h"
+#include "threads.h"
 #include "huffman.h"
+#include "hashindex.h"
 
 static int	sv_protocol = 0;
 
@@ -207,6 +209,99 @@ void SV_FinalMessage (const char *message)
 }
 
 
+/*
+==============================================================================
+
+CLIENT ADDRESSES
+
+Every client slot that isn't free is hashed by its remote address, so
+that an incoming packet finds its client without a compare against
+each slot.
+
+==============================================================================
+*/
+
+#define	CLIENT_HASH_SIZE	64	/* power of two, at least MAX_CLIENTS */
+
+static hashindex_t	client_hash;
+static int		client_key[MAX_CLIENTS];	/* -1 if not hashed */
+
+static int SV_AddressKey (const netadr_t *a)
+{
+	unsigned int	h;
+
+	memcpy (&h, a->ip, 4);
+	h = (h ^ a->port) * 0x9e3779b1;
+	return (int)(h >> 16);
+}
+
+static void SV_InitClientHash (void)
+{
+	int		i;
+
+	Hash_Allocate (&client_hash, CLIENT_HASH_SIZE);
+	for (i = 0; i < MAX_CLIENTS; i++)
+		client_key[i] = -1;
+}
+
+/*
+==================
+SV_HashClient
+
+Called when cl takes on a new remote address
+==================
+*/
+static void SV_HashClient (client_t *cl)
+{
+	int		num = cl - svs.clients;
+
+	if (client_key[num] != -1)
+		Hash_Remove (&client_hash, client_key[num], num);
+	client_key[num] = SV_AddressKey (&cl->netchan.remote_address);
+	Hash_Add (&client_hash, client_key[num], num);
+}
+
+/*
+==================
+SV_UnhashClient
+
+Called when cl becomes cs_free
+==================
+*/
+static void SV_UnhashClient (client_t *cl)
+{
+	int		num = cl - svs.clients;
+
+	if (client_key[num] == -1)
+		return;
+	Hash_Remove (&client_hash, client_key[num], num);
+	client_key[num] = -1;
+}
+
+/*
+==================
+SV_ClientForAddress
+
+Returns the lowest numbered client that isn't free and has the given
+remote address, or NULL
+==================
+*/
+static client_t *SV_ClientForAddress (const netadr_t *a)
+{
+	int		i, best;
+	client_t	*cl;
+
+	best = MAX_CLIENTS;
+	for (i = Hash_First (&client_hash, SV_AddressKey (a)); i != -1; i = Hash_Next (&client_hash, i))
+	{
+		cl = &svs.clients[i];
+		if (i < best && cl->state != cs_free && NET_CompareAdr (a, &cl->netchan.remote_address))
+			best = i;
+	}
+	return (best < MAX_CLIENTS) ? &svs.clients[best] : NULL;
+}
+
+
 /*
 =====================
 SV_DropClient
@@ -575,16 +670,11 @@ static void SVC_DirectConnect (void)
 	}
 
 	// if there is already a slot for this ip, drop it
-	for (i = 0, cl = svs.clients; i < MAX_CLIENTS; i++, cl++)
+	cl = SV_ClientForAddress (&adr);
+	if (cl)
 	{
-		if (cl->state == cs_free)
-			continue;
-		if (NET_CompareAdr (&adr, &cl->netchan.remote_address))
-		{
-			Con_Printf ("%s:reconnect\n", NET_AdrToString (&adr));
-			SV_DropClient (cl);
-			break;
-		}
+		Con_Printf ("%s:reconnect\n", NET_AdrToString (&adr));
+		SV_DropClient (cl);
 	}
 
 	// count up the clients and spectators
@@ -634,22 +724,26 @@ static void SVC_DirectConnect (void)
 	// build a new connection
 	// accept the new client
 	// this is the only place a client_t is ever initialized
+	SV_FreePacketEntities (newcl);
 	*newcl = temp;
 
+	s = Info_ValueForKey(userinfo, "*cap");
 	if (sv_protocol != 0)
 		newcl->protocol = sv_protocol;
 	else {
-		s = Info_ValueForKey(userinfo, "*cap");
 		if (strstr(s, "c"))
 			newcl->protocol = PROTOCOL_VERSION_EXT;
 		else	newcl->protocol = PROTOCOL_VERSION;
 	}
+	newcl->entext = (strstr(s, "e") != NULL);
+	newcl->hufftables = (strstr(s, "h") != NULL);
 
 	Netchan_OutOfBandPrint (&adr, "%c", S2C_CONNECTION );
 
 	edictnum = (newcl-svs.clients)+1;
 
 	Netchan_Setup (&newcl->netchan, &adr);
+	SV_HashClient (newcl);
 
 	newcl->state = cs_connected;
 
@@ -846,6 +940,13 @@ typedef struct
 static ipfilter_t	ipfilters[MAX_IPFILTERS];
 static int		numipfilters;
 
+/* Unspecified digits can be anywhere in a filter, so the masks aren't
+ * prefixes, but there are only 16 of them: the filters are hashed by
+ * compare value and a packet is looked up once for each mask in use. */
+static hashindex_t	ipfilter_hash;
+static unsigned int	ipfilter_masks[16];
+static int		ipfilter_maskcount[16];
+
 static	cvar_t	filterban = {"filterban", "1", CVAR_NONE};
 
 
@@ -897,6 +998,51 @@ static qboolean StringToFilter (const char *s, ipfilter_t *f)
 }
 
 
+static int SV_FilterKey (unsigned int compare)
+{
+	return (int)((compare * 0x9e3779b1) >> 16);
+}
+
+static int SV_FilterMaskNum (unsigned int mask)
+{
+	byte	*m = (byte *)&mask;
+
+	return (m[0] ? 1 : 0) | (m[1] ? 2 : 0) | (m[2] ? 4 : 0) | (m[3] ? 8 : 0);
+}
+
+/*
+=================
+SV_IndexFilters
+
+Rebuilds the filter hash after the list changes
+=================
+*/
+static void SV_IndexFilters (void)
+{
+	int		i, j;
+	byte	*m;
+
+	if (!ipfilter_hash.hash)
+	{
+		Hash_Allocate (&ipfilter_hash, MAX_IPFILTERS);
+		for (i = 0; i < 16; i++)
+		{
+			m = (byte *)&ipfilter_masks[i];
+			for (j = 0; j < 4; j++)
+				m[j] = (i & (1 << j)) ? 255 : 0;
+		}
+	}
+
+	Hash_Clear (&ipfilter_hash);
+	memset (ipfilter_maskcount, 0, sizeof(ipfilter_maskcount));
+	for (i = numipfilters - 1; i >= 0; i--)
+	{
+		Hash_Add (&ipfilter_hash, SV_FilterKey (ipfilters[i].compare), i);
+		ipfilter_maskcount[SV_FilterMaskNum (ipfilters[i].mask)]++;
+	}
+}
+
+
 /*
 =================
 SV_AddIP_f
@@ -924,6 +1070,7 @@ static void SV_AddIP_f (void)
 
 	if (!StringToFilter (Cmd_Argv(1), &ipfilters[i]))
 		ipfilters[i].compare = 0xffffffff;
+	SV_IndexFilters ();
 }
 
 
@@ -947,6 +1094,7 @@ static void SV_RemoveIP_f (void)
 			for (j = i+1; j < numipfilters; j++)
 				ipfilters[j-1] = ipfilters[j];
 			numipfilters--;
+			SV_IndexFilters ();
 			Con_Printf ("Removed.\n");
 			return;
 		}
@@ -1028,15 +1176,24 @@ SV_FilterPacket
 */
 static qboolean SV_FilterPacket (void)
 {
-	int		i;
-	unsigned int	in;
+	int		i, m;
+	unsigned int	in, compare;
+
+	if (!numipfilters)
+		return !filterban.integer;
 
 	memcpy (&in, net_from.ip, 4);
 
-	for (i = 0; i < numipfilters; i++)
+	for (m = 0; m < 16; m++)
 	{
-		if ( (in & ipfilters[i].mask) == ipfilters[i].compare)
-			return filterban.integer;
+		if (!ipfilter_maskcount[m])
+			continue;
+		compare = in & ipfilter_masks[m];
+		for (i = Hash_First (&ipfilter_hash, SV_FilterKey (compare)); i != -1; i = Hash_Next (&ipfilter_hash, i))
+		{
+			if (ipfilters[i].mask == ipfilter_masks[m] && ipfilters[i].compare == compare)
+				return filterban.integer;
+		}
 	}
 
 	return !filterban.integer;
@@ -1052,7 +1209,6 @@ SV_ReadPackets
 */
 static void SV_ReadPackets (void)
 {
-	int			i;
 	client_t	*cl;
 
 	while (NET_GetPacket ())
@@ -1071,12 +1227,9 @@ static void SV_ReadPackets (void)
 		}
 
 		// check for packets from connected clients
-		for (i = 0, cl = svs.clients; i < MAX_CLIENTS; i++, cl++)
+		cl = SV_ClientForAddress (&net_from);
+		if (cl)
 		{
-			if (cl->state == cs_free)
-				continue;
-			if (!NET_CompareAdr (&net_from, &cl->netchan.remote_address))
-				continue;
 			if (Netchan_Process(&cl->netchan))
 			{	// this is a valid, sequenced packet, so process it
 				svs.stats.packets++;
@@ -1084,11 +1237,8 @@ static void SV_ReadPackets (void)
 				if (cl->state != cs_zombie)
 					SV_ExecuteClientMessage (cl);
 			}
-			break;
-		}
-
-		if (i != MAX_CLIENTS)
 			continue;
+		}
 
 		// packet is not from a known client
 		//	Con_Printf ("%s:sequenced packet without connection\n", NET_AdrToString(&net_from));
@@ -1124,10 +1274,12 @@ static void SV_CheckTimeouts (void)
 			SV_BroadcastPrintf (PRINT_HIGH, "%s timed out\n", cl->name);
 			SV_DropClient (cl);
 			cl->state = cs_free;	// don't bother with zombie state
+			SV_UnhashClient (cl);
 		}
 		if (cl->state == cs_zombie && realtime - cl->connection_started > zombietime.value)
 		{
 			cl->state = cs_free;	// can now be reused
+			SV_UnhashClient (cl);
 		}
 	}
 }
@@ -1184,6 +1336,475 @@ static void SV_CheckVars (void)
 }
 
 
+/*
+=============================================================================
+
+HUFFMAN TABLES
+
+The static huffman table was trained on Quake traffic long ago.
+Clients with the 'h' capability get one trained on what this
+server sends on the current map: the first HUFF_TRAIN_BYTES of
+netchan traffic are counted, and if a table built from them codes
+that traffic at least 2% smaller it is pushed with svc_hufftable.
+Once a client acknowledges it with "hufftable", the packets to it
+are coded with that table.  The counts are remembered per map, so
+the next run of a map starts with its table.  A packet only says
+which of two slots its table is in, so a new table waits until no
+client can still be coding with the one it replaces.
+
+=============================================================================
+*/
+
+#define	HUFF_TRAIN_BYTES	32768
+#define	HUFF_MIN_GAIN		980	// trained bits per 1000 static bits
+#define	MAX_HUFF_MAPS		32
+
+typedef struct
+{
+	char		mapname[MAX_QPATH];
+	qboolean	useful;		// false if it didn't beat the static table
+	unsigned short	counts[256];
+} huffmap_t;
+
+static huffmap_t	sv_huffmaps[MAX_HUFF_MAPS];
+static int		sv_numhuffmaps, sv_huffreplace;
+static int		sv_hufflast;	// generations only go up
+static unsigned short	sv_huffslots[2][256];	// counts of the tables in the slots
+static int		sv_huffslotgen[2];
+static unsigned short	sv_huffwaiting[256];	// counts of a table waiting for its slot
+static qboolean		sv_huffiswaiting;
+
+int	sv_huffgen;	// the current trained table, 0 for none
+
+cvar_t	sv_hufftables = {"sv_hufftables", "1", CVAR_NONE};
+
+static huffmap_t *SV_FindHuffMap (const char *mapname)
+{
+	int	i;
+
+	for (i = 0; i < sv_numhuffmaps; i++)
+	{
+		if (!strcmp(sv_huffmaps[i].mapname, mapname))
+			return &sv_huffmaps[i];
+	}
+	return NULL;
+}
+
+/*
+================
+SV_SendHuffTable
+
+Sends the trained table of the given generation, which must be in
+its slot, and codes the packets to the client statically until it
+acknowledges it.
+================
+*/
+static void SV_SendHuffTable (client_t *cl, int generation)
+{
+	unsigned short	*counts = sv_huffslots[generation & 1];
+	int	i;
+
+	cl->netchan.huffgen = 0;
+	cl->huffsent = generation;
+	MSG_WriteByte (&cl->netchan.message, svc_hufftable);
+	MSG_WriteByte (&cl->netchan.message, generation);
+	for (i = 0; i < 256; i++)
+		MSG_WriteShort (&cl->netchan.message, counts[i]);
+}
+
+/*
+================
+SV_HuffSlotFree
+
+A packet only carries the slot of its table, so a slot can't take
+a new generation while a client may still code with the old one:
+the client's packets would be decoded with the wrong table.  A
+client that hasn't acknowledged its last table may be using any
+older one, and is waited for.  One that is on the old table of the
+slot is moved to the table in the other slot first.
+================
+*/
+static qboolean SV_HuffSlotFree (int generation)
+{
+	client_t	*cl;
+	int		i, other;
+	qboolean	isfree = true;
+
+	other = sv_huffslotgen[(generation + 1) & 1];
+	for (i = 0, cl = svs.clients; i < MAX_CLIENTS; i++, cl++)
+	{
+		if (cl->state < cs_connected || !cl->hufftables || !cl->huffsent)
+			continue;
+		if (cl->netchan.huffgen != cl->huffsent)
+			isfree = false;	// not acknowledged yet
+		else if ((cl->huffsent & 1) == (generation & 1))
+		{
+			isfree = false;
+			if (other)	// always, the generations alternate
+				SV_SendHuffTable (cl, other);
+		}
+	}
+
+	return isfree;
+}
+
+/*
+================
+SV_SetHuffTable
+
+Installs a table as the next generation, or keeps it waiting
+until its slot is free.  Generations alternate between the two
+slots, so they wrap from 254 to 1.
+================
+*/
+static void SV_SetHuffTable (const unsigned short *counts)
+{
+	int	generation, slot;
+
+	if (counts != sv_huffwaiting)
+		memcpy (sv_huffwaiting, counts, sizeof(sv_huffwaiting));
+	generation = sv_hufflast % 254 + 1;
+	if (!SV_HuffSlotFree (generation))
+	{
+		sv_huffiswaiting = true;
+		return;
+	}
+
+	sv_huffiswaiting = false;
+	sv_hufflast = generation;
+	sv_huffgen = generation;
+	slot = generation & 1;
+	memcpy (sv_huffslots[slot], sv_huffwaiting, sizeof(sv_huffslots[slot]));
+	sv_huffslotgen[slot] = generation;
+	HuffSetTable (generation, sv_huffslots[slot]);
+}
+
+/*
+================
+SV_WriteHuffTable
+
+Sends the current trained table to a client, which keeps
+getting the static coding until it acknowledges it.
+================
+*/
+void SV_WriteHuffTable (client_t *cl)
+{
+	if (!cl->hufftables || !sv_huffgen)
+		return;
+	SV_SendHuffTable (cl, sv_huffgen);
+}
+
+/*
+================
+SV_InitHuffTable
+
+Called from SV_SpawnServer: use the table this map had last
+time, or train a new one.
+================
+*/
+void SV_InitHuffTable (void)
+{
+	huffmap_t	*m;
+
+	HuffTrainReset ();
+	net_hufftrain = false;
+	sv_huffiswaiting = false;
+	sv_huffgen = 0;	// the old tables stay until they're replaced
+	if (!sv_hufftables.integer)
+		return;
+
+	m = SV_FindHuffMap (sv.name);
+	if (!m)
+		net_hufftrain = true;
+	else if (m->useful)
+		SV_SetHuffTable (m->counts);
+}
+
+/*
+================
+SV_CheckHuffTable
+
+Builds the table once enough traffic has been counted, and
+installs a waiting one once its slot is free.
+================
+*/
+static void SV_CheckHuffTable (void)
+{
+	huffmap_t	*m;
+	client_t	*cl;
+	int		i, bits;
+
+	if (sv_huffiswaiting)
+	{
+		SV_SetHuffTable (sv_huffwaiting);
+		if (sv_huffiswaiting)
+			return;
+		for (i = 0, cl = svs.clients; i < MAX_CLIENTS; i++, cl++)
+		{
+			if (cl->state >= cs_connected)
+				SV_WriteHuffTable (cl);
+		}
+		return;
+	}
+
+	if (!net_hufftrain || HuffTrainedBytes() < HUFF_TRAIN_BYTES)
+		return;
+	net_hufftrain = false;
+
+	if (sv_numhuffmaps < MAX_HUFF_MAPS)
+		m = &sv_huffmaps[sv_numhuffmaps++];
+	else
+	{
+		m = &sv_huffmaps[sv_huffreplace];
+		sv_huffreplace = (sv_huffreplace + 1) % MAX_HUFF_MAPS;
+	}
+	q_strlcpy (m->mapname, sv.name, sizeof(m->mapname));
+	bits = HuffTrainedTable (m->counts);
+	m->useful = (bits <= HUFF_MIN_GAIN);
+	Con_DPrintf ("%s: %s codes to %d.%d%% of the static table\n",
+			__thisfunc__, sv.name, bits / 10, bits % 10);
+	if (!m->useful || !sv_hufftables.integer)
+		return;
+
+	SV_SetHuffTable (m->counts);
+	if (sv_huffiswaiting)
+		return;	// installed and sent once its slot is free
+	for (i = 0, cl = svs.clients; i < MAX_CLIENTS; i++, cl++)
+	{
+		if (cl->state >= cs_connected)
+			SV_WriteHuffTable (cl);
+	}
+}
+
+
+/*
+==============================================================================
+
+SEND BENCHMARK
+
+sendbench <bots> [frames] connects that many bots and, once they are all
+in the game, times the frames that follow and prints how long sending and
+whole frames took.  The bots have no socket of their own: each frame
+SV_BenchPackets hands the server a packet from every bot as if it had
+come in over the net, acking what was sent to it, asking for a delta
+from the last frame, and running and turning about, and what the server
+sends them goes to an unused loopback address.  Running it again with
+other sv_sendthreads settings and bot counts shows how the frame time
+grows with the number of players.  sendbench 0 drops the bots.
+
+==============================================================================
+*/
+
+#define	BENCH_ADDRESS	"127.0.0.2"
+#define	BENCH_PORT	40000
+
+typedef struct
+{
+	client_t	*cl;
+	int		sequence;
+	int		stage;		// 0 new, 1 spawn, 2 begin, 3 in the game
+} benchbot_t;
+
+static	benchbot_t	bench_bots[MAX_CLIENTS];
+static	int		bench_numbots;
+static	int		bench_frames;	// frames left to time
+static	int		bench_timed;
+static	double		bench_sendtime, bench_frametime;
+
+static void SV_BenchDropBots (void)
+{
+	client_t	*cl;
+	int		i;
+
+	for (i = 0; i < bench_numbots; i++)
+	{
+		cl = bench_bots[i].cl;
+		if (cl->state == cs_free)
+			continue;
+		if (cl->state != cs_zombie)
+			SV_DropClient (cl);
+		cl->state = cs_free;	// don't bother with zombie state
+		SV_UnhashClient (cl);
+	}
+	bench_numbots = 0;
+	bench_frames = 0;
+}
+
+static void SV_BenchConnect (int bot)
+{
+	netadr_t	adr;
+	client_t	*cl;
+
+	NET_StringToAdr (va("%s:%i", BENCH_ADDRESS, BENCH_PORT + bot), &adr);
+	net_from = adr;
+	Cmd_TokenizeString (va("connect 0 \"\\name\\bot%i\\playerclass\\%i\\*cap\\e\"",
+						bot, bot % 4 + 1));
+	SVC_DirectConnect ();
+
+	cl = SV_ClientForAddress (&adr);
+	if (!cl)
+		return;
+	cl->netchan.rate = 0;	// never choked
+
+	bench_bots[bench_numbots].cl = cl;
+	bench_bots[bench_numbots].sequence = 0;
+	bench_bots[bench_numbots].stage = 0;
+	bench_numbots++;
+}
+
+/*
+==================
+SV_BenchPackets
+
+Called after SV_ReadPackets.
+==================
+*/
+static void SV_BenchPackets (float time)
+{
+	benchbot_t	*bot;
+	client_t	*cl;
+	usercmd_t	cmd;
+	int		i;
+
+	memset (&cmd, 0, sizeof(cmd));
+	cmd.msec = (time * 1000 > 250) ? 250 : (byte)(time * 1000);
+	cmd.forwardmove = 200;
+
+	for (i = 0, bot = bench_bots; i < bench_numbots; i++, bot++)
+	{
+		cl = bot->cl;
+		if (cl->state != cs_connected && cl->state != cs_spawned)
+			continue;
+		if (cl->state == cs_connected && bot->stage == 3)
+			bot->stage = 0;	// the map changed
+
+		SZ_Clear (&net_message);
+		MSG_WriteLong (&net_message, ++bot->sequence);
+		MSG_WriteLong (&net_message, (cl->netchan.outgoing_sequence ? cl->netchan.outgoing_sequence - 1 : 0)
+						| ((unsigned int)cl->netchan.reliable_sequence << 31));
+		if (cl->state == cs_spawned)
+		{
+			MSG_WriteByte (&net_message, clc_delta);
+			MSG_WriteByte (&net_message, (cl->netchan.outgoing_sequence - 1) & 255);
+		}
+
+		// one signon step per round trip, like a real client
+		if (bot->stage < 3 && !cl->netchan.message.cursize && !cl->netchan.reliable_length)
+		{
+			MSG_WriteByte (&net_message, clc_stringcmd);
+			if (bot->stage == 0)
+				MSG_WriteString (&net_message, "new");
+			else if (bot->stage == 1)
+				MSG_WriteString (&net_message, va("spawn %i", svs.spawncount));
+			else
+				MSG_WriteString (&net_message, va("begin %i", svs.spawncount));
+			bot->stage++;
+		}
+
+		cmd.angles[YAW] = anglemod (bot->sequence * 3 + i * 40);
+		cmd.sidemove = ((bot->sequence / 50 + i) % 3 - 1) * 150;
+		cmd.buttons = (bot->sequence % 40 == 0) ? 2 : 0;	// jump now and then
+		MSG_WriteByte (&net_message, clc_move);
+		MSG_WriteUsercmd (&net_message, &cmd, false);
+		MSG_WriteUsercmd (&net_message, &cmd, false);
+		MSG_WriteUsercmd (&net_message, &cmd, true);
+
+		net_from = cl->netchan.remote_address;
+		if (Netchan_Process (&cl->netchan))
+		{
+			cl->send_message = true;
+			SV_ExecuteClientMessage (cl);
+		}
+	}
+}
+
+/*
+==================
+SV_BenchFrame
+==================
+*/
+static void SV_BenchFrame (double sendtime, double frametime)
+{
+	int		i, clients, jobs;
+
+	for (i = 0; i < bench_numbots; i++)
+	{
+		if (bench_bots[i].cl->state != cs_spawned)
+			return;	// not everyone is in yet
+	}
+
+	bench_sendtime += sendtime;
+	bench_frametime += frametime;
+	bench_timed++;
+	if (--bench_frames)
+		return;
+
+	for (i = clients = 0; i < MAX_CLIENTS; i++)
+	{
+		if (svs.clients[i].state == cs_spawned)
+			clients++;
+	}
+	jobs = 1;
+	if (sv_sendthreads.integer > 0)
+	{
+		jobs = sv_sendthreads.integer + 1;
+		if (jobs > Thread_NumWorkers() + 1)
+			jobs = Thread_NumWorkers() + 1;
+		if (jobs > MAX_SEND_JOBS)
+			jobs = MAX_SEND_JOBS;
+	}
+
+	Con_Printf ("sendbench: %i clients, %i send jobs, %i frames: %.3f ms sending, %.3f ms per frame\n",
+			clients, jobs, bench_timed, bench_sendtime * 1000 / bench_timed,
+			bench_frametime * 1000 / bench_timed);
+}
+
+/*
+==================
+SV_SendBench_f
+
+sendbench <bots> [frames]
+==================
+*/
+static void SV_SendBench_f (void)
+{
+	int		i, numbots, frames;
+
+	if (Cmd_Argc() < 2)
+	{
+		Con_Printf ("usage: sendbench <bots> [frames]\n"
+			    "%i bots connected\n", bench_numbots);
+		return;
+	}
+	if (sv.state != ss_active)
+	{
+		Con_Printf ("no map running\n");
+		return;
+	}
+
+	numbots = atoi (Cmd_Argv(1));
+	frames = (Cmd_Argc() > 2) ? atoi(Cmd_Argv(2)) : 500;
+	if (numbots < 0)
+		numbots = 0;
+	if (numbots > MAX_CLIENTS)
+		numbots = MAX_CLIENTS;
+
+	if (numbots != bench_numbots)
+	{
+		SV_BenchDropBots ();
+		for (i = 0; i < numbots; i++)
+			SV_BenchConnect (i);
+		if (bench_numbots < numbots)
+			Con_Printf ("sendbench: only %i bots got in, raise maxclients\n", bench_numbots);
+	}
+	if (!bench_numbots)
+		return;
+
+	bench_frames = (frames > 0) ? frames : 1;
+	bench_timed = 0;
+	bench_sendtime = bench_frametime = 0;
+}
+
 /*
 ==================
 SV_Frame
@@ -1193,6 +1814,7 @@ SV_Frame
 void SV_Frame (float time)
 {
 	static double	start, end;
+	double		send;
 
 	start = Sys_DoubleTime ();
 	svs.stats.idle += start - end;
@@ -1215,6 +1837,8 @@ void SV_Frame (float time)
 
 // get packets
 	SV_ReadPackets ();
+	if (bench_numbots)
+		SV_BenchPackets (time);
 
 // check for commands typed to the host
 	SV_GetConsoleCommands ();
@@ -1225,7 +1849,11 @@ void SV_Frame (float time)
 	SV_CheckVars ();
 
 // send messages back to the clients that had packets read this frame
+	send = Sys_DoubleTime ();
 	SV_SendClientMessages ();
+	send = Sys_DoubleTime () - send;
+
+	SV_CheckHuffTable ();
 
 // send a heartbeat to the master if needed
 	Master_Heartbeat ();
@@ -1233,6 +1861,8 @@ void SV_Frame (float time)
 // collect timing statistics
 	end = Sys_DoubleTime ();
 	svs.stats.active += end-start;
+	if (bench_frames)
+		SV_BenchFrame (send, end - start);
 	if (++svs.stats.count == STATFRAMES)
 	{
 		svs.stats.latched_active = svs.stats.active;
@@ -1368,16 +1998,25 @@ static void SV_InitLocal (void)
 
 	Cvar_RegisterVariable (&sv_ce_scale);
 	Cvar_RegisterVariable (&sv_ce_max_size);
+	Cvar_RegisterVariable (&sv_hufftables);
+	Cvar_RegisterVariable (&sv_sendthreads);
+	Cvar_SetCallback (&sv_sendthreads, SV_SendThreads_f);
+
+	SV_InitClientHash ();
 
 	Cmd_AddCommand ("addip", SV_AddIP_f);
 	Cmd_AddCommand ("removeip", SV_RemoveIP_f);
 	Cmd_AddCommand ("listip", SV_ListIP_f);
 	Cmd_AddCommand ("writeip", SV_WriteIP_f);
+	Cmd_AddCommand ("sendbench", SV_SendBench_f);
 
 	for (i = 0; i < MAX_MODELS; i++)
 		sprintf (localmodels[i], "*%i", i);
 
 	Info_SetValueForStarKey (svs.info, "*version", va("%4.2f", ENGINE_VERSION), MAX_SERVERINFO_STRING);
+	// 'e': escaped entity numbers, MAX_PACKET_ENTITIES per frame
+	// 'h': trained huffman tables, see SV_CheckHuffTable
+	Info_SetValueForStarKey (svs.info, "*cap", "eh", MAX_SERVERINFO_STRING);
 
 	// init fraglog stuff
 	svs.logsequence = 1;
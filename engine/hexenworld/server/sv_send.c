@@ -21,6 +21,7 @@
  */
 
 #include "quakedef.h"
+#include "threads.h"
 
 unsigned int	clients_multicast;
 
@@ -405,6 +406,8 @@ void SV_UpdateSoundPos (edict_t *entity, int channel)
 	vec3_t		origin;
 
 	ent = NUM_FOR_EDICT(entity);
+	if (ent >= OLD_MAX_EDICTS)
+		return;	// wasn't started on the entity, see SV_StartSound
 	channel = (ent<<3) | channel;
 
 	// use the entity origin unless it is a bmodel
@@ -471,6 +474,11 @@ void SV_StartSound (edict_t *entity, int channel, const char *sample, int volume
 	}
 
 	ent = NUM_FOR_EDICT(entity);
+	// sounds are multicast to every client, and the ones without the
+	// 'e' capability only know OLD_MAX_EDICTS entities: play the high
+	// ones as positioned world sounds.
+	if (ent >= OLD_MAX_EDICTS)
+		ent = 0;
 
 	if ((channel & PHS_OVERRIDE_R) || !sv_phs.integer)	// no PHS flag
 	{
@@ -813,47 +821,108 @@ static void SV_UpdateClientStats (client_t *client)
 }
 
 
+/*
+=============================================================================
+
+CLIENT DATAGRAMS
+
+Each spawned client's datagram is built from the world as it is after
+physics, into a buffer of its own, and only touches that client's own
+state, so with sv_sendthreads > 0 they are built by several send jobs at
+once.  Job j builds every sv_sendjobs'th client with entity workspace j.
+Everything that can print, error out or write shared state, the stats
+and the transmitting, stays on the main thread in client order, so the
+packets come out the same whatever the number of jobs.
+
+=============================================================================
+*/
+
+cvar_t	sv_sendthreads = {"sv_sendthreads", "0", CVAR_ARCHIVE};
+
+typedef struct
+{
+	sizebuf_t	msg;
+	qboolean	datagram_overflowed;
+	byte		buf[MAX_DATAGRAM];
+} clientsend_t;
+
+static	clientsend_t	sv_clientsend[MAX_CLIENTS];
+static	int		sv_sendlist[MAX_CLIENTS];
+static	int		sv_numsend;
+static	int		sv_sendjobs;
+
 /*
 =======================
-SV_SendClientDatagram
+SV_SendThreads_f
+
+Callback for sv_sendthreads
 =======================
 */
-static qboolean SV_SendClientDatagram (client_t *client)
+void SV_SendThreads_f (cvar_t *var)
 {
-	byte		buf[MAX_DATAGRAM];
-	sizebuf_t	msg;
+	Thread_WantWorkers (THREAD_SEND, var->integer);
+}
+
+/*
+=======================
+SV_BuildClientDatagram
+=======================
+*/
+static void SV_BuildClientDatagram (client_t *client, int job)
+{
+	clientsend_t	*send = &sv_clientsend[client - svs.clients];
 
-	SZ_Init (&msg, buf, sizeof(buf));
-	msg.allowoverflow = true;
+	SZ_Init (&send->msg, send->buf, sizeof(send->buf));
+	send->msg.allowoverflow = true;
 
 	// add the client specific data to the datagram
-	SV_WriteClientdataToMessage (client, &msg);
+	SV_WriteClientdataToMessage (client, &send->msg);
 
 	// send over all the objects that are in the PVS
 	// this will include clients, a packetentities, and
 	// possibly a nails update
-	SV_WriteEntitiesToClient (client, &msg);
+	SV_WriteEntitiesToClient (client, &send->msg, job);
 
 	// copy the accumulated multicast datagram
 	// for this client out to the message
-	if (client->datagram.overflowed)
-		Con_Printf ("WARNING: datagram overflowed for %s\n", client->name);
-	else
-		SZ_Write (&msg, client->datagram.data, client->datagram.cursize);
+	send->datagram_overflowed = client->datagram.overflowed;
+	if (!client->datagram.overflowed)
+		SZ_Write (&send->msg, client->datagram.data, client->datagram.cursize);
 	SZ_Clear (&client->datagram);
+}
+
+static void SV_SendJob (void *data, int job)
+{
+	int		i;
+
+	for (i = job; i < sv_numsend; i += sv_sendjobs)
+		SV_BuildClientDatagram (&svs.clients[sv_sendlist[i]], job);
+}
+
+/*
+=======================
+SV_SendClientDatagram
+=======================
+*/
+static qboolean SV_SendClientDatagram (client_t *client)
+{
+	clientsend_t	*send = &sv_clientsend[client - svs.clients];
+
+	if (send->datagram_overflowed)
+		Con_Printf ("WARNING: datagram overflowed for %s\n", client->name);
 
 	// send deltas over reliable stream
 	if (Netchan_CanReliable (&client->netchan))
 		SV_UpdateClientStats (client);
 
-	if (msg.overflowed)
+	if (send->msg.overflowed)
 	{
 		Con_Printf ("WARNING: msg overflowed for %s\n", client->name);
-		SZ_Clear (&msg);
+		SZ_Clear (&send->msg);
 	}
 
 	// send the datagram
-	Netchan_Transmit (&client->netchan, msg.cursize, buf);
+	Netchan_Transmit (&client->netchan, send->msg.cursize, send->buf);
 
 	return true;
 }
@@ -1054,13 +1123,16 @@ void SV_SendClientMessages (void)
 {
 	int			i;
 	client_t	*c;
+	qboolean	ready[MAX_CLIENTS];
 
 // update frags, names, etc
 	SV_UpdateToReliableMessages ();
 
-// build individual updates
+// find out who gets a packet this frame
+	sv_numsend = 0;
 	for (i = 0, c = svs.clients; i < MAX_CLIENTS; i++, c++)
 	{
+		ready[i] = false;
 		if (!c->state)
 			continue;
 		// if the reliable message overflowed,
@@ -1087,6 +1159,38 @@ void SV_SendClientMessages (void)
 			continue;		// bandwidth choke
 		}
 
+		ready[i] = true;
+		if (c->state == cs_spawned)
+			sv_sendlist[sv_numsend++] = i;
+	}
+
+// build the datagrams
+	sv_sendjobs = 1;
+	if (sv_sendthreads.integer > 0)
+	{
+		sv_sendjobs = sv_sendthreads.integer + 1;
+		if (sv_sendjobs > Thread_NumWorkers() + 1)
+			sv_sendjobs = Thread_NumWorkers() + 1;
+		if (sv_sendjobs > MAX_SEND_JOBS)
+			sv_sendjobs = MAX_SEND_JOBS;
+		if (sv_sendjobs > sv_numsend)
+			sv_sendjobs = sv_numsend;
+	}
+	if (sv_numsend)
+	{
+		SV_PrepareSendWork (sv_sendjobs);
+		if (sv_sendjobs > 1)
+			Thread_RunJobs (SV_SendJob, NULL, sv_sendjobs);
+		else
+			SV_SendJob (NULL, 0);
+		SV_CheckSendWork (sv_sendjobs);
+	}
+
+// and send them in order
+	for (i = 0, c = svs.clients; i < MAX_CLIENTS; i++, c++)
+	{
+		if (!ready[i])
+			continue;
 		if (c->state == cs_spawned)
 			SV_SendClientDatagram (c);
 		else
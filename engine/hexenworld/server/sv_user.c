@@ -114,6 +114,8 @@ static void SV_New_f (void)
 // send server info string
 	MSG_WriteByte (&host_client->netchan.message, svc_stufftext);
 	MSG_WriteString (&host_client->netchan.message, va("fullserverinfo \"%s\"\n", svs.info) );
+
+	SV_WriteHuffTable (host_client);
 }
 
 /*
@@ -350,6 +352,7 @@ static void SV_Spawn_f (void)
 		ent->v.team = 0;	// FIXME
 
 	ent->v.netname = PR_SetEngineString(host_client->name);
+	ED_FindDirty (ent);
 	//ent->v.playerclass = host_client->playerclass = 
 	ent->v.next_playerclass = host_client->next_playerclass;
 	ent->v.has_portals = host_client->portals;
@@ -867,6 +870,21 @@ static void SV_PTrack_f (void)
 	host_client->spec_track = i + 1; // now tracking
 }
 
+/*
+=================
+SV_HuffTable_f
+
+The client installed a trained huffman table (svc_hufftable):
+code the packets to it with that table from now on.
+=================
+*/
+static void SV_HuffTable_f (void)
+{
+	if (host_client->hufftables && host_client->huffsent != 0 &&
+			atoi(Cmd_Argv(1)) == host_client->huffsent)
+		host_client->netchan.huffgen = host_client->huffsent;
+}
+
 /*
 =================
 SV_Rate_f
@@ -1006,6 +1024,8 @@ static ucmd_t ucmds[] =
 
 	{"ptrack", SV_PTrack_f}, //ZOID - used with autocam
 
+	{"hufftable", SV_HuffTable_f},
+
 	{NULL, NULL}
 };
 
@@ -1210,6 +1230,274 @@ static void AddAllEntsToPmove (void)
 }
 #endif
 
+/*
+=============================================================================
+
+PMOVE RECORDING
+
+"pmrecord <file>" writes the input of every PlayerMove the server
+runs, physents and all, plus where it ended up.  "pmbench <file>"
+replays such a recording on the same map and reports the time per
+move and how many moves didn't end where they did when recorded.
+The files are in the machine's own byte order: they're meant for
+tracking pmove costs on one machine, not for passing around.
+
+=============================================================================
+*/
+
+#define	PMREC_VERSION	1
+
+typedef struct
+{
+	char		id[4];		// "PMRC"
+	int		version;
+	char		mapname[64];
+} pmrecheader_t;
+
+typedef struct
+{
+	movevars_t	movevars;
+	vec3_t		origin, angles, velocity;
+	int		oldbuttons;
+	float		waterjumptime;
+	float		teleport_time;	// relative to realtime
+	int		dead, spectator, movetype, crouched;
+	float		hasted;
+	usercmd_t	cmd;
+	int		numphysent;	// pmrecent_t that follow, the world excluded
+	vec3_t		end_origin, end_velocity;
+} pmrecord_t;
+
+typedef struct
+{
+	vec3_t		origin, angles, mins, maxs;
+	int		modelindex;	// 0 for a box
+	int		info;
+} pmrecent_t;
+
+static FILE		*pmrec_file;
+static char		pmrec_map[64];
+static pmrecord_t	pmrec;
+
+static void SV_PmoveRecordInput (void)
+{
+	if (strcmp(sv.name, pmrec_map))
+	{	// the physents wouldn't make sense on the next map
+		SV_PmoveRecord_f ();
+		return;
+	}
+	pmrec.movevars = movevars;
+	VectorCopy (pmove.origin, pmrec.origin);
+	VectorCopy (pmove.angles, pmrec.angles);
+	VectorCopy (pmove.velocity, pmrec.velocity);
+	pmrec.oldbuttons = pmove.oldbuttons;
+	pmrec.waterjumptime = pmove.waterjumptime;
+	pmrec.teleport_time = pmove.teleport_time - realtime;
+	pmrec.dead = pmove.dead;
+	pmrec.spectator = pmove.spectator;
+	pmrec.movetype = pmove.movetype;
+	pmrec.crouched = pmove.crouched;
+	pmrec.hasted = pmove.hasted;
+	pmrec.cmd = pmove.cmd;
+	pmrec.numphysent = pmove.numphysent - 1;
+}
+
+static void SV_PmoveRecordResult (void)
+{
+	pmrecent_t	ent;
+	physent_t	*pe;
+	int		i;
+
+	VectorCopy (pmove.origin, pmrec.end_origin);
+	VectorCopy (pmove.velocity, pmrec.end_velocity);
+	fwrite (&pmrec, sizeof(pmrec), 1, pmrec_file);
+
+	for (i = 1, pe = pmove.physents + 1; i < pmove.numphysent; i++, pe++)
+	{
+		memset (&ent, 0, sizeof(ent));
+		VectorCopy (pe->origin, ent.origin);
+		VectorCopy (pe->angles, ent.angles);
+		VectorCopy (pe->mins, ent.mins);
+		VectorCopy (pe->maxs, ent.maxs);
+		if (pe->model)
+			ent.modelindex = (int) EDICT_NUM(pe->info)->v.modelindex;
+		ent.info = pe->info;
+		fwrite (&ent, sizeof(ent), 1, pmrec_file);
+	}
+}
+
+/*
+==================
+SV_PmoveRecord_f
+==================
+*/
+void SV_PmoveRecord_f (void)
+{
+	pmrecheader_t	header;
+	const char	*name;
+
+	if (pmrec_file)
+	{
+		Con_Printf ("pmove recording stopped.\n");
+		fclose (pmrec_file);
+		pmrec_file = NULL;
+		return;
+	}
+	if (Cmd_Argc() != 2)
+	{
+		Con_Printf ("pmrecord <file> : record player moves\n"
+			    "pmrecord : stop recording\n");
+		return;
+	}
+	if (sv.state != ss_active)
+	{
+		Con_Printf ("No map running\n");
+		return;
+	}
+
+	name = FS_MakePath(FS_USERDIR, NULL, Cmd_Argv(1));
+	pmrec_file = fopen (name, "wb");
+	if (!pmrec_file)
+	{
+		Con_Printf ("Couldn't open %s\n", name);
+		return;
+	}
+	Con_Printf ("Recording player moves to %s.\n", name);
+
+	memset (&header, 0, sizeof(header));
+	memcpy (header.id, "PMRC", 4);
+	header.version = PMREC_VERSION;
+	q_strlcpy (header.mapname, sv.name, sizeof(header.mapname));
+	q_strlcpy (pmrec_map, sv.name, sizeof(pmrec_map));
+	fwrite (&header, sizeof(header), 1, pmrec_file);
+}
+
+/*
+==================
+SV_PmoveBench_f
+==================
+*/
+void SV_PmoveBench_f (void)
+{
+	static playermove_t	saved;
+	movevars_t	savedvars;
+	pmrecheader_t	header;
+	pmrecord_t	rec;
+	pmrecent_t	ent;
+	physent_t	*pe;
+	FILE		*f;
+	const char	*name;
+	double		start, time;
+	int		i, loops, loop, moves, physents, differ;
+
+	if (Cmd_Argc() < 2)
+	{
+		Con_Printf ("pmbench <file> [loops] : replay recorded player moves\n");
+		return;
+	}
+	if (sv.state != ss_active)
+	{
+		Con_Printf ("No map running\n");
+		return;
+	}
+	loops = (Cmd_Argc() > 2) ? atoi(Cmd_Argv(2)) : 1;
+	if (loops < 1)
+		loops = 1;
+
+	name = FS_MakePath(FS_USERDIR, NULL, Cmd_Argv(1));
+	f = fopen (name, "rb");
+	if (!f)
+	{
+		Con_Printf ("Couldn't open %s\n", name);
+		return;
+	}
+	if (fread (&header, sizeof(header), 1, f) != 1 ||
+			memcmp (header.id, "PMRC", 4) || header.version != PMREC_VERSION)
+	{
+		Con_Printf ("%s is not a pmove recording\n", name);
+		fclose (f);
+		return;
+	}
+	header.mapname[sizeof(header.mapname) - 1] = 0;
+	if (strcmp (header.mapname, sv.name))
+	{
+		Con_Printf ("%s was recorded on %s\n", name, header.mapname);
+		fclose (f);
+		return;
+	}
+
+	saved = pmove;
+	savedvars = movevars;
+	time = 0;
+	moves = physents = differ = 0;
+
+	for (loop = 0; loop < loops; loop++)
+	{
+		fseek (f, sizeof(header), SEEK_SET);
+		while (fread (&rec, sizeof(rec), 1, f) == 1)
+		{
+			if (rec.numphysent < 0 || rec.numphysent >= MAX_PHYSENTS)
+				break;
+			pmove.numphysent = 1;
+			pmove.physents[0].model = sv.worldmodel;
+			for (i = 0; i < rec.numphysent; i++)
+			{
+				if (fread (&ent, sizeof(ent), 1, f) != 1)
+					break;
+				if (ent.modelindex < 0 || ent.modelindex >= MAX_MODELS)
+					continue;
+				pe = &pmove.physents[pmove.numphysent++];
+				VectorCopy (ent.origin, pe->origin);
+				VectorCopy (ent.angles, pe->angles);
+				VectorCopy (ent.mins, pe->mins);
+				VectorCopy (ent.maxs, pe->maxs);
+				pe->model = ent.modelindex ? sv.models[ent.modelindex] : NULL;
+				pe->info = ent.info;
+			}
+			if (i != rec.numphysent)
+				break;
+
+			movevars = rec.movevars;
+			VectorCopy (rec.origin, pmove.origin);
+			VectorCopy (rec.angles, pmove.angles);
+			VectorCopy (rec.velocity, pmove.velocity);
+			pmove.oldbuttons = rec.oldbuttons;
+			pmove.waterjumptime = rec.waterjumptime;
+			pmove.teleport_time = realtime + rec.teleport_time;
+			pmove.dead = rec.dead;
+			pmove.spectator = rec.spectator;
+			pmove.movetype = rec.movetype;
+			pmove.crouched = rec.crouched;
+			pmove.hasted = rec.hasted;
+			pmove.cmd = rec.cmd;
+
+			start = Sys_DoubleTime ();
+			PlayerMove ();
+			time += Sys_DoubleTime () - start;
+
+			moves++;
+			physents += pmove.numphysent;
+			if (!VectorCompare(pmove.origin, rec.end_origin) ||
+					!VectorCompare(pmove.velocity, rec.end_velocity))
+				differ++;
+		}
+	}
+
+	fclose (f);
+	pmove = saved;
+	movevars = savedvars;
+
+	if (!moves)
+	{
+		Con_Printf ("%s has no moves\n", name);
+		return;
+	}
+	Con_Printf ("%d moves, %.2f usec per move, %.1f physents per move, "
+		    "%d ended elsewhere\n", moves, time * 1.0e6 / moves,
+		    (float) physents / moves, differ);
+}
+
+
 /*
 ===========
 SV_PreRunCmd
@@ -1336,7 +1624,11 @@ static void SV_RunCmd (usercmd_t *ucmd)
 			Con_Printf ("player %s got stuck in playermove!!!!\n", host_client->name);
 	}
 #else
+	if (pmrec_file)
+		SV_PmoveRecordInput ();
 	PlayerMove ();
+	if (pmrec_file)
+		SV_PmoveRecordResult ();
 #endif
 
 	host_client->oldbuttons = pmove.oldbuttons;
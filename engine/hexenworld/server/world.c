@@ -236,6 +236,269 @@ static areanode_t *SV_CreateAreaNode (int depth, vec3_t mins, vec3_t maxs)
 	return anode;
 }
 
+/*
+===============================================================================
+
+EDICT GRID
+
+A coarse hash grid over the bounding box centres of all edicts, used to
+find the candidates for the findradius builtin.  Edicts are marked dirty
+whenever they might have moved: when they are linked or unlinked, when
+they are cleared or parsed, or when progs take the address of their
+origin, mins or maxs.  Dirty edicts are rehashed by the next query, and
+every edict is rehashed on the first query of a server frame to catch
+anything that was changed behind our back.
+
+===============================================================================
+*/
+
+#define	GRID_CELLSIZE	256
+#define	GRID_LIMIT	(1 << 20)	/* cell coordinates are clamped to this */
+#define	GRID_HASHSIZE	512		/* must be a power of two */
+#define	GRID_NOCELL	GRID_HASHSIZE	/* bucket for NaN centres */
+#define	GRID_MAXCELLS	(GRID_HASHSIZE / 4)
+
+static	int		grid_head[GRID_HASHSIZE + 1];
+static	int		grid_next[MAX_EDICTS];
+static	int		grid_prev[MAX_EDICTS];
+static	int		grid_bucket[MAX_EDICTS];	// -1 if not in the grid
+static	int		grid_dirty[MAX_EDICTS];
+static	int		grid_numdirty;
+static	byte		grid_isdirty[MAX_EDICTS];
+static	unsigned int	grid_found[(MAX_EDICTS + 31) / 32];
+static	double		grid_synctime;
+
+gridstats_t	sv_gridstats;
+
+/*
+===============
+SV_ClearGrid
+
+===============
+*/
+static void SV_ClearGrid (void)
+{
+	int		i;
+
+	for (i = 0; i <= GRID_HASHSIZE; i++)
+		grid_head[i] = -1;
+	for (i = 0; i < MAX_EDICTS; i++)
+		grid_bucket[i] = -1;
+	memset (grid_isdirty, 0, sizeof(grid_isdirty));
+	grid_numdirty = 0;
+	grid_synctime = -1;
+	memset (&sv_gridstats, 0, sizeof(sv_gridstats));
+}
+
+/*
+===============
+SV_GridCell
+
+===============
+*/
+static int SV_GridCell (double v)
+{
+	v = floor (v / GRID_CELLSIZE);
+	if (v < -GRID_LIMIT)
+		return -GRID_LIMIT;
+	if (v > GRID_LIMIT)
+		return GRID_LIMIT;
+	return (int) v;
+}
+
+static int SV_GridHash (int x, int y)
+{
+	return (int)(((unsigned int)x * 73856093U) ^ ((unsigned int)y * 19349663U)) & (GRID_HASHSIZE - 1);
+}
+
+/*
+===============
+SV_GridBucket
+
+Same centre as PF_findradius uses
+===============
+*/
+static int SV_GridBucket (edict_t *ent)
+{
+	double	c[2];
+	float	f;
+	int		i;
+
+	for (i = 0; i < 2; i++)
+	{
+		c[i] = ent->v.origin[i] + (ent->v.mins[i] + ent->v.maxs[i]) * 0.5;
+		f = (float) c[i];
+		if (IS_NAN(f))
+			return GRID_NOCELL;
+	}
+
+	return SV_GridHash (SV_GridCell(c[0]), SV_GridCell(c[1]));
+}
+
+/*
+===============
+SV_GridUpdate
+
+===============
+*/
+static void SV_GridUpdate (int num)
+{
+	edict_t	*ent;
+	int		bucket;
+
+	ent = EDICT_NUM(num);
+	if (ent->free || num >= sv.num_edicts)
+		bucket = -1;
+	else
+		bucket = SV_GridBucket (ent);
+
+	if (bucket == grid_bucket[num])
+		return;
+
+	if (grid_bucket[num] != -1)
+	{
+		if (grid_prev[num] != -1)
+			grid_next[grid_prev[num]] = grid_next[num];
+		else
+			grid_head[grid_bucket[num]] = grid_next[num];
+		if (grid_next[num] != -1)
+			grid_prev[grid_next[num]] = grid_prev[num];
+	}
+
+	grid_bucket[num] = bucket;
+	if (bucket != -1)
+	{
+		grid_prev[num] = -1;
+		grid_next[num] = grid_head[bucket];
+		if (grid_head[bucket] != -1)
+			grid_prev[grid_head[bucket]] = num;
+		grid_head[bucket] = num;
+	}
+}
+
+/*
+===============
+SV_GridDirty
+
+Called whenever ent might have moved
+===============
+*/
+void SV_GridDirty (edict_t *ent)
+{
+	int		num;
+
+	num = ((byte *)ent - (byte *)sv.edicts) / pr_edict_size;
+	if (num <= 0 || num >= MAX_EDICTS || grid_isdirty[num])
+		return;
+	grid_isdirty[num] = 1;
+	grid_dirty[grid_numdirty++] = num;
+}
+
+/*
+===============
+SV_GridSync
+
+Dirty edicts stay dirty until the next frame: progs may take the
+address of a field, run a query and only then store to the field.
+===============
+*/
+static void SV_GridSync (void)
+{
+	int		i;
+
+	if (grid_synctime != sv.time)
+	{
+		for (i = 1; i < sv.num_edicts; i++)
+			SV_GridUpdate (i);
+		for (i = 0; i < grid_numdirty; i++)
+			grid_isdirty[grid_dirty[i]] = 0;
+		grid_numdirty = 0;
+		grid_synctime = sv.time;
+		return;
+	}
+
+	for (i = 0; i < grid_numdirty; i++)
+		SV_GridUpdate (grid_dirty[i]);
+}
+
+/*
+===============
+SV_GridFindRadius
+
+Fills list with the numbers of all edicts whose centre might be within
+rad units of org, in ascending order.  Returns the number of edicts in
+list, or -1 if the caller has to check all of them.
+===============
+*/
+int SV_GridFindRadius (const float *org, float rad, int *list)
+{
+	double	r;
+	int		x, y, x0, y0, x1, y1;
+	int		i, j, num, count;
+	unsigned int	bits;
+
+	sv_gridstats.queries++;
+
+	if (IS_NAN(rad) || IS_NAN(org[0]) || IS_NAN(org[1]))
+	{
+		sv_gridstats.fullscans++;
+		return -1;
+	}
+	// generous margin for the rounding in PF_findradius
+	r = fabs(rad) * 1.001 + 1;
+	x0 = SV_GridCell (org[0] - r);
+	x1 = SV_GridCell (org[0] + r);
+	y0 = SV_GridCell (org[1] - r);
+	y1 = SV_GridCell (org[1] + r);
+	if ((double)(x1 - x0 + 1) * (y1 - y0 + 1) > GRID_MAXCELLS)
+	{
+		sv_gridstats.fullscans++;
+		return -1;
+	}
+
+	SV_GridSync ();
+
+	// several cells may share a bucket, so collect into a bit set
+	memset (grid_found, 0, sizeof(grid_found));
+	for (x = x0; x <= x1; x++)
+	{
+		for (y = y0; y <= y1; y++)
+		{
+			for (num = grid_head[SV_GridHash(x, y)]; num != -1; num = grid_next[num])
+				grid_found[num >> 5] |= 1U << (num & 31);
+		}
+	}
+	for (num = grid_head[GRID_NOCELL]; num != -1; num = grid_next[num])
+		grid_found[num >> 5] |= 1U << (num & 31);
+
+	count = 0;
+	for (i = 0; i < (int)(sizeof(grid_found) / sizeof(grid_found[0])); i++)
+	{
+		for (bits = grid_found[i], j = 0; bits; bits >>= 1, j++)
+		{
+			if (bits & 1)
+				list[count++] = (i << 5) + j;
+		}
+	}
+
+	sv_gridstats.candidates += count;
+	return count;
+}
+
+/*
+===============
+SV_GridStats_f
+
+===============
+*/
+void SV_GridStats_f (void)
+{
+	Con_Printf ("findradius: %d queries, %d full scans\n",
+			sv_gridstats.queries, sv_gridstats.fullscans);
+	Con_Printf ("%.0f candidates examined, %.0f returned\n",
+			sv_gridstats.candidates, sv_gridstats.found);
+}
+
 /*
 ===============
 SV_ClearWorld
@@ -249,6 +512,8 @@ void SV_ClearWorld (void)
 	memset (sv_areanodes, 0, sizeof(sv_areanodes));
 	sv_numareanodes = 0;
 	SV_CreateAreaNode (0, sv.worldmodel->mins, sv.worldmodel->maxs);
+
+	SV_ClearGrid ();
 }
 
 
@@ -263,6 +528,7 @@ static link_t	**sv_link_prev;
 
 void SV_UnlinkEdict (edict_t *ent)
 {
+	SV_GridDirty (ent);
 	if (!ent->area.prev)
 		return;		// not linked in anywhere
 	RemoveLink (&ent->area);
@@ -417,6 +683,8 @@ void SV_LinkEdict (edict_t *ent, qboolean touch_triggers)
 {
 	areanode_t	*node;
 
+	SV_GridDirty (ent);
+
 	if (ent->area.prev)
 		SV_UnlinkEdict (ent);	// unlink from old position
 
@@ -75,6 +75,30 @@ void SV_LinkEdict (edict_t *ent, qboolean touch_triggers);
 // sets ent->v.absmin and ent->v.absmax
 // if touchtriggers, calls prog functions for the intersected triggers
 
+typedef struct
+{
+	int		queries;
+	int		fullscans;	// queries which had to check every edict
+	double	candidates;	// edicts examined by findradius
+	double	found;		// edicts returned by findradius
+} gridstats_t;
+
+extern	gridstats_t	sv_gridstats;
+
+void SV_GridDirty (edict_t *ent);
+// call whenever ent might have moved without being relinked
+
+// progs took the address of origin, mins or maxs
+#define	SV_GRID_FIELD(ofs)						\
+	((unsigned int)((ofs) - (int)(offsetof(entvars_t, origin) / 4)) < 3 ||	\
+	 (unsigned int)((ofs) - (int)(offsetof(entvars_t, mins) / 4)) < 6)
+
+int SV_GridFindRadius (const float *org, float rad, int *list);
+// fills list with the edicts whose centre might be within rad units of
+// org, in ascending order.  returns -1 if all edicts have to be checked
+
+void SV_GridStats_f (void);
+
 int SV_PointContents (vec3_t p);
 // returns the CONTENTS_* value from the world at the given point.
 // does not check any entities at all
@@ -22,16 +22,10 @@
 #include "huffman.h"
 /* h2w engine includes */
 #undef	USE_INTEL_ASM
-/* use Hunk_Alloc or malloc : */
-#define USE_HUNKMEM	1
 #include "arch_def.h"
 #include "sys.h"
 #include "printsys.h"
-#if defined(PLATFORM_DOS)
-#undef  USE_HUNKMEM
-#define USE_HUNKMEM	1
-#endif
-#if USE_HUNKMEM
+#if _DEBUG_HUFFMAN
 #include "zone.h"
 #endif
 #define HuffPrintf	Sys_Printf
@@ -52,13 +46,45 @@ typedef struct huffnode_s
 
 typedef struct
 {
-	unsigned int	bits;
+	unsigned int	bits;	// the code, first bit in bit 0
 	int		len;
 } hufftab_t;
 
-static void *HuffMemBase = NULL;
-static huffnode_t *HuffTree = NULL;
-static hufftab_t HuffLookup[256];
+// the decoder looks up this many bits at a time, codes
+// that are longer continue down the tree from there.
+#define	HUFF_LOOKUP_BITS	10
+#define	HUFF_LOOKUP_SIZE	(1 << HUFF_LOOKUP_BITS)
+
+typedef struct
+{
+	unsigned short	val;	// symbol, or the node to continue from
+	unsigned short	len;	// 0 if the code is longer than HUFF_LOOKUP_BITS
+} huffdec_t;
+
+typedef struct
+{
+	int		generation;	// 0: not built
+	huffnode_t	*tree;
+	huffnode_t	nodes[512];
+	hufftab_t	lookup[256];
+	huffdec_t	decode[HUFF_LOOKUP_SIZE];
+} hufftable_t;
+
+// the static table and the two trained slots: a new trained
+// table goes into the slot that the previous one isn't using,
+// so that the packets still in flight can be decoded.
+static hufftable_t	HuffTables[3];
+#define	HuffStatic	(&HuffTables[0])
+#define	HuffSlot(gen)	(&HuffTables[1 + ((gen) & 1)])
+
+// the first byte of a packet is the number of padding bits,
+// 0xff for a packet that is sent as is, or for the trained
+// tables HUFF_TRAINED | slot << 3 | padding
+#define	HUFF_RAW	0xff
+#define	HUFF_TRAINED	0x10
+
+static unsigned int	HuffCounts[256];	// see HuffTrain
+static unsigned int	HuffCounted;
 
 #ifdef _MSC_VER
 #pragma warning(disable:4305)
@@ -125,7 +151,7 @@ void PrintFreqs (void)
 // huffman functions
 //
 
-static void FindTab (huffnode_t *tmp, int len, unsigned int bits)
+static void FindTab (hufftable_t *t, huffnode_t *tmp, int len, unsigned int bits)
 {
 	if (!tmp)
 		Sys_Error("no huff node");
@@ -136,60 +162,53 @@ static void FindTab (huffnode_t *tmp, int len, unsigned int bits)
 			Sys_Error("no one in node");
 		if (len >= 32)
 			Sys_Error("compression screwd");
-		FindTab (tmp->zero, len+1, bits<<1);
-		FindTab (tmp->one, len+1, (bits<<1)|1);
+		FindTab (t, tmp->zero, len+1, bits);
+		FindTab (t, tmp->one, len+1, bits | (1U << len));
 		return;
 	}
 
-	HuffLookup[tmp->val].len = len;
-	HuffLookup[tmp->val].bits = bits;
-	return;
+	t->lookup[tmp->val].len = len;
+	t->lookup[tmp->val].bits = bits;
 }
 
-static unsigned char const Masks[8] =
+/*
+fills the decode entries of every HUFF_LOOKUP_BITS wide index
+whose low bits are the code that leads to tmp.
+*/
+static void FindDecode (hufftable_t *t, huffnode_t *tmp, int len, unsigned int bits)
 {
-	0x1,
-	0x2,
-	0x4,
-	0x8,
-	0x10,
-	0x20,
-	0x40,
-	0x80
-};
+	unsigned int	i;
 
-static void PutBit (unsigned char *buf, int pos, int bit)
-{
-	if (bit)
-		buf[pos/8] |= Masks[pos%8];
-	else
-		buf[pos/8] &=~Masks[pos%8];
-}
+	if (tmp->zero && len < HUFF_LOOKUP_BITS)
+	{
+		FindDecode (t, tmp->zero, len+1, bits);
+		FindDecode (t, tmp->one, len+1, bits | (1U << len));
+		return;
+	}
 
-static int GetBit (const unsigned char *buf, int pos)
-{
-	if (buf[pos/8] & Masks[pos%8])
-		return 1;
-	else
-		return 0;
+	if (tmp->zero)
+	{	// longer than the lookup, continue from this node
+		t->decode[bits].val = (unsigned short)(tmp - t->nodes);
+		t->decode[bits].len = 0;
+		return;
+	}
+
+	for (i = bits; i < HUFF_LOOKUP_SIZE; i += 1U << len)
+	{
+		t->decode[i].val = tmp->val;
+		t->decode[i].len = len;
+	}
 }
 
-static void BuildTree (const float *freq)
+static void BuildTree (hufftable_t *t, const float *freq)
 {
 	float	min1, min2;
 	int	i, j, minat1, minat2;
 	huffnode_t	*work[256];
 	huffnode_t	*tmp;
 
-#if USE_HUNKMEM
-	HuffMemBase = Hunk_AllocName(512 * sizeof(huffnode_t), "hufftree");
-#else
-	HuffMemBase = malloc(512 * sizeof(huffnode_t));
-	if (!HuffMemBase)
-		Sys_Error("Failed allocating memory for HuffTree");
-	memset(HuffMemBase, 0, 512 * sizeof(huffnode_t));
-#endif
-	tmp = (huffnode_t *) HuffMemBase;
+	memset (t->nodes, 0, sizeof(t->nodes));
+	tmp = t->nodes;
 
 	for (i = 0; i < 256; tmp++, i++)
 	{
@@ -197,7 +216,7 @@ static void BuildTree (const float *freq)
 		tmp->freq = freq[i];
 		tmp->zero = NULL;
 		tmp->one = NULL;
-		HuffLookup[i].len = 0;
+		t->lookup[i].len = 0;
 		work[i] = tmp;
 	}
 
@@ -237,25 +256,53 @@ static void BuildTree (const float *freq)
 		work[minat2] = NULL;
 	}
 
-	HuffTree = --tmp; // last incrementation in the loop above wasn't used
-	FindTab (HuffTree, 0, 0);
+	t->tree = --tmp; // last incrementation in the loop above wasn't used
+	FindTab (t, t->tree, 0, 0);
+	FindDecode (t, t->tree, 0, 0);
 
 #if _DEBUG_HUFFMAN
 	for (i = 0; i < 256; i++)
 	{
-		if (!HuffLookup[i].len && HuffLookup[i].len <= 32)
+		if (!t->lookup[i].len && t->lookup[i].len <= 32)
 		{
-		//	HuffPrintf("%d %d %2X\n", HuffLookup[i].len, HuffLookup[i].bits, i);
+		//	HuffPrintf("%d %d %2X\n", t->lookup[i].len, t->lookup[i].bits, i);
 			Sys_Error("bad frequency table");
 		}
 	}
 #endif	/* _DEBUG_HUFFMAN */
 }
 
+/*
+==================
+HuffPacketTable
+
+Returns the table a packet was encoded with: 0 for the static
+one, the generation for a trained one, -1 if it isn't known or
+the packet was sent as is.
+==================
+*/
+int HuffPacketTable (const unsigned char *in, int inlen)
+{
+	hufftable_t	*t;
+
+	if (inlen < 1 || *in == HUFF_RAW)
+		return -1;
+	if (*in < 8)
+		return 0;
+	if ((*in & 0xf0) != HUFF_TRAINED)
+		return -1;
+	t = HuffSlot(*in >> 3);
+	return t->generation ? t->generation : -1;
+}
+
 void HuffDecode (const unsigned char *in, unsigned char *out, int inlen, int *outlen, const int maxlen)
 {
+	const hufftable_t	*t;
+	const huffdec_t	*d;
+	const huffnode_t	*tmp;
+	uint64_t	acc;
+	int	accbits, pos, len, sym;
 	int	bits, tbits;
-	huffnode_t	*tmp;
 
 	--inlen;
 	if (inlen < 0)
@@ -263,7 +310,7 @@ void HuffDecode (const unsigned char *in, unsigned char *out, int inlen, int *ou
 		*outlen = 0;
 		return;
 	}
-	if (*in == 0xff)
+	if (*in == HUFF_RAW)
 	{
 		if (inlen > maxlen)
 			memcpy (out, in+1, maxlen);
@@ -273,59 +320,119 @@ void HuffDecode (const unsigned char *in, unsigned char *out, int inlen, int *ou
 		return;
 	}
 
-	tbits = inlen*8 - *in;
+	if (*in < 8)
+		t = HuffStatic;
+	else if ((*in & 0xf0) == HUFF_TRAINED && HuffSlot(*in >> 3)->generation)
+		t = HuffSlot(*in >> 3);
+	else
+	{	// a table we don't have
+		*outlen = 0;
+		return;
+	}
+
+	tbits = inlen*8 - (*in & 7);
 	bits = 0;
 	*outlen = 0;
 
+	acc = 0;
+	accbits = 0;
+	pos = 0;
+	in++;
+
 	while (bits < tbits)
 	{
-		tmp = HuffTree;
-		do
+		// keep at least 32 bits in the accumulator, zeros
+		// past the end of the packet
+		while (accbits <= 56)
+		{
+			if (pos < inlen)
+				acc |= (uint64_t)in[pos] << accbits;
+			pos++;
+			accbits += 8;
+		}
+
+		d = &t->decode[acc & (HUFF_LOOKUP_SIZE - 1)];
+		len = d->len;
+		if (len)
+		{
+			sym = d->val;
+			acc >>= len;
+		}
+		else
 		{
-			if ( GetBit(in+1, bits) )
-				tmp = tmp->one;
-			else
-				tmp = tmp->zero;
-			bits++;
-		} while (tmp->zero);
+			tmp = &t->nodes[d->val];
+			acc >>= HUFF_LOOKUP_BITS;
+			len = HUFF_LOOKUP_BITS;
+			do
+			{
+				tmp = (acc & 1) ? tmp->one : tmp->zero;
+				acc >>= 1;
+				len++;
+			} while (tmp->zero);
+			sym = tmp->val;
+		}
+		accbits -= len;
+		bits += len;
 
 		if ( ++(*outlen) > maxlen )
 			return;	// out[maxlen - 1] is written already
-		*out++ = tmp->val;
+		*out++ = (unsigned char)sym;
 	}
 }
 
-void HuffEncode (const unsigned char *in, unsigned char *out, int inlen, int *outlen)
+static void HuffEncodeTable (const hufftable_t *t, const unsigned char *in, unsigned char *out, int inlen, int *outlen)
 {
-	int	i, j, bitat;
-	unsigned int	t;
+	const hufftab_t	*c;
+	uint64_t	acc;
+	int	i, accbits, size;
+	unsigned char	*o;
 #if _DEBUG_HUFFMAN
 	unsigned char	*buf;
 	int	tlen;
 #endif	/* _DEBUG_HUFFMAN */
 
-	bitat = 0;
+	acc = 0;
+	accbits = 0;
+	o = out + 1;
 
 	for (i = 0; i < inlen; i++)
 	{
-		t = HuffLookup[in[i]].bits;
-		for (j = 0; j < HuffLookup[in[i]].len; j++)
+		c = &t->lookup[in[i]];
+		acc |= (uint64_t)c->bits << accbits;
+		accbits += c->len;
+		if (accbits >= 32)
 		{
-			PutBit (out+1, bitat + HuffLookup[in[i]].len-j-1, t&1);
-			t >>= 1;
+			if (o + 4 - (out + 1) >= inlen)
+				break;	// won't be any smaller than the input
+			o[0] = (unsigned char)acc;
+			o[1] = (unsigned char)(acc >> 8);
+			o[2] = (unsigned char)(acc >> 16);
+			o[3] = (unsigned char)(acc >> 24);
+			o += 4;
+			acc >>= 32;
+			accbits -= 32;
 		}
-		bitat += HuffLookup[in[i]].len;
 	}
 
-	*outlen = 1 + (bitat + 7)/8;
-	*out = 8 * ((*outlen)-1) - bitat;
-
-	if (*outlen >= inlen+1)
+	size = (int)(o - (out + 1)) + (accbits + 7) / 8;
+	if (i < inlen || size >= inlen)
 	{
-		*out = 0xff;
+		*out = HUFF_RAW;
 		memcpy (out+1, in, inlen);
 		*outlen = inlen+1;
 	}
+	else
+	{
+		for ( ; accbits > 0; accbits -= 8)
+		{
+			*o++ = (unsigned char)acc;
+			acc >>= 8;
+		}
+		*outlen = 1 + size;
+		*out = -accbits;	// the padding bits
+		if (t != HuffStatic)
+			*out |= HUFF_TRAINED | ((t->generation & 1) << 3);
+	}
 
 #if _DEBUG_HUFFMAN
 	HuffIn += inlen;
@@ -346,10 +453,139 @@ void HuffEncode (const unsigned char *in, unsigned char *out, int inlen, int *ou
 #endif	/* _DEBUG_HUFFMAN */
 }
 
+void HuffEncode (const unsigned char *in, unsigned char *out, int inlen, int *outlen)
+{
+	HuffEncodeTable (HuffStatic, in, out, inlen, outlen);
+}
+
+/*
+==================
+HuffEncodeWith
+
+Encodes with the trained table of the given generation, or with
+the static one if that table isn't there (any more).
+==================
+*/
+void HuffEncodeWith (int generation, const unsigned char *in, unsigned char *out, int inlen, int *outlen)
+{
+	hufftable_t	*t = HuffSlot(generation);
+
+	if (generation && t->generation == generation)
+		HuffEncodeTable (t, in, out, inlen, outlen);
+	else
+		HuffEncodeTable (HuffStatic, in, out, inlen, outlen);
+}
+
+
+//=============================================================================
+
+//
+// trained tables
+//
+
+/*
+==================
+HuffSetTable
+
+Builds the trained table of the given generation (1-255) from
+256 symbol counts.  The counts are whole numbers that sum up to
+less than 2^24, so the float tree is built exactly the same by
+the server and every client.
+==================
+*/
+void HuffSetTable (int generation, const unsigned short *counts)
+{
+	float	freq[256];
+	int	i;
+
+	for (i = 0; i < 256; i++)
+		freq[i] = counts[i] ? counts[i] : 1;
+	BuildTree (HuffSlot(generation), freq);
+	HuffSlot(generation)->generation = generation;
+}
+
+void HuffResetTables (void)
+{
+	HuffTables[1].generation = 0;
+	HuffTables[2].generation = 0;
+}
+
+/*
+==================
+HuffTrain
+
+Counts the bytes of a packet that is about to be encoded, for
+HuffTrainedTable.  CalcFreq, minus the debug build.
+==================
+*/
+void HuffTrain (const unsigned char *in, int inlen)
+{
+	int	i;
+
+	for (i = 0; i < inlen; i++)
+		HuffCounts[in[i]]++;
+	HuffCounted += inlen;
+}
+
+void HuffTrainReset (void)
+{
+	memset (HuffCounts, 0, sizeof(HuffCounts));
+	HuffCounted = 0;
+}
+
+int HuffTrainedBytes (void)
+{
+	return (int)HuffCounted;
+}
+
+/*
+==================
+HuffTrainedTable
+
+Scales the counts gathered by HuffTrain down to HuffSetTable's
+range and returns how many bits a table built from them would
+have taken for those bytes, per 1000 bits of the static table.
+==================
+*/
+int HuffTrainedTable (unsigned short *counts)
+{
+	static hufftable_t	t;
+	unsigned int	max;
+	double	oldbits, newbits;
+	float	freq[256];
+	int	i;
+
+	for (i = 0, max = 1; i < 256; i++)
+	{
+		if (HuffCounts[i] > max)
+			max = HuffCounts[i];
+	}
+	for (i = 0; i < 256; i++)
+	{
+		counts[i] = (unsigned short)((double)HuffCounts[i] * 65535 / max);
+		freq[i] = counts[i] ? counts[i] : 1;
+	}
+
+	BuildTree (&t, freq);
+	oldbits = newbits = 0;
+	for (i = 0; i < 256; i++)
+	{
+		oldbits += (double)HuffCounts[i] * HuffStatic->lookup[i].len;
+		newbits += (double)HuffCounts[i] * t.lookup[i].len;
+	}
+	if (!oldbits)
+		return 1000;
+
+	return (int)(newbits * 1000 / oldbits);
+}
+
 void HuffInit (void)
 {
 #if _DEBUG_HUFFMAN
 	ZeroFreq ();
 #endif	/* _DEBUG_HUFFMAN */
-	BuildTree(HuffFreq);
+	BuildTree(HuffStatic, HuffFreq);
+	HuffStatic->generation = 0;
+	HuffResetTables ();
+	HuffTrainReset ();
 }
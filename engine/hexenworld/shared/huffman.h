@@ -24,6 +24,16 @@ extern void HuffInit (void);
 extern void HuffEncode (const unsigned char *in, unsigned char *out, int inlen, int *outlen);
 extern void HuffDecode (const unsigned char *in, unsigned char *out, int inlen, int *outlen, const int maxlen);
 
+/* trained tables, see SV_CheckHuffTable */
+extern void HuffEncodeWith (int generation, const unsigned char *in, unsigned char *out, int inlen, int *outlen);
+extern int HuffPacketTable (const unsigned char *in, int inlen);
+extern void HuffSetTable (int generation, const unsigned short *counts);
+extern void HuffResetTables (void);
+extern void HuffTrain (const unsigned char *in, int inlen);
+extern void HuffTrainReset (void);
+extern int HuffTrainedBytes (void);
+extern int HuffTrainedTable (unsigned short *counts);
+
 #define	_DEBUG_HUFFMAN	0
 
 #if _DEBUG_HUFFMAN
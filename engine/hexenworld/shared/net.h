@@ -41,6 +41,7 @@ void		NET_Init (int port);
 void		NET_Shutdown (void);
 int		NET_GetPacket (void);
 void		NET_SendPacket (int length, void *data, const netadr_t *to);
+void		NET_SendPacketWith (int length, void *data, const netadr_t *to, int generation);
 int		NET_CheckReadTimeout (long sec, long usec);
 
 qboolean	NET_CompareAdr (const netadr_t *a, const netadr_t *b);
@@ -97,9 +98,14 @@ typedef struct
 	// time and size data to calculate bandwidth
 	int	outgoing_size[MAX_LATENT];
 	double	outgoing_time[MAX_LATENT];
+
+	// trained huffman table the other side has acknowledged,
+	// 0 for the static one
+	int	huffgen;
 } netchan_t;
 
 extern	int	net_drop;		// packets dropped before this one
+extern	qboolean	net_hufftrain;	// feed sent packets to HuffTrain
 
 void Netchan_Init (void);
 void Netchan_Transmit (netchan_t *chan, int length, byte *data);
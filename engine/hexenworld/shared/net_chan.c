@@ -21,6 +21,7 @@
  */
 
 #include "quakedef.h"
+#include "huffman.h"
 
 #define	PACKET_HEADER	8
 
@@ -65,6 +66,7 @@ address spoofing.
 */
 
 int		net_drop;
+qboolean	net_hufftrain;
 static	cvar_t	showpackets = {"showpackets", "0", CVAR_NONE};
 static	cvar_t	showdrop = {"showdrop", "0", CVAR_NONE};
 
@@ -252,7 +254,12 @@ void Netchan_Transmit (netchan_t *chan, int length, byte *data)
 	chan->outgoing_time[i] = realtime;
 
 	if (NOT_DEMOPLAYBACK)	// zoid, no input in demo playback mode
-		NET_SendPacket (senddata.cursize, senddata.data, &chan->remote_address);
+	{
+		if (net_hufftrain)
+			HuffTrain (senddata.data, senddata.cursize);
+		NET_SendPacketWith (senddata.cursize, senddata.data,
+					&chan->remote_address, chan->huffgen);
+	}
 
 	if (chan->cleartime < realtime)
 		chan->cleartime = realtime + senddata.cursize*chan->rate;
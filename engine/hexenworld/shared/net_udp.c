@@ -20,6 +20,9 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE 1	/* for recvmmsg() */
+#endif
 #include "q_stdinc.h"
 #include "arch_def.h"
 #include "net_sys.h"
@@ -48,6 +51,18 @@ static WSADATA	winsockdata;
 #define	MAX_UDP_PACKET	(MAX_MSGLEN + 9)	/* one more than msg + header */
 static byte	net_message_buffer[MAX_UDP_PACKET];
 
+/* Linux can receive a whole batch of datagrams with one system call:
+ * NET_GetPacket then hands them out one at a time and only goes back
+ * to the socket when the batch is used up. */
+#if defined(__linux__) && defined(MSG_WAITFORONE)
+#define	NET_BATCH	32
+static byte		batch_buf[NET_BATCH][MAX_UDP_PACKET];
+static struct sockaddr_in	batch_from[NET_BATCH];
+static struct iovec	batch_iov[NET_BATCH];
+static struct mmsghdr	batch_msgs[NET_BATCH];
+static int		batch_count, batch_next;
+#endif
+
 
 //=============================================================================
 
@@ -156,76 +171,192 @@ qboolean NET_StringToAdr (const char *s, netadr_t *a)
 
 static unsigned char huffbuff[65536];
 
-int NET_GetPacket (void)
+/* compression statistics for the netstats command,
+ * [0] for the static table and raw packets, [1] for trained tables */
+typedef struct
 {
-	int	ret;
-	struct sockaddr_in	from;
-	socklen_t		fromlen;
+	double	packets;
+	double	bytes;		// uncompressed
+	double	wire;		// as sent
+	double	time;		// spent in the coder
+} netstat_t;
 
-	fromlen = sizeof(from);
-	ret = recvfrom(net_socket, (char *)huffbuff, sizeof(net_message_buffer), 0,
-			(struct sockaddr *)&from, &fromlen);
-	if (ret == SOCKET_ERROR)
+static netstat_t	net_sent[2], net_recv[2];
+
+static void NET_CountPacket (netstat_t *s, int bytes, int wire, double time)
+{
+	s->packets++;
+	s->bytes += bytes;
+	s->wire += wire;
+	s->time += time;
+}
+
+static void NET_PrintStats (const char *name, const netstat_t *s)
+{
+	if (!s->packets)
 	{
-		int err = SOCKETERRNO;
-		if (err == NET_EWOULDBLOCK)
-			return 0;
-		if (err == NET_ECONNREFUSED)
-		{
-			Con_Printf ("%s: Connection refused\n", __thisfunc__);
-			return 0;
-		}
-# ifdef PLATFORM_WINDOWS
-		if (err == WSAEMSGSIZE)
-		{
-			Con_Printf ("Oversize packet from %s\n",
-					NET_AdrToString (&net_from));
-			return 0;
-		}
-		if (err == WSAECONNRESET)
-		{
-			Con_Printf ("Connection reset by peer %s\n",
-					NET_AdrToString (&net_from));
-			return 0;
-		}
-# endif	/* _WINDOWS */
-		Sys_Error ("%s: %s", __thisfunc__, socketerror(err));
+		Con_Printf ("%-15s none\n", name);
+		return;
 	}
+	Con_Printf ("%-15s %8.0f %8.0f %8.0f %5.1f%% %6.0f\n", name, s->packets,
+			s->bytes / 1024, s->wire / 1024,
+			100 * (s->bytes - s->wire) / s->bytes,
+			1.0e9 * s->time / s->packets);
+}
 
-	SockadrToNetadr (&from, &net_from);
+/*
+====================
+NET_Stats_f
 
-	if (ret == (int) sizeof(net_message_buffer))
+"netstats" prints how much the huffman coder saves and
+what it costs, "netstats clear" starts counting anew.
+====================
+*/
+static void NET_Stats_f (void)
+{
+	if (Cmd_Argc() > 1 && !q_strcasecmp(Cmd_Argv(1), "clear"))
+	{
+		memset (net_sent, 0, sizeof(net_sent));
+		memset (net_recv, 0, sizeof(net_recv));
+		return;
+	}
+
+	Con_Printf ("%-15s %8s %8s %8s %6s %6s\n", "", "packets",
+			"KB", "wire KB", "saved", "ns/pkt");
+	NET_PrintStats ("sent static", &net_sent[0]);
+	NET_PrintStats ("sent trained", &net_sent[1]);
+	NET_PrintStats ("recv static", &net_recv[0]);
+	NET_PrintStats ("recv trained", &net_recv[1]);
+}
+
+static int NET_ReceiveError (int err)
+{
+	if (err == NET_EWOULDBLOCK)
+		return 0;
+	if (err == NET_ECONNREFUSED)
+	{
+		Con_Printf ("%s: Connection refused\n", "NET_GetPacket");
+		return 0;
+	}
+# ifdef PLATFORM_WINDOWS
+	if (err == WSAEMSGSIZE)
 	{
 		Con_Printf ("Oversize packet from %s\n",
-					NET_AdrToString (&net_from));
+				NET_AdrToString (&net_from));
 		return 0;
 	}
+	if (err == WSAECONNRESET)
+	{
+		Con_Printf ("Connection reset by peer %s\n",
+				NET_AdrToString (&net_from));
+		return 0;
+	}
+# endif	/* _WINDOWS */
+	Sys_Error ("%s: %s", "NET_GetPacket", socketerror(err));
+	return 0;
+}
+
+#if defined(NET_BATCH)
+static int NET_ReceiveBatch (void)
+{
+	int	i;
 
-	LastCompMessageSize += ret;	/* debug: bytes actually received */
+	for (i = 0; i < NET_BATCH; i++)
+		batch_msgs[i].msg_hdr.msg_namelen = sizeof(batch_from[i]);
 
-	HuffDecode(huffbuff, net_message_buffer, ret, &ret,
-				sizeof(net_message_buffer));
-	if (ret > (int) sizeof(net_message_buffer))
+	batch_next = 0;
+	batch_count = recvmmsg (net_socket, batch_msgs, NET_BATCH, 0, NULL);
+	if (batch_count == SOCKET_ERROR)
 	{
-		Con_Printf ("Oversize compressed data from %s\n",
-					NET_AdrToString (&net_from));
-		return 0;
+		batch_count = 0;
+		return NET_ReceiveError (SOCKETERRNO);
 	}
-	net_message.cursize = ret;
+	return batch_count;
+}
+#endif
 
-	return ret;
+int NET_GetPacket (void)
+{
+	int	ret, wire;
+	byte	*data;
+	double	time;
+	struct sockaddr_in	from;
+
+	for ( ; ; )
+	{
+#if defined(NET_BATCH)
+		if (batch_next == batch_count && !NET_ReceiveBatch ())
+			return 0;
+		data = batch_buf[batch_next];
+		ret = (int) batch_msgs[batch_next].msg_len;
+		from = batch_from[batch_next];
+		batch_next++;
+#else
+		socklen_t		fromlen;
+
+		fromlen = sizeof(from);
+		data = huffbuff;
+		ret = recvfrom(net_socket, (char *)data, sizeof(net_message_buffer), 0,
+				(struct sockaddr *)&from, &fromlen);
+		if (ret == SOCKET_ERROR)
+			return NET_ReceiveError (SOCKETERRNO);
+#endif
+
+		SockadrToNetadr (&from, &net_from);
+
+		if (ret == (int) sizeof(net_message_buffer))
+		{
+			Con_Printf ("Oversize packet from %s\n",
+						NET_AdrToString (&net_from));
+			return 0;
+		}
+
+		LastCompMessageSize += ret;	/* debug: bytes actually received */
+
+		wire = ret;
+		time = Sys_DoubleTime ();
+		HuffDecode(data, net_message_buffer, wire, &ret,
+					sizeof(net_message_buffer));
+		if (ret > (int) sizeof(net_message_buffer))
+		{
+			Con_Printf ("Oversize compressed data from %s\n",
+						NET_AdrToString (&net_from));
+			return 0;
+		}
+		// a packet coded with a table we don't have (any more)
+		// decodes to nothing: skip it, don't end the read loop
+		if (!ret && wire)
+			continue;
+		NET_CountPacket (&net_recv[HuffPacketTable(data, wire) > 0],
+					ret, wire, Sys_DoubleTime() - time);
+		net_message.cursize = ret;
+
+		return ret;
+	}
 }
 
 
 //=============================================================================
 
-void NET_SendPacket (int length, void *data, const netadr_t *to)
+/*
+====================
+NET_SendPacketWith
+
+sends with the trained huffman table of the given generation
+if we have it, with the static one otherwise.
+====================
+*/
+void NET_SendPacketWith (int length, void *data, const netadr_t *to, int generation)
 {
 	int	ret, outlen;
+	double	time;
 	struct sockaddr_in	addr;
 
 	NetadrToSockadr (to, &addr);
-	HuffEncode((unsigned char *)data, huffbuff, length, &outlen);
+	time = Sys_DoubleTime ();
+	HuffEncodeWith(generation, (unsigned char *)data, huffbuff, length, &outlen);
+	NET_CountPacket (&net_sent[HuffPacketTable(huffbuff, outlen) > 0],
+				length, outlen, Sys_DoubleTime() - time);
 
 	ret = sendto (net_socket, (char *) huffbuff, outlen, 0,
 				(struct sockaddr *)&addr, sizeof(addr) );
@@ -243,6 +374,11 @@ void NET_SendPacket (int length, void *data, const netadr_t *to)
 	}
 }
 
+void NET_SendPacket (int length, void *data, const netadr_t *to)
+{
+	NET_SendPacketWith (length, data, to, 0);
+}
+
 
 //=============================================================================
 
@@ -251,6 +387,10 @@ int NET_CheckReadTimeout (long sec, long usec)
 	fd_set		readfds;
 	struct timeval	timeout;
 
+#if defined(NET_BATCH)
+	if (batch_next < batch_count)
+		return 1;	/* still have some from the last batch */
+#endif
 	FD_ZERO (&readfds);
 	FD_SET (net_socket, &readfds);
 	timeout.tv_sec = sec;
@@ -353,6 +493,9 @@ NET_Init
 void NET_Init (int port)
 {
 	in_addr_t a = htonl(INADDR_LOOPBACK);
+#if defined(NET_BATCH)
+	int i;
+#endif
 #ifdef PLATFORM_WINDOWS
 	int err = WSAStartup(MAKEWORD(1,1), &winsockdata);
 	if (err != 0)
@@ -384,6 +527,17 @@ void NET_Init (int port)
 
 	// init the message buffer
 	SZ_Init (&net_message, net_message_buffer, sizeof(net_message_buffer));
+#if defined(NET_BATCH)
+	for (i = 0; i < NET_BATCH; i++)
+	{
+		batch_iov[i].iov_base = batch_buf[i];
+		batch_iov[i].iov_len = sizeof(batch_buf[i]);
+		batch_msgs[i].msg_hdr.msg_name = &batch_from[i];
+		batch_msgs[i].msg_hdr.msg_iov = &batch_iov[i];
+		batch_msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+	batch_count = batch_next = 0;
+#endif
 
 	// determine my name & address
 	NET_GetLocalAddress ();
@@ -391,6 +545,8 @@ void NET_Init (int port)
 	memset (&net_loopback_adr, 0, sizeof(netadr_t));
 	memcpy (net_loopback_adr.ip, &a, 4);
 
+	Cmd_AddCommand ("netstats", NET_Stats_f);
+
 	Con_SafePrintf("UDP Initialized\n");
 }
 
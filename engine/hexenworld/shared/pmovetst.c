@@ -172,24 +172,110 @@ LINE TESTING IN HULLS
 
 /*
 ==================
-PM_RecursiveHullCheck
+PM_HullCheck
 
+Traces the line from p1 to p2 through the hull.  Where the line
+crosses a node, the near side is traced first and the node is kept
+on a stack, to go on to the far side (or to take the node's plane
+as the impact) once the near side is through.  Returns false if
+the line was stopped.
 ==================
 */
-static qboolean PM_RecursiveHullCheck (hull_t *hull, int num, float p1f, float p2f, vec3_t p1, vec3_t p2, pmtrace_t *trace)
+#define	MAX_HULL_STACK	512
+
+typedef struct
 {
+	mclipnode_t	*node;
+	int		side;
+	float		frac;
+	float		p1f, midf, p2f;
+	vec3_t		p1, mid, p2;
+} hullstack_t;
+
+static qboolean PM_HullCheck (hull_t *hull, int num, float p1f, float p2f, vec3_t p1, vec3_t p2, pmtrace_t *trace)
+{
+	static hullstack_t	stack[MAX_HULL_STACK];
+	hullstack_t	*s;
+	int		depth;
 	mclipnode_t	*node;
 	mplane_t	*plane;
 	float		t1, t2;
 	float		frac;
-	int			i;
-	vec3_t		mid;
-	int			side;
 	float		midf;
+	vec3_t		start, end, mid;
+	int		i;
+
+	depth = 0;
+	VectorCopy (p1, start);
+	VectorCopy (p2, end);
 
-// check for empty
-	if (num < 0)
+	while (1)
 	{
+	// go down to the leaf the start point is in
+		while (num >= 0)
+		{
+			if (num < hull->firstclipnode || num > hull->lastclipnode)
+				Sys_Error ("%s: bad node number", __thisfunc__);
+
+		//
+		// find the point distances
+		//
+			node = hull->clipnodes + num;
+			plane = hull->planes + node->planenum;
+
+			if (plane->type < 3)
+			{
+				t1 = start[plane->type] - plane->dist;
+				t2 = end[plane->type] - plane->dist;
+			}
+			else
+			{
+				t1 = DotProduct (plane->normal, start) - plane->dist;
+				t2 = DotProduct (plane->normal, end) - plane->dist;
+			}
+
+			if (t1 >= 0 && t2 >= 0)
+			{
+				num = node->children[0];
+				continue;
+			}
+			if (t1 < 0 && t2 < 0)
+			{
+				num = node->children[1];
+				continue;
+			}
+
+		// put the crosspoint DIST_EPSILON pixels on the near side
+			if (t1 < 0)
+				frac = (t1 + DIST_EPSILON)/(t1-t2);
+			else
+				frac = (t1 - DIST_EPSILON)/(t1-t2);
+			if (frac < 0)
+				frac = 0;
+			if (frac > 1)
+				frac = 1;
+
+			if (depth == MAX_HULL_STACK)
+				Sys_Error ("%s: stack overflow", __thisfunc__);
+			s = &stack[depth++];
+			s->node = node;
+			s->side = (t1 < 0);
+			s->frac = frac;
+			s->p1f = p1f;
+			s->p2f = p2f;
+			s->midf = p1f + (p2f - p1f)*frac;
+			for (i = 0; i < 3; i++)
+				s->mid[i] = start[i] + frac*(end[i] - start[i]);
+			VectorCopy (start, s->p1);
+			VectorCopy (end, s->p2);
+
+		// move up to the node
+			num = node->children[s->side];
+			p2f = s->midf;
+			VectorCopy (s->mid, end);
+		}
+
+	// check for empty
 		if (num != CONTENTS_SOLID)
 		{
 			trace->allsolid = false;
@@ -200,107 +286,106 @@ static qboolean PM_RecursiveHullCheck (hull_t *hull, int num, float p1f, float p
 		}
 		else
 			trace->startsolid = true;
-		return true;		// empty
-	}
-
-	if (num < hull->firstclipnode || num > hull->lastclipnode)
-		Sys_Error ("%s: bad node number", __thisfunc__);
 
-//
-// find the point distances
-//
-	node = hull->clipnodes + num;
-	plane = hull->planes + node->planenum;
+	// the near side of the innermost node is through
+		if (!depth)
+			return true;
+		s = &stack[--depth];
+
+		if (PM_HullPointContents (hull, s->node->children[s->side^1], s->mid) != CONTENTS_SOLID)
+		{	// go past the node
+			num = s->node->children[s->side^1];
+			p1f = s->midf;
+			p2f = s->p2f;
+			VectorCopy (s->mid, start);
+			VectorCopy (s->p2, end);
+			continue;
+		}
 
-	if (plane->type < 3)
-	{
-		t1 = p1[plane->type] - plane->dist;
-		t2 = p2[plane->type] - plane->dist;
-	}
-	else
-	{
-		t1 = DotProduct (plane->normal, p1) - plane->dist;
-		t2 = DotProduct (plane->normal, p2) - plane->dist;
-	}
+		if (trace->allsolid)
+			return false;		// never got out of the solid area
 
-#if 1
-	if (t1 >= 0 && t2 >= 0)
-		return PM_RecursiveHullCheck (hull, node->children[0], p1f, p2f, p1, p2, trace);
-	if (t1 < 0 && t2 < 0)
-		return PM_RecursiveHullCheck (hull, node->children[1], p1f, p2f, p1, p2, trace);
-#else
-	if ( (t1 >= DIST_EPSILON && t2 >= DIST_EPSILON) || (t2 > t1 && t1 >= 0) )
-		return PM_RecursiveHullCheck (hull, node->children[0], p1f, p2f, p1, p2, trace);
-	if ( (t1 <= -DIST_EPSILON && t2 <= -DIST_EPSILON) || (t2 < t1 && t1 <= 0) )
-		return PM_RecursiveHullCheck (hull, node->children[1], p1f, p2f, p1, p2, trace);
-#endif
-
-// put the crosspoint DIST_EPSILON pixels on the near side
-	if (t1 < 0)
-		frac = (t1 + DIST_EPSILON)/(t1-t2);
-	else
-		frac = (t1 - DIST_EPSILON)/(t1-t2);
-	if (frac < 0)
-		frac = 0;
-	if (frac > 1)
-		frac = 1;
-
-	midf = p1f + (p2f - p1f)*frac;
-	for (i = 0; i < 3; i++)
-		mid[i] = p1[i] + frac*(p2[i] - p1[i]);
+	//==================
+	// the other side of the node is solid, this is the impact point
+	//==================
+		plane = hull->planes + s->node->planenum;
+		if (!s->side)
+		{
+			VectorCopy (plane->normal, trace->plane.normal);
+			trace->plane.dist = plane->dist;
+		}
+		else
+		{
+			VectorNegate (plane->normal, trace->plane.normal);
+			trace->plane.dist = -plane->dist;
+		}
 
-	side = (t1 < 0);
+		frac = s->frac;
+		midf = s->midf;
+		VectorCopy (s->mid, mid);
+		while (PM_HullPointContents (hull, hull->firstclipnode, mid) == CONTENTS_SOLID)
+		{ // shouldn't really happen, but does occasionally
+			frac -= 0.1;
+			if (frac < 0)
+			{
+				trace->fraction = midf;
+				VectorCopy (mid, trace->endpos);
+				Con_DPrintf ("backup past 0\n");
+				return false;
+			}
+			midf = s->p1f + (s->p2f - s->p1f)*frac;
+			for (i = 0; i < 3; i++)
+				mid[i] = s->p1[i] + frac*(s->p2[i] - s->p1[i]);
+		}
 
-// move up to the node
-	if (!PM_RecursiveHullCheck (hull, node->children[side], p1f, midf, p1, mid, trace) )
-		return false;
+		trace->fraction = midf;
+		VectorCopy (mid, trace->endpos);
 
-#ifdef PARANOID
-	if (PM_HullPointContents (hull, node->children[side], mid) == CONTENTS_SOLID)
-	{
-		Con_Printf ("mid PointInHullSolid\n");
 		return false;
 	}
-#endif
+}
 
-	if (PM_HullPointContents (hull, node->children[side^1], mid) != CONTENTS_SOLID)
-		// go past the node
-		return PM_RecursiveHullCheck (hull, node->children[side^1], midf, p2f, mid, p2, trace);
 
-	if (trace->allsolid)
-		return false;		// never got out of the solid area
+/*
+================
+PM_CullPhysent
 
-//==================
-// the other side of the node is solid, this is the impact point
-//==================
-	if (!side)
-	{
-		VectorCopy (plane->normal, trace->plane.normal);
-		trace->plane.dist = plane->dist;
-	}
-	else
-	{
-		VectorNegate (plane->normal, trace->plane.normal);
-		trace->plane.dist = -plane->dist;
-	}
+The broadphase: true if no point between lo and hi (the bounds of
+the move) can be in the solid part of pe's clipping hull, so that
+the hull needn't be traced.  mins and maxs are the box hull of a
+non-bsp physent.
+================
+*/
+#define	CULL_EPSILON	1
+
+static qboolean PM_CullPhysent (physent_t *pe, hull_t *hull, vec3_t mins, vec3_t maxs, vec3_t lo, vec3_t hi)
+{
+	vec3_t		smins, smaxs;
+	int			i;
 
-	while (PM_HullPointContents (hull, hull->firstclipnode, mid) == CONTENTS_SOLID)
-	{ // shouldn't really happen, but does occasionally
-		frac -= 0.1;
-		if (frac < 0)
+	if (pe->model)
+	{
+		if (pe->angles[0] || pe->angles[1] || pe->angles[2])
+			return false;	// rotated, not worth the bother
+	// the hull is the model grown by the player box, and it
+	// is traced with the player's origin at clip_mins[2]
+		for (i = 0; i < 3; i++)
 		{
-			trace->fraction = midf;
-			VectorCopy (mid, trace->endpos);
-			Con_DPrintf ("backup past 0\n");
-			return false;
+			smins[i] = pe->model->mins[i] - hull->clip_maxs[i];
+			smaxs[i] = pe->model->maxs[i] - hull->clip_mins[i];
 		}
-		midf = p1f + (p2f - p1f)*frac;
-		for (i = 0; i < 3; i++)
-			mid[i] = p1[i] + frac*(p2[i] - p1[i]);
+		smins[2] += hull->clip_mins[2];
+		smaxs[2] += hull->clip_mins[2];
+		mins = smins;
+		maxs = smaxs;
 	}
 
-	trace->fraction = midf;
-	VectorCopy (mid, trace->endpos);
+	for (i = 0; i < 3; i++)
+	{
+		if (lo[i] > pe->origin[i] + maxs[i] + CULL_EPSILON
+				|| hi[i] < pe->origin[i] + mins[i] - CULL_EPSILON)
+			return true;
+	}
 
 	return false;
 }
@@ -396,6 +481,7 @@ pmtrace_t PM_PlayerMove (vec3_t start, vec3_t end)
 	int			i;
 	physent_t	*pe;
 	vec3_t		mins, maxs;
+	vec3_t		lo, hi;
 
 // fill in a default trace
 	memset (&total, 0, sizeof(pmtrace_t));
@@ -403,6 +489,12 @@ pmtrace_t PM_PlayerMove (vec3_t start, vec3_t end)
 	total.ent = -1;
 	VectorCopy (end, total.endpos);
 
+	for (i = 0; i < 3; i++)
+	{
+		lo[i] = q_min(start[i], end[i]);
+		hi[i] = q_max(start[i], end[i]);
+	}
+
 	for (i = 0; i < pmove.numphysent; i++)
 	{
 		pe = &pmove.physents[i];
@@ -439,6 +531,11 @@ pmtrace_t PM_PlayerMove (vec3_t start, vec3_t end)
 			hull = PM_HullForBox (mins, maxs);
 		}
 
+	// the world is always traced, the rest only if the move
+	// comes near enough
+		if (i != 0 && PM_CullPhysent (pe, hull, mins, maxs, lo, hi))
+			continue;
+
 	// PM_HullForEntity (ent, mins, maxs, offset);
 		VectorCopy (pe->origin, offset);
 
@@ -477,7 +574,7 @@ pmtrace_t PM_PlayerMove (vec3_t start, vec3_t end)
 		trace.endpos[2] -= hull->clip_mins[2];
 
 	// trace a line through the apropriate clipping hull
-		PM_RecursiveHullCheck (hull, hull->firstclipnode, 0, 1, start_l, end_l, &trace);
+		PM_HullCheck (hull, hull->firstclipnode, 0, 1, start_l, end_l, &trace);
 
 	// rjr will need to adjust for player when going into different hulls
 		trace.endpos[2] += hull->clip_mins[2];
@@ -157,6 +157,7 @@
 #define	svc_isdoc		81	// [byte] [byte]
 #define	svc_nodoc		82	// [byte] [byte]
 #define	svc_playerskipped	83	// [byte]
+#define	svc_hufftable		84	// [byte] generation [short]*256 byte counts
 
 //==============================================
 
@@ -213,7 +214,12 @@
 //==============================================
 
 // the first 16 bits of a packetentities update holds 9 bits
-// of entity number and 7 bits of flags
+// of entity number and 7 bits of flags.  if the client and the
+// server both advertise the 'e' capability (see U_ENTNUM_ESCAPE)
+// entity number 511 is an escape: the real number follows as a
+// short, right after the flags word.
+#define	U_ENTNUM_MASK	511
+#define	U_ENTNUM_ESCAPE	511
 #define	U_ORIGIN1	(1<<9)
 #define	U_ORIGIN2	(1<<10)
 #define	U_ORIGIN3	(1<<11)
@@ -442,11 +448,13 @@ typedef struct
 } entity_state_t;
 
 
-#define	MAX_PACKET_ENTITIES	64	// doesn't count nails
+#define	MAX_PACKET_ENTITIES	512	// doesn't count nails
+#define	OLD_MAX_PACKET_ENTITIES	64	// without the 'e' capability
 typedef struct
 {
 	int		num_entities;
-	entity_state_t	entities[MAX_PACKET_ENTITIES];
+	int		max_entities;	// allocated size of entities[]
+	entity_state_t	*entities;
 } packet_entities_t;
 
 typedef struct usercmd_s
@@ -75,7 +75,8 @@
 //
 // per-level limits
 //
-#define	MAX_EDICTS	768		// FIXME: ouch! ouch! ouch!
+#define	MAX_EDICTS	2048
+#define	OLD_MAX_EDICTS	768		// all that baselines and sounds can address
 #define	MAX_LIGHTSTYLES	64
 
 #define	MAX_MODELS	512		/* Sent over the net as a word */
@@ -0,0 +1,1497 @@
+/* hwbot.c - HWBOT 0.1 HexenWorld server load generator
+ * Connects many headless bot clients to one or more hexenworld servers
+ * and reports the latency, packet loss and choke they see.  The netchan
+ * and the message parsing follow net_chan.c and cl_parse.c from the
+ * HexenWorld engine (C) Raven Software and ID Software.
+ * Based on hwmload.c and hwterm.c, Copyright (C) 2006-2011 O. Sezer <sezero@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <sys/types.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <signal.h>
+
+#include "q_stdinc.h"
+#include "arch_def.h"
+#include "compiler.h"
+#include "net_sys.h"
+#include "qsnprint.h"
+
+#include "huffman.h"
+#include "protocol.h"
+
+#if defined(PLATFORM_UNIX)
+#include <sys/time.h>
+#include <sys/resource.h>
+#endif
+
+/*****************************************************************************/
+
+typedef struct
+{
+	unsigned char	ip[4];
+	unsigned short	port;
+	unsigned short	pad;
+} netadr_t;
+
+#if defined(_MSC_VER)
+#if defined(_WIN64)
+#define ssize_t	SSIZE_T
+#else
+typedef int	ssize_t;
+#endif	/* _WIN64 */
+#endif	/* _MSC_VER */
+
+#if defined(PLATFORM_AMIGA)
+struct Library	*SocketBase;
+#endif
+#if defined(PLATFORM_WINDOWS)
+#include "wsaerror.h"
+static WSADATA	winsockdata;
+#endif
+
+FUNC_NORETURN void Sys_Error (const char *error, ...) FUNC_PRINTF(1,2);
+#ifdef __WATCOMC__
+#pragma aux Sys_Error aborts;
+#endif
+
+/*****************************************************************************/
+
+static void NetadrToSockadr (const netadr_t *a, struct sockaddr_in *s)
+{
+	memset (s, 0, sizeof(*s));
+	s->sin_family = AF_INET;
+
+	memcpy (&s->sin_addr, a->ip, 4);
+	s->sin_port = a->port;
+}
+
+static void SockadrToNetadr (const struct sockaddr_in *s, netadr_t *a)
+{
+	memcpy (a->ip, &s->sin_addr, 4);
+	a->port = s->sin_port;
+}
+
+const char *NET_AdrToString (const netadr_t *a)
+{
+	static	char	s[64];
+
+	sprintf (s, "%i.%i.%i.%i:%i", a->ip[0], a->ip[1], a->ip[2], a->ip[3],
+							ntohs(a->port));
+
+	return s;
+}
+
+static int NET_StringToAdr (const char *s, netadr_t *a)
+{
+	struct hostent		*h;
+	struct sockaddr_in	sadr;
+	char	*colon;
+	char	copy[128];
+
+	memset (&sadr, 0, sizeof(sadr));
+	sadr.sin_family = AF_INET;
+	sadr.sin_port = 0;
+
+	strncpy (copy, s, sizeof(copy) - 1);
+	copy[sizeof(copy) - 1] = '\0';
+	/* strip off a trailing :port if present */
+	for (colon = copy; *colon; colon++)
+	{
+		if (*colon == ':')
+		{
+			*colon = 0;
+			sadr.sin_port = htons((short)atoi(colon+1));
+		}
+	}
+
+	if (copy[0] >= '0' && copy[0] <= '9')
+	{
+		sadr.sin_addr.s_addr = inet_addr(copy);
+	}
+	else
+	{
+		h = gethostbyname (copy);
+		if (!h)
+			return 0;
+		sadr.sin_addr.s_addr = *(in_addr_t *)h->h_addr_list[0];
+	}
+
+	SockadrToNetadr (&sadr, a);
+
+	return 1;
+}
+
+static void NET_Init (void)
+{
+#if defined(PLATFORM_WINDOWS)
+	int err = WSAStartup(MAKEWORD(1,1), &winsockdata);
+	if (err != 0)
+		Sys_Error ("Winsock initialization failed (%s)", socketerror(err));
+#endif	/* PLATFORM_WINDOWS */
+#if defined(PLATFORM_OS2) && !defined(__EMX__)
+	if (sock_init() < 0)
+		Sys_Error ("Can't initialize IBM OS/2 sockets");
+#endif	/* OS/2 */
+#ifdef PLATFORM_AMIGA
+	SocketBase = OpenLibrary("bsdsocket.library", 0);
+	if (!SocketBase)
+		Sys_Error ("Can't open bsdsocket.library.");
+#endif	/* PLATFORM_AMIGA */
+#if defined(PLATFORM_UNIX)
+	/* one socket per bot: allow as many as we may */
+	struct rlimit	rl;
+	if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max)
+	{
+		rl.rlim_cur = rl.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &rl);
+	}
+#endif	/* PLATFORM_UNIX */
+}
+
+static void NET_Shutdown (void)
+{
+#if defined(PLATFORM_WINDOWS)
+	WSACleanup ();
+#endif
+#ifdef PLATFORM_AMIGA
+	if (SocketBase)
+	{
+		CloseLibrary(SocketBase);
+		SocketBase = NULL;
+	}
+#endif
+}
+
+static sys_socket_t NET_OpenSocket (void)
+{
+	sys_socket_t	s;
+#if defined(PLATFORM_WINDOWS) || defined(PLATFORM_DOS)
+	u_long	_true = 1;
+#else
+	int	_true = 1;
+#endif
+	int	err;
+
+	s = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (s == INVALID_SOCKET)
+		return INVALID_SOCKET;
+	if (ioctlsocket (s, FIONBIO, IOCTLARG_P(&_true)) == SOCKET_ERROR)
+	{
+		err = SOCKETERRNO;
+		Sys_Error ("ioctl FIONBIO: %s", socketerror(err));
+	}
+
+	return s;
+}
+
+static void NET_Wait (sys_socket_t maxsocket, fd_set *readfds, long usec)
+{
+	struct timeval	timeout;
+
+	timeout.tv_sec = 0;
+	timeout.tv_usec = usec;
+
+	selectsocket(maxsocket + 1, readfds, NULL, NULL, &timeout);
+}
+
+/* all hexenworld packets, out of band ones included, are huffman coded */
+static unsigned char	huffbuff[65536];
+
+static int NET_Send (sys_socket_t s, const void *data, int len, const netadr_t *to)
+{
+	struct sockaddr_in	addr;
+	int	hufflen;
+
+	HuffEncode ((const unsigned char *)data, huffbuff, len, &hufflen);
+	NetadrToSockadr (to, &addr);
+	sendto (s, (const char *)huffbuff, hufflen, 0, (struct sockaddr *)&addr, sizeof(addr));
+
+	return hufflen;
+}
+
+static int NET_Recv (sys_socket_t s, unsigned char *data, int maxlen, int *wirelen)
+{
+	ssize_t	size;
+	int	len;
+
+	size = recvfrom(s, (char *)huffbuff, sizeof(huffbuff), 0, NULL, NULL);
+	if (size <= 0)
+		return -1;
+	*wirelen = (int)size;
+	HuffDecode (huffbuff, data, (int)size, &len, maxlen);
+
+	return (len > maxlen) ? 0 : len;
+}
+
+/*****************************************************************************/
+
+static double Sys_DoubleTime (void)
+{
+#if defined(PLATFORM_WINDOWS)
+	return GetTickCount() / 1000.0;
+#else
+	struct timeval	tp;
+
+	gettimeofday (&tp, NULL);
+	return tp.tv_sec + tp.tv_usec / 1e6;
+#endif
+}
+
+void Sys_Error (const char *error, ...)
+{
+	va_list		argptr;
+	char		text[1024];
+
+	va_start (argptr,error);
+	q_vsnprintf (text, sizeof (text), error,argptr);
+	va_end (argptr);
+
+	NET_Shutdown ();
+
+	printf ("\nERROR: %s\n\n", text);
+
+	exit (1);
+}
+
+/*****************************************************************************/
+
+#define	VER_HWBOT_MAJ		0
+#define	VER_HWBOT_MID		1
+#define	VER_HWBOT_MIN		0
+
+#define	MAX_MSGLEN		7500	/* max length of a reliable message */
+#define	MAX_PACKET		(MAX_MSGLEN + 8)
+
+#define	MAX_BOTS		512	/* keeps the bot sockets below FD_SETSIZE */
+#define	MAX_SERVERS		32
+
+/* payload sizes of the server messages that have a fixed layout.  the
+ * others are parsed by hand in Bot_ParseServerMessage. */
+static const struct
+{
+	int	svc;
+	int	size;
+} svc_fixed[] =
+{
+	{ svc_nop, 0 },
+	{ svc_updatestat, 2 },
+	{ svc_time, 4 },
+	{ svc_setangle, 3 },
+	{ svc_updatefrags, 3 },
+	{ svc_stopsound, 2 },
+	{ svc_particle, 11 },
+	{ svc_damage, 8 },
+	{ svc_spawnstatic, 17 },
+	{ svc_spawnbaseline, 19 },
+	{ svc_killedmonster, 0 },
+	{ svc_foundsecret, 0 },
+	{ svc_spawnstaticsound, 9 },
+	{ svc_cdtrack, 1 },
+	{ svc_sellscreen, 0 },
+	{ svc_smallkick, 0 },
+	{ svc_bigkick, 0 },
+	{ svc_updateentertime, 5 },
+	{ svc_updatestatlong, 5 },
+	{ svc_muzzleflash, 2 },
+	{ svc_maxspeed, 4 },
+	{ svc_entgravity, 4 },
+	{ svc_plaque, 2 },
+	{ svc_particle_explosion, 12 },
+	{ svc_set_view_tint, 1 },
+	{ svc_end_effect, 1 },
+	{ svc_set_view_flags, 1 },
+	{ svc_clear_view_flags, 1 },
+	{ svc_particle2, 34 },
+	{ svc_particle3, 13 },
+	{ svc_particle4, 11 },
+	{ svc_turn_effect, 17 },
+	{ svc_raineffect, 18 },
+	{ svc_indexed_print, 3 },
+	{ svc_targetupdate, 3 },
+	{ svc_name_print, 2 },
+	{ svc_sound_update_pos, 8 },
+	{ svc_update_piv, 4 },
+	{ svc_player_sound, 9 },
+	{ svc_updatepclass, 2 },
+	{ svc_updatedminfo, 4 },
+	{ svc_updatesiegeinfo, 2 },
+	{ svc_updatesiegeteam, 2 },
+	{ svc_updatesiegelosses, 2 },
+	{ svc_haskey, 2 },
+	{ svc_nonehaskey, 0 },
+	{ svc_isdoc, 2 },
+	{ svc_nodoc, 0 },
+	{ svc_playerskipped, 1 },
+	{ svc_hufftable, 1 + 256 * 2 },
+};
+
+static int	svc_sizes[256];	/* from svc_fixed[], -1 for the others */
+
+/* svc_update_inv: payload sizes for the sc1 and sc2 bits, -1 for strings */
+static const signed char sc1_sizes[32] =
+{
+	2, 1, 1, 1, 1, 1, 0, 1,  1, 4, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1,  1, 1, 1, 1, 1, 4, 1, 1
+};
+static const signed char sc2_sizes[32] =
+{
+	1, 1, 1, 1, 1, 1, 1, 1,  1, 0, 0,-1,-1,-1,-1,-1,
+	-1,-1,-1, 2, 1, 4, 0, 0,  0, 0, 0, 0, 0, 0, 0, 0
+};
+
+typedef enum
+{
+	bs_idle,	/* waiting for its turn to connect */
+	bs_connecting,	/* sending connect requests */
+	bs_connected,	/* signon in progress */
+	bs_active,	/* sent begin, moving around */
+	bs_dropped	/* rejected, disconnected or timed out */
+} botstate_t;
+
+typedef struct
+{
+	/* netchan, as in net_chan.c */
+	int		outgoing_sequence;
+	int		incoming_sequence;
+	int		incoming_acknowledged;
+	int		incoming_reliable_acknowledged;
+	int		incoming_reliable_sequence;
+	int		reliable_sequence;
+	int		last_reliable_sequence;
+	int		reliable_length;
+	int		message_length;
+	unsigned char	message_buf[MAX_MSGLEN];
+	unsigned char	reliable_buf[MAX_MSGLEN];
+	double		sent_time[UPDATE_BACKUP];
+} botchan_t;
+
+typedef struct
+{
+	sys_socket_t	socket;
+	int		server;
+	botstate_t	state;
+	botchan_t	chan;
+	double		next_send, next_connect, last_received, start_time;
+	int		protocol, servercount, playernum;
+	int		validsequence;
+	int		frame;
+	float		yaw;
+	/* results */
+	int		packets_out, bytes_out;
+	int		packets_in, bytes_in;
+	int		skipped, choked;
+	int		latency_count;
+	double		latency_total, latency_max;
+	double		spawn_time;
+	int		serverping;
+	int		partial, bad;
+} bot_t;
+
+typedef struct
+{
+	netadr_t	adr;
+	int		cpu, frame_ms;
+	float		packets;
+	int		replies;
+} botserver_t;
+
+static bot_t		*bots;
+static botserver_t	servers[MAX_SERVERS];
+static int		num_servers;
+static sys_socket_t	rcon_socket = INVALID_SOCKET;
+
+static int	num_bots = 16;
+static double	run_time = 30;
+static double	bot_fps = 30;
+static double	join_rate = 20;		/* new connections per second */
+static double	report_interval = 5;
+static int	bot_rate = 2500;
+static int	bot_attack;
+static const char	*rcon_password;
+
+static unsigned char	packet[MAX_PACKET];
+static unsigned char	message[MAX_PACKET];
+static volatile int	bot_quit;
+
+
+/*
+==============================================================================
+
+MESSAGE IO
+
+==============================================================================
+*/
+
+static unsigned char	*msg_data;
+static int		msg_size, msg_readcount;
+static int		msg_badread;
+
+static void MSG_BeginReading (unsigned char *data, int size)
+{
+	msg_data = data;
+	msg_size = size;
+	msg_readcount = 0;
+	msg_badread = 0;
+}
+
+static int MSG_Skip (int count)
+{
+	if (msg_readcount + count > msg_size)
+	{
+		msg_badread = 1;
+		msg_readcount = msg_size;
+		return 0;
+	}
+	msg_readcount += count;
+	return 1;
+}
+
+static int MSG_ReadByte (void)
+{
+	if (!MSG_Skip(1))
+		return -1;
+	return msg_data[msg_readcount - 1];
+}
+
+static int MSG_ReadShort (void)
+{
+	if (!MSG_Skip(2))
+		return -1;
+	return (short)(msg_data[msg_readcount - 2] + (msg_data[msg_readcount - 1] << 8));
+}
+
+static int MSG_ReadLong (void)
+{
+	if (!MSG_Skip(4))
+		return -1;
+	return (int)(msg_data[msg_readcount - 4] + (msg_data[msg_readcount - 3] << 8) +
+		(msg_data[msg_readcount - 2] << 16) + ((unsigned int)msg_data[msg_readcount - 1] << 24));
+}
+
+static const char *MSG_ReadString (void)
+{
+	static char	string[2048];
+	int		l, c;
+
+	l = 0;
+	do
+	{
+		c = MSG_ReadByte ();
+		if (c == -1 || c == 0)
+			break;
+		string[l] = c;
+		l++;
+	} while (l < (int)sizeof(string) - 1);
+
+	string[l] = 0;
+
+	return string;
+}
+
+static void MSG_WriteByte (bot_t *bot, int c)
+{
+	botchan_t	*chan = &bot->chan;
+
+	if (chan->message_length < MAX_MSGLEN)
+		chan->message_buf[chan->message_length++] = c;
+}
+
+static void MSG_WriteString (bot_t *bot, const char *s)
+{
+	do
+	{
+		MSG_WriteByte (bot, *s);
+	} while (*s++);
+}
+
+static void Bot_StringCmd (bot_t *bot, const char *fmt, ...) FUNC_PRINTF(2,3);
+static void Bot_StringCmd (bot_t *bot, const char *fmt, ...)
+{
+	va_list		argptr;
+	char		text[256];
+
+	va_start (argptr, fmt);
+	q_vsnprintf (text, sizeof(text), fmt, argptr);
+	va_end (argptr);
+
+	MSG_WriteByte (bot, clc_stringcmd);
+	MSG_WriteString (bot, text);
+}
+
+
+/*
+==============================================================================
+
+NETCHAN
+
+==============================================================================
+*/
+
+/*
+===============
+Bot_Transmit
+
+Netchan_Transmit for a bot: the reliable message goes first, then the
+unreliable data.
+================
+*/
+static void Bot_Transmit (bot_t *bot, const unsigned char *data, int length, double now)
+{
+	botchan_t	*chan = &bot->chan;
+	unsigned int	w1, w2;
+	int		send_reliable, len;
+
+// if the remote side dropped the last reliable message, resend it
+	send_reliable = 0;
+	if (chan->incoming_acknowledged > chan->last_reliable_sequence &&
+	    chan->incoming_reliable_acknowledged != chan->reliable_sequence)
+		send_reliable = 1;
+
+// if the reliable transmit buffer is empty, copy the current message out
+	if (!chan->reliable_length && chan->message_length)
+	{
+		memcpy (chan->reliable_buf, chan->message_buf, chan->message_length);
+		chan->reliable_length = chan->message_length;
+		chan->message_length = 0;
+		chan->reliable_sequence ^= 1;
+		send_reliable = 1;
+	}
+
+	w1 = chan->outgoing_sequence | ((unsigned int)send_reliable << 31);
+	w2 = chan->incoming_sequence | ((unsigned int)chan->incoming_reliable_sequence << 31);
+
+	chan->sent_time[chan->outgoing_sequence & UPDATE_MASK] = now;
+	chan->outgoing_sequence++;
+
+	packet[0] = w1 & 0xff; packet[1] = (w1 >> 8) & 0xff; packet[2] = (w1 >> 16) & 0xff; packet[3] = w1 >> 24;
+	packet[4] = w2 & 0xff; packet[5] = (w2 >> 8) & 0xff; packet[6] = (w2 >> 16) & 0xff; packet[7] = w2 >> 24;
+	len = 8;
+
+	if (send_reliable)
+	{
+		memcpy (packet + len, chan->reliable_buf, chan->reliable_length);
+		len += chan->reliable_length;
+		chan->last_reliable_sequence = chan->outgoing_sequence;
+	}
+
+	if (MAX_PACKET - len >= length)
+	{
+		memcpy (packet + len, data, length);
+		len += length;
+	}
+
+	bot->bytes_out += NET_Send (bot->socket, packet, len, &servers[bot->server].adr);
+	bot->packets_out++;
+}
+
+/*
+=================
+Bot_Process
+
+Netchan_Process for a bot.  Returns false for stale packets, leaves
+the message pointer at the payload otherwise.
+=================
+*/
+static int Bot_Process (bot_t *bot, double now)
+{
+	botchan_t	*chan = &bot->chan;
+	unsigned int	sequence, sequence_ack;
+	int		reliable_ack, reliable_message;
+
+	sequence = (unsigned int)MSG_ReadLong ();
+	sequence_ack = (unsigned int)MSG_ReadLong ();
+	if (msg_badread)
+		return 0;
+
+	reliable_message = (int)(sequence >> 31);
+	reliable_ack = (int)(sequence_ack >> 31);
+	sequence &= ~(1U<<31);
+	sequence_ack &= ~(1U<<31);
+
+// discard stale or duplicated packets
+	if (sequence <= (unsigned int) chan->incoming_sequence)
+		return 0;
+
+// the server numbers its replies after our commands, so a gap is a
+// command that got no reply of its own: choked (reported later with
+// svc_chokecount), lost, or run in the same server frame as the next
+	if (sequence > (unsigned int) chan->incoming_sequence + 1 && bot->state == bs_active)
+		bot->skipped += sequence - (chan->incoming_sequence + 1);
+
+// the round trip of the newest command the server has seen
+	if ((int)sequence_ack > chan->incoming_acknowledged &&
+	    chan->outgoing_sequence - (int)sequence_ack < UPDATE_BACKUP)
+	{
+		double	latency = now - chan->sent_time[sequence_ack & UPDATE_MASK];
+
+		bot->latency_total += latency;
+		bot->latency_count++;
+		if (latency > bot->latency_max)
+			bot->latency_max = latency;
+	}
+
+// if the current outgoing reliable message has been acknowledged
+// clear the buffer to make way for the next
+	if (reliable_ack == chan->reliable_sequence)
+		chan->reliable_length = 0;
+
+	chan->incoming_sequence = sequence;
+	chan->incoming_acknowledged = sequence_ack;
+	chan->incoming_reliable_acknowledged = reliable_ack;
+	if (reliable_message)
+		chan->incoming_reliable_sequence ^= 1;
+
+	return 1;
+}
+
+
+/*
+==============================================================================
+
+SERVER MESSAGES
+
+==============================================================================
+*/
+
+static void Bot_Stufftext (bot_t *bot, const char *text)
+{
+	char		line[256];
+	const char	*end;
+	int		len;
+
+	while (*text)
+	{
+		end = strchr (text, '\n');
+		len = end ? (int)(end - text) : (int)strlen(text);
+		if (len > (int)sizeof(line) - 1)
+			len = (int)sizeof(line) - 1;
+		memcpy (line, text, len);
+		line[len] = 0;
+		text += end ? (end - text) + 1 : (int)strlen(text);
+
+		if (!strncmp(line, "cmd ", 4))
+			Bot_StringCmd (bot, "%s", line + 4);	/* prespawn, spawn */
+		else if (!strcmp(line, "skins"))
+		{	/* the client loads the skins, then begins */
+			Bot_StringCmd (bot, "begin %i", bot->servercount);
+			if (bot->state == bs_connected)
+			{
+				bot->state = bs_active;
+				bot->spawn_time = Sys_DoubleTime() - bot->start_time;
+			}
+		}
+		else if (!strcmp(line, "reconnect"))
+		{	/* map change */
+			bot->state = bs_connected;
+			bot->validsequence = 0;
+			Bot_StringCmd (bot, "new");
+		}
+		else if (!strcmp(line, "changing"))
+			bot->validsequence = 0;
+	}
+}
+
+static void Bot_ParseServerData (bot_t *bot)
+{
+	bot->protocol = MSG_ReadLong ();
+	bot->servercount = MSG_ReadLong ();
+	MSG_ReadString ();			/* gamedir */
+	bot->playernum = MSG_ReadByte () & 127;
+	MSG_ReadString ();			/* levelname */
+	if (bot->protocol >= PROTOCOL_VERSION)
+		MSG_Skip (10 * 4);		/* movevars */
+
+	Bot_StringCmd (bot, "soundlist %i", bot->servercount);
+}
+
+static void Bot_ParseList (bot_t *bot, const char *list, const char *next)
+{
+	int	n = 0;
+
+	if (bot->protocol >= PROTOCOL_VERSION_EXT)
+		MSG_ReadLong ();
+	while (MSG_ReadString()[0])
+		;
+	if (bot->protocol >= PROTOCOL_VERSION_EXT)
+		n = MSG_ReadLong ();
+
+	if (n > 0)
+		Bot_StringCmd (bot, "%s %i %i", list, bot->servercount, n);
+	else	Bot_StringCmd (bot, "%s %i", next, bot->servercount);
+}
+
+static void Bot_SkipUsercmd (void)
+{
+	int	bits = MSG_ReadByte ();
+
+	MSG_Skip (((bits & 1) ? 2 : 0) + 2 + ((bits & 2) ? 2 : 0) +
+		  ((bits >> 2) & 1) + ((bits >> 3) & 1) + ((bits >> 4) & 1) +
+		  ((bits >> 5) & 1) + ((bits >> 6) & 1) + ((bits >> 7) & 1));
+}
+
+static void Bot_ParsePlayerinfo (void)
+{
+	int	flags;
+
+	MSG_ReadByte ();
+	flags = MSG_ReadShort ();
+	MSG_Skip (3 * 2 + 1);			/* origin, frame */
+	if (flags & PF_MSEC)
+		MSG_Skip (1);
+	if (flags & PF_COMMAND)
+		Bot_SkipUsercmd ();
+	MSG_Skip (((flags & PF_VELOCITY1) ? 2 : 0) + ((flags & (PF_VELOCITY1<<1)) ? 2 : 0) +
+		  ((flags & (PF_VELOCITY1<<2)) ? 2 : 0));
+	if (flags & PF_MODEL)
+		MSG_Skip (2);
+	MSG_Skip (!!(flags & PF_SKINNUM) + !!(flags & PF_EFFECTS) + !!(flags & PF_EFFECTS2) +
+		  !!(flags & PF_WEAPONFRAME) + !!(flags & PF_DRAWFLAGS) + !!(flags & PF_SCALE) +
+		  !!(flags & PF_ABSLIGHT));
+	if (flags & PF_SOUND)
+		MSG_Skip (2);
+}
+
+/* the bots never advertise the 'e' capability, so the entity
+ * number is always in the low bits of the first word */
+static void Bot_ParsePacketEntities (bot_t *bot, int delta)
+{
+	int	bits;
+
+	if (delta)
+		MSG_ReadByte ();
+	while (!msg_badread)
+	{
+		bits = MSG_ReadShort () & 0xffff;
+		if (!bits)
+			break;
+		bits &= ~U_ENTNUM_MASK;
+		if (bits & U_MOREBITS)
+			bits |= MSG_ReadByte ();
+		if (bits & U_MOREBITS2)
+			bits |= MSG_ReadByte () << 16;
+		if (bits & U_MODEL)
+			MSG_Skip ((bits & U_MODEL16) ? 2 : 1);
+		MSG_Skip (!!(bits & U_FRAME) + !!(bits & U_COLORMAP) + !!(bits & U_SKIN) +
+			  !!(bits & U_DRAWFLAGS) + ((bits & U_EFFECTS) ? 4 : 0) +
+			  ((bits & U_ORIGIN1) ? 2 : 0) + !!(bits & U_ANGLE1) +
+			  ((bits & U_ORIGIN2) ? 2 : 0) + !!(bits & U_ANGLE2) +
+			  ((bits & U_ORIGIN3) ? 2 : 0) + !!(bits & U_ANGLE3) +
+			  !!(bits & U_SCALE) + !!(bits & U_ABSLIGHT) + ((bits & U_SOUND) ? 2 : 0));
+	}
+
+	bot->validsequence = bot->chan.incoming_sequence;
+}
+
+static void Bot_ParseUpdateInv (void)
+{
+	unsigned int	sc1, sc2;
+	int		test, i;
+
+	sc1 = sc2 = 0;
+	test = MSG_ReadByte ();
+	/* all of the sc1 mask bytes come before the sc2 ones */
+	for (i = 0; i < 4; i++)
+	{
+		if (test & (1 << i))
+			sc1 |= (unsigned int)MSG_ReadByte () << (8 * i);
+	}
+	for (i = 0; i < 4; i++)
+	{
+		if (test & (16 << i))
+			sc2 |= (unsigned int)MSG_ReadByte () << (8 * i);
+	}
+
+	for (i = 0; i < 32; i++)
+	{
+		if (sc1 & (1U << i))
+			MSG_Skip (sc1_sizes[i]);
+	}
+	for (i = 0; i < 32; i++)
+	{
+		if (!(sc2 & (1U << i)))
+			continue;
+		if (sc2_sizes[i] < 0)
+			MSG_ReadString ();
+		else	MSG_Skip (sc2_sizes[i]);
+	}
+}
+
+/*
+=====================
+Bot_ParseServerMessage
+
+Walks the packet like CL_ParseServerMessage.  The temp entities and
+the effects have layouts that depend on their type; as they only
+carry visuals, the rest of a packet is skipped when one is met.
+=====================
+*/
+static void Bot_ParseServerMessage (bot_t *bot)
+{
+	int	cmd, i;
+
+	while (!msg_badread)
+	{
+		cmd = MSG_ReadByte ();
+		if (cmd == -1)
+			return;		/* end of message */
+
+		if (svc_sizes[cmd] >= 0)
+		{
+			MSG_Skip (svc_sizes[cmd]);
+			continue;
+		}
+
+		switch (cmd)
+		{
+		case svc_disconnect:
+			bot->state = bs_dropped;
+			return;
+
+		case svc_print:
+			MSG_ReadByte ();
+			MSG_ReadString ();
+			break;
+
+		case svc_centerprint:
+		case svc_finale:
+		case svc_midi_name:
+			MSG_ReadString ();
+			break;
+
+		case svc_stufftext:
+			Bot_Stufftext (bot, MSG_ReadString());
+			break;
+
+		case svc_serverdata:
+			Bot_ParseServerData (bot);
+			break;
+
+		case svc_lightstyle:
+			MSG_ReadByte ();
+			MSG_ReadString ();
+			break;
+
+		case svc_sound:
+			i = MSG_ReadShort ();
+			MSG_Skip (!!(i & SND_VOLUME) + !!(i & SND_ATTENUATION) + 1 + 3 * 2);
+			break;
+
+		case svc_updateping:
+			i = MSG_ReadByte ();
+			if (i == bot->playernum)
+				bot->serverping = MSG_ReadShort ();
+			else	MSG_Skip (2);
+			break;
+
+		case svc_chokecount:
+			bot->choked += MSG_ReadByte ();
+			break;
+
+		case svc_updateuserinfo:
+			MSG_Skip (1 + 4);
+			MSG_ReadString ();
+			break;
+
+		case svc_download:
+			i = MSG_ReadShort ();
+			MSG_Skip (1 + (i > 0 ? i : 0));
+			break;
+
+		case svc_playerinfo:
+			Bot_ParsePlayerinfo ();
+			break;
+
+		case svc_nails:
+			MSG_Skip (MSG_ReadByte () * 6);
+			break;
+
+		case svc_packmissile:
+			MSG_Skip (MSG_ReadByte () * 5);
+			break;
+
+		case svc_soundlist:
+			Bot_ParseList (bot, "soundlist", "modellist");
+			break;
+
+		case svc_modellist:
+			Bot_ParseList (bot, "modellist", "prespawn");
+			break;
+
+		case svc_packetentities:
+		case svc_deltapacketentities:
+			Bot_ParsePacketEntities (bot, cmd == svc_deltapacketentities);
+			break;
+
+		case svc_update_inv:
+			Bot_ParseUpdateInv ();
+			break;
+
+		case svc_temp_entity:
+		case svc_start_effect:
+		case svc_update_effect:
+		case svc_multieffect:
+		case svc_intermission:
+			bot->partial++;
+			return;
+
+		default:
+			bot->bad++;
+			return;
+		}
+	}
+
+	if (msg_badread)
+		bot->bad++;
+}
+
+/*
+==============================================================================
+
+BOTS
+
+==============================================================================
+*/
+
+static void Bot_Connect (bot_t *bot, double now)
+{
+	char	text[256];
+	int	len;
+
+	len = q_snprintf (text, sizeof(text), "%c%c%c%cconnect 1 \"\\name\\bot%d\\playerclass\\%d\\rate\\%d\\*cap\\c\"\n",
+				255, 255, 255, 255, (int)(bot - bots), 1 + (int)(bot - bots) % 5, bot_rate);
+	NET_Send (bot->socket, text, len + 1, &servers[bot->server].adr);
+	if (bot->state == bs_idle)
+		bot->start_time = now;
+	bot->state = bs_connecting;
+	bot->next_connect = now + 1;
+}
+
+static void Bot_Connectionless (bot_t *bot, int len, double now)
+{
+	if (len < 5)
+		return;
+
+	if (message[4] == S2C_CONNECTION && bot->state == bs_connecting)
+	{
+		memset (&bot->chan, 0, sizeof(bot->chan));
+		bot->state = bs_connected;
+		bot->last_received = now;
+		bot->next_send = now;
+		Bot_StringCmd (bot, "new");
+	}
+	else if (message[4] == A2C_PRINT && bot->state == bs_connecting)
+	{
+		message[len < MAX_PACKET ? len : MAX_PACKET - 1] = 0;
+		printf ("bot%d: %s", (int)(bot - bots), (char *)message + 5);
+		bot->state = bs_dropped;
+	}
+}
+
+static void Bot_ReadPackets (bot_t *bot, double now)
+{
+	int	len, wirelen;
+
+	while ((len = NET_Recv(bot->socket, message, sizeof(message) - 1, &wirelen)) >= 0)
+	{
+		if (len >= 4 && message[0] == 255 && message[1] == 255 &&
+		    message[2] == 255 && message[3] == 255)
+		{
+			Bot_Connectionless (bot, len, now);
+			continue;
+		}
+		if (bot->state != bs_connected && bot->state != bs_active)
+			continue;
+		if (len < 8)
+		{
+			bot->bad++;
+			continue;
+		}
+
+		MSG_BeginReading (message, len);
+		if (!Bot_Process(bot, now))
+			continue;
+		bot->packets_in++;
+		bot->bytes_in += wirelen;
+		bot->last_received = now;
+		Bot_ParseServerMessage (bot);
+	}
+}
+
+static void Bot_SendCmd (bot_t *bot, double now)
+{
+	unsigned char	buf[64];
+	int		i, len, msec, angle, bits;
+
+	msec = (int)(1000 / bot_fps);
+	if (msec > 255)
+		msec = 255;
+
+	/* wander: run forward, turn slowly, strafe now and then, jump
+	 * every few seconds and fire if asked to */
+	bot->frame++;
+	bot->yaw += 90.0f / bot_fps;
+	angle = (int)(bot->yaw * 65536 / 360) & 65535;
+
+	len = 0;
+	buf[len++] = clc_move;
+	for (i = 0; i < 3; i++)
+	{	/* this and the two previous commands, like CL_SendCmd */
+		bits = CM_FORWARD | CM_SIDE | CM_MSEC;
+		if (bot_attack || (bot->frame + i) % (int)(3 * bot_fps + 1) == 0)
+			bits |= CM_BUTTONS;
+		buf[len++] = bits;
+		if (i == 2)
+			buf[len++] = 0;		/* light level */
+		buf[len++] = angle & 255;
+		buf[len++] = angle >> 8;
+		buf[len++] = 200 / 4;
+		buf[len++] = (unsigned char)(signed char)((((bot->frame / (int)bot_fps) % 3) - 1) * 100 / 4);
+		if (bits & CM_BUTTONS)
+			buf[len++] = (bot_attack ? 1 : 0) | (((bot->frame + i) % (int)(3 * bot_fps + 1) == 0) ? 2 : 0);
+		buf[len++] = msec;
+	}
+
+	if (bot->state == bs_active && bot->validsequence &&
+	    bot->chan.outgoing_sequence - bot->validsequence < UPDATE_BACKUP - 1)
+	{
+		buf[len++] = clc_delta;
+		buf[len++] = bot->validsequence & 255;
+	}
+
+	Bot_Transmit (bot, buf, len, now);
+}
+
+static void Bot_Frame (bot_t *bot, double now)
+{
+	switch (bot->state)
+	{
+	case bs_connecting:
+		if (bot->next_connect <= now)
+			Bot_Connect (bot, now);
+		break;
+
+	case bs_connected:
+	case bs_active:
+		if (now - bot->last_received > 10)
+		{
+			printf ("bot%d: server timed out\n", (int)(bot - bots));
+			bot->state = bs_dropped;
+			break;
+		}
+		if (bot->next_send > now)
+			break;
+		bot->next_send += 1 / bot_fps;
+		if (bot->next_send < now)
+			bot->next_send = now;	/* we fell behind, don't burst */
+		Bot_SendCmd (bot, now);
+		break;
+
+	default:
+		break;
+	}
+}
+
+static void Bot_Disconnect (bot_t *bot, double now)
+{
+	unsigned char	buf[32];
+	int		i;
+
+	if (bot->state != bs_connected && bot->state != bs_active)
+		return;
+	/* like CL_Disconnect, send it a few times to be sure */
+	buf[0] = clc_stringcmd;
+	memcpy (buf + 1, "drop", 5);
+	for (i = 0; i < 3; i++)
+		Bot_Transmit (bot, buf, 6, now);
+}
+
+
+/*
+==============================================================================
+
+SERVER STATS
+
+==============================================================================
+*/
+
+/* the server statistics come from the cpu utilization, avg response
+ * time and packets/frame lines of its status command (svs.stats),
+ * read through rcon */
+static void Rcon_Status (void)
+{
+	char	text[256];
+	int	i, len;
+
+	len = q_snprintf (text, sizeof(text), "%c%c%c%crcon %s status", 255, 255, 255, 255, rcon_password);
+	for (i = 0; i < num_servers; i++)
+		NET_Send (rcon_socket, text, len + 1, &servers[i].adr);
+}
+
+static void Rcon_ReadReplies (void)
+{
+	struct sockaddr_in	from;
+	socklen_t	fromlen;
+	netadr_t	adr;
+	const char	*s;
+	ssize_t		size;
+	int		i, len;
+
+	for (;;)
+	{
+		fromlen = sizeof(from);
+		size = recvfrom(rcon_socket, (char *)huffbuff, sizeof(huffbuff), 0,
+					(struct sockaddr *)&from, &fromlen);
+		if (size <= 0)
+			break;
+		HuffDecode (huffbuff, message, (int)size, &len, sizeof(message) - 1);
+		if (len < 5 || len >= (int)sizeof(message) || message[4] != A2C_PRINT)
+			continue;
+		message[len] = 0;
+
+		SockadrToNetadr (&from, &adr);
+		for (i = 0; i < num_servers; i++)
+		{
+			if (!memcmp(servers[i].adr.ip, adr.ip, 4) && servers[i].adr.port == adr.port)
+				break;
+		}
+		if (i == num_servers)
+			continue;
+
+		if ((s = strstr((char *)message, "cpu utilization  :")) != NULL)
+			servers[i].cpu = atoi(s + 18);
+		if ((s = strstr((char *)message, "avg response time:")) != NULL)
+			servers[i].frame_ms = atoi(s + 18);
+		if ((s = strstr((char *)message, "packets/frame    :")) != NULL)
+		{
+			servers[i].packets = (float)atof(s + 18);
+			servers[i].replies++;
+		}
+		else if (strstr((char *)message, "Bad rcon_password") && !servers[i].replies--)
+			printf ("%s: bad rcon_password\n", NET_AdrToString(&adr));
+	}
+}
+
+
+/*
+==============================================================================
+
+REPORTS
+
+==============================================================================
+*/
+
+typedef struct
+{
+	int		bots[5];
+	int		packets_out, bytes_out, packets_in, bytes_in;
+	int		skipped, choked, partial, bad;
+	int		latency_count;
+	double		latency_total, latency_max;
+} botstats_t;
+
+static void Bot_Sum (botstats_t *s)
+{
+	bot_t	*bot;
+	int	i;
+
+	memset (s, 0, sizeof(*s));
+	for (i = 0, bot = bots; i < num_bots; i++, bot++)
+	{
+		s->bots[bot->state]++;
+		s->packets_out += bot->packets_out;
+		s->bytes_out += bot->bytes_out;
+		s->packets_in += bot->packets_in;
+		s->bytes_in += bot->bytes_in;
+		s->skipped += bot->skipped;
+		s->choked += bot->choked;
+		s->partial += bot->partial;
+		s->bad += bot->bad;
+		s->latency_count += bot->latency_count;
+		s->latency_total += bot->latency_total;
+		if (bot->latency_max > s->latency_max)
+			s->latency_max = bot->latency_max;
+	}
+}
+
+static void Bot_Report (double elapsed, double interval, botstats_t *last)
+{
+	botstats_t	now;
+	int		i, count, in, lost;
+
+	Bot_Sum (&now);
+	count = now.latency_count - last->latency_count;
+	in = now.packets_in - last->packets_in;
+	lost = (now.skipped - last->skipped) - (now.choked - last->choked);
+	if (lost < 0)
+		lost = 0;
+
+	printf ("%5.1fs: %3d active %3d joining, in %5.0f pkt/s %6.1f kB/s, out %5.0f pkt/s, "
+		"latency %5.1f ms, loss %5.2f%%, choke %d\n",
+		elapsed, now.bots[bs_active], now.bots[bs_connecting] + now.bots[bs_connected],
+		in / interval, (now.bytes_in - last->bytes_in) / interval / 1024,
+		(now.packets_out - last->packets_out) / interval,
+		count ? 1000 * (now.latency_total - last->latency_total) / count : 0.0,
+		(in + lost) ? 100.0 * lost / (in + lost) : 0.0,
+		now.choked - last->choked);
+	for (i = 0; i < num_servers; i++)
+	{
+		if (servers[i].replies <= 0)
+			continue;
+		printf ("        %s: cpu %3d%%, frame %d ms, %.2f packets/frame\n",
+			NET_AdrToString(&servers[i].adr), servers[i].cpu,
+			servers[i].frame_ms, servers[i].packets);
+	}
+
+	*last = now;
+}
+
+static void Bot_Summary (double elapsed)
+{
+	botstats_t	s;
+	bot_t		*bot;
+	double		avg, min_avg, max_avg, spawn, max_spawn;
+	int		i, spawned, lost;
+
+	Bot_Sum (&s);
+
+	min_avg = max_avg = -1;
+	spawn = max_spawn = 0;
+	spawned = 0;
+	for (i = 0, bot = bots; i < num_bots; i++, bot++)
+	{
+		if (bot->spawn_time)
+		{
+			spawned++;
+			spawn += bot->spawn_time;
+			if (bot->spawn_time > max_spawn)
+				max_spawn = bot->spawn_time;
+		}
+		if (!bot->latency_count)
+			continue;
+		avg = bot->latency_total / bot->latency_count;
+		if (min_avg < 0 || avg < min_avg)
+			min_avg = avg;
+		if (avg > max_avg)
+			max_avg = avg;
+	}
+
+	printf ("\n%d bots, %d spawned, %d still active, %d dropped or refused\n",
+		num_bots, spawned, s.bots[bs_active], s.bots[bs_dropped]);
+	if (spawned)
+		printf ("time to spawn: avg %.0f ms, max %.0f ms\n",
+			1000 * spawn / spawned, 1000 * max_spawn);
+	printf ("sent %d packets (%.1f kB/s), received %d packets (%.1f kB/s)\n",
+		s.packets_out, s.bytes_out / elapsed / 1024,
+		s.packets_in, s.bytes_in / elapsed / 1024);
+	lost = s.skipped - s.choked;
+	if (lost < 0)
+		lost = 0;
+	printf ("commands without a reply: %d choked, %d lost (%.2f%%)\n", s.choked, lost,
+		(s.packets_in + lost) ? 100.0 * lost / (s.packets_in + lost) : 0.0);
+	if (s.latency_count)
+		printf ("latency: avg %.1f ms, max %.1f ms, per bot avg from %.1f to %.1f ms\n",
+			1000 * s.latency_total / s.latency_count, 1000 * s.latency_max,
+			1000 * min_avg, 1000 * max_avg);
+	printf ("server pings: ");
+	for (i = 0, bot = bots; i < num_bots; i++, bot++)
+	{
+		if (bot->state == bs_active)
+			printf ("%d ", bot->serverping);
+	}
+	printf ("\n");
+	if (s.partial || s.bad)
+		printf ("%d packets with effects left unparsed, %d unreadable\n", s.partial, s.bad);
+}
+
+
+/*****************************************************************************/
+
+static void hwbot_sighandler (int sig)
+{
+	bot_quit = 1;
+}
+
+static void Usage (const char *prog)
+{
+	printf ("Usage: %s <address>[:port] [<address>[:port] ...] [options]\n", prog);
+	printf ("  -bots <n>       bots, spread over the servers, max %d (default %d)\n", MAX_BOTS, num_bots);
+	printf ("  -time <s>       seconds to run (default %g)\n", run_time);
+	printf ("  -fps <n>        commands per second per bot (default %g)\n", bot_fps);
+	printf ("  -join <n>       connections per second while joining (default %g)\n", join_rate);
+	printf ("  -rate <n>       rate userinfo of the bots (default %d)\n", bot_rate);
+	printf ("  -attack         keep the attack button down\n");
+	printf ("  -rcon <pass>    read the server statistics through rcon\n");
+	printf ("  -report <s>     seconds between reports (default %g)\n", report_interval);
+	exit (1);
+}
+
+int main (int argc, char **argv)
+{
+	botstats_t	last;
+	sys_socket_t	maxsocket;
+	fd_set		readfds;
+	double		start, now, end, next_join, next_report;
+	int		i, joined;
+
+	printf ("HWBOT %d.%d.%d\n", VER_HWBOT_MAJ, VER_HWBOT_MID, VER_HWBOT_MIN);
+
+/* command line sanity checking */
+	if (argc < 2)
+		Usage (argv[0]);
+
+/* init OS-specific network stuff */
+	NET_Init ();
+
+	for (i = 1; i < argc; i++)
+	{
+		if (argv[i][0] != '-')
+		{
+			if (num_servers == MAX_SERVERS)
+				Usage (argv[0]);
+			if (!NET_StringToAdr(argv[i], &servers[num_servers].adr))
+				Sys_Error ("Unable to resolve address %s", argv[i]);
+			if (servers[num_servers].adr.port == 0)
+				servers[num_servers].adr.port = htons(PORT_SERVER);
+			num_servers++;
+			continue;
+		}
+		if (!strcmp(argv[i], "-attack"))
+		{
+			bot_attack = 1;
+			continue;
+		}
+		if (i + 1 >= argc)
+			Usage (argv[0]);
+		if (!strcmp(argv[i], "-bots"))
+			num_bots = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-time"))
+			run_time = atof(argv[++i]);
+		else if (!strcmp(argv[i], "-fps"))
+			bot_fps = atof(argv[++i]);
+		else if (!strcmp(argv[i], "-join"))
+			join_rate = atof(argv[++i]);
+		else if (!strcmp(argv[i], "-rate"))
+			bot_rate = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-rcon"))
+			rcon_password = argv[++i];
+		else if (!strcmp(argv[i], "-report"))
+			report_interval = atof(argv[++i]);
+		else	Usage (argv[0]);
+	}
+	if (!num_servers || num_bots <= 0 || num_bots > MAX_BOTS ||
+	    bot_fps < 1 || bot_fps > 250 || join_rate <= 0 || report_interval <= 0)
+		Usage (argv[0]);
+
+/* open the sockets */
+	bots = (bot_t *) calloc (num_bots, sizeof(bot_t));
+	if (!bots)
+		Sys_Error ("Out of memory");
+	maxsocket = 0;
+	for (i = 0; i < num_bots; i++)
+	{
+		bots[i].socket = NET_OpenSocket ();
+		if (bots[i].socket == INVALID_SOCKET)
+			Sys_Error ("Couldn't open bot socket %d: %s", i, socketerror(SOCKETERRNO));
+		if (bots[i].socket > maxsocket)
+			maxsocket = bots[i].socket;
+		bots[i].server = i % num_servers;
+	}
+	if (rcon_password)
+	{
+		rcon_socket = NET_OpenSocket ();
+		if (rcon_socket == INVALID_SOCKET)
+			Sys_Error ("Couldn't open rcon socket: %s", socketerror(SOCKETERRNO));
+		if (rcon_socket > maxsocket)
+			maxsocket = rcon_socket;
+	}
+
+/* init Huffman */
+	HuffInit ();
+
+	memset (svc_sizes, -1, sizeof(svc_sizes));
+	for (i = 0; i < (int)(sizeof(svc_fixed) / sizeof(svc_fixed[0])); i++)
+		svc_sizes[svc_fixed[i].svc] = svc_fixed[i].size;
+
+	signal(SIGINT, hwbot_sighandler);
+#ifdef SIGBREAK
+	signal(SIGBREAK, hwbot_sighandler);
+#endif
+	signal(SIGTERM, hwbot_sighandler);
+
+	printf ("Running %d bots against %d server%s for %g seconds, use CTRL-C to stop early\n",
+				num_bots, num_servers, num_servers > 1 ? "s" : "", run_time);
+
+	start = Sys_DoubleTime ();
+	end = start + run_time;
+	next_join = start;
+	next_report = start + report_interval;
+	joined = 0;
+	memset (&last, 0, sizeof(last));
+	if (rcon_password)
+		Rcon_Status ();
+
+	while (!bot_quit && (now = Sys_DoubleTime()) < end)
+	{
+		/* bring the bots in gradually, a real crowd doesn't arrive at once */
+		while (joined < num_bots && next_join <= now)
+		{
+			Bot_Connect (&bots[joined++], now);
+			next_join += 1 / join_rate;
+		}
+
+		for (i = 0; i < num_bots; i++)
+		{
+			Bot_ReadPackets (&bots[i], now);
+			Bot_Frame (&bots[i], now);
+		}
+		if (rcon_password)
+			Rcon_ReadReplies ();
+
+		if (next_report <= now)
+		{
+			Bot_Report (now - start, report_interval, &last);
+			next_report += report_interval;
+			if (rcon_password)
+				Rcon_Status ();
+		}
+
+		FD_ZERO (&readfds);
+		for (i = 0; i < num_bots; i++)
+			FD_SET (bots[i].socket, &readfds);
+		if (rcon_password)
+			FD_SET (rcon_socket, &readfds);
+		NET_Wait (maxsocket, &readfds, 1000);
+	}
+
+	now = Sys_DoubleTime ();
+	for (i = 0; i < num_bots; i++)
+	{
+		Bot_Disconnect (&bots[i], now);
+		closesocket (bots[i].socket);
+	}
+	if (rcon_password)
+		closesocket (rcon_socket);
+
+	Bot_Summary (now - start);
+
+	NET_Shutdown ();
+	return 0;
+}
@@ -29,7 +29,7 @@
 
 #define VER_HWMASTER_MAJ	1
 #define VER_HWMASTER_MID	2
-#define VER_HWMASTER_MIN	7
+#define VER_HWMASTER_MIN	8
 #define VER_HWMASTER_STR	STRINGIFY(VER_HWMASTER_MAJ) "." STRINGIFY(VER_HWMASTER_MID) "." STRINGIFY(VER_HWMASTER_MIN)
 
 /* =====================================================================
@@ -294,19 +294,93 @@ SERVER LISTS HANDLING
 ==============================================================================
 */
 
+/* the servers are kept in a doubly linked list for the list replies,
+ * in a hash table on the address for the per-packet lookups and in a
+ * timer wheel of one second slots for the timeouts.  the wheel spans
+ * more than SV_TIMEOUT seconds, so each server is looked at only once,
+ * when its slot comes due.  */
+#define	SV_TIMEOUT	450
+
+#define	SVL_HASH_SIZE	4096		/* must be a power of two */
+#define	SVL_WHEEL_SIZE	512		/* must be a power of two > SV_TIMEOUT */
+
 typedef struct server_s
 {
 	netadr_t	ip;
 	struct	server_s *next;
 	struct	server_s *previous;
+	struct	server_s *hashnext;
+	struct	server_s *wheelnext;
+	struct	server_s *wheelprev;
 	double	timeout;
+	int	expire;		/* timer wheel tick */
 } server_t;
 
 server_t *sv_list = NULL;
+static int	sv_count;
+static server_t	*sv_hash[SVL_HASH_SIZE];
+static server_t	*sv_wheel[SVL_WHEEL_SIZE];
+static int	sv_wheeltick;
+
+/* the server list reply is built once and resent until the list
+ * changes.  a list that doesn't fit in one datagram is split in parts
+ * of LIST_PART_SERVERS, each part ending with an M2C_LISTCONT marker.  */
+#define	LIST_HEADER_SIZE	7
+#define	LIST_PART_SERVERS	((MAX_DATAGRAM - LIST_HEADER_SIZE - 3) / 6)
+#define	MAX_LIST_PARTS		255
+
+static byte	*sv_reply;
+static int	sv_replysize[MAX_LIST_PARTS];
+static int	sv_replyparts, sv_replyalloc;
+static qboolean	sv_replydirty = true;
+
+
+static unsigned int SVL_Hash (const netadr_t *adr)
+{
+	unsigned int	h;
+
+	h = (adr->ip[0] << 24) | (adr->ip[1] << 16) | (adr->ip[2] << 8) | adr->ip[3];
+	h = (h ^ adr->port) * 2654435761U;
+
+	return (h >> 20) & (SVL_HASH_SIZE - 1);
+}
 
+static void SVL_Unschedule (server_t *sv)
+{
+	server_t	**slot = &sv_wheel[sv->expire & (SVL_WHEEL_SIZE - 1)];
+
+	if (sv->wheelprev)
+		sv->wheelprev->wheelnext = sv->wheelnext;
+	else if (*slot == sv)
+		*slot = sv->wheelnext;
+	if (sv->wheelnext)
+		sv->wheelnext->wheelprev = sv->wheelprev;
+
+	sv->wheelnext = NULL;
+	sv->wheelprev = NULL;
+}
+
+static void SVL_Touch (server_t *sv)
+{
+	server_t	**slot;
+
+	SVL_Unschedule (sv);
+
+	sv->timeout = Sys_DoubleTime();
+	/* first tick at which timeout + SV_TIMEOUT has passed */
+	sv->expire = (int)sv->timeout + SV_TIMEOUT + 1;
+
+	slot = &sv_wheel[sv->expire & (SVL_WHEEL_SIZE - 1)];
+	sv->wheelnext = *slot;
+	if (*slot)
+		(*slot)->wheelprev = sv;
+	*slot = sv;
+}
 
 static void SVL_Remove (server_t *sv)
 {
+	server_t	**link;
+
 	if (sv_list == sv)
 		sv_list = sv->next;
 
@@ -317,6 +391,21 @@ static void SVL_Remove (server_t *sv)
 
 	sv->next = NULL;
 	sv->previous = NULL;
+
+	for (link = &sv_hash[SVL_Hash(&sv->ip)] ; *link ; link = &(*link)->hashnext)
+	{
+		if (*link == sv)
+		{
+			*link = sv->hashnext;
+			break;
+		}
+	}
+	sv->hashnext = NULL;
+
+	SVL_Unschedule (sv);
+
+	sv_count--;
+	sv_replydirty = true;
 }
 
 static void SVL_Clear (void)
@@ -351,18 +440,26 @@ static server_t *SVL_New (const netadr_t *adr)
 
 static void SVL_Add (server_t *sv)
 {
+	unsigned int	hash = SVL_Hash(&sv->ip);
+
 	sv->next = sv_list;
 	sv->previous = NULL;
 	if (sv_list)
 		sv_list->previous = sv;
 	sv_list = sv;
+
+	sv->hashnext = sv_hash[hash];
+	sv_hash[hash] = sv;
+
+	sv_count++;
+	sv_replydirty = true;
 }
 
 static server_t *SVL_Find (const netadr_t *adr)
 {
 	server_t *sv;
 
-	for (sv = sv_list ; sv ; sv = sv->next)
+	for (sv = sv_hash[SVL_Hash(adr)] ; sv ; sv = sv->hashnext)
 	{
 		if (NET_CompareAdr(&sv->ip, adr))
 			return sv;
@@ -371,12 +468,84 @@ static server_t *SVL_Find (const netadr_t *adr)
 	return NULL;
 }
 
+static void SVL_Heartbeat (const netadr_t *adr)
+{
+	server_t *sv;
+
+	if (!(sv = SVL_Find(adr)))
+	{
+		sv = SVL_New(adr);
+		SVL_Add(sv);
+	}
+	SVL_Touch(sv);
+}
+
 static void SVL_ServerList_f (void)
 {
 	server_t *sv;
 
 	for (sv = sv_list ; sv ; sv = sv->next)
 		printf("\t%s\n", NET_AdrToString(&sv->ip));
+	printf("%d servers\n", sv_count);
+}
+
+static void SVL_BuildReply (void)
+{
+	sizebuf_t	msg;
+	server_t	*sv;
+	int		parts, part, i;
+
+	parts = (sv_count + LIST_PART_SERVERS - 1) / LIST_PART_SERVERS;
+	if (parts < 1)
+		parts = 1;
+	if (parts > MAX_LIST_PARTS)
+	{
+		printf("%d servers, list reply truncated to %d\n", sv_count, MAX_LIST_PARTS * LIST_PART_SERVERS);
+		parts = MAX_LIST_PARTS;
+	}
+	if (parts > sv_replyalloc)
+	{
+		sv_reply = (byte *)realloc(sv_reply, parts * MAX_DATAGRAM);
+		if (!sv_reply)
+			Sys_Error("%s: out of memory", __thisfunc__);
+		sv_replyalloc = parts;
+	}
+
+	sv = sv_list;
+	for (part = 0 ; part < parts ; part++)
+	{
+		SZ_Init (&msg, sv_reply + part * MAX_DATAGRAM, MAX_DATAGRAM);
+
+		MSG_WriteByte(&msg,255);
+		MSG_WriteByte(&msg,255);
+		MSG_WriteByte(&msg,255);
+		MSG_WriteByte(&msg,255);
+		MSG_WriteByte(&msg,255);
+		MSG_WriteByte(&msg,M2C_SERVERLST);
+		MSG_WriteByte(&msg,'\n');
+
+		for (i = 0 ; sv && i < LIST_PART_SERVERS ; i++, sv = sv->next)
+		{
+			MSG_WriteByte(&msg,sv->ip.ip[0]);
+			MSG_WriteByte(&msg,sv->ip.ip[1]);
+			MSG_WriteByte(&msg,sv->ip.ip[2]);
+			MSG_WriteByte(&msg,sv->ip.ip[3]);
+			MSG_WriteShort(&msg,sv->ip.port);
+		}
+
+		/* a single part reply stays in the old format */
+		if (parts > 1)
+		{
+			MSG_WriteByte(&msg,M2C_LISTCONT);
+			MSG_WriteByte(&msg,part);
+			MSG_WriteByte(&msg,parts);
+		}
+
+		sv_replysize[part] = msg.cursize;
+	}
+
+	sv_replyparts = parts;
+	sv_replydirty = false;
 }
 
 
@@ -415,31 +584,13 @@ static void SV_AnalysePacket (void)
 
 static void Mst_SendList (void)
 {
-	byte		buf[MAX_DATAGRAM];
-	sizebuf_t	msg;
-	server_t	*sv;
-
-	SZ_Init (&msg, buf, sizeof(buf));
-	msg.allowoverflow = true;
+	int	part;
 
-	MSG_WriteByte(&msg,255);
-	MSG_WriteByte(&msg,255);
-	MSG_WriteByte(&msg,255);
-	MSG_WriteByte(&msg,255);
-	MSG_WriteByte(&msg,255);
-	MSG_WriteByte(&msg,M2C_SERVERLST);
-	MSG_WriteByte(&msg,'\n');
+	if (sv_replydirty)
+		SVL_BuildReply ();
 
-	for (sv = sv_list ; sv ; sv = sv->next)
-	{
-		MSG_WriteByte(&msg,sv->ip.ip[0]);
-		MSG_WriteByte(&msg,sv->ip.ip[1]);
-		MSG_WriteByte(&msg,sv->ip.ip[2]);
-		MSG_WriteByte(&msg,sv->ip.ip[3]);
-		MSG_WriteShort(&msg,sv->ip.port);
-	}
-
-	NET_SendPacket(msg.cursize,msg.data,&net_from);
+	for (part = 0 ; part < sv_replyparts ; part++)
+		NET_SendPacket(sv_replysize[part], sv_reply + part * MAX_DATAGRAM, &net_from);
 }
 
 static void Mst_Packet (void)
@@ -454,23 +605,13 @@ static void Mst_Packet (void)
 	case A2A_PING:
 		SV_Filter();
 		printf("%s >> A2A_PING\n", NET_AdrToString(&net_from));
-		if (!(sv = SVL_Find(&net_from)))
-		{
-			sv = SVL_New(&net_from);
-			SVL_Add(sv);
-		}
-		sv->timeout = Sys_DoubleTime();
+		SVL_Heartbeat(&net_from);
 		break;
 
 	case S2M_HEARTBEAT:
 		SV_Filter();
 		printf("%s >> S2M_HEARTBEAT\n", NET_AdrToString(&net_from));
-		if (!(sv = SVL_Find(&net_from)))
-		{
-			sv = SVL_New(&net_from);
-			SVL_Add(sv);
-		}
-		sv->timeout = Sys_DoubleTime();
+		SVL_Heartbeat(&net_from);
 		break;
 
 	case S2M_SHUTDOWN:
@@ -538,31 +679,30 @@ static void SV_GetConsoleCommands (void)
 	}
 }
 
-#define SV_TIMEOUT 450
-
 static void SV_TimeOut(void)
 {
-	double t = Sys_DoubleTime();
+	int	now = (int)Sys_DoubleTime();
+	int	steps, tick;
 	server_t *sv;
 	server_t *next;
 
-	if (sv_list == NULL)
-		return;
+	/* remove servers that haven't sent a heartbeat for some time:
+	 * walk the wheel slots that came due since the last frame.  */
+	steps = now - sv_wheeltick;
+	if (steps > SVL_WHEEL_SIZE)
+		steps = SVL_WHEEL_SIZE;
+	sv_wheeltick = now;
 
-	/* remove servers that haven't sent a heartbeat for some time */
-	for (sv = sv_list ; sv ; )
+	for (tick = now - steps + 1 ; tick <= now ; tick++)
 	{
-		if (sv->timeout + SV_TIMEOUT < t)
+		for (sv = sv_wheel[tick & (SVL_WHEEL_SIZE - 1)] ; sv ; sv = next)
 		{
-			next = sv->next;
+			next = sv->wheelnext;
+			if (sv->expire > now)
+				continue;
 			printf("%s timed out\n",NET_AdrToString(&sv->ip));
 			SVL_Remove(sv);
 			free(sv);
-			sv = next;
-		}
-		else
-		{
-			sv = sv->next;
 		}
 	}
 }
@@ -48,6 +48,8 @@
 #define	S2M_SHUTDOWN		'C'
 
 #define	M2C_SERVERLST		'd'	// + \n + hw server port list
+#define	M2C_LISTCONT		'+'	// + part + numparts, ends each part
+					// of a server list split over packets
 
 #endif	/* __HWM_PROTOCOL_H */
 
@@ -0,0 +1,498 @@
+/* hwmload.c - HWMLOAD 0.1 HexenWorld Master Server load generator
+ * Based on hwmquery.c, Copyright (C) 2006-2011 O. Sezer <sezero@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <sys/types.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include "arch_def.h"
+#include "compiler.h"
+#define	COMPILE_TIME_ASSERT(name, x)	\
+	typedef int dummy_ ## name[(x) * 2 - 1]
+#include "net_sys.h"
+#include "qsnprint.h"
+
+#if defined(PLATFORM_UNIX)
+#include <sys/time.h>
+#include <sys/resource.h>
+#endif
+
+/*****************************************************************************/
+
+typedef struct
+{
+	unsigned char	ip[4];
+	unsigned short	port;
+	unsigned short	pad;
+} netadr_t;
+
+#if defined(_MSC_VER)
+#if defined(_WIN64)
+#define ssize_t	SSIZE_T
+#else
+typedef int	ssize_t;
+#endif	/* _WIN64 */
+#endif	/* _MSC_VER */
+
+#if defined(PLATFORM_AMIGA)
+struct Library	*SocketBase;
+#endif
+#if defined(PLATFORM_WINDOWS)
+#include "wsaerror.h"
+static WSADATA	winsockdata;
+#endif
+
+FUNC_NORETURN void Sys_Error (const char *error, ...) FUNC_PRINTF(1,2);
+#ifdef __WATCOMC__
+#pragma aux Sys_Error aborts;
+#endif
+
+/*****************************************************************************/
+
+static void NetadrToSockadr (const netadr_t *a, struct sockaddr_in *s)
+{
+	memset (s, 0, sizeof(*s));
+	s->sin_family = AF_INET;
+
+	memcpy (&s->sin_addr, a->ip, 4);
+	s->sin_port = a->port;
+}
+
+static void SockadrToNetadr (const struct sockaddr_in *s, netadr_t *a)
+{
+	memcpy (a->ip, &s->sin_addr, 4);
+	a->port = s->sin_port;
+}
+
+const char *NET_AdrToString (const netadr_t *a)
+{
+	static	char	s[64];
+
+	sprintf (s, "%i.%i.%i.%i:%i", a->ip[0], a->ip[1], a->ip[2], a->ip[3],
+							ntohs(a->port));
+
+	return s;
+}
+
+static int NET_StringToAdr (const char *s, netadr_t *a)
+{
+	struct hostent		*h;
+	struct sockaddr_in	sadr;
+	char	*colon;
+	char	copy[128];
+
+	memset (&sadr, 0, sizeof(sadr));
+	sadr.sin_family = AF_INET;
+	sadr.sin_port = 0;
+
+	strncpy (copy, s, sizeof(copy) - 1);
+	copy[sizeof(copy) - 1] = '\0';
+	/* strip off a trailing :port if present */
+	for (colon = copy; *colon; colon++)
+	{
+		if (*colon == ':')
+		{
+			*colon = 0;
+			sadr.sin_port = htons((short)atoi(colon+1));
+		}
+	}
+
+	if (copy[0] >= '0' && copy[0] <= '9')
+	{
+		sadr.sin_addr.s_addr = inet_addr(copy);
+	}
+	else
+	{
+		h = gethostbyname (copy);
+		if (!h)
+			return 0;
+		sadr.sin_addr.s_addr = *(in_addr_t *)h->h_addr_list[0];
+	}
+
+	SockadrToNetadr (&sadr, a);
+
+	return 1;
+}
+
+static void NET_Init (void)
+{
+#if defined(PLATFORM_WINDOWS)
+	int err = WSAStartup(MAKEWORD(1,1), &winsockdata);
+	if (err != 0)
+		Sys_Error ("Winsock initialization failed (%s)", socketerror(err));
+#endif	/* PLATFORM_WINDOWS */
+#if defined(PLATFORM_OS2) && !defined(__EMX__)
+	if (sock_init() < 0)
+		Sys_Error ("Can't initialize IBM OS/2 sockets");
+#endif	/* OS/2 */
+#ifdef PLATFORM_AMIGA
+	SocketBase = OpenLibrary("bsdsocket.library", 0);
+	if (!SocketBase)
+		Sys_Error ("Can't open bsdsocket.library.");
+#endif	/* PLATFORM_AMIGA */
+#if defined(PLATFORM_UNIX)
+	/* one socket per simulated server: allow as many as we may */
+	struct rlimit	rl;
+	if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max)
+	{
+		rl.rlim_cur = rl.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &rl);
+	}
+#endif	/* PLATFORM_UNIX */
+}
+
+static void NET_Shutdown (void)
+{
+#if defined(PLATFORM_WINDOWS)
+	WSACleanup ();
+#endif
+#ifdef PLATFORM_AMIGA
+	if (SocketBase)
+	{
+		CloseLibrary(SocketBase);
+		SocketBase = NULL;
+	}
+#endif
+}
+
+static sys_socket_t NET_OpenSocket (void)
+{
+	sys_socket_t	s;
+#if defined(PLATFORM_WINDOWS) || defined(PLATFORM_DOS)
+	u_long	_true = 1;
+#else
+	int	_true = 1;
+#endif
+	int	err;
+
+	s = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (s == INVALID_SOCKET)
+		return INVALID_SOCKET;
+	if (ioctlsocket (s, FIONBIO, IOCTLARG_P(&_true)) == SOCKET_ERROR)
+	{
+		err = SOCKETERRNO;
+		Sys_Error ("ioctl FIONBIO: %s", socketerror(err));
+	}
+
+	return s;
+}
+
+static void NET_Send (sys_socket_t s, const void *data, int len, const netadr_t *to)
+{
+	struct sockaddr_in	addr;
+
+	NetadrToSockadr (to, &addr);
+	sendto (s, (const char *)data, len, 0, (struct sockaddr *)&addr, sizeof(addr));
+}
+
+static void NET_Wait (sys_socket_t maxsocket, fd_set *readfds, long usec)
+{
+	struct timeval	timeout;
+
+	timeout.tv_sec = 0;
+	timeout.tv_usec = usec;
+
+	selectsocket(maxsocket + 1, readfds, NULL, NULL, &timeout);
+}
+
+/*****************************************************************************/
+
+static double Sys_DoubleTime (void)
+{
+#if defined(PLATFORM_WINDOWS)
+	return GetTickCount() / 1000.0;
+#else
+	struct timeval	tp;
+
+	gettimeofday (&tp, NULL);
+	return tp.tv_sec + tp.tv_usec / 1e6;
+#endif
+}
+
+void Sys_Error (const char *error, ...)
+{
+	va_list		argptr;
+	char		text[1024];
+
+	va_start (argptr,error);
+	q_vsnprintf (text, sizeof (text), error,argptr);
+	va_end (argptr);
+
+	NET_Shutdown ();
+
+	printf ("\nERROR: %s\n\n", text);
+
+	exit (1);
+}
+
+/*****************************************************************************/
+
+#define	VER_HWMLOAD_MAJ		0
+#define	VER_HWMLOAD_MID		1
+#define	VER_HWMLOAD_MIN		0
+
+#define	PORT_MASTER		26900
+
+#define	S2C_CHALLENGE		'c'
+#define	S2M_HEARTBEAT		'a'
+#define	S2M_SHUTDOWN		'C'
+#define	M2C_SERVERLST		'd'
+#define	M2C_LISTCONT		'+'
+
+#define	MAX_PACKET		2048
+#define	MAX_QUERY_CLIENTS	256	/* keeps the client sockets below FD_SETSIZE */
+
+static const unsigned char query_msg[] =
+		{ 255, S2C_CHALLENGE, '\0' };
+
+static const unsigned char shutdown_msg[] =
+		{ 255, S2M_SHUTDOWN, '\n', '\0' };
+
+static const unsigned char reply_hdr[] =
+		{ 255, 255, 255, 255,
+		  255, M2C_SERVERLST, '\n' };
+
+typedef struct
+{
+	sys_socket_t	socket;
+	int		sequence;
+	double		next;
+} loadserver_t;
+
+typedef struct
+{
+	sys_socket_t	socket;
+	double		next;
+	double		sent;		/* 0 when no query is outstanding */
+	int		parts, received, entries;
+} loadclient_t;
+
+static loadserver_t	*servers;
+static loadclient_t	clients[MAX_QUERY_CLIENTS];
+static unsigned char	packet[MAX_PACKET];
+
+static int	num_servers = 1000;
+static int	num_clients = 8;
+static double	run_time = 10;
+static double	hb_interval = 5;	/* seconds between heartbeats */
+static double	query_interval = 0.1;	/* seconds between queries, per client */
+
+/* results */
+static int	hb_sent, queries_sent, replies, lost, packets, bad;
+static int	last_entries, min_entries = -1, max_entries;
+static double	total_latency, max_latency;
+
+
+static void ReadReplies (loadclient_t *cl, double now)
+{
+	unsigned char	*p;
+	ssize_t		size;
+
+	while ((size = recvfrom(cl->socket, (char *)packet, sizeof(packet), 0, NULL, NULL)) > 0)
+	{
+		packets++;
+		if (size < 7 || memcmp(packet, reply_hdr, 7) != 0)
+		{
+			bad++;
+			continue;
+		}
+		if (!cl->sent)
+			continue;	/* late part of a query we gave up on */
+
+		p = packet + 7;
+		size -= 7;
+		if (size % 6 == 3 && p[size - 3] == M2C_LISTCONT)
+		{
+			size -= 3;
+			cl->parts = p[size + 2];
+		}
+		else
+		{
+			cl->parts = 1;
+		}
+		cl->entries += (int)size / 6;
+
+		if (++cl->received < cl->parts)
+			continue;
+
+		/* all parts are in */
+		replies++;
+		total_latency += now - cl->sent;
+		if (now - cl->sent > max_latency)
+			max_latency = now - cl->sent;
+		last_entries = cl->entries;
+		if (min_entries < 0 || cl->entries < min_entries)
+			min_entries = cl->entries;
+		if (cl->entries > max_entries)
+			max_entries = cl->entries;
+		cl->sent = 0;
+	}
+}
+
+static void Usage (const char *prog)
+{
+	printf ("Usage: %s <address>[:port] [options]\n", prog);
+	printf ("  -servers <n>    simulated servers (default %d)\n", num_servers);
+	printf ("  -clients <n>    querying clients, max %d (default %d)\n", MAX_QUERY_CLIENTS, num_clients);
+	printf ("  -heartbeat <s>  seconds between heartbeats (default %g)\n", hb_interval);
+	printf ("  -query <s>      seconds between queries per client (default %g)\n", query_interval);
+	printf ("  -time <s>       seconds to run (default %g)\n", run_time);
+	exit (1);
+}
+
+int main (int argc, char **argv)
+{
+	netadr_t	master;
+	sys_socket_t	maxsocket;
+	fd_set		readfds;
+	char		text[32];
+	double		start, now, end;
+	int		i, len;
+
+	printf ("HWMASTER LOAD %d.%d.%d\n", VER_HWMLOAD_MAJ, VER_HWMLOAD_MID, VER_HWMLOAD_MIN);
+
+/* command line sanity checking */
+	if (argc < 2)
+		Usage (argv[0]);
+	for (i = 2; i < argc; i++)
+	{
+		if (i + 1 >= argc)
+			Usage (argv[0]);
+		if (!strcmp(argv[i], "-servers"))
+			num_servers = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-clients"))
+			num_clients = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-heartbeat"))
+			hb_interval = atof(argv[++i]);
+		else if (!strcmp(argv[i], "-query"))
+			query_interval = atof(argv[++i]);
+		else if (!strcmp(argv[i], "-time"))
+			run_time = atof(argv[++i]);
+		else	Usage (argv[0]);
+	}
+	if (num_servers < 0 || num_clients < 0 || num_clients > MAX_QUERY_CLIENTS ||
+	    hb_interval <= 0 || query_interval <= 0)
+		Usage (argv[0]);
+
+/* init OS-specific network stuff */
+	NET_Init ();
+
+/* decode the address and port */
+	if (!NET_StringToAdr(argv[1], &master))
+		Sys_Error ("Unable to resolve address %s", argv[1]);
+	if (master.port == 0)
+		master.port = htons(PORT_MASTER);
+
+/* open the client sockets first, so that they fit in an fd_set */
+	maxsocket = 0;
+	for (i = 0; i < num_clients; i++)
+	{
+		clients[i].socket = NET_OpenSocket ();
+		if (clients[i].socket == INVALID_SOCKET)
+			Sys_Error ("Couldn't open client socket %d: %s", i, socketerror(SOCKETERRNO));
+		if (clients[i].socket > maxsocket)
+			maxsocket = clients[i].socket;
+	}
+	servers = (loadserver_t *) calloc (num_servers + 1, sizeof(loadserver_t));
+	if (!servers)
+		Sys_Error ("Out of memory");
+	for (i = 0; i < num_servers; i++)
+	{
+		servers[i].socket = NET_OpenSocket ();
+		if (servers[i].socket == INVALID_SOCKET)
+			Sys_Error ("Couldn't open server socket %d: %s", i, socketerror(SOCKETERRNO));
+	}
+
+/* spread the first heartbeats and queries evenly over one interval */
+	start = Sys_DoubleTime ();
+	end = start + run_time;
+	for (i = 0; i < num_servers; i++)
+		servers[i].next = start + hb_interval * i / num_servers;
+	for (i = 0; i < num_clients; i++)
+		clients[i].next = start + hb_interval + query_interval * i / num_clients;
+
+	printf ("Simulating %d servers and %d clients against %s for %g seconds\n",
+				num_servers, num_clients, NET_AdrToString(&master), run_time);
+
+	while ((now = Sys_DoubleTime()) < end)
+	{
+		for (i = 0; i < num_servers; i++)
+		{
+			if (servers[i].next > now)
+				continue;
+			servers[i].next += hb_interval;
+			len = q_snprintf (text, sizeof(text), "%c%c\n%i\n%i\n", 255, S2M_HEARTBEAT,
+						++servers[i].sequence, i & 7);
+			NET_Send (servers[i].socket, text, len, &master);
+			hb_sent++;
+		}
+
+		for (i = 0; i < num_clients; i++)
+		{
+			ReadReplies (&clients[i], now);
+			if (clients[i].next > now)
+				continue;
+			if (clients[i].sent)
+				lost++;	/* no complete reply since the last query */
+			clients[i].next += query_interval;
+			clients[i].sent = now;
+			clients[i].parts = clients[i].received = clients[i].entries = 0;
+			NET_Send (clients[i].socket, query_msg, sizeof(query_msg), &master);
+			queries_sent++;
+		}
+
+		FD_ZERO (&readfds);
+		for (i = 0; i < num_clients; i++)
+			FD_SET (clients[i].socket, &readfds);
+		NET_Wait (maxsocket, &readfds, 1000);
+	}
+
+/* collect the last replies, then take the servers off the list */
+	NET_Wait (0, NULL, 200000);
+	now = Sys_DoubleTime ();
+	for (i = 0; i < num_clients; i++)
+	{
+		ReadReplies (&clients[i], now);
+		if (clients[i].sent)
+			lost++;
+	}
+	for (i = 0; i < num_servers; i++)
+	{
+		NET_Send (servers[i].socket, shutdown_msg, sizeof(shutdown_msg), &master);
+		closesocket (servers[i].socket);
+	}
+	for (i = 0; i < num_clients; i++)
+		closesocket (clients[i].socket);
+
+	printf ("%d heartbeats sent (%.0f/s)\n", hb_sent, hb_sent / run_time);
+	printf ("%d queries sent, %d complete replies, %d lost or incomplete\n", queries_sent, replies, lost);
+	printf ("%d reply packets, %d invalid\n", packets, bad);
+	if (replies)
+	{
+		printf ("reply latency: avg %.2f ms, max %.2f ms\n",
+				1000 * total_latency / replies, 1000 * max_latency);
+		printf ("servers per reply: min %d, max %d, last %d\n",
+				min_entries, max_entries, last_entries);
+	}
+
+	NET_Shutdown ();
+	return 0;
+}
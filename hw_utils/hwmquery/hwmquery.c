@@ -211,13 +211,14 @@ void Sys_Error (const char *error, ...)
 
 #define	VER_HWMQUERY_MAJ	0
 #define	VER_HWMQUERY_MID	2
-#define	VER_HWMQUERY_MIN	3
+#define	VER_HWMQUERY_MIN	4
 
 #define	PORT_MASTER		26900
 #define	PORT_SERVER		26950
 
 #define	S2C_CHALLENGE		'c'
 #define	M2C_SERVERLST		'd'
+#define	M2C_LISTCONT		'+'
 
 #define	MAX_PACKET		2048
 
@@ -242,6 +243,9 @@ int main (int argc, char **argv)
 	int	_true = 1;
 #endif
 	int		err;
+	int		count, parts = 0, received = 0;
+	unsigned char	*tmp;
+	unsigned short	port;
 
 	printf ("HWMASTER QUERY %d.%d.%d\n", VER_HWMQUERY_MAJ, VER_HWMQUERY_MID, VER_HWMQUERY_MIN);
 
@@ -288,54 +292,69 @@ int main (int argc, char **argv)
 		Sys_Error ("Sendto failed: %s", socketerror(err));
 	}
 
-/* read the response */
-	memset (response, 0, sizeof(response));
-	fromlen = sizeof(hostaddress);
-	if (NET_CheckReadTimeout(5, 0) <= 0)
-		Sys_Error ("*** timeout waiting for reply");
-
-	size = recvfrom(socketfd, (char *)response, sizeof(response), 0,
-			(struct sockaddr *)&hostaddress, &fromlen);
-	if (size == SOCKET_ERROR)
-	{
-		err = SOCKETERRNO;
-		if (err != NET_EWOULDBLOCK)
-			Sys_Error ("Recv failed: %s", socketerror(err));
-	}
-	else if (size == sizeof(response))
-	{
-		Sys_Error ("Received oversized packet!");
-	}
-	else if (memcmp(response, reply_hdr, 7) != 0)
-	{
-		Sys_Error ("Invalid response received");
-	}
-	else
+/* read the response: a long list comes in several parts, each
+ * ending with an M2C_LISTCONT trailer.  */
+	count = 0;
+	do
 	{
-		unsigned char	*tmp;
-		unsigned short	port;
+		memset (response, 0, sizeof(response));
+		fromlen = sizeof(hostaddress);
+		if (NET_CheckReadTimeout(5, 0) <= 0)
+		{
+			if (!parts)
+				Sys_Error ("*** timeout waiting for reply");
+			printf ("Warning: timeout, got %d of %d parts\n", received, parts);
+			break;
+		}
 
-		printf ("H2W Servers registered at %s:", NET_AdrToString(&ipaddress));
+		size = recvfrom(socketfd, (char *)response, sizeof(response), 0,
+				(struct sockaddr *)&hostaddress, &fromlen);
+		if (size == SOCKET_ERROR)
+		{
+			err = SOCKETERRNO;
+			if (err != NET_EWOULDBLOCK)
+				Sys_Error ("Recv failed: %s", socketerror(err));
+			continue;
+		}
+		else if (size == sizeof(response))
+		{
+			Sys_Error ("Received oversized packet!");
+		}
+		else if (size < 7 || memcmp(response, reply_hdr, 7) != 0)
+		{
+			Sys_Error ("Invalid response received");
+		}
 
 		tmp = &response[7];
 		size -= 7;
-		if (!size)
-			printf (" NONE\n");
-		else
+		if (size % 6 == 3 && tmp[size - 3] == M2C_LISTCONT)
 		{
-			/* each address is 4 bytes (ip) + 2 bytes (port) == 6 bytes */
-			printf (" %d entries\n", (int)size / 6);
-			if (size % 6 != 0)
-				printf ("Warning: not counting truncated last entry\n");
-			while (size >= 6)
+			size -= 3;
+			if (!parts)
 			{
-				port = ntohs (tmp[4] + (tmp[5] << 8));
-				printf ("%u.%u.%u.%u:%u\n", tmp[0], tmp[1], tmp[2], tmp[3], port);
-				tmp += 6;
-				size -= 6;
+				parts = tmp[size + 2];
+				printf ("Server list in %d parts\n", parts);
 			}
 		}
-	}
+		received++;
+
+		/* each address is 4 bytes (ip) + 2 bytes (port) == 6 bytes */
+		if (size % 6 != 0)
+			printf ("Warning: not counting truncated last entry\n");
+		while (size >= 6)
+		{
+			port = ntohs (tmp[4] + (tmp[5] << 8));
+			printf ("%u.%u.%u.%u:%u\n", tmp[0], tmp[1], tmp[2], tmp[3], port);
+			tmp += 6;
+			size -= 6;
+			count++;
+		}
+	} while (received < parts);
+
+	printf ("H2W Servers registered at %s:", NET_AdrToString(&ipaddress));
+	if (!count)
+		printf (" NONE\n");
+	else	printf (" %d entries\n", count);
 
 	NET_Shutdown ();
 	return 0;
@@ -7,6 +7,7 @@ if test "$1" = "strip"; then
 	fi
 	strip hcc/hcc$exe_ext			\
 		dcc/dhcc$exe_ext		\
+		qc2c/qc2c$exe_ext		\
 		vis/vis$exe_ext			\
 		light/light$exe_ext		\
 		qbsp/qbsp$exe_ext		\
@@ -41,6 +42,7 @@ if test "$1" = "clean"; then
 	$MAKE_CMD -s -C qfiles clean
 	$MAKE_CMD -s -C pak clean
 	$MAKE_CMD -s -C dcc clean
+	$MAKE_CMD -s -C qc2c clean
 	$MAKE_CMD -s -C jsh2color clean
 	$MAKE_CMD -s -C texutils/bsp2wal clean
 	$MAKE_CMD -s -C texutils/lmp2pcx clean
@@ -67,6 +69,8 @@ echo "" && echo "Now building bspinfo.."
 $MAKE_CMD -C bspinfo $* || exit 1
 echo "" && echo "Now building dhcc, a progs.dat decompiler.."
 $MAKE_CMD -C dcc $* || exit 1
+echo "" && echo "Now building qc2c, a progs.dat to C translator.."
+$MAKE_CMD -C qc2c $* || exit 1
 echo "" && echo "Now building jsh2colour, a lit file generator.."
 $MAKE_CMD -C jsh2color $* || exit 1
 echo "" && echo "Now building the texutils.."
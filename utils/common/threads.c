@@ -626,6 +626,8 @@ void RunThreadsOn (threadfunc_t func)
 
 #else	/* no threads  */
 
+static const int	numthreads = 1;
+
 void InitThreads (int wantthreads, size_t needstack)
 {
 	printf ("Single-threaded at compile time\n");
@@ -652,3 +654,84 @@ void RunThreadsOn (threadfunc_t func)
 }
 
 #endif	/* no threads  */
+
+
+/* WORK STEALING:
+
+Work item i starts out in the share of thread i % numthreads, so that
+every thread begins with the lowest numbered items.  A thread takes
+items off the front of its share, and when that runs out it steals
+the back half of the biggest share left.  Stolen items keep coming from
+the stride they were dealt in, so a share is just a range of positions
+in one stride.
+*/
+
+static workfunc_t	work_func;
+static int		work_threads;
+static int		work_stride[MAX_THREADS];	/* whose deal this share is from */
+static int		work_next[MAX_THREADS];
+static int		work_end[MAX_THREADS];
+
+static int GetWork (int t)
+{
+	int		i, v, left, most;
+
+	ThreadLock ();
+	if (work_next[t] == work_end[t])
+	{
+		v = -1;
+		most = 0;
+		for (i = 0; i < work_threads; i++)
+		{
+			left = work_end[i] - work_next[i];
+			if (left > most)
+			{
+				most = left;
+				v = i;
+			}
+		}
+		if (v == -1)
+		{
+			ThreadUnlock ();
+			return -1;
+		}
+		work_stride[t] = work_stride[v];
+		work_end[t] = work_end[v];
+		work_next[t] = work_end[v] - (most + 1) / 2;
+		work_end[v] = work_next[t];
+	}
+	i = work_next[t]++ * work_threads + work_stride[t];
+	ThreadUnlock ();
+
+	return i;
+}
+
+static void WorkThread (void *threadnum)
+{
+	int		t, work;
+
+	t = (int)(intptr_t)threadnum;
+	while ((work = GetWork (t)) != -1)
+		work_func (work, t);
+}
+
+/*
+===============
+RunWorkOn
+===============
+*/
+void RunWorkOn (int workcnt, workfunc_t func)
+{
+	int		t;
+
+	work_func = func;
+	work_threads = (numthreads > 1) ? numthreads : 1;
+	for (t = 0; t < work_threads; t++)
+	{
+		work_stride[t] = t;
+		work_next[t] = 0;
+		work_end[t] = (workcnt - t + work_threads - 1) / work_threads;
+	}
+
+	RunThreadsOn (WorkThread);
+}
@@ -31,4 +31,11 @@ void	ThreadLock (void);
 void	ThreadUnlock (void);
 void	RunThreadsOn (threadfunc_t func);
 
+typedef void (*workfunc_t) (int work, int threadnum);
+
+void	RunWorkOn (int workcnt, workfunc_t func);
+/* calls func for each of the workcnt work items, about in order, on
+ * numthreads threads that steal work from each other when they run
+ * out.  threadnum is 0 .. numthreads-1. */
+
 #endif	/* H2UTILS_THREADS_H */
@@ -32,6 +32,7 @@
 #include "light.h"
 
 qboolean	extrasamples;
+qboolean	scalartrace;
 
 float		scaledist	= 1.0F;
 float		scalecos	= 0.5F;
@@ -133,6 +134,11 @@ int main (int argc, char **argv)
 			extrasamples = true;
 			printf ("extra sampling enabled\n");
 		}
+		else if (!strcmp(argv[i],"-scalar"))
+		{
+			scalartrace = true;
+			printf ("tracing every sample on its own\n");
+		}
 		else if (!strcmp(argv[i],"-dist"))
 		{
 			if (i >= argc - 1)
@@ -152,7 +158,7 @@ int main (int argc, char **argv)
 	}
 
 	if (i != argc - 1)
-		COM_Error ("usage: light [-threads num] [-extra] [-dist ?] [-range ?] bspfile");
+		COM_Error ("usage: light [-threads num] [-extra] [-scalar] [-dist ?] [-range ?] bspfile");
 
 	InitThreads (wantthreads, 0);
 
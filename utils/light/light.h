@@ -37,10 +37,14 @@ extern	vec3_t		bsp_origin;
 extern	float		minlights[MAX_MAP_FACES];
 
 extern	qboolean	extrasamples;
+extern	qboolean	scalartrace;
+
+#define	PACKET_RAYS	4	// rays traced together by TestLinePacket
 
 byte	*GetFileSpace (int size);
 
 qboolean TestLine (const vec3_t start, const vec3_t stop);
+int	TestLinePacket (const vec3_t start, vec3_t *stops, int numrays);
 void	LightFace (int surfnum);
 void	LightFace2 (int surfnum);
 void	MakeTnodes (dmodel_t *bm);
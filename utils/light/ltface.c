@@ -30,21 +30,13 @@
 
 /*
 ============
-CastRay
-
-Returns the distance between the points, or -1 if blocked
-=============
+RayLength
+============
 */
-static double CastRay (vec3_t p1, vec3_t p2)
+static double RayLength (vec3_t p1, vec3_t p2)
 {
 	int		i;
 	double	t;
-	qboolean	trace;
-
-	trace = TestLine (p1, p2);
-
-	if (!trace)
-		return -1;		// ray was blocked
 
 	t = 0;
 	for (i = 0 ; i < 3 ; i++)
@@ -56,6 +48,21 @@ static double CastRay (vec3_t p1, vec3_t p2)
 	return sqrt(t);
 }
 
+/*
+============
+CastRay
+
+Returns the distance between the points, or -1 if blocked
+=============
+*/
+static double CastRay (vec3_t p1, vec3_t p2)
+{
+	if (!TestLine (p1, p2))
+		return -1;		// ray was blocked
+
+	return RayLength (p1, p2);
+}
+
 
 /*
 ===============================================================================
@@ -90,6 +97,7 @@ typedef struct
 
 	int		numsurfpt;
 	vec3_t	surfpt[SINGLEMAP];
+	vec3_t	surfmins, surfmaxs;	// bounds of the sample points
 
 	vec3_t	texorg;
 	vec3_t	worldtotex[2];	// s = (world - texorg) . worldtotex[0]
@@ -386,6 +394,19 @@ static void CalcPoints (lightinfo_t *l)
 			//	c_bad++;
 		}
 	}
+
+	VectorCopy (l->surfpt[0], l->surfmins);
+	VectorCopy (l->surfpt[0], l->surfmaxs);
+	for (i = 1, surf = l->surfpt[1] ; i < l->numsurfpt ; i++, surf+=3)
+	{
+		for (j = 0 ; j < 3 ; j++)
+		{
+			if (surf[j] < l->surfmins[j])
+				l->surfmins[j] = surf[j];
+			if (surf[j] > l->surfmaxs[j])
+				l->surfmaxs[j] = surf[j];
+		}
+	}
 }
 
 
@@ -398,6 +419,91 @@ FACE LIGHTING
 */
 
 //int		c_culldistplane, c_proper;
+/*
+================
+SampleLight
+
+Returns how much light reaches a sample dist away, ignoring anything
+in the way, or something negative if it gets none.
+================
+*/
+static double SampleLight (entity_t *light, lightinfo_t *l, double *surf, double dist,
+			   vec3_t spotvec, double falloff)
+{
+	vec3_t	incoming;
+	double	angle;
+	double	add;
+
+	VectorSubtract (light->origin, surf, incoming);
+	VectorNormalize (incoming);
+	angle = DotProduct (incoming, l->facenormal);
+	if (light->targetent)
+	{	// spotlight cutoff
+		if (DotProduct (spotvec, incoming) > falloff)
+			return -1;
+	}
+
+	angle = (1.0-scalecos) + scalecos*angle;
+	add = light->light - dist;
+	add *= angle;
+	return add;
+}
+
+/*
+================
+BoundsDistance
+
+Distance from a point to the nearest point of a box
+================
+*/
+static double BoundsDistance (vec3_t p, vec3_t mins, vec3_t maxs)
+{
+	int		i;
+	double	d, t;
+
+	t = 0;
+	for (i = 0 ; i < 3 ; i++)
+	{
+		if (p[i] < mins[i])
+			d = mins[i] - p[i];
+		else if (p[i] > maxs[i])
+			d = p[i] - maxs[i];
+		else
+			continue;
+		t += d*d;
+	}
+
+	return sqrt(t);
+}
+
+/*
+================
+TracePacket
+
+Traces the queued samples and adds the light of the ones that can
+see it.  Returns true if any of them got bright enough to count.
+================
+*/
+static qboolean TracePacket (entity_t *light, double *lightsamp, int numrays,
+			     vec3_t *stops, int *samp, double *add)
+{
+	int		i, clear;
+	qboolean	hit;
+
+	hit = false;
+	clear = TestLinePacket (light->origin, stops, numrays);
+	for (i = 0 ; i < numrays ; i++)
+	{
+		if (!(clear & (1 << i)))
+			continue;	// light doesn't reach
+		lightsamp[samp[i]] += add[i];
+		if (lightsamp[samp[i]] > 1)	// ignore real tiny lights
+			hit = true;
+	}
+
+	return hit;
+}
+
 /*
 ================
 SingleLightFace
@@ -406,8 +512,6 @@ SingleLightFace
 static void SingleLightFace (entity_t *light, lightinfo_t *l)
 {
 	double	dist;
-	vec3_t	incoming;
-	double	angle;
 	double	add;
 	double	*surf;
 	qboolean	hit;
@@ -418,6 +522,10 @@ static void SingleLightFace (entity_t *light, lightinfo_t *l)
 	vec3_t	spotvec;
 	double	falloff;
 	double	*lightsamp;
+	int		numrays;
+	int		raysamp[PACKET_RAYS];
+	double	rayadd[PACKET_RAYS];
+	vec3_t	raystop[PACKET_RAYS];
 
 	VectorSubtract (light->origin, bsp_origin, rel);
 	dist = scaledist * (DotProduct (rel, l->facenormal) - l->facedist);
@@ -473,29 +581,52 @@ static void SingleLightFace (entity_t *light, lightinfo_t *l)
 	//c_proper++;
 
 	surf = l->surfpt[0];
-	for (c = 0 ; c < l->numsurfpt ; c++, surf+=3)
+	if (scalartrace || scaledist <= 0)
 	{
-		dist = CastRay(light->origin, surf)*scaledist;
-		if (dist < 0)
-			continue;	// light doesn't reach
+		for (c = 0 ; c < l->numsurfpt ; c++, surf+=3)
+		{
+			dist = CastRay(light->origin, surf)*scaledist;
+			if (dist < 0)
+				continue;	// light doesn't reach
 
-		VectorSubtract (light->origin, surf, incoming);
-		VectorNormalize (incoming);
-		angle = DotProduct (incoming, l->facenormal);
-		if (light->targetent)
-		{	// spotlight cutoff
-			if (DotProduct (spotvec, incoming) > falloff)
+			add = SampleLight (light, l, surf, dist, spotvec, falloff);
+			if (add < 0)
 				continue;
+			lightsamp[c] += add;
+			if (lightsamp[c] > 1)		// ignore real tiny lights
+				hit = true;
 		}
+	}
+	else
+	{
+	// the samples are a unit in front of the face, so a light further
+	// out than that can't give a negative angle scale and can't reach
+	// a sample that is further away than its level
+		if (DotProduct (rel, l->facenormal) - l->facedist > 2 &&
+		    scaledist * BoundsDistance (light->origin, l->surfmins, l->surfmaxs) > light->light + 1)
+			return;
 
-		angle = (1.0-scalecos) + scalecos*angle;
-		add = light->light - dist;
-		add *= angle;
-		if (add < 0)
-			continue;
-		lightsamp[c] += add;
-		if (lightsamp[c] > 1)		// ignore real tiny lights
-			hit = true;
+	// only trace the samples the light would reach if nothing was in
+	// the way, a packet at a time
+		numrays = 0;
+		for (c = 0 ; c < l->numsurfpt ; c++, surf+=3)
+		{
+			dist = RayLength(light->origin, surf)*scaledist;
+			add = SampleLight (light, l, surf, dist, spotvec, falloff);
+			if (add < 0)
+				continue;
+
+			raysamp[numrays] = c;
+			rayadd[numrays] = add;
+			VectorCopy (surf, raystop[numrays]);
+			if (++numrays == PACKET_RAYS)
+			{
+				hit |= TracePacket (light, lightsamp, numrays, raystop, raysamp, rayadd);
+				numrays = 0;
+			}
+		}
+		if (numrays)
+			hit |= TracePacket (light, lightsamp, numrays, raystop, raysamp, rayadd);
 	}
 
 	if (mapnum == l->numlightstyles && hit)
@@ -247,3 +247,273 @@ qboolean TestLine (const vec3_t start, const vec3_t stop)
 		node = tnode->children[side];
 	}
 }
+
+
+/*
+==============================================================================
+
+PACKET TRACING
+
+Traces up to PACKET_RAYS lines from one start point at once.  Every ray
+keeps its own segment and is clipped exactly the way TestLine clips it,
+so each ray sees the same leafs and gets the same answer.  The rays
+share the walk down the tree and only part ways where they cross a
+plane differently; the far side is then pushed with the rays that need
+it.
+
+==============================================================================
+*/
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define	MAX_PACKET_STACK	256
+
+typedef struct
+{
+	float	front[3][PACKET_RAYS];
+	float	back[3][PACKET_RAYS];
+} packetseg_t;
+
+typedef struct
+{
+	packetseg_t	seg;
+	int		node;
+	int		mask;
+} packetstack_t;
+
+#if defined(__SSE2__)
+
+/* front/back distances are computed the way TestLine does, including
+ * the double precision dot product for non axial planes.  the float
+ * compares against ON_EPSILON give the same result as the double ones
+ * because 0.1f is the nearest float to 0.1 on the far side of it.
+ */
+static __m128 PlaneDist4 (const tnode_t *tnode, float p[3][PACKET_RAYS])
+{
+	__m128		v;
+	__m128d		lo, hi, n;
+
+	if (tnode->type < 3)
+		return _mm_sub_ps (_mm_loadu_ps(p[tnode->type]), _mm_set1_ps(tnode->dist));
+
+	v = _mm_loadu_ps (p[0]);
+	n = _mm_set1_pd (tnode->normal[0]);
+	lo = _mm_mul_pd (_mm_cvtps_pd(v), n);
+	hi = _mm_mul_pd (_mm_cvtps_pd(_mm_movehl_ps(v, v)), n);
+	v = _mm_loadu_ps (p[1]);
+	n = _mm_set1_pd (tnode->normal[1]);
+	lo = _mm_add_pd (lo, _mm_mul_pd(_mm_cvtps_pd(v), n));
+	hi = _mm_add_pd (hi, _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(v, v)), n));
+	v = _mm_loadu_ps (p[2]);
+	n = _mm_set1_pd (tnode->normal[2]);
+	lo = _mm_add_pd (lo, _mm_mul_pd(_mm_cvtps_pd(v), n));
+	hi = _mm_add_pd (hi, _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(v, v)), n));
+	n = _mm_set1_pd ((double)tnode->dist);
+	lo = _mm_sub_pd (lo, n);
+	hi = _mm_sub_pd (hi, n);
+
+	return _mm_movelh_ps (_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi));
+}
+
+/*
+==============
+SplitPacket
+
+Classifies the rays in mask against the node's plane and returns the
+ones that reach the front and back child in mask0 and mask1.  Returns
+true if any ray crosses the plane, in which case the front child's part
+of the segments is in seg0 and the back child's in seg1.
+==============
+*/
+static qboolean SplitPacket (const tnode_t *tnode, const packetseg_t *in, int mask,
+			 packetseg_t *seg0, int *mask0, packetseg_t *seg1, int *mask1)
+{
+	__m128	front, back, frac, f, b, mid, m0, m1;
+	__m128	eps = _mm_set1_ps ((float)ON_EPSILON);
+	__m128	negeps = _mm_set1_ps (-(float)ON_EPSILON);
+	int		onlyfront, onlyback, side0, side1, k;
+
+	front = PlaneDist4 (tnode, (float (*)[PACKET_RAYS]) in->front);
+	back = PlaneDist4 (tnode, (float (*)[PACKET_RAYS]) in->back);
+
+	onlyfront = _mm_movemask_ps (_mm_and_ps(_mm_cmpgt_ps(front, negeps), _mm_cmpgt_ps(back, negeps)));
+	onlyback = _mm_movemask_ps (_mm_and_ps(_mm_cmplt_ps(front, eps), _mm_cmplt_ps(back, eps)))
+			& ~onlyfront;
+
+	*mask0 = mask & ~onlyback;
+	*mask1 = mask & ~onlyfront;
+	if (!(*mask0 & *mask1))
+		return false;	// nobody crosses the plane
+
+	side1 = _mm_movemask_ps (_mm_cmplt_ps(front, _mm_setzero_ps())) & ~(onlyfront | onlyback);
+	side0 = ~(onlyfront | onlyback | side1) & 15;
+	m0 = _mm_castsi128_ps (_mm_set_epi32(-((side0 >> 3) & 1), -((side0 >> 2) & 1),
+					     -((side0 >> 1) & 1), -(side0 & 1)));
+	m1 = _mm_castsi128_ps (_mm_set_epi32(-((side1 >> 3) & 1), -((side1 >> 2) & 1),
+					     -((side1 >> 1) & 1), -(side1 & 1)));
+
+	frac = _mm_div_ps (front, _mm_sub_ps(front, back));
+	for (k = 0 ; k < 3 ; k++)
+	{
+		f = _mm_loadu_ps (in->front[k]);
+		b = _mm_loadu_ps (in->back[k]);
+		mid = _mm_add_ps (f, _mm_mul_ps(frac, _mm_sub_ps(b, f)));
+	// the near side runs from front to mid, the far side from mid to back
+		_mm_storeu_ps (seg0->front[k], _mm_or_ps(_mm_and_ps(m1, mid), _mm_andnot_ps(m1, f)));
+		_mm_storeu_ps (seg0->back[k], _mm_or_ps(_mm_and_ps(m0, mid), _mm_andnot_ps(m0, b)));
+		_mm_storeu_ps (seg1->front[k], _mm_or_ps(_mm_and_ps(m0, mid), _mm_andnot_ps(m0, f)));
+		_mm_storeu_ps (seg1->back[k], _mm_or_ps(_mm_and_ps(m1, mid), _mm_andnot_ps(m1, b)));
+	}
+
+	return true;
+}
+
+#else	/* !__SSE2__ */
+
+static qboolean SplitPacket (const tnode_t *tnode, const packetseg_t *in, int mask,
+			 packetseg_t *seg0, int *mask0, packetseg_t *seg1, int *mask1)
+{
+	float	front[PACKET_RAYS], back[PACKET_RAYS], mid;
+	int		i, k, side;
+
+	*mask0 = *mask1 = 0;
+	for (i = 0 ; i < PACKET_RAYS ; i++)
+	{
+		switch (tnode->type)
+		{
+		case PLANE_X:
+		case PLANE_Y:
+		case PLANE_Z:
+			front[i] = in->front[tnode->type][i] - tnode->dist;
+			back[i] = in->back[tnode->type][i] - tnode->dist;
+			break;
+		default:
+			front[i] = (float)((in->front[0][i]*tnode->normal[0] + in->front[1][i]*tnode->normal[1] + in->front[2][i]*tnode->normal[2]) - tnode->dist);
+			back[i] = (float)((in->back[0][i]*tnode->normal[0] + in->back[1][i]*tnode->normal[1] + in->back[2][i]*tnode->normal[2]) - tnode->dist);
+			break;
+		}
+		if (front[i] > -ON_EPSILON && back[i] > -ON_EPSILON)
+			*mask0 |= 1 << i;
+		else if (front[i] < ON_EPSILON && back[i] < ON_EPSILON)
+			*mask1 |= 1 << i;
+		else
+		{
+			*mask0 |= 1 << i;
+			*mask1 |= 1 << i;
+		}
+	}
+
+	*mask0 &= mask;
+	*mask1 &= mask;
+	if (!(*mask0 & *mask1))
+		return false;
+
+	*seg0 = *seg1 = *in;
+	for (i = 0 ; i < PACKET_RAYS ; i++)
+	{
+		if (!(*mask0 & *mask1 & (1 << i)))
+			continue;
+		side = (front[i] < 0.0f) ? 1 : 0;
+		front[i] /= (front[i] - back[i]);
+		for (k = 0 ; k < 3 ; k++)
+		{
+			mid = in->front[k][i] + front[i]*(in->back[k][i] - in->front[k][i]);
+			if (side)
+				seg0->front[k][i] = seg1->back[k][i] = mid;
+			else
+				seg0->back[k][i] = seg1->front[k][i] = mid;
+		}
+	}
+
+	return true;
+}
+
+#endif	/* !__SSE2__ */
+
+/*
+==============
+TestLinePacket
+
+Returns a bit mask of the rays from start to stops[0..numrays-1] that
+were not blocked.
+==============
+*/
+int TestLinePacket (const vec3_t start, vec3_t *stops, int numrays)
+{
+	int			node, mask, mask0, mask1, blocked, all;
+	int			i, k;
+	qboolean	split;
+	packetseg_t	seg, seg0;
+	packetstack_t	*pstack_p;
+	packetstack_t	packetstack[MAX_PACKET_STACK];
+
+	if (numrays < 1 || numrays > PACKET_RAYS)
+		COM_Error ("%s: bad numrays %d", __thisfunc__, numrays);
+
+	for (k = 0 ; k < 3 ; k++)
+	{
+		for (i = 0 ; i < PACKET_RAYS ; i++)
+		{
+			seg.front[k][i] = (float)start[k];
+			seg.back[k][i] = (float)stops[(i < numrays) ? i : 0][k];
+		}
+	}
+
+	all = (1 << numrays) - 1;
+	mask = all;
+	blocked = 0;
+	pstack_p = packetstack;
+	node = 0;
+
+	while (1)
+	{
+		if (node < 0)
+		{
+			if (node == CONTENTS_SOLID)
+			{
+				blocked |= mask;
+				if (blocked == all)
+					return 0;
+			}
+
+		// pop up the stack for a back side that someone still needs
+			do
+			{
+				if (pstack_p == packetstack)
+					return all & ~blocked;
+				pstack_p--;
+				mask = pstack_p->mask & ~blocked;
+			} while (!mask);
+
+			seg = pstack_p->seg;
+			node = pstack_p->node;
+			continue;
+		}
+
+		if (pstack_p == &packetstack[MAX_PACKET_STACK])
+			COM_Error ("%s: stack overflow", __thisfunc__);
+
+		split = SplitPacket (&tnodes[node], &seg, mask, &seg0, &mask0, &pstack_p->seg, &mask1);
+
+		if (!mask0)
+		{	// all on the back side
+			node = tnodes[node].children[1];
+			continue;
+		}
+		if (mask1)
+		{	// come back for the back side
+			if (!split)
+				pstack_p->seg = seg;
+			pstack_p->node = tnodes[node].children[1];
+			pstack_p->mask = mask1;
+			pstack_p++;
+		}
+
+		if (split)
+			seg = seg0;
+		mask = mask0;
+		node = tnodes[node].children[0];
+	}
+}
@@ -0,0 +1,482 @@
+/* qc2c.c -- translates compiled HexenC (progs.dat) into C
+ *
+ * The output is meant to be linked into the engine (make PROGS_NATIVE=
+ * file.c) where it replaces the QuakeC interpreter for the progs it was
+ * generated from.  Each statement becomes one PRA_ macro invocation from
+ * engine/h2shared/pr_native.h, branch targets become labels.  Functions
+ * which cannot be translated are left to the interpreter.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "q_stdinc.h"
+#include "compiler.h"
+#include "arch_def.h"
+#include "cmdlib.h"
+#include "util_io.h"
+#include "q_ctype.h"
+#include "q_endian.h"
+#include "byteordr.h"
+#include "crc.h"
+#include "pr_comp.h"
+
+/* must match PR_NATIVE_VERSION in engine/h2shared/pr_native.h */
+#define PR_NATIVE_VERSION	1
+
+static dprograms_t	*progs;
+static dfunction_t	*pr_functions;
+static dstatement_t	*pr_statements;
+static char		*pr_strings;
+static int		progs_length;
+static unsigned short	progs_crc;
+
+static byte		*is_target;	/* statement is a branch target */
+static int		*func_end;	/* one past the last statement */
+
+static FILE		*out;
+
+/* macro names for the plain three operand opcodes */
+static const char *pra_names[OP_CASERANGE + 1] =
+{
+	NULL,		/* OP_DONE */
+	"MUL_F", "MUL_V", "MUL_FV", "MUL_VF",
+	"DIV_F",
+	"ADD_F", "ADD_V",
+	"SUB_F", "SUB_V",
+	"EQ_F", "EQ_V", "EQ_S", "EQ_E", "EQ_FNC",
+	"NE_F", "NE_V", "NE_S", "NE_E", "NE_FNC",
+	"LE", "GE", "LT", "GT",
+	"LOAD", "LOAD_V", "LOAD", "LOAD", "LOAD", "LOAD",
+	"ADDRESS",
+	"STORE", "STORE_V", "STORE", "STORE", "STORE", "STORE",
+	"STOREP", "STOREP_V", "STOREP", "STOREP", "STOREP", "STOREP",
+	NULL,		/* OP_RETURN */
+	"NOT_F", "NOT_V", "NOT_S", "NOT_ENT", "NOT_FNC",
+	NULL, NULL,	/* OP_IF, OP_IFNOT */
+	NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,	/* OP_CALLx */
+	"STATE",
+	NULL,		/* OP_GOTO */
+	"AND", "OR",
+	"BITAND", "BITOR",
+	"MULSTORE_F", "MULSTORE_V", "MULSTOREP_F", "MULSTOREP_V",
+	"DIVSTORE_F", "DIVSTOREP_F",
+	"ADDSTORE_F", "ADDSTORE_V", "ADDSTOREP_F", "ADDSTOREP_V",
+	"SUBSTORE_F", "SUBSTORE_V", "SUBSTOREP_F", "SUBSTOREP_V",
+	"FETCH_GBL", "FETCH_GBL_V", "FETCH_GBL", "FETCH_GBL", "FETCH_GBL",
+	"CSTATE", "CWSTATE",
+	"THINKTIME",
+	"BITSET", "BITSETP", "BITCLR", "BITCLRP",
+	"RAND0", "RAND1", "RAND2", "RANDV0", "RANDV1", "RANDV2",
+	NULL, NULL, NULL, NULL, NULL,	/* OP_SWITCH_x */
+	NULL, NULL	/* OP_CASE, OP_CASERANGE */
+};
+
+static const char *switch_names[] =
+{
+	"SWITCH_F", "SWITCH_V", "SWITCH_S", "SWITCH_E", "SWITCH_FNC"
+};
+
+
+static dstatement_t *ConvertV6Stmts (dstatement_v6_t *stmts, int numstatements)
+{
+	dstatement_t	*st;
+	int		i;
+
+	st = (dstatement_t *) SafeMalloc (numstatements * sizeof(dstatement_t));
+	for (i = 0; i < numstatements; i++)
+	{
+	/* zero-extended, just like PR_ConvertV6Stmts() in the engine */
+		st[i].op = LittleShort(stmts[i].op);
+		st[i].a = (unsigned short) LittleShort(stmts[i].a);
+		st[i].b = (unsigned short) LittleShort(stmts[i].b);
+		st[i].c = (unsigned short) LittleShort(stmts[i].c);
+	}
+	return st;
+}
+
+static void ReadProgs (const char *srcfile)
+{
+	void		*p;
+	int		i;
+
+	progs_length = LoadFile (srcfile, &p);
+	progs = (dprograms_t *) p;
+	if (progs_length < (int) sizeof(dprograms_t))
+		COM_Error ("%s is not a progs file", srcfile);
+
+	/* same as pr_crc in the engine: the whole file, as is */
+	progs_crc = CRC_Block ((byte *)progs, progs_length);
+
+	for (i = 0; i < (int) sizeof(*progs) / 4; i++)
+		((int *)progs)[i] = LittleLong ( ((int *)progs)[i] );
+
+	if (progs->version != PROG_VERSION_V6 && progs->version != PROG_VERSION_V7)
+	{
+		COM_Error("%s is of unsupported version (%d, should be %d or %d)",
+			  srcfile, progs->version, PROG_VERSION_V6, PROG_VERSION_V7);
+	}
+
+	pr_functions = (dfunction_t *)((byte *)progs + progs->ofs_functions);
+	pr_strings = (char *)progs + progs->ofs_strings;
+
+	for (i = 0; i < progs->numfunctions; i++)
+	{
+		pr_functions[i].first_statement = LittleLong (pr_functions[i].first_statement);
+		pr_functions[i].s_name = LittleLong (pr_functions[i].s_name);
+	}
+
+	if (progs->version == PROG_VERSION_V6)
+	{
+		pr_statements = ConvertV6Stmts((dstatement_v6_t *)((byte *)progs + progs->ofs_statements), progs->numstatements);
+	}
+	else
+	{
+		pr_statements = (dstatement_t *)((byte *)progs + progs->ofs_statements);
+		for (i = 0; i < progs->numstatements; i++)
+		{
+			pr_statements[i].op = LittleShort(pr_statements[i].op);
+			pr_statements[i].a = LittleLong(pr_statements[i].a);
+			pr_statements[i].b = LittleLong(pr_statements[i].b);
+			pr_statements[i].c = LittleLong(pr_statements[i].c);
+		}
+	}
+}
+
+static int JumpTarget (int s, int ofs)
+{
+	if (progs->version == PROG_VERSION_V6)
+		ofs = (signed short)ofs;
+	return s + ofs;
+}
+
+/* returns the branch target of statement s, or -1 */
+static int BranchTarget (int s)
+{
+	dstatement_t	*st = &pr_statements[s];
+
+	switch (st->op)
+	{
+	case OP_IF:
+	case OP_IFNOT:
+	case OP_SWITCH_F:
+	case OP_CASE:
+		return JumpTarget(s, st->b);
+	case OP_GOTO:
+		return JumpTarget(s, st->a);
+	case OP_CASERANGE:
+		return JumpTarget(s, st->c);
+	}
+	return -1;
+}
+
+static int CompareInts (const void *a, const void *b)
+{
+	return *(const int *)a - *(const int *)b;
+}
+
+/* the statements of a function run up to the next function's first
+ * statement, which is how hcc lays them out.  */
+static void FindFunctionEnds (void)
+{
+	int	*starts;
+	int	i, n, lo, hi, mid;
+
+	starts = (int *) SafeMalloc ((progs->numfunctions + 1) * sizeof(int));
+	func_end = (int *) SafeMalloc (progs->numfunctions * sizeof(int));
+
+	for (i = n = 0; i < progs->numfunctions; i++)
+	{
+		if (pr_functions[i].first_statement > 0)
+			starts[n++] = pr_functions[i].first_statement;
+	}
+	starts[n++] = progs->numstatements;
+	qsort (starts, n, sizeof(int), CompareInts);
+
+	for (i = 0; i < progs->numfunctions; i++)
+	{
+		int	first = pr_functions[i].first_statement;
+		if (first <= 0)
+			continue;
+		lo = 0;
+		hi = n - 1;
+		while (lo < hi)
+		{
+			mid = (lo + hi) / 2;
+			if (starts[mid] > first)
+				hi = mid;
+			else
+				lo = mid + 1;
+		}
+		func_end[i] = starts[lo];
+	}
+
+	free (starts);
+}
+
+/* checks that a function is self-contained: every branch stays within
+ * the function and the last statement does not fall through.  */
+static qboolean CanTranslate (int fnum)
+{
+	int	s, t, first, end;
+	unsigned short	op;
+
+	first = pr_functions[fnum].first_statement;
+	end = func_end[fnum];
+	if (first >= progs->numstatements || end <= first)
+		return false;
+
+	for (s = first; s < end; s++)
+	{
+		if (pr_statements[s].op > OP_CASERANGE)
+			return false;
+		t = BranchTarget(s);
+		if (t != -1 && (t < first || t >= end))
+			return false;
+	}
+
+	op = pr_statements[end - 1].op;
+	if (op != OP_DONE && op != OP_RETURN && op != OP_GOTO)
+		return false;
+
+	return true;
+}
+
+static const char *FunctionName (int fnum)
+{
+	static char	name[64];
+	const char	*s;
+	int		i;
+
+	s = "";
+	if (pr_functions[fnum].s_name > 0 && pr_functions[fnum].s_name < progs->numstrings)
+		s = pr_strings + pr_functions[fnum].s_name;
+	/* the name goes into a comment */
+	for (i = 0; *s && i < (int) sizeof(name) - 1; s++)
+	{
+		if (q_isalnum(*s) || *s == '_')
+			name[i++] = *s;
+	}
+	name[i] = 0;
+	return name;
+}
+
+/* backward branches count towards the runaway loop limit */
+static void EmitBranch (int s, int t)
+{
+	if (t <= s)
+		fprintf (out, "{ PRA_LOOP(%d); goto s_%d; }\n", s, t);
+	else
+		fprintf (out, "goto s_%d;\n", t);
+}
+
+static void EmitFunction (int p, int fnum)
+{
+	dstatement_t	*st;
+	int		s, first, end;
+	qboolean	has_switch;
+
+	first = pr_functions[fnum].first_statement;
+	end = func_end[fnum];
+
+	has_switch = false;
+	for (s = first; s < end; s++)
+	{
+		st = &pr_statements[s];
+		if (st->op == OP_SWITCH_F || st->op == OP_CASE || st->op == OP_CASERANGE)
+			has_switch = true;
+		if (BranchTarget(s) != -1)
+			is_target[BranchTarget(s)] = 1;
+	}
+
+	fprintf (out, "/* %s */\n", FunctionName(fnum));
+	fprintf (out, "static void qc%d_%d (void)\n{\n", p, fnum);
+	fprintf (out, "\tfloat *const glob = pr_globals;\n");
+	if (has_switch)
+		fprintf (out, "\tint switch_type = -1;\n\tfloat switch_float = 0;\n");
+	fprintf (out, "\n");
+
+	for (s = first; s < end; s++)
+	{
+		st = &pr_statements[s];
+		if (is_target[s])
+			fprintf (out, "s_%d:\n", s);
+		fprintf (out, "\t");
+
+		switch (st->op)
+		{
+		case OP_DONE:
+		case OP_RETURN:
+			fprintf (out, "PRA_RETURN(%d, %d);\n", s, st->a);
+			break;
+		case OP_IF:
+			fprintf (out, "if (PRA_G(%d)->_int) ", st->a);
+			EmitBranch (s, BranchTarget(s));
+			break;
+		case OP_IFNOT:
+			fprintf (out, "if (!PRA_G(%d)->_int) ", st->a);
+			EmitBranch (s, BranchTarget(s));
+			break;
+		case OP_GOTO:
+			EmitBranch (s, BranchTarget(s));
+			break;
+		case OP_CALL0:
+		case OP_CALL1:
+		case OP_CALL2:
+		case OP_CALL3:
+		case OP_CALL4:
+		case OP_CALL5:
+		case OP_CALL6:
+		case OP_CALL7:
+		case OP_CALL8:
+			fprintf (out, "PRA_CALL(%d, %d, %d, %d, %d);\n",
+					s, st->op - OP_CALL0, st->a, st->b, st->c);
+			break;
+		case OP_SWITCH_F:
+			fprintf (out, "switch_type = 0; switch_float = PRA_G(%d)->_float; ", st->a);
+			EmitBranch (s, BranchTarget(s));
+			break;
+		case OP_SWITCH_V:
+		case OP_SWITCH_S:
+		case OP_SWITCH_E:
+		case OP_SWITCH_FNC:
+			fprintf (out, "PR_NativeError(%d, \"%s not done yet!\");\n",
+					s, switch_names[st->op - OP_SWITCH_F]);
+			break;
+		case OP_CASE:
+			fprintf (out, "if (switch_type != 0) PR_NativeError(%d, \"fucked case!\");\n", s);
+			fprintf (out, "\tif (switch_float == PRA_G(%d)->_float) ", st->a);
+			EmitBranch (s, BranchTarget(s));
+			break;
+		case OP_CASERANGE:
+			fprintf (out, "if (switch_type != 0) PR_NativeError(%d, \"caserange fucked!\");\n", s);
+			fprintf (out, "\tif (switch_float >= PRA_G(%d)->_float && switch_float <= PRA_G(%d)->_float) ",
+					st->a, st->b);
+			EmitBranch (s, BranchTarget(s));
+			break;
+		default:
+			fprintf (out, "PRA_%s(%d, %d, %d, %d);\n",
+					pra_names[st->op], s, st->a, st->b, st->c);
+			break;
+		}
+	}
+
+	fprintf (out, "}\n\n");
+
+	for (s = first; s < end; s++)
+		is_target[s] = 0;
+}
+
+static void TranslateProgs (int p, const char *srcfile)
+{
+	qboolean	*translate;
+	int		i, count, total;
+
+	ReadProgs (srcfile);
+	FindFunctionEnds ();
+
+	translate = (qboolean *) SafeMalloc (progs->numfunctions * sizeof(qboolean));
+	is_target = (byte *) SafeMalloc (progs->numstatements + 1);
+
+	fprintf (out, "/* %s: %d bytes, crc %u */\n\n", srcfile, progs_length, progs_crc);
+
+	for (i = count = total = 0; i < progs->numfunctions; i++)
+	{
+		if (pr_functions[i].first_statement <= 0)
+			continue;
+		total++;
+		if (!CanTranslate(i))
+		{
+			printf ("%s: function %d (%s) left to the interpreter\n",
+					srcfile, i, FunctionName(i));
+			continue;
+		}
+		translate[i] = true;
+		count++;
+		EmitFunction (p, i);
+	}
+
+	fprintf (out, "static const pr_nativefunc_t progs%d_functions[%d] =\n{\n", p, progs->numfunctions);
+	for (i = 0; i < progs->numfunctions; i++)
+	{
+		if (translate[i])
+			fprintf (out, "\tqc%d_%d,\n", p, i);
+		else	fprintf (out, "\tNULL,\n");
+	}
+	fprintf (out, "};\n\n");
+
+	printf ("%s: %d statements, %d of %d functions translated, crc %u\n",
+			srcfile, progs->numstatements, count, total, progs_crc);
+
+	free (translate);
+	free (is_target);
+	free (func_end);
+	if (progs->version == PROG_VERSION_V6)
+		free (pr_statements);
+}
+
+int main (int argc, char **argv)
+{
+	int		p, numprogs;
+	const char	*outfile;
+	int		*crcs, *sizes, *numstatements, *numfunctions;
+
+	if (argc < 3)
+	{
+		printf ("usage: qc2c output.c progs.dat [progs2.dat ...]\n");
+		exit (1);
+	}
+
+	ValidateByteorder ();
+
+	outfile = argv[1];
+	numprogs = argc - 2;
+	crcs = (int *) SafeMalloc (numprogs * sizeof(int));
+	sizes = (int *) SafeMalloc (numprogs * sizeof(int));
+	numstatements = (int *) SafeMalloc (numprogs * sizeof(int));
+	numfunctions = (int *) SafeMalloc (numprogs * sizeof(int));
+
+	out = SafeOpenWrite (outfile);
+	fprintf (out, "/* generated by qc2c, do not edit */\n\n");
+	fprintf (out, "#include \"quakedef.h\"\n");
+	fprintf (out, "#include \"pr_native.h\"\n\n");
+	fprintf (out, "#if PR_NATIVE_VERSION != %d\n", PR_NATIVE_VERSION);
+	fprintf (out, "#error regenerate this file with qc2c\n");
+	fprintf (out, "#endif\n\n");
+
+	for (p = 0; p < numprogs; p++)
+	{
+		TranslateProgs (p, argv[p + 2]);
+		crcs[p] = progs_crc;
+		sizes[p] = progs_length;
+		numstatements[p] = progs->numstatements;
+		numfunctions[p] = progs->numfunctions;
+		free (progs);
+	}
+
+	fprintf (out, "const pr_nativeprogs_t pr_nativeprogs[] =\n{\n");
+	for (p = 0; p < numprogs; p++)
+	{
+		fprintf (out, "\t{ PR_NATIVE_VERSION, %d, %d, %d, %d, progs%d_functions },\n",
+				crcs[p], sizes[p], numstatements[p], numfunctions[p], p);
+	}
+	fprintf (out, "\t{ PR_NATIVE_VERSION, 0, 0, 0, 0, NULL }\n};\n\n");
+
+	fclose (out);
+
+	printf ("wrote %s\n", outfile);
+
+	return 0;
+}
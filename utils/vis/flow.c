@@ -307,9 +307,10 @@ RecursiveLeafFlow
 
 Flood fill through the leafs
 If src_portal is NULL, this is the originating leaf
+If exitnum isn't -1, only flows out through that portal of the leaf
 ==================
 */
-static void RecursiveLeafFlow (int leafnum, threaddata_t *thread, pstack_t *prevstack)
+static void RecursiveLeafFlow (int leafnum, threaddata_t *thread, pstack_t *prevstack, int exitnum)
 {
 	pstack_t	stack;
 	portal_t	*p;
@@ -326,11 +327,7 @@ static void RecursiveLeafFlow (int leafnum, threaddata_t *thread, pstack_t *prev
 	CheckStack (leaf, thread);
 
 // mark the leaf as visible
-	if (! (thread->leafvis[leafnum>>3] & (1<<(leafnum & 7)) ) )
-	{
-		thread->leafvis[leafnum>>3] |= 1<<(leafnum & 7);
-		thread->base->numcansee++;
-	}
+	thread->leafvis[leafnum>>3] |= 1<<(leafnum & 7);
 
 	prevstack->next = &stack;
 	stack.next = NULL;
@@ -343,6 +340,8 @@ static void RecursiveLeafFlow (int leafnum, threaddata_t *thread, pstack_t *prev
 // check all portals for flowing into other leafs
 	for (i = 0 ; i < leaf->numportals ; i++)
 	{
+		if (exitnum != -1 && i != exitnum)
+			continue;
 		p = leaf->portals[i];
 
 		if ( ! (prevstack->mightsee[p->leaf>>3] & (1<<(p->leaf & 7)) ) )
@@ -397,7 +396,7 @@ static void RecursiveLeafFlow (int leafnum, threaddata_t *thread, pstack_t *prev
 		{	// the second leaf can only be blocked if coplanar
 			stack.source = prevstack->source;
 			stack.pass = target;
-			RecursiveLeafFlow (p->leaf, thread, &stack);
+			RecursiveLeafFlow (p->leaf, thread, &stack, -1);
 			FreeWinding (target);
 			continue;
 		}
@@ -463,7 +462,7 @@ static void RecursiveLeafFlow (int leafnum, threaddata_t *thread, pstack_t *prev
 		c_portalpass++;
 
 	// flow through it for real
-		RecursiveLeafFlow (p->leaf, thread, &stack);
+		RecursiveLeafFlow (p->leaf, thread, &stack, -1);
 
 		FreeWinding (source);
 		FreeWinding (target);
@@ -477,20 +476,20 @@ static void RecursiveLeafFlow (int leafnum, threaddata_t *thread, pstack_t *prev
 ===============
 PortalFlow
 
+Flows p out through the exitnum'th portal of the leaf it looks into,
+marking what it sees in leafvis.  Every exit can be flowed on its own,
+the portal sees the union of all of them.
 ===============
 */
-void PortalFlow (portal_t *p)
+void PortalFlow (portal_t *p, int exitnum, byte *leafvis)
 {
 	threaddata_t	data;
 
 	if (p->status != stat_working)
 		COM_Error ("%s: reflowed", __thisfunc__);
-	p->status = stat_working;
-
-	p->visbits = (byte *) SafeMalloc (bitbytes);
 
 	memset (&data, 0, sizeof(data));
-	data.leafvis = p->visbits;
+	data.leafvis = leafvis;
 	data.base = p;
 
 	data.pstack_head.portal = p;
@@ -498,9 +497,7 @@ void PortalFlow (portal_t *p)
 	data.pstack_head.portalplane = p->plane;
 	data.pstack_head.mightsee = p->mightsee;
 
-	RecursiveLeafFlow (p->leaf, &data, &data.pstack_head);
-
-	p->status = stat_done;
+	RecursiveLeafFlow (p->leaf, &data, &data.pstack_head, exitnum);
 }
 
 
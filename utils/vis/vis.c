@@ -25,6 +25,7 @@
 #include "q_endian.h"
 #include "byteordr.h"
 #include "pathutil.h"
+#include "util_io.h"
 #include "mathlib.h"
 #include "bspfile.h"
 #include "threads.h"
@@ -38,9 +39,6 @@ int			c_portaltest, c_portalpass, c_portalcheck;
 portal_t		*portals;
 leaf_t			*leafs;
 
-int			leafon;		// the next leaf to be given
-					// to a thread to process
-
 static byte	*vismap, *vismap_p, *vismap_end;        // past visfile
 static int		originalvismapsize;
 
@@ -50,9 +48,13 @@ int			bitbytes;		// (portalleafs+63)>>3
 int			bitlongs;
 
 static qboolean		fastvis;
+static qboolean		resume;
 qboolean		verbose;
 int			testlevel = 2;
 
+static char		checkpointfile[1024];
+static unsigned int	portalsum;	// checksum of the portal file
+
 
 #if 0
 void NormalizePlane (plane_t *dp)
@@ -306,67 +308,237 @@ winding_t *ClipWinding (winding_t *in, plane_t *split, qboolean keepon)
 //=============================================================================
 
 /*
-=============
-GetNextPortal
+==============================================================================
+
+CHECKPOINTS
 
-Returns the next portal for a thread to work on
-Returns the portals from the least complex, so the later ones can reuse
-the earlier information.
-=============
+Every portal is appended to the checkpoint file when its flow is done,
+so that an interrupted vis can be restarted with -resume without
+flowing those portals again.  The file is removed once vis finishes.
+
+==============================================================================
 */
-static portal_t *GetNextPortal (void)
+
+#define	CHECKPOINT_ID	"VCK1"
+
+typedef struct
 {
-	int		j;
-	portal_t	*p, *tp;
-	int		minsee;
-	const int	num2 = numportals * 2;
+	char	id[4];
+	int	numportals;
+	int	portalleafs;
+	int	bitbytes;
+	int	testlevel;
+	int	gilmode;
+	unsigned int	portalsum;
+} ckheader_t;
+
+static FILE	*checkpoint;
+
+static void MakeCheckpointHeader (ckheader_t *h)
+{
+	memset (h, 0, sizeof(*h));
+	memcpy (h->id, CHECKPOINT_ID, 4);
+	h->numportals = numportals;
+	h->portalleafs = portalleafs;
+	h->bitbytes = bitbytes;
+	h->testlevel = testlevel;
+	h->gilmode = GilMode;
+	h->portalsum = portalsum;
+}
 
-	ThreadLock();
+static int CountBits (byte *bits)
+{
+	int		i, c;
 
-	minsee = 99999;
-	p = NULL;
+	c = 0;
+	for (i = 0 ; i < portalleafs ; i++)
+	{
+		if (bits[i>>3] & (1<<(i&7)))
+			c++;
+	}
+	return c;
+}
 
-	for (j = 0, tp = portals ; j < num2 ; j++, tp++)
+/*
+==============
+LoadCheckpoint
+
+Marks the portals saved in the checkpoint file done and returns how
+many there were
+==============
+*/
+static int LoadCheckpoint (void)
+{
+	ckheader_t	header, want;
+	FILE		*f;
+	portal_t	*p;
+	int		num, count;
+
+	f = fopen (checkpointfile, "rb");
+	if (!f)
 	{
-		if (tp->nummightsee < minsee && tp->status == stat_none)
-		{
-			minsee = tp->nummightsee;
-			p = tp;
-		}
+		printf ("no checkpoint %s, starting from scratch\n", checkpointfile);
+		return 0;
 	}
 
-	if (p)
-		p->status = stat_working;
+	MakeCheckpointHeader (&want);
+	if (fread (&header, sizeof(header), 1, f) != 1 || memcmp (&header, &want, sizeof(header)))
+	{
+		printf ("checkpoint %s doesn't match, starting from scratch\n", checkpointfile);
+		fclose (f);
+		return 0;
+	}
 
-	ThreadUnlock();
+	count = 0;
+	while (fread (&num, sizeof(num), 1, f) == 1)
+	{
+		if (num < 0 || num >= numportals*2)
+			COM_Error ("%s: bad portal %i in %s", __thisfunc__, num, checkpointfile);
+		p = &portals[num];
+		if (fread (p->visbits, bitbytes, 1, f) != 1)
+			break;	// cut off in the middle of a write
+		if (p->status != stat_done)
+			count++;
+		p->status = stat_done;
+		p->numcansee = CountBits (p->visbits);
+	}
+	fclose (f);
 
-	return p;
+	printf ("resuming with %i portals from %s\n", count, checkpointfile);
+	return count;
+}
+
+static void OpenCheckpoint (void)
+{
+	ckheader_t	header;
+	portal_t	*p;
+	int		i, num2;
+
+	checkpoint = fopen (checkpointfile, "wb");
+	if (!checkpoint)
+	{
+		printf ("WARNING: couldn't write checkpoint %s\n", checkpointfile);
+		return;
+	}
+
+// the portals we resumed from go back into the new file
+	MakeCheckpointHeader (&header);
+	fwrite (&header, sizeof(header), 1, checkpoint);
+	num2 = numportals * 2;
+	for (i = 0, p = portals ; i < num2 ; i++, p++)
+	{
+		if (p->status != stat_done)
+			continue;
+		fwrite (&i, sizeof(i), 1, checkpoint);
+		fwrite (p->visbits, bitbytes, 1, checkpoint);
+	}
+	fflush (checkpoint);
 }
 
 /*
 ==============
-LeafThread
+SaveCheckpoint
+
+Called with the thread lock held
 ==============
 */
-static	void	LeafThread (void *junk)
+static void SaveCheckpoint (portal_t *p)
+{
+	int		num = p - portals;
+
+	if (!checkpoint)
+		return;
+	fwrite (&num, sizeof(num), 1, checkpoint);
+	fwrite (p->visbits, bitbytes, 1, checkpoint);
+	fflush (checkpoint);
+}
+
+static void CloseCheckpoint (void)
 {
+	if (!checkpoint)
+		return;
+	fclose (checkpoint);
+	checkpoint = NULL;
+	Q_unlink (checkpointfile);
+}
+
+
+/*
+==============================================================================
+
+PORTAL FLOW
+
+The flow of every portal is split into one piece of work for each
+portal leaving the leaf it looks into, so that a few very complex
+portals can't leave all but one thread idle at the end.  The pieces
+are handed out starting with the least complex portals, so that the
+later ones can reuse the earlier information, and threads that run
+out of work steal it from the others.
+
+==============================================================================
+*/
+
+typedef struct
+{
+	portal_t	*portal;
+	int		exitnum;	// which portal of portal->leaf to flow out of
+} flowwork_t;
+
+static flowwork_t	*flowwork;
+static int		*flowsleft;	// pieces of work left for each portal
+static byte		*threadvis[MAX_THREADS];
+static int		portalsleft;
+
+static int PortalCompare (const void *a, const void *b)
+{
+	const portal_t	*p1 = *(const portal_t **)a;
+	const portal_t	*p2 = *(const portal_t **)b;
+
+	if (p1->nummightsee != p2->nummightsee)
+		return p1->nummightsee - p2->nummightsee;
+	return (int)(p1 - p2);
+}
+
+/*
+==============
+FlowWork
+==============
+*/
+static void FlowWork (int work, int threadnum)
+{
+	flowwork_t	*w;
 	portal_t	*p;
+	long		*vis, *out;
+	int		j;
 
-	printf ("Begining %s: %i\n", __thisfunc__, (int)(intptr_t)junk);
-	do
+	w = &flowwork[work];
+	p = w->portal;
+	vis = (long *)threadvis[threadnum];
+	out = (long *)p->visbits;
+
+// start from what the other pieces have found so far, it prunes the flow.
+// they are still or'ing their bits in, so copy under the lock
+	ThreadLock ();
+	memcpy (vis, out, bitbytes);
+	ThreadUnlock ();
+	PortalFlow (p, w->exitnum, (byte *)vis);
+
+	ThreadLock ();
+	for (j = 0 ; j < bitlongs ; j++)
+		out[j] |= vis[j];
+	if (--flowsleft[p - portals] == 0)
 	{
-		p = GetNextPortal ();
-		if (!p)
-			break;
-
-		PortalFlow (p);
-		if (verbose) {
-			printf ("portal:%4i  mightsee:%4i  cansee:%4i\n",
-				(int)(p - portals), p->nummightsee, p->numcansee);
+		p->numcansee = CountBits (p->visbits);
+		p->status = stat_done;
+		SaveCheckpoint (p);
+		portalsleft--;
+		if (verbose)
+		{
+			printf ("portal:%4i  mightsee:%4i  cansee:%4i  (%i left)\n",
+				(int)(p - portals), p->nummightsee, p->numcansee, portalsleft);
 		}
-	} while (1);
-
-	printf ("Completed %s: %i\n", __thisfunc__, (int)(intptr_t)junk);
+	}
+	ThreadUnlock ();
 }
 
 /*
@@ -488,7 +660,8 @@ CalcPortalVis
 */
 static void CalcPortalVis (void)
 {
-	int		i;
+	int		i, j, count, numwork;
+	portal_t	*p, **sorted;
 
 // fastvis just uses mightsee for a very loose bound
 	if (fastvis)
@@ -501,9 +674,60 @@ static void CalcPortalVis (void)
 		return;
 	}
 
-	leafon = 0;
+	for (i = 0 ; i < numportals*2 ; i++)
+		portals[i].visbits = (byte *) SafeMalloc (bitbytes);
+
+	if (resume)
+		LoadCheckpoint ();
+	OpenCheckpoint ();
+
+// sort the portals that are left, least complex first
+	sorted = (portal_t **) SafeMalloc (numportals*2 * sizeof(portal_t *));
+	for (i = 0, count = 0 ; i < numportals*2 ; i++)
+	{
+		if (portals[i].status != stat_done)
+			sorted[count++] = &portals[i];
+	}
+	qsort (sorted, count, sizeof(portal_t *), PortalCompare);
+
+	flowsleft = (int *) SafeMalloc (numportals*2 * sizeof(int));
+	for (i = 0, numwork = 0 ; i < count ; i++)
+		numwork += leafs[sorted[i]->leaf].numportals;
+	flowwork = (flowwork_t *) SafeMalloc (numwork * sizeof(flowwork_t) + 1);
+
+	portalsleft = count;
+	for (i = 0, numwork = 0 ; i < count ; i++)
+	{
+		p = sorted[i];
+		p->status = stat_working;
+		flowsleft[p - portals] = leafs[p->leaf].numportals;
+		for (j = 0 ; j < leafs[p->leaf].numportals ; j++, numwork++)
+		{
+			flowwork[numwork].portal = p;
+			flowwork[numwork].exitnum = j;
+		}
+		if (!leafs[p->leaf].numportals)
+		{	// can't flow anywhere, only sees its own leaf
+			p->visbits[p->leaf>>3] |= 1<<(p->leaf&7);
+			p->numcansee = 1;
+			p->status = stat_done;
+			SaveCheckpoint (p);
+			portalsleft--;
+		}
+	}
+	free (sorted);
+
+	printf ("%i portals to flow in %i pieces\n", portalsleft, numwork);
 
-	RunThreadsOn (LeafThread);
+	for (i = 0 ; i < MAX_THREADS ; i++)
+		threadvis[i] = (byte *) SafeMalloc (bitbytes);
+
+	RunWorkOn (numwork, FlowWork);
+
+	for (i = 0 ; i < MAX_THREADS ; i++)
+		free (threadvis[i]);
+	free (flowwork);
+	free (flowsleft);
 
 	if (verbose)
 	{
@@ -685,6 +909,15 @@ sep_t *Findpassages (winding_t *source, winding_t *pass)
 
 //=============================================================================
 
+static unsigned int Checksum (unsigned int sum, const void *data, size_t len)
+{
+	const byte	*b = (const byte *)data;
+
+	while (len--)
+		sum = (sum ^ *b++) * 16777619;
+	return sum;
+}
+
 /*
 ============
 LoadPortals
@@ -731,6 +964,7 @@ static void LoadPortals (char *name)
 	leafs = (leaf_t *) SafeMalloc(portalleafs * sizeof(leaf_t));
 
 	originalvismapsize = portalleafs*((portalleafs+7)/8);
+	portalsum = 2166136261U;
 
 	vismap = vismap_p = dvisdata;
 	vismap_end = vismap + MAX_MAP_VISIBILITY;
@@ -754,6 +988,8 @@ static void LoadPortals (char *name)
 					&w->points[j][0], &w->points[j][1], &w->points[j][2]) != 3)
 				COM_Error ("%s: reading portal %i", __thisfunc__, i);
 		}
+		portalsum = Checksum (portalsum, leafnums, sizeof(leafnums));
+		portalsum = Checksum (portalsum, w->points, numpoints * sizeof(w->points[0]));
 		j += fscanf (f, "\n");  /* dummy assigmnent to j to silence -Wunused-result. */
 
 	// calc plane
@@ -838,6 +1074,11 @@ int main (int argc, char **argv)
 			printf ("verbose = true\n");
 			verbose = true;
 		}
+		else if (!strcmp(argv[i], "-resume"))
+		{
+			printf ("resume = true\n");
+			resume = true;
+		}
 		else if (argv[i][0] == '-')
 			COM_Error ("Unknown option \"%s\"", argv[i]);
 		else
@@ -845,7 +1086,7 @@ int main (int argc, char **argv)
 	}
 
 	if (i != argc - 1)
-		COM_Error ("usage: vis [-nogil] [-threads #] [-level 0-4] [-fast] [-v] bspfile");
+		COM_Error ("usage: vis [-nogil] [-threads #] [-level 0-4] [-fast] [-resume] [-v] bspfile");
 
 	InitThreads (wantthreads, 0);
 
@@ -861,6 +1102,10 @@ int main (int argc, char **argv)
 	StripExtension (portalfile);
 	strcat (portalfile, ".prt");
 
+	strcpy (checkpointfile, argv[i]);
+	StripExtension (checkpointfile);
+	strcat (checkpointfile, ".vck");
+
 	LoadPortals (portalfile);
 
 	uncompressed = (byte *) SafeMalloc(bitbytes*portalleafs);
@@ -878,6 +1123,7 @@ int main (int argc, char **argv)
 		CalcAmbientSounds2 ();
 
 	WriteBSPFile (source, is_bsp2);
+	CloseCheckpoint ();
 
 //	Q_unlink (portalfile);
 	if (GilMode)
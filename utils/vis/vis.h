@@ -124,7 +124,7 @@ extern	int			GilMode;
 
 void	PrintStats(void);
 void	BasePortalVis (void);
-void	PortalFlow (portal_t *p);
+void	PortalFlow (portal_t *p, int exitnum, byte *leafvis);
 void	CalcAmbientSounds (void);
 void	CalcAmbientSounds2(void);
 winding_t	*NewWinding (int points);